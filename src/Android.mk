@@ -52,7 +52,8 @@ COMMON_SRC_FILES += \
 	Reactor/Routine.cpp \
 	Reactor/Debug.cpp \
 	Reactor/DebugAndroid.cpp \
-	Reactor/ExecutableMemory.cpp
+	Reactor/ExecutableMemory.cpp \
+	Reactor/Profiler.cpp
 
 COMMON_SRC_FILES += \
 	Reactor/LLVMReactor.cpp \
@@ -104,6 +104,25 @@ namespace sw
 		return buffer;
 	}
 
+	bool Resource::attemptLock(Accessor claimer)
+	{
+		criticalSection.lock();
+
+		if(count > 0 && accessor != claimer)
+		{
+			criticalSection.unlock();
+
+			return false;
+		}
+
+		accessor = claimer;
+		count++;
+
+		criticalSection.unlock();
+
+		return true;
+	}
+
 	void Resource::unlock()
 	{
 		criticalSection.lock();
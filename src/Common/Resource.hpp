@@ -36,6 +36,7 @@ namespace sw
 
 		void *lock(Accessor claimer);
 		void *lock(Accessor relinquisher, Accessor claimer);
+		bool attemptLock(Accessor claimer);   // Locks only if lock() wouldn't have to wait
 		void unlock();
 		void unlock(Accessor relinquisher);
 
@@ -0,0 +1,1598 @@
+// Copyright 2019 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ASTC_Decoder.hpp"
+
+#include "System/CPUID.hpp"
+
+#if defined(__i386__) || defined(__x86_64__)
+	#include <emmintrin.h>
+#endif
+
+#include <stdint.h>
+#include <string.h>
+
+// See the ASTC chapter of the Khronos Data Format Specification for the encoding
+namespace
+{
+	enum
+	{
+		MAX_WEIGHTS = 64,         // Of both planes of the weight grid
+		MAX_TEXELS = 216,         // Of a 6x6x6 block
+		MAX_COLOR_VALUES = 18,
+		MIN_WEIGHT_BITS = 24,
+		MAX_WEIGHT_BITS = 96,
+		RANGE_6 = 4,              // Smallest range of color values
+	};
+
+	// Integer sequence encoding ranges, in the order of their encoding in the block mode
+	// and of the selection of the color value range
+	struct Range
+	{
+		int trits;
+		int quints;
+		int bits;
+	};
+
+	const Range ranges[21] =
+	{
+		{0, 0, 1},   // 2
+		{1, 0, 0},   // 3
+		{0, 0, 2},   // 4
+		{0, 1, 0},   // 5
+		{1, 0, 1},   // 6
+		{0, 0, 3},   // 8
+		{0, 1, 1},   // 10
+		{1, 0, 2},   // 12
+		{0, 0, 4},   // 16
+		{0, 1, 2},   // 20
+		{1, 0, 3},   // 24
+		{0, 0, 5},   // 32
+		{0, 1, 3},   // 40
+		{1, 0, 4},   // 48
+		{0, 0, 6},   // 64
+		{0, 1, 4},   // 80
+		{1, 0, 5},   // 96
+		{0, 0, 7},   // 128
+		{0, 1, 5},   // 160
+		{1, 0, 6},   // 192
+		{0, 0, 8},   // 256
+	};
+
+	inline int clamp(int value, int min, int max)
+	{
+		return (value < min) ? min : ((value > max) ? max : value);
+	}
+
+	int iseBitCount(int count, int range)
+	{
+		const Range &r = ranges[range];
+
+		return count * r.bits + (r.trits ? (8 * count + 4) / 5 : 0) + (r.quints ? (7 * count + 2) / 3 : 0);
+	}
+
+	uint64_t reverseBits(uint64_t x)
+	{
+		x = ((x >> 1) & 0x5555555555555555ull) | ((x & 0x5555555555555555ull) << 1);
+		x = ((x >> 2) & 0x3333333333333333ull) | ((x & 0x3333333333333333ull) << 2);
+		x = ((x >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((x & 0x0F0F0F0F0F0F0F0Full) << 4);
+		x = ((x >> 8) & 0x00FF00FF00FF00FFull) | ((x & 0x00FF00FF00FF00FFull) << 8);
+		x = ((x >> 16) & 0x0000FFFF0000FFFFull) | ((x & 0x0000FFFF0000FFFFull) << 16);
+
+		return (x >> 32) | (x << 32);
+	}
+
+	struct Block
+	{
+		Block(const unsigned char *source)
+		{
+			memcpy(data, source, sizeof(data));
+		}
+
+		unsigned int bits(int offset, int count) const
+		{
+			if(offset >= 128)
+			{
+				return 0;
+			}
+
+			uint64_t value = data[offset >> 6] >> (offset & 63);
+
+			if(offset > 0 && offset < 64)
+			{
+				value |= data[1] << (64 - offset);
+			}
+
+			return (unsigned int)value & ((1u << count) - 1);
+		}
+
+		// Clears the bits from the given offset onwards, which integer sequences read as zero
+		void truncate(int end)
+		{
+			if(end < 64)
+			{
+				data[0] &= (1ull << end) - 1;
+				data[1] = 0;
+			}
+			else if(end < 128)
+			{
+				data[1] &= (1ull << (end - 64)) - 1;
+			}
+		}
+
+		// Weights are stored from the top of the block downwards
+		Block reversed() const
+		{
+			Block block = *this;
+			block.data[0] = reverseBits(data[1]);
+			block.data[1] = reverseBits(data[0]);
+
+			return block;
+		}
+
+		uint64_t data[2];
+	};
+
+	void decodeTrits(unsigned int T, int t[5])
+	{
+		unsigned int C;
+
+		if(((T >> 2) & 7) == 7)
+		{
+			C = ((T >> 3) & 0x1C) | (T & 3);
+			t[4] = 2;
+			t[3] = 2;
+		}
+		else
+		{
+			C = T & 0x1F;
+
+			if(((T >> 5) & 3) == 3)
+			{
+				t[4] = 2;
+				t[3] = (T >> 7) & 1;
+			}
+			else
+			{
+				t[4] = (T >> 7) & 1;
+				t[3] = (T >> 5) & 3;
+			}
+		}
+
+		if((C & 3) == 3)
+		{
+			t[2] = 2;
+			t[1] = (C >> 4) & 1;
+			t[0] = (((C >> 3) & 1) << 1) | ((C >> 2) & ~(C >> 3) & 1);
+		}
+		else if(((C >> 2) & 3) == 3)
+		{
+			t[2] = 2;
+			t[1] = 2;
+			t[0] = C & 3;
+		}
+		else
+		{
+			t[2] = (C >> 4) & 1;
+			t[1] = (C >> 2) & 3;
+			t[0] = (C & 2) | (C & ~(C >> 1) & 1);
+		}
+	}
+
+	void decodeQuints(unsigned int Q, int q[3])
+	{
+		if(((Q >> 1) & 3) == 3 && ((Q >> 5) & 3) == 0)
+		{
+			q[2] = ((Q & 1) << 2) | (((Q >> 4) & ~Q & 1) << 1) | ((Q >> 3) & ~Q & 1);
+			q[1] = 4;
+			q[0] = 4;
+		}
+		else
+		{
+			unsigned int C;
+
+			if(((Q >> 1) & 3) == 3)
+			{
+				q[2] = 4;
+				C = (((Q >> 3) & 3) << 3) | ((~Q >> 4) & 6) | (Q & 1);
+			}
+			else
+			{
+				q[2] = (Q >> 5) & 3;
+				C = Q & 0x1F;
+			}
+
+			if((C & 7) == 5)
+			{
+				q[1] = 4;
+				q[0] = (C >> 3) & 3;
+			}
+			else
+			{
+				q[1] = (C >> 3) & 3;
+				q[0] = C & 7;
+			}
+		}
+	}
+
+	void decodeIntegerSequence(const Block &block, int offset, int count, int range, int *values)
+	{
+		const Range &r = ranges[range];
+		int b = r.bits;
+
+		if(r.trits)
+		{
+			static const int tritBits[5] = {2, 2, 1, 2, 1};
+
+			for(int i = 0; i < count; i += 5)
+			{
+				int m[5];
+				int t[5];
+				unsigned int T = 0;
+
+				for(int j = 0, shift = 0; j < 5; j++)
+				{
+					m[j] = block.bits(offset, b);
+					offset += b;
+					T |= block.bits(offset, tritBits[j]) << shift;
+					offset += tritBits[j];
+					shift += tritBits[j];
+				}
+
+				decodeTrits(T, t);
+
+				for(int j = 0; j < 5 && i + j < count; j++)
+				{
+					values[i + j] = (t[j] << b) | m[j];
+				}
+			}
+		}
+		else if(r.quints)
+		{
+			static const int quintBits[3] = {3, 2, 2};
+
+			for(int i = 0; i < count; i += 3)
+			{
+				int m[3];
+				int q[3];
+				unsigned int Q = 0;
+
+				for(int j = 0, shift = 0; j < 3; j++)
+				{
+					m[j] = block.bits(offset, b);
+					offset += b;
+					Q |= block.bits(offset, quintBits[j]) << shift;
+					offset += quintBits[j];
+					shift += quintBits[j];
+				}
+
+				decodeQuints(Q, q);
+
+				for(int j = 0; j < 3 && i + j < count; j++)
+				{
+					values[i + j] = (q[j] << b) | m[j];
+				}
+			}
+		}
+		else
+		{
+			for(int i = 0; i < count; i++, offset += b)
+			{
+				values[i] = block.bits(offset, b);
+			}
+		}
+	}
+
+	// Maps encoded values of each range to colors in [0, 255] and weights in [0, 64]
+	struct Unquantization
+	{
+		Unquantization()
+		{
+			memset(color, 0, sizeof(color));
+			memset(weight, 0, sizeof(weight));
+
+			for(int range = 0; range < 21; range++)
+			{
+				const Range &r = ranges[range];
+				int levels = (r.trits ? 3 : (r.quints ? 5 : 1)) << r.bits;
+
+				for(int value = 0; value < levels; value++)
+				{
+					color[range][value] = unquantizeColor(r, value);
+
+					if(range < 12)
+					{
+						weight[range][value] = unquantizeWeight(r, value);
+					}
+				}
+			}
+		}
+
+		static unsigned char unquantizeColor(const Range &r, int value)
+		{
+			int m = value & ((1 << r.bits) - 1);
+			int D = value >> r.bits;
+
+			if(!r.trits && !r.quints)   // Bit replication
+			{
+				int c = m << (8 - r.bits);
+
+				for(int shift = r.bits; shift < 8; shift += r.bits)
+				{
+					c |= c >> shift;
+				}
+
+				return (unsigned char)c;
+			}
+
+			if(r.bits == 0)   // Not a valid color range
+			{
+				return (unsigned char)(D * 255 / (r.trits ? 2 : 4));
+			}
+
+			int a = m & 1, b = (m >> 1) & 1, c = (m >> 2) & 1, d = (m >> 3) & 1, e = (m >> 4) & 1, f = (m >> 5) & 1;
+			int A = a ? 0x1FF : 0;
+			int B = 0;
+			int C = 0;
+
+			if(r.trits)
+			{
+				switch(r.bits)
+				{
+				case 1: C = 204;                                                                   break;
+				case 2: C = 93; B = b * 0x116;                                                     break;
+				case 3: C = 44; B = c * 0x10A + b * 0x085;                                         break;
+				case 4: C = 22; B = d * 0x104 + c * 0x082 + b * 0x041;                             break;
+				case 5: C = 11; B = e * 0x102 + d * 0x081 + c * 0x040 + b * 0x020;                 break;
+				case 6: C = 5;  B = f * 0x101 + e * 0x080 + d * 0x040 + c * 0x020 + b * 0x010;     break;
+				}
+			}
+			else
+			{
+				switch(r.bits)
+				{
+				case 1: C = 113;                                                                   break;
+				case 2: C = 54; B = b * 0x10C;                                                     break;
+				case 3: C = 26; B = c * 0x105 + b * 0x082;                                         break;
+				case 4: C = 13; B = d * 0x102 + c * 0x081 + b * 0x040;                             break;
+				case 5: C = 6;  B = e * 0x101 + d * 0x080 + c * 0x040 + b * 0x020;                 break;
+				}
+			}
+
+			int T = (D * C + B) ^ A;
+
+			return (unsigned char)((A & 0x80) | (T >> 2));
+		}
+
+		static unsigned char unquantizeWeight(const Range &r, int value)
+		{
+			int m = value & ((1 << r.bits) - 1);
+			int D = value >> r.bits;
+			int T;
+
+			if(!r.trits && !r.quints)   // Bit replication
+			{
+				T = m << (6 - r.bits);
+
+				for(int shift = r.bits; shift < 6; shift += r.bits)
+				{
+					T |= T >> shift;
+				}
+			}
+			else if(r.bits == 0)
+			{
+				return (unsigned char)(D * 64 / (r.trits ? 2 : 4));
+			}
+			else
+			{
+				int a = m & 1, b = (m >> 1) & 1, c = (m >> 2) & 1;
+				int A = a ? 0x7F : 0;
+				int B = 0;
+				int C = 0;
+
+				if(r.trits)
+				{
+					switch(r.bits)
+					{
+					case 1: C = 50;                           break;
+					case 2: C = 23; B = b * 0x45;             break;
+					case 3: C = 11; B = c * 0x42 + b * 0x21;  break;
+					}
+				}
+				else
+				{
+					switch(r.bits)
+					{
+					case 1: C = 28;                           break;
+					case 2: C = 13; B = b * 0x42;             break;
+					}
+				}
+
+				T = (D * C + B) ^ A;
+				T = (A & 0x20) | (T >> 2);
+			}
+
+			return (unsigned char)((T > 32) ? T + 1 : T);
+		}
+
+		unsigned char color[21][256];
+		unsigned char weight[12][32];
+	};
+
+	const Unquantization &unquantization()
+	{
+		static const Unquantization tables;
+
+		return tables;
+	}
+
+	struct BlockMode
+	{
+		int width;    // Of the weight grid
+		int height;
+		int depth;
+		bool dualPlane;
+		int weightRange;
+	};
+
+	bool decodeBlockMode2D(int mode, BlockMode &blockMode)
+	{
+		int R = (mode >> 4) & 1;
+		int H = (mode >> 9) & 1;
+		int D = (mode >> 10) & 1;
+		int A = (mode >> 5) & 3;
+
+		if((mode & 3) != 0)
+		{
+			int B = (mode >> 7) & 3;
+			R |= (mode & 3) << 1;
+
+			switch((mode >> 2) & 3)
+			{
+			case 0: blockMode.width = B + 4; blockMode.height = A + 2; break;
+			case 1: blockMode.width = B + 8; blockMode.height = A + 2; break;
+			case 2: blockMode.width = A + 2; blockMode.height = B + 8; break;
+			case 3:
+				if(mode & 0x100)
+				{
+					blockMode.width = (B & 1) + 2;
+					blockMode.height = A + 2;
+				}
+				else
+				{
+					blockMode.width = A + 2;
+					blockMode.height = (B & 1) + 6;
+				}
+				break;
+			}
+		}
+		else
+		{
+			int B = (mode >> 9) & 3;
+			R |= ((mode >> 2) & 3) << 1;
+
+			if(((mode >> 2) & 3) == 0)
+			{
+				return false;   // Reserved
+			}
+
+			switch((mode >> 7) & 3)
+			{
+			case 0: blockMode.width = 12;    blockMode.height = A + 2; break;
+			case 1: blockMode.width = A + 2; blockMode.height = 12;    break;
+			case 2: blockMode.width = A + 6; blockMode.height = B + 6; D = 0; H = 0; break;
+			case 3:
+				switch(A)
+				{
+				case 0:  blockMode.width = 6;  blockMode.height = 10; break;
+				case 1:  blockMode.width = 10; blockMode.height = 6;  break;
+				default: return false;   // Reserved
+				}
+				break;
+			}
+		}
+
+		blockMode.depth = 1;
+		blockMode.dualPlane = (D != 0);
+		blockMode.weightRange = (R - 2) + 6 * H;
+
+		return true;
+	}
+
+	bool decodeBlockMode3D(int mode, BlockMode &blockMode)
+	{
+		int R = (mode >> 4) & 1;
+		int H = (mode >> 9) & 1;
+		int D = (mode >> 10) & 1;
+		int A = (mode >> 5) & 3;
+
+		if((mode & 3) != 0)
+		{
+			R |= (mode & 3) << 1;
+			blockMode.width = A + 2;
+			blockMode.height = ((mode >> 7) & 3) + 2;
+			blockMode.depth = ((mode >> 2) & 3) + 2;
+		}
+		else
+		{
+			int B = (mode >> 9) & 3;
+			R |= ((mode >> 2) & 3) << 1;
+
+			if(((mode >> 2) & 3) == 0)
+			{
+				return false;   // Reserved
+			}
+
+			if(((mode >> 7) & 3) != 3)
+			{
+				D = 0;
+				H = 0;
+			}
+
+			switch((mode >> 7) & 3)
+			{
+			case 0: blockMode.width = 6;     blockMode.height = B + 2; blockMode.depth = A + 2; break;
+			case 1: blockMode.width = A + 2; blockMode.height = 6;     blockMode.depth = B + 2; break;
+			case 2: blockMode.width = A + 2; blockMode.height = B + 2; blockMode.depth = 6;     break;
+			case 3:
+				blockMode.width = 2;
+				blockMode.height = 2;
+				blockMode.depth = 2;
+
+				switch(A)
+				{
+				case 0:  blockMode.width = 6;  break;
+				case 1:  blockMode.height = 6; break;
+				case 2:  blockMode.depth = 6;  break;
+				default: return false;   // Reserved
+				}
+				break;
+			}
+		}
+
+		blockMode.dualPlane = (D != 0);
+		blockMode.weightRange = (R - 2) + 6 * H;
+
+		return true;
+	}
+
+	// Endpoint components are 16-bit UNORM values, or for HDR components, 12-bit logarithmic values shifted left by 4
+	struct Endpoints
+	{
+		int e0[4];
+		int e1[4];
+		bool hdr[4];
+	};
+
+	void bitTransferSigned(int &a, int &b)
+	{
+		b = (b >> 1) | (a & 0x80);
+		a = (a >> 1) & 0x3F;
+
+		if(a & 0x20)
+		{
+			a -= 0x40;
+		}
+	}
+
+	void set(int e[4], int r, int g, int b, int a)
+	{
+		e[0] = r;
+		e[1] = g;
+		e[2] = b;
+		e[3] = a;
+	}
+
+	void blueContract(int e[4], int r, int g, int b, int a)
+	{
+		set(e, (r + b) >> 1, (g + b) >> 1, b, a);
+	}
+
+	void hdrLuminanceLargeRange(const int *v, int e0[4], int e1[4])
+	{
+		int y0, y1;
+
+		if(v[1] >= v[0])
+		{
+			y0 = v[0] << 4;
+			y1 = v[1] << 4;
+		}
+		else
+		{
+			y0 = (v[1] << 4) + 8;
+			y1 = (v[0] << 4) - 8;
+		}
+
+		set(e0, y0 << 4, y0 << 4, y0 << 4, 0x7800);
+		set(e1, y1 << 4, y1 << 4, y1 << 4, 0x7800);
+	}
+
+	void hdrLuminanceSmallRange(const int *v, int e0[4], int e1[4])
+	{
+		int y0, y1;
+
+		if(v[0] & 0x80)
+		{
+			y0 = ((v[1] & 0xE0) << 4) | ((v[0] & 0x7F) << 2);
+			y1 = (v[1] & 0x1F) << 2;
+		}
+		else
+		{
+			y0 = ((v[1] & 0xF0) << 4) | ((v[0] & 0x7F) << 1);
+			y1 = (v[1] & 0x0F) << 1;
+		}
+
+		y1 = clamp(y0 + y1, 0, 0xFFF);
+
+		set(e0, y0 << 4, y0 << 4, y0 << 4, 0x7800);
+		set(e1, y1 << 4, y1 << 4, y1 << 4, 0x7800);
+	}
+
+	void hdrRGBScale(const int *v, int e0[4], int e1[4])
+	{
+		int modeValue = ((v[0] & 0xC0) >> 6) | ((v[1] & 0x80) >> 5) | ((v[2] & 0x80) >> 4);
+		int majorComponent;
+		int mode;
+
+		if((modeValue & 0xC) != 0xC)
+		{
+			majorComponent = modeValue >> 2;
+			mode = modeValue & 3;
+		}
+		else if(modeValue != 0xF)
+		{
+			majorComponent = modeValue & 3;
+			mode = 4;
+		}
+		else
+		{
+			majorComponent = 0;
+			mode = 5;
+		}
+
+		int red = v[0] & 0x3F;
+		int green = v[1] & 0x1F;
+		int blue = v[2] & 0x1F;
+		int scale = v[3] & 0x1F;
+
+		int x0 = (v[1] >> 6) & 1;
+		int x1 = (v[1] >> 5) & 1;
+		int x2 = (v[2] >> 6) & 1;
+		int x3 = (v[2] >> 5) & 1;
+		int x4 = (v[3] >> 7) & 1;
+		int x5 = (v[3] >> 6) & 1;
+		int x6 = (v[3] >> 5) & 1;
+
+		// The variable bits are placed according to the mode
+		int ohm = 1 << mode;
+
+		if(ohm & 0x30) green |= x0 << 6;
+		if(ohm & 0x3A) green |= x1 << 5;
+		if(ohm & 0x30) blue |= x2 << 6;
+		if(ohm & 0x3A) blue |= x3 << 5;
+
+		if(ohm & 0x3D) scale |= x6 << 5;
+		if(ohm & 0x2D) scale |= x5 << 6;
+		if(ohm & 0x04) scale |= x4 << 7;
+
+		if(ohm & 0x3B) red |= x4 << 6;
+		if(ohm & 0x04) red |= x3 << 6;
+
+		if(ohm & 0x10) red |= x5 << 7;
+		if(ohm & 0x0F) red |= x2 << 7;
+
+		if(ohm & 0x05) red |= x1 << 8;
+		if(ohm & 0x0A) red |= x0 << 8;
+
+		if(ohm & 0x05) red |= x0 << 9;
+		if(ohm & 0x02) red |= x6 << 9;
+
+		if(ohm & 0x01) red |= x3 << 10;
+		if(ohm & 0x02) red |= x5 << 10;
+
+		static const int shifts[6] = {1, 1, 2, 3, 4, 5};
+		int shift = shifts[mode];
+
+		red <<= shift;
+		green <<= shift;
+		blue <<= shift;
+		scale <<= shift;
+
+		if(mode != 5)   // Green and blue are differences
+		{
+			green = red - green;
+			blue = red - blue;
+		}
+
+		if(majorComponent == 1)
+		{
+			int temp = red; red = green; green = temp;
+		}
+		else if(majorComponent == 2)
+		{
+			int temp = red; red = blue; blue = temp;
+		}
+
+		set(e0, clamp(red - scale, 0, 0xFFF) << 4, clamp(green - scale, 0, 0xFFF) << 4, clamp(blue - scale, 0, 0xFFF) << 4, 0x7800);
+		set(e1, clamp(red, 0, 0xFFF) << 4, clamp(green, 0, 0xFFF) << 4, clamp(blue, 0, 0xFFF) << 4, 0x7800);
+	}
+
+	void hdrRGB(const int *v, int e0[4], int e1[4])
+	{
+		int majorComponent = ((v[4] & 0x80) >> 7) | ((v[5] & 0x80) >> 6);
+
+		if(majorComponent == 3)
+		{
+			set(e0, v[0] << 8, v[2] << 8, (v[4] & 0x7F) << 9, 0x7800);
+			set(e1, v[1] << 8, v[3] << 8, (v[5] & 0x7F) << 9, 0x7800);
+
+			return;
+		}
+
+		int modeValue = ((v[1] & 0x80) >> 7) | ((v[2] & 0x80) >> 6) | ((v[3] & 0x80) >> 5);
+
+		int a = v[0] | ((v[1] & 0x40) << 2);
+		int b0 = v[2] & 0x3F;
+		int b1 = v[3] & 0x3F;
+		int c = v[1] & 0x3F;
+		int d0 = v[4] & 0x1F;
+		int d1 = v[5] & 0x1F;
+
+		int x0 = (v[2] >> 6) & 1;
+		int x1 = (v[3] >> 6) & 1;
+		int x2 = (v[4] >> 6) & 1;
+		int x3 = (v[5] >> 6) & 1;
+		int x4 = (v[4] >> 5) & 1;
+		int x5 = (v[5] >> 5) & 1;
+
+		// The variable bits are placed according to the mode
+		int ohm = 1 << modeValue;
+
+		if(ohm & 0xA4) a |= x0 << 9;
+		if(ohm & 0x08) a |= x2 << 9;
+		if(ohm & 0x50) a |= x4 << 9;
+
+		if(ohm & 0x50) a |= x5 << 10;
+		if(ohm & 0xA0) a |= x1 << 10;
+
+		if(ohm & 0xC0) a |= x2 << 11;
+
+		if(ohm & 0x04) c |= x1 << 6;
+		if(ohm & 0xE8) c |= x3 << 6;
+
+		if(ohm & 0x20) c |= x2 << 7;
+
+		if(ohm & 0x5B)
+		{
+			b0 |= x0 << 6;
+			b1 |= x1 << 6;
+		}
+
+		if(ohm & 0x12)
+		{
+			b0 |= x2 << 7;
+			b1 |= x3 << 7;
+		}
+
+		if(ohm & 0xAF)
+		{
+			d0 |= x4 << 5;
+			d1 |= x5 << 5;
+		}
+
+		if(ohm & 0x05)
+		{
+			d0 |= x2 << 6;
+			d1 |= x3 << 6;
+		}
+
+		// Sign extend the d values
+		static const int dBits[8] = {7, 6, 7, 6, 5, 6, 5, 6};
+		int signBit = 1 << (dBits[modeValue] - 1);
+
+		d0 = (d0 ^ signBit) - signBit;
+		d1 = (d1 ^ signBit) - signBit;
+
+		int shift = (modeValue >> 1) ^ 3;
+
+		a <<= shift;
+		b0 <<= shift;
+		b1 <<= shift;
+		c <<= shift;
+		d0 <<= shift;
+		d1 <<= shift;
+
+		int red1 = clamp(a, 0, 0xFFF);
+		int green1 = clamp(a - b0, 0, 0xFFF);
+		int blue1 = clamp(a - b1, 0, 0xFFF);
+		int red0 = clamp(a - c, 0, 0xFFF);
+		int green0 = clamp(a - b0 - c - d0, 0, 0xFFF);
+		int blue0 = clamp(a - b1 - c - d1, 0, 0xFFF);
+
+		if(majorComponent == 1)
+		{
+			int temp0 = red0; red0 = green0; green0 = temp0;
+			int temp1 = red1; red1 = green1; green1 = temp1;
+		}
+		else if(majorComponent == 2)
+		{
+			int temp0 = red0; red0 = blue0; blue0 = temp0;
+			int temp1 = red1; red1 = blue1; blue1 = temp1;
+		}
+
+		set(e0, red0 << 4, green0 << 4, blue0 << 4, 0x7800);
+		set(e1, red1 << 4, green1 << 4, blue1 << 4, 0x7800);
+	}
+
+	void hdrAlpha(int v6, int v7, int &a0, int &a1)
+	{
+		int selector = ((v6 >> 7) & 1) | ((v7 >> 6) & 2);
+
+		v6 &= 0x7F;
+		v7 &= 0x7F;
+
+		if(selector == 3)
+		{
+			a0 = v6 << 5;
+			a1 = v7 << 5;
+		}
+		else
+		{
+			v6 |= (v7 << (selector + 1)) & 0x780;
+			v7 &= 0x3F >> selector;
+			v7 ^= 0x20 >> selector;
+			v7 -= 0x20 >> selector;
+			v6 <<= 4 - selector;
+			v7 <<= 4 - selector;
+
+			a0 = v6;
+			a1 = clamp(v6 + v7, 0, 0xFFF);
+		}
+
+		a0 <<= 4;
+		a1 <<= 4;
+	}
+
+	// Returns false for HDR endpoints of sRGB images
+	bool decodeEndpoints(int mode, int *v, Endpoints &endpoints, bool isSRGB)
+	{
+		int *e0 = endpoints.e0;
+		int *e1 = endpoints.e1;
+		bool hdrColor = false;
+		bool hdrA = false;
+
+		switch(mode)
+		{
+		case 0:   // LDR luminance, direct
+			set(e0, v[0], v[0], v[0], 0xFF);
+			set(e1, v[1], v[1], v[1], 0xFF);
+			break;
+		case 1:   // LDR luminance, base + offset
+			{
+				int l0 = (v[0] >> 2) | (v[1] & 0xC0);
+				int l1 = clamp(l0 + (v[1] & 0x3F), 0, 0xFF);
+
+				set(e0, l0, l0, l0, 0xFF);
+				set(e1, l1, l1, l1, 0xFF);
+			}
+			break;
+		case 2:   // HDR luminance, large range
+			hdrLuminanceLargeRange(v, e0, e1);
+			hdrColor = hdrA = true;
+			break;
+		case 3:   // HDR luminance, small range
+			hdrLuminanceSmallRange(v, e0, e1);
+			hdrColor = hdrA = true;
+			break;
+		case 4:   // LDR luminance + alpha, direct
+			set(e0, v[0], v[0], v[0], v[2]);
+			set(e1, v[1], v[1], v[1], v[3]);
+			break;
+		case 5:   // LDR luminance + alpha, base + offset
+			bitTransferSigned(v[1], v[0]);
+			bitTransferSigned(v[3], v[2]);
+			set(e0, v[0], v[0], v[0], v[2]);
+			set(e1, v[0] + v[1], v[0] + v[1], v[0] + v[1], v[2] + v[3]);
+			break;
+		case 6:   // LDR RGB, base + scale
+			set(e0, (v[0] * v[3]) >> 8, (v[1] * v[3]) >> 8, (v[2] * v[3]) >> 8, 0xFF);
+			set(e1, v[0], v[1], v[2], 0xFF);
+			break;
+		case 7:   // HDR RGB, base + scale
+			hdrRGBScale(v, e0, e1);
+			hdrColor = hdrA = true;
+			break;
+		case 8:   // LDR RGB, direct
+			if(v[1] + v[3] + v[5] >= v[0] + v[2] + v[4])
+			{
+				set(e0, v[0], v[2], v[4], 0xFF);
+				set(e1, v[1], v[3], v[5], 0xFF);
+			}
+			else
+			{
+				blueContract(e0, v[1], v[3], v[5], 0xFF);
+				blueContract(e1, v[0], v[2], v[4], 0xFF);
+			}
+			break;
+		case 9:   // LDR RGB, base + offset
+			bitTransferSigned(v[1], v[0]);
+			bitTransferSigned(v[3], v[2]);
+			bitTransferSigned(v[5], v[4]);
+
+			if(v[1] + v[3] + v[5] >= 0)
+			{
+				set(e0, v[0], v[2], v[4], 0xFF);
+				set(e1, v[0] + v[1], v[2] + v[3], v[4] + v[5], 0xFF);
+			}
+			else
+			{
+				blueContract(e0, v[0] + v[1], v[2] + v[3], v[4] + v[5], 0xFF);
+				blueContract(e1, v[0], v[2], v[4], 0xFF);
+			}
+			break;
+		case 10:   // LDR RGB, base + scale plus two alpha
+			set(e0, (v[0] * v[3]) >> 8, (v[1] * v[3]) >> 8, (v[2] * v[3]) >> 8, v[4]);
+			set(e1, v[0], v[1], v[2], v[5]);
+			break;
+		case 11:   // HDR RGB, direct
+			hdrRGB(v, e0, e1);
+			hdrColor = hdrA = true;
+			break;
+		case 12:   // LDR RGBA, direct
+			if(v[1] + v[3] + v[5] >= v[0] + v[2] + v[4])
+			{
+				set(e0, v[0], v[2], v[4], v[6]);
+				set(e1, v[1], v[3], v[5], v[7]);
+			}
+			else
+			{
+				blueContract(e0, v[1], v[3], v[5], v[7]);
+				blueContract(e1, v[0], v[2], v[4], v[6]);
+			}
+			break;
+		case 13:   // LDR RGBA, base + offset
+			bitTransferSigned(v[1], v[0]);
+			bitTransferSigned(v[3], v[2]);
+			bitTransferSigned(v[5], v[4]);
+			bitTransferSigned(v[7], v[6]);
+
+			if(v[1] + v[3] + v[5] >= 0)
+			{
+				set(e0, v[0], v[2], v[4], v[6]);
+				set(e1, v[0] + v[1], v[2] + v[3], v[4] + v[5], v[6] + v[7]);
+			}
+			else
+			{
+				blueContract(e0, v[0] + v[1], v[2] + v[3], v[4] + v[5], v[6] + v[7]);
+				blueContract(e1, v[0], v[2], v[4], v[6]);
+			}
+			break;
+		case 14:   // HDR RGB, direct plus LDR alpha
+			hdrRGB(v, e0, e1);
+			e0[3] = v[6];
+			e1[3] = v[7];
+			hdrColor = true;
+			break;
+		case 15:   // HDR RGB, direct plus HDR alpha
+			hdrRGB(v, e0, e1);
+			hdrAlpha(v[6], v[7], e0[3], e1[3]);
+			hdrColor = hdrA = true;
+			break;
+		}
+
+		if(isSRGB && (hdrColor || hdrA))
+		{
+			return false;
+		}
+
+		for(int c = 0; c < 4; c++)
+		{
+			bool hdr = (c < 3) ? hdrColor : hdrA;
+			endpoints.hdr[c] = hdr;
+
+			if(!hdr)
+			{
+				int c0 = clamp(e0[c], 0, 0xFF);
+				int c1 = clamp(e1[c], 0, 0xFF);
+
+				// sRGB color components are expanded such that the top 8 bits of the interpolated values are output
+				if(isSRGB && c < 3)
+				{
+					e0[c] = (c0 << 8) | 0x80;
+					e1[c] = (c1 << 8) | 0x80;
+				}
+				else
+				{
+					e0[c] = c0 * 257;
+					e1[c] = c1 * 257;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	unsigned int hash52(unsigned int p)
+	{
+		p ^= p >> 15;
+		p -= p << 17;
+		p += p << 7;
+		p += p << 4;
+		p ^= p >> 5;
+		p += p << 16;
+		p ^= p >> 7;
+		p ^= p >> 3;
+		p ^= p << 6;
+		p ^= p >> 17;
+
+		return p;
+	}
+
+	int selectPartition(int seed, int x, int y, int z, int partitionCount, bool smallBlock)
+	{
+		if(smallBlock)
+		{
+			x <<= 1;
+			y <<= 1;
+			z <<= 1;
+		}
+
+		seed += (partitionCount - 1) * 1024;
+
+		unsigned int rnum = hash52(seed);
+		unsigned int seeds[12] =
+		{
+			rnum & 0xF, (rnum >> 4) & 0xF, (rnum >> 8) & 0xF, (rnum >> 12) & 0xF,
+			(rnum >> 16) & 0xF, (rnum >> 20) & 0xF, (rnum >> 24) & 0xF, (rnum >> 28) & 0xF,
+			(rnum >> 18) & 0xF, (rnum >> 22) & 0xF, (rnum >> 26) & 0xF, ((rnum >> 30) | (rnum << 2)) & 0xF,
+		};
+
+		int sh1, sh2;
+
+		if(seed & 1)
+		{
+			sh1 = (seed & 2) ? 4 : 5;
+			sh2 = (partitionCount == 3) ? 6 : 5;
+		}
+		else
+		{
+			sh1 = (partitionCount == 3) ? 6 : 5;
+			sh2 = (seed & 2) ? 4 : 5;
+		}
+
+		int sh3 = (seed & 0x10) ? sh1 : sh2;
+
+		for(int i = 0; i < 12; i++)
+		{
+			seeds[i] = (seeds[i] * seeds[i]) >> ((i >= 8) ? sh3 : ((i & 1) ? sh2 : sh1));
+		}
+
+		unsigned int a = (seeds[0] * x + seeds[1] * y + seeds[10] * z + (rnum >> 14)) & 0x3F;
+		unsigned int b = (seeds[2] * x + seeds[3] * y + seeds[11] * z + (rnum >> 10)) & 0x3F;
+		unsigned int c = (seeds[4] * x + seeds[5] * y + seeds[8] * z + (rnum >> 6)) & 0x3F;
+		unsigned int d = (seeds[6] * x + seeds[7] * y + seeds[9] * z + (rnum >> 2)) & 0x3F;
+
+		if(partitionCount < 4) d = 0;
+		if(partitionCount < 3) c = 0;
+
+		if(a >= b && a >= c && a >= d) return 0;
+		else if(b >= c && b >= d) return 1;
+		else if(c >= d) return 2;
+		else return 3;
+	}
+
+	inline int gridWeight(const int *grid, int count, int index)
+	{
+		return (index < count) ? grid[index] : 0;   // Beyond the edge only with a zero contribution
+	}
+
+	// Interpolates the weights of the grid at the texels of the block, bilinearly in 2D and over simplices in 3D
+	void infillWeights(const int *grid, const BlockMode &mode, int xBlockSize, int yBlockSize, int zBlockSize, int *weights)
+	{
+		int N = mode.width;
+		int M = mode.height;
+		int count = mode.width * mode.height * mode.depth;
+
+		int Ds = (1024 + xBlockSize / 2) / (xBlockSize - 1);
+		int Dt = (1024 + yBlockSize / 2) / (yBlockSize - 1);
+		int Dr = (zBlockSize > 1) ? (1024 + zBlockSize / 2) / (zBlockSize - 1) : 0;
+
+		for(int r = 0; r < zBlockSize; r++)
+		{
+			int gr = (Dr * r * (mode.depth - 1) + 32) >> 6;
+			int jr = gr >> 4;
+			int fr = gr & 0xF;
+
+			for(int t = 0; t < yBlockSize; t++)
+			{
+				int gt = (Dt * t * (M - 1) + 32) >> 6;
+				int jt = gt >> 4;
+				int ft = gt & 0xF;
+
+				for(int s = 0; s < xBlockSize; s++)
+				{
+					int gs = (Ds * s * (N - 1) + 32) >> 6;
+					int js = gs >> 4;
+					int fs = gs & 0xF;
+
+					int v0 = js + jt * N + jr * N * M;
+					int P;
+
+					if(zBlockSize == 1)
+					{
+						int w11 = (fs * ft + 8) >> 4;
+						int w10 = ft - w11;
+						int w01 = fs - w11;
+						int w00 = 16 - fs - ft + w11;
+
+						P = gridWeight(grid, count, v0) * w00 + gridWeight(grid, count, v0 + 1) * w01 +
+						    gridWeight(grid, count, v0 + N) * w10 + gridWeight(grid, count, v0 + N + 1) * w11;
+					}
+					else
+					{
+						int s1, s2, w0, w1, w2, w3;
+
+						if(fs > ft)
+						{
+							if(ft > fr)      { s1 = 1;     s2 = N;     w0 = 16 - fs; w1 = fs - ft; w2 = ft - fr; w3 = fr; }
+							else if(fs > fr) { s1 = 1;     s2 = N * M; w0 = 16 - fs; w1 = fs - fr; w2 = fr - ft; w3 = ft; }
+							else             { s1 = N * M; s2 = 1;     w0 = 16 - fr; w1 = fr - fs; w2 = fs - ft; w3 = ft; }
+						}
+						else
+						{
+							if(fs > fr)      { s1 = N;     s2 = 1;     w0 = 16 - ft; w1 = ft - fs; w2 = fs - fr; w3 = fr; }
+							else if(ft > fr) { s1 = N;     s2 = N * M; w0 = 16 - ft; w1 = ft - fr; w2 = fr - fs; w3 = fs; }
+							else             { s1 = N * M; s2 = N;     w0 = 16 - fr; w1 = fr - ft; w2 = ft - fs; w3 = fs; }
+						}
+
+						P = gridWeight(grid, count, v0) * w0 + gridWeight(grid, count, v0 + s1) * w1 +
+						    gridWeight(grid, count, v0 + s1 + s2) * w2 + gridWeight(grid, count, v0 + N * M + N + 1) * w3;
+					}
+
+					*weights++ = (P + 8) >> 4;
+				}
+			}
+		}
+	}
+
+	float halfToFloat(unsigned int h)
+	{
+		unsigned int sign = (h & 0x8000) << 16;
+		unsigned int exponent = (h >> 10) & 0x1F;
+		unsigned int mantissa = h & 0x3FF;
+		float f;
+
+		if(exponent == 0)   // Zero or denormal
+		{
+			f = (float)mantissa * (1.0f / 16777216.0f);
+			return sign ? -f : f;
+		}
+
+		unsigned int bits = sign | (mantissa << 13) | ((exponent == 0x1F) ? 0x7F800000 : ((exponent + 112) << 23));
+		memcpy(&f, &bits, sizeof(f));
+
+		return f;
+	}
+
+	// Converts an interpolated 16-bit logarithmic value to half-precision floating-point
+	unsigned int lnsToHalf(int C)
+	{
+		int E = (C >> 11) & 0x1F;
+		int M = C & 0x7FF;
+		int Mt;
+
+		if(M < 512)
+		{
+			Mt = 3 * M;
+		}
+		else if(M >= 1536)
+		{
+			Mt = 5 * M - 2048;
+		}
+		else
+		{
+			Mt = 4 * M - 512;
+		}
+
+		int Cf = (E << 10) + (Mt >> 3);
+
+		return (Cf < 0x7BFF) ? Cf : 0x7BFF;
+	}
+
+	void writeTexel(unsigned char *texel, const int C[4], const bool hdr[4], bool isSRGB)
+	{
+		if(isSRGB)
+		{
+			texel[0] = (unsigned char)(C[2] >> 8);
+			texel[1] = (unsigned char)(C[1] >> 8);
+			texel[2] = (unsigned char)(C[0] >> 8);
+			texel[3] = (unsigned char)(C[3] >> 8);
+		}
+		else
+		{
+			float *rgba = reinterpret_cast<float*>(texel);
+
+			for(int c = 0; c < 4; c++)
+			{
+				rgba[c] = hdr[c] ? halfToFloat(lnsToHalf(C[c])) : (float)C[c] * (1.0f / 65535.0f);
+			}
+		}
+	}
+
+	void writeBlock(unsigned char *dest, int pitch, int slice, int width, int height, int depth, const int C[4], const bool hdr[4], bool isSRGB)
+	{
+		int bytes = isSRGB ? 4 : 16;
+
+		for(int z = 0; z < depth; z++)
+		{
+			for(int y = 0; y < height; y++)
+			{
+				for(int x = 0; x < width; x++)
+				{
+					writeTexel(dest + z * slice + y * pitch + x * bytes, C, hdr, isSRGB);
+				}
+			}
+		}
+	}
+
+	void writeError(unsigned char *dest, int pitch, int slice, int width, int height, int depth, bool isSRGB)
+	{
+		static const int magenta[4] = {0xFFFF, 0, 0xFFFF, 0xFFFF};
+		static const bool ldr[4] = {false, false, false, false};
+
+		writeBlock(dest, pitch, slice, width, height, depth, magenta, ldr, isSRGB);
+	}
+
+	void decodeVoidExtent(const Block &block, unsigned char *dest, int pitch, int slice, int width, int height, int depth, bool is3D, bool isSRGB)
+	{
+		bool hdr = block.bits(9, 1) != 0;
+		bool valid;
+
+		if(!is3D)
+		{
+			unsigned int s0 = block.bits(12, 13), s1 = block.bits(25, 13);
+			unsigned int t0 = block.bits(38, 13), t1 = block.bits(51, 13);
+			bool allOnes = (s0 & s1 & t0 & t1) == 0x1FFF;
+
+			valid = (block.bits(10, 2) == 3) && (allOnes || (s0 < s1 && t0 < t1));
+		}
+		else
+		{
+			unsigned int s0 = block.bits(10, 9), s1 = block.bits(19, 9);
+			unsigned int t0 = block.bits(28, 9), t1 = block.bits(37, 9);
+			unsigned int r0 = block.bits(46, 9), r1 = block.bits(55, 9);
+			bool allOnes = (s0 & s1 & t0 & t1 & r0 & r1) == 0x1FF;
+
+			valid = allOnes || (s0 < s1 && t0 < t1 && r0 < r1);
+		}
+
+		if(!valid || (hdr && isSRGB))
+		{
+			writeError(dest, pitch, slice, width, height, depth, isSRGB);
+			return;
+		}
+
+		if(hdr)
+		{
+			float rgba[4];
+
+			for(int c = 0; c < 4; c++)
+			{
+				rgba[c] = halfToFloat(block.bits(64 + 16 * c, 16));
+			}
+
+			for(int z = 0; z < depth; z++)
+			{
+				for(int y = 0; y < height; y++)
+				{
+					for(int x = 0; x < width; x++)
+					{
+						memcpy(dest + z * slice + y * pitch + x * 16, rgba, sizeof(rgba));
+					}
+				}
+			}
+		}
+		else
+		{
+			int C[4] = {(int)block.bits(64, 16), (int)block.bits(80, 16), (int)block.bits(96, 16), (int)block.bits(112, 16)};
+			static const bool ldr[4] = {false, false, false, false};
+
+			writeBlock(dest, pitch, slice, width, height, depth, C, ldr, isSRGB);
+		}
+	}
+
+	void decodeBlock(const unsigned char *source, unsigned char *dest, int pitch, int slice, int xBlockSize, int yBlockSize, int zBlockSize,
+	                 int width, int height, int depth, bool isSRGB)
+	{
+		const Unquantization &tables = unquantization();
+		Block block(source);
+		bool is3D = (zBlockSize > 1);
+
+		int mode = block.bits(0, 11);
+
+		if((mode & 0x1FF) == 0x1FC)
+		{
+			decodeVoidExtent(block, dest, pitch, slice, width, height, depth, is3D, isSRGB);
+			return;
+		}
+
+		BlockMode blockMode;
+
+		if(!(is3D ? decodeBlockMode3D(mode, blockMode) : decodeBlockMode2D(mode, blockMode)) ||
+		   blockMode.width > xBlockSize || blockMode.height > yBlockSize || blockMode.depth > zBlockSize)
+		{
+			writeError(dest, pitch, slice, width, height, depth, isSRGB);
+			return;
+		}
+
+		int partitions = block.bits(11, 2) + 1;
+		int planes = blockMode.dualPlane ? 2 : 1;
+		int gridSize = blockMode.width * blockMode.height * blockMode.depth;
+		int weightCount = gridSize * planes;
+		int weightBits = iseBitCount(weightCount, blockMode.weightRange);
+
+		if(weightCount > MAX_WEIGHTS || weightBits < MIN_WEIGHT_BITS || weightBits > MAX_WEIGHT_BITS ||
+		   (partitions == 4 && blockMode.dualPlane))
+		{
+			writeError(dest, pitch, slice, width, height, depth, isSRGB);
+			return;
+		}
+
+		int colorEndpointModes[4];
+		int seed = 0;
+		int colorOffset = 17;
+		int belowWeights = 128 - weightBits;
+
+		if(partitions == 1)
+		{
+			colorEndpointModes[0] = block.bits(13, 4);
+		}
+		else
+		{
+			seed = block.bits(13, 10);
+			colorOffset = 29;
+
+			int selector = block.bits(23, 6);
+
+			if((selector & 3) == 0)   // All partitions use the same mode
+			{
+				for(int i = 0; i < partitions; i++)
+				{
+					colorEndpointModes[i] = selector >> 2;
+				}
+			}
+			else   // Mode classes and modes of each partition, partly stored below the weights
+			{
+				int extraBits = 3 * partitions - 4;
+				belowWeights -= extraBits;
+
+				int modes = (selector >> 2) | (block.bits(belowWeights, extraBits) << 4);
+				int baseClass = (selector & 3) - 1;
+
+				for(int i = 0; i < partitions; i++)
+				{
+					int modeClass = baseClass + ((modes >> i) & 1);
+
+					colorEndpointModes[i] = (modeClass << 2) | ((modes >> (partitions + 2 * i)) & 3);
+				}
+			}
+		}
+
+		int colorEnd = belowWeights;
+		int planeComponent = -1;
+
+		if(blockMode.dualPlane)
+		{
+			colorEnd -= 2;
+			planeComponent = block.bits(colorEnd, 2);
+		}
+
+		int colorValueCount = 0;
+
+		for(int i = 0; i < partitions; i++)
+		{
+			colorValueCount += 2 * (colorEndpointModes[i] >> 2) + 2;
+		}
+
+		// The color values use the largest range which fits the remaining bits
+		int colorRange = 20;
+
+		while(colorRange >= RANGE_6 && iseBitCount(colorValueCount, colorRange) > colorEnd - colorOffset)
+		{
+			colorRange--;
+		}
+
+		if(colorValueCount > MAX_COLOR_VALUES || colorRange < RANGE_6)
+		{
+			writeError(dest, pitch, slice, width, height, depth, isSRGB);
+			return;
+		}
+
+		int colorValues[MAX_COLOR_VALUES];
+		Block colorData = block;
+		colorData.truncate(colorOffset + iseBitCount(colorValueCount, colorRange));
+		decodeIntegerSequence(colorData, colorOffset, colorValueCount, colorRange, colorValues);
+
+		Endpoints endpoints[4];
+
+		for(int i = 0, v = 0; i < partitions; i++)
+		{
+			int *values = colorValues + v;
+			int count = 2 * (colorEndpointModes[i] >> 2) + 2;
+
+			for(int j = 0; j < count; j++)
+			{
+				values[j] = tables.color[colorRange][values[j]];
+			}
+
+			if(!decodeEndpoints(colorEndpointModes[i], values, endpoints[i], isSRGB))
+			{
+				writeError(dest, pitch, slice, width, height, depth, isSRGB);
+				return;
+			}
+
+			v += count;
+		}
+
+		int weightValues[MAX_WEIGHTS];
+		Block weightData = block.reversed();
+		weightData.truncate(weightBits);
+		decodeIntegerSequence(weightData, 0, weightCount, blockMode.weightRange, weightValues);
+
+		int texelWeights[2][MAX_TEXELS];
+
+		for(int p = 0; p < planes; p++)
+		{
+			int grid[MAX_WEIGHTS];
+
+			for(int i = 0; i < gridSize; i++)
+			{
+				grid[i] = tables.weight[blockMode.weightRange][weightValues[i * planes + p]];
+			}
+
+			infillWeights(grid, blockMode, xBlockSize, yBlockSize, zBlockSize, texelWeights[p]);
+		}
+
+		const int *plane1 = texelWeights[planes - 1];
+		bool smallBlock = (xBlockSize * yBlockSize * zBlockSize) < 31;
+		int bytes = isSRGB ? 4 : 16;
+
+		#if defined(__i386__) || defined(__x86_64__)
+			if(sw::CPUID::supportsSSE2())
+			{
+				// The endpoints of each component are interleaved and biased to signed 16-bit, so that a multiply-add
+				// with the complementary weights interpolates them with 32-bit precision.
+				__m128i interleaved[4];
+				bool ldrFloat[4];
+
+				for(int i = 0; i < partitions; i++)
+				{
+					const Endpoints &e = endpoints[i];
+
+					interleaved[i] = _mm_setr_epi16((short)(e.e0[0] - 0x8000), (short)(e.e1[0] - 0x8000), (short)(e.e0[1] - 0x8000), (short)(e.e1[1] - 0x8000),
+					                                (short)(e.e0[2] - 0x8000), (short)(e.e1[2] - 0x8000), (short)(e.e0[3] - 0x8000), (short)(e.e1[3] - 0x8000));
+					ldrFloat[i] = !isSRGB && !e.hdr[0] && !e.hdr[1] && !e.hdr[2] && !e.hdr[3];
+				}
+
+				__m128i planeMask = _mm_setzero_si128();
+
+				if(planeComponent >= 0)
+				{
+					int mask[4] = {0, 0, 0, 0};
+					mask[planeComponent] = -1;
+					planeMask = _mm_setr_epi32(mask[0], mask[1], mask[2], mask[3]);
+				}
+
+				const __m128i bias = _mm_set1_epi32(0x8000 * 64 + 32);
+				const __m128 scale = _mm_set1_ps(1.0f / 65535.0f);
+
+				for(int z = 0; z < depth; z++)
+				{
+					for(int y = 0; y < height; y++)
+					{
+						unsigned char *texel = dest + z * slice + y * pitch;
+						int t = (z * yBlockSize + y) * xBlockSize;
+
+						for(int x = 0; x < width; x++, t++, texel += bytes)
+						{
+							int p = (partitions > 1) ? selectPartition(seed, x, y, z, partitions, smallBlock) : 0;
+							int w0 = texelWeights[0][t];
+							int w1 = plane1[t];
+
+							__m128i weights0 = _mm_set1_epi32((w0 << 16) | (64 - w0));
+							__m128i weights1 = _mm_set1_epi32((w1 << 16) | (64 - w1));
+							__m128i weights = _mm_or_si128(_mm_andnot_si128(planeMask, weights0), _mm_and_si128(planeMask, weights1));
+							__m128i C = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(interleaved[p], weights), bias), 6);
+
+							if(isSRGB)
+							{
+								C = _mm_shuffle_epi32(_mm_srli_epi32(C, 8), 0xC6);   // BGRA
+								C = _mm_packs_epi32(C, C);
+								*(int*)texel = _mm_cvtsi128_si32(_mm_packus_epi16(C, C));
+							}
+							else if(ldrFloat[p])
+							{
+								_mm_storeu_ps((float*)texel, _mm_mul_ps(_mm_cvtepi32_ps(C), scale));
+							}
+							else
+							{
+								int c[4];
+								_mm_storeu_si128((__m128i*)c, C);
+								writeTexel(texel, c, endpoints[p].hdr, isSRGB);
+							}
+						}
+					}
+				}
+
+				return;
+			}
+		#endif
+
+		for(int z = 0; z < depth; z++)
+		{
+			for(int y = 0; y < height; y++)
+			{
+				unsigned char *texel = dest + z * slice + y * pitch;
+				int t = (z * yBlockSize + y) * xBlockSize;
+
+				for(int x = 0; x < width; x++, t++, texel += bytes)
+				{
+					int p = (partitions > 1) ? selectPartition(seed, x, y, z, partitions, smallBlock) : 0;
+					const Endpoints &e = endpoints[p];
+					int C[4];
+
+					for(int c = 0; c < 4; c++)
+					{
+						int w = (c == planeComponent) ? plane1[t] : texelWeights[0][t];
+
+						C[c] = (e.e0[c] * (64 - w) + e.e1[c] * w + 32) >> 6;
+					}
+
+					writeTexel(texel, C, e.hdr, isSRGB);
+				}
+			}
+		}
+	}
+}
+
+void ASTC_Decoder::Decode(const unsigned char *src, unsigned char *dst, int w, int h, int dstW, int dstH, int dstD, int dstPitch, int dstSlice,
+                          int xBlockSize, int yBlockSize, int zBlockSize, bool isSRGB, int firstRow, int rows)
+{
+	int xBlocks = (w + xBlockSize - 1) / xBlockSize;
+	int yBlocks = (h + yBlockSize - 1) / yBlockSize;
+	int bytes = isSRGB ? 4 : 16;
+
+	for(int row = firstRow; row < firstRow + rows; row++)
+	{
+		int y = (row % yBlocks) * yBlockSize;
+		int z = (row / yBlocks) * zBlockSize;
+
+		if(y >= dstH || z >= dstD)
+		{
+			continue;
+		}
+
+		const unsigned char *source = src + row * xBlocks * 16;
+		int height = (dstH - y < yBlockSize) ? dstH - y : yBlockSize;
+		int depth = (dstD - z < zBlockSize) ? dstD - z : zBlockSize;
+
+		for(int x = 0; x < w && x < dstW; x += xBlockSize, source += 16)
+		{
+			int width = (dstW - x < xBlockSize) ? dstW - x : xBlockSize;
+
+			decodeBlock(source, dst + z * dstSlice + y * dstPitch + x * bytes, dstPitch, dstSlice,
+			            xBlockSize, yBlockSize, zBlockSize, width, height, depth, isSRGB);
+		}
+	}
+}
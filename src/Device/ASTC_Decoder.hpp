@@ -0,0 +1,43 @@
+// Copyright 2019 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_ASTC_Decoder_hpp
+#define sw_ASTC_Decoder_hpp
+
+class ASTC_Decoder
+{
+public:
+	/// ASTC_Decoder::Decode - Decodes rows of 2D or 3D ASTC blocks. LDR and HDR blocks are output as
+	///                        RGBA 32 bit float. sRGB images only support LDR blocks, and are output as
+	///                        BGRA 8 bit, still sRGB encoded. Invalid blocks decode to magenta.
+	/// @param src            Pointer to the ASTC encoded image
+	/// @param dst            Pointer to the output image
+	/// @param w              src image width
+	/// @param h              src image height
+	/// @param dstW           dst image width
+	/// @param dstH           dst image height
+	/// @param dstD           dst image depth
+	/// @param dstPitch       dst image pitch (bytes per row)
+	/// @param dstSlice       dst image slice pitch (bytes per 2D slice)
+	/// @param xBlockSize     block footprint width
+	/// @param yBlockSize     block footprint height
+	/// @param zBlockSize     block footprint depth
+	/// @param isSRGB         src's color space
+	/// @param firstRow       first row of blocks to decode, counting through all layers of blocks
+	/// @param rows           number of rows of blocks to decode
+	static void Decode(const unsigned char *src, unsigned char *dst, int w, int h, int dstW, int dstH, int dstD, int dstPitch, int dstSlice,
+	                   int xBlockSize, int yBlockSize, int zBlockSize, bool isSRGB, int firstRow, int rows);
+};
+
+#endif   // sw_ASTC_Decoder_hpp
@@ -17,13 +17,28 @@
 #include "Pipeline/ShaderCore.hpp"
 #include "Reactor/Reactor.hpp"
 #include "System/Memory.hpp"
+#include "System/Thread.hpp"
 #include "Vulkan/VkDebug.hpp"
 
+#include <vector>
+
 namespace sw
 {
+	bool precacheBlit = false;
+
+	extern AtomicInt threadCount;
+
+	struct Blitter::BlitTask
+	{
+		void (*function)(const BlitData *data);
+		std::vector<BlitData> rects;
+		int bandHeight;
+		int bands;
+	};
+
 	Blitter::Blitter()
 	{
-		blitCache = new RoutineCache<State>(1024);
+		blitCache = new RoutineCache<State>(1024, precacheBlit ? "sw-blit" : 0);
 	}
 
 	Blitter::~Blitter()
@@ -33,14 +48,30 @@ namespace sw
 
 	void Blitter::clear(void *pixel, VkFormat format, Surface *dest, const SliceRect &dRect, unsigned int rgbaMask)
 	{
-		if(fastClear(pixel, format, dest, dRect, rgbaMask))
+		clear(pixel, format, dest, &dRect, 1, rgbaMask);
+	}
+
+	void Blitter::clear(void *pixel, VkFormat format, Surface *dest, const SliceRect *dRects, int count, unsigned int rgbaMask)
+	{
+		if(count <= 0)
+		{
+			return;
+		}
+
+		// Fast clears only depend on the formats and mask, so either all rectangles take them or none
+		if(fastClear(pixel, format, dest, dRects[0], rgbaMask))
 		{
+			for(int i = 1; i < count; i++)
+			{
+				fastClear(pixel, format, dest, dRects[i], rgbaMask);
+			}
+
 			return;
 		}
 
 		sw::Surface *color = sw::Surface::create(1, 1, 1, format, pixel, sw::Surface::bytes(format), sw::Surface::bytes(format));
-		SliceRectF sRect(0.5f, 0.5f, 0.5f, 0.5f, 0);   // Sample from the middle.
-		blit(color, sRect, dest, dRect, {rgbaMask});
+		std::vector<SliceRectF> sRects(count, SliceRectF(0.5f, 0.5f, 0.5f, 0.5f, 0));   // Sample from the middle.
+		blit(color, sRects.data(), dest, dRects, count, {rgbaMask});
 		delete color;
 	}
 
@@ -143,7 +174,7 @@ namespace sw
 			return;
 		}
 
-		if(blitReactor(source, sourceRect, dest, destRect, options))
+		if(blitReactor(source, &sourceRect, dest, &destRect, 1, options))
 		{
 			return;
 		}
@@ -191,6 +222,24 @@ namespace sw
 		dest->unlockInternal();
 	}
 
+	void Blitter::blit(Surface *source, const SliceRectF *sourceRects, Surface *dest, const SliceRect *destRects, int count, const Blitter::Options& options)
+	{
+		if(dest->getInternalFormat() == VK_FORMAT_UNDEFINED || count <= 0)
+		{
+			return;
+		}
+
+		if(blitReactor(source, sourceRects, dest, destRects, count, options))
+		{
+			return;
+		}
+
+		for(int i = 0; i < count; i++)
+		{
+			blit(source, sourceRects[i], dest, destRects[i], options);
+		}
+	}
+
 	void Blitter::blit3D(Surface *source, Surface *dest)
 	{
 		source->lockInternal(0, 0, 0, sw::LOCK_READONLY, sw::PUBLIC);
@@ -1625,31 +1674,64 @@ namespace sw
 			}
 		}
 
-		return function("BlitRoutine");
+		return function("BlitRoutine_%0.8X", (unsigned int)FNV_1a(reinterpret_cast<const unsigned char*>(&state), sizeof(State)));
 	}
 
-	bool Blitter::blitReactor(Surface *source, const SliceRectF &sourceRect, Surface *dest, const SliceRect &destRect, const Blitter::Options &options)
+	Routine *Blitter::getRoutine(const State &state)
 	{
-		ASSERT(!options.clearOperation || ((source->getWidth() == 1) && (source->getHeight() == 1) && (source->getDepth() == 1)));
+		criticalSection.lock();
+		Routine *blitRoutine = blitCache->query(state);
+		criticalSection.unlock();
 
-		Rect dRect = destRect;
-		RectF sRect = sourceRect;
-		if(destRect.x0 > destRect.x1)
-		{
-			swap(dRect.x0, dRect.x1);
-			swap(sRect.x0, sRect.x1);
-		}
-		if(destRect.y0 > destRect.y1)
+		if(!blitRoutine)
 		{
-			swap(dRect.y0, dRect.y1);
-			swap(sRect.y0, sRect.y1);
+			// Load or generate outside of the critical section, so blits with other states can proceed
+			Routine *generatedRoutine = blitCache->load(state);
+
+			if(!generatedRoutine)
+			{
+				generatedRoutine = generate(state);
+
+				if(!generatedRoutine)
+				{
+					return nullptr;
+				}
+
+				blitCache->store(state, generatedRoutine);
+			}
+
+			criticalSection.lock();
+			blitRoutine = blitCache->query(state);
+
+			if(!blitRoutine)   // Not generated concurrently by another thread
+			{
+				blitRoutine = blitCache->add(state, generatedRoutine);
+			}
+			else
+			{
+				delete generatedRoutine;
+			}
+
+			criticalSection.unlock();
 		}
 
+		return blitRoutine;
+	}
+
+	bool Blitter::blitReactor(Surface *source, const SliceRectF *sourceRects, Surface *dest, const SliceRect *destRects, int count, const Blitter::Options &options)
+	{
+		ASSERT(!options.clearOperation || ((source->getWidth() == 1) && (source->getHeight() == 1) && (source->getDepth() == 1)));
+
 		State state(options);
-		state.clampToEdge = (sourceRect.x0 < 0.0f) ||
-		                    (sourceRect.y0 < 0.0f) ||
-		                    (sourceRect.x1 > (float)source->getWidth()) ||
-		                    (sourceRect.y1 > (float)source->getHeight());
+
+		for(int i = 0; i < count; i++)
+		{
+			state.clampToEdge = state.clampToEdge ||
+			                    (sourceRects[i].x0 < 0.0f) ||
+			                    (sourceRects[i].y0 < 0.0f) ||
+			                    (sourceRects[i].x1 > (float)source->getWidth()) ||
+			                    (sourceRects[i].y1 > (float)source->getHeight());
+		}
 
 		bool useSourceInternal = !source->isExternalDirty();
 		bool useDestInternal = !dest->isExternalDirty();
@@ -1659,53 +1741,83 @@ namespace sw
 		state.destFormat = isStencil ? dest->getStencilFormat() : dest->getFormat(useDestInternal);
 		state.destSamples = dest->getSamples();
 
-		criticalSection.lock();
-		Routine *blitRoutine = blitCache->query(state);
+		Routine *blitRoutine = getRoutine(state);
 
 		if(!blitRoutine)
 		{
-			blitRoutine = generate(state);
+			return false;
+		}
 
-			if(!blitRoutine)
-			{
-				criticalSection.unlock();
-				return false;
-			}
+		BlitTask task;
+		task.function = (void(*)(const BlitData*))blitRoutine->getEntry();
+		task.rects.resize(count);
+
+		bool isRGBA = options.writeMask == 0xF;
+		bool isEntireDest = false;
 
-			blitCache->add(state, blitRoutine);
+		for(int i = 0; i < count; i++)
+		{
+			isEntireDest = isEntireDest || dest->isEntire(destRects[i]);
 		}
 
-		criticalSection.unlock();
+		uint8_t *source0 = (uint8_t*)(isStencil ? source->lockStencil(0, 0, 0, sw::PUBLIC) :
+		                                          source->lock(0, 0, 0, sw::LOCK_READONLY, sw::PUBLIC, useSourceInternal));
+		uint8_t *dest0 = (uint8_t*)(isStencil ? dest->lockStencil(0, 0, 0, sw::PUBLIC) :
+		                                        dest->lock(0, 0, 0, isRGBA ? (isEntireDest ? sw::LOCK_DISCARD : sw::LOCK_WRITEONLY) : sw::LOCK_READWRITE, sw::PUBLIC, useDestInternal));
+		int sSliceB = isStencil ? 0 : source->getSliceB(useSourceInternal);   // Stencil is only blitted from and to the first slice
+		int dSliceB = isStencil ? dest->getStencilSliceB() : dest->getSliceB(useDestInternal);
+
+		uint64_t area = 0;
+		int height = 0;
+
+		for(int i = 0; i < count; i++)
+		{
+			Rect dRect = destRects[i];
+			RectF sRect = sourceRects[i];
+			if(destRects[i].x0 > destRects[i].x1)
+			{
+				swap(dRect.x0, dRect.x1);
+				swap(sRect.x0, sRect.x1);
+			}
+			if(destRects[i].y0 > destRects[i].y1)
+			{
+				swap(dRect.y0, dRect.y1);
+				swap(sRect.y0, sRect.y1);
+			}
 
-		void (*blitFunction)(const BlitData *data) = (void(*)(const BlitData*))blitRoutine->getEntry();
+			BlitData &data = task.rects[i];
 
-		BlitData data;
+			data.source = source0 + sourceRects[i].slice * sSliceB;
+			data.dest = dest0 + destRects[i].slice * (isStencil ? 0 : dSliceB);
+			data.sPitchB = isStencil ? source->getStencilPitchB() : source->getPitchB(useSourceInternal);
+			data.dPitchB = isStencil ? dest->getStencilPitchB() : dest->getPitchB(useDestInternal);
+			data.dSliceB = dSliceB;
 
-		bool isRGBA = options.writeMask == 0xF;
-		bool isEntireDest = dest->isEntire(destRect);
+			data.w = sRect.width() / dRect.width();
+			data.h = sRect.height() / dRect.height();
+			data.x0 = sRect.x0 + (0.5f - dRect.x0) * data.w;
+			data.y0 = sRect.y0 + (0.5f - dRect.y0) * data.h;
 
-		data.source = isStencil ? source->lockStencil(0, 0, 0, sw::PUBLIC) :
-		                          source->lock(0, 0, sourceRect.slice, sw::LOCK_READONLY, sw::PUBLIC, useSourceInternal);
-		data.dest = isStencil ? dest->lockStencil(0, 0, 0, sw::PUBLIC) :
-		                        dest->lock(0, 0, destRect.slice, isRGBA ? (isEntireDest ? sw::LOCK_DISCARD : sw::LOCK_WRITEONLY) : sw::LOCK_READWRITE, sw::PUBLIC, useDestInternal);
-		data.sPitchB = isStencil ? source->getStencilPitchB() : source->getPitchB(useSourceInternal);
-		data.dPitchB = isStencil ? dest->getStencilPitchB() : dest->getPitchB(useDestInternal);
-		data.dSliceB = isStencil ? dest->getStencilSliceB() : dest->getSliceB(useDestInternal);
+			data.x0d = dRect.x0;
+			data.x1d = dRect.x1;
+			data.y0d = dRect.y0;
+			data.y1d = dRect.y1;
 
-		data.w = sRect.width() / dRect.width();
-		data.h = sRect.height() / dRect.height();
-		data.x0 = sRect.x0 + (0.5f - dRect.x0) * data.w;
-		data.y0 = sRect.y0 + (0.5f - dRect.y0) * data.h;
+			data.sWidth = source->getWidth();
+			data.sHeight = source->getHeight();
 
-		data.x0d = dRect.x0;
-		data.x1d = dRect.x1;
-		data.y0d = dRect.y0;
-		data.y1d = dRect.y1;
+			area += (uint64_t)dRect.width() * dRect.height();
+			height = max(height, dRect.y1);
+		}
 
-		data.sWidth = source->getWidth();
-		data.sHeight = source->getHeight();
+		// Large batches are blitted by up to one thread per 64k texels. Each thread takes bands of
+		// destination rows through all rectangles in order, so overlapping blits keep their order.
+		int threads = min((int)threadCount, (int)min(area / 0x10000, (uint64_t)16));
 
-		blitFunction(&data);
+		task.bands = (threads > 1) ? 4 * threads : 1;
+		task.bandHeight = max((height + task.bands - 1) / task.bands, 1);
+
+		parallelRows(task.bands, threads, blitBand, &task);
 
 		if(isStencil)
 		{
@@ -1720,4 +1832,24 @@ namespace sw
 
 		return true;
 	}
+
+	void Blitter::blitBand(void *parameters, int band)
+	{
+		BlitTask *task = static_cast<BlitTask*>(parameters);
+
+		int y0 = band * task->bandHeight;
+		int y1 = y0 + task->bandHeight;
+
+		for(const BlitData &rect : task->rects)
+		{
+			BlitData data = rect;
+			data.y0d = max(rect.y0d, y0);
+			data.y1d = min(rect.y1d, y1);
+
+			if(data.y0d < data.y1d)
+			{
+				task->function(&data);
+			}
+		}
+	}
 }
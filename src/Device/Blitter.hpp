@@ -56,7 +56,17 @@ namespace sw
 		struct State : Options
 		{
 			State() = default;
-			State(const Options &options) : Options(options) {}
+			State(const Options &options)
+			{
+				memset(this, 0, sizeof(State));   // Padding is compared and stored by the routine caches
+
+				writeMask = options.writeMask;
+				clearOperation = options.clearOperation;
+				filter = options.filter;
+				useStencil = options.useStencil;
+				convertSRGB = options.convertSRGB;
+				clampToEdge = options.clampToEdge;
+			}
 
 			bool operator==(const State &state) const
 			{
@@ -95,10 +105,14 @@ namespace sw
 		virtual ~Blitter();
 
 		void clear(void *pixel, VkFormat format, Surface *dest, const SliceRect &dRect, unsigned int rgbaMask);
+		void clear(void *pixel, VkFormat format, Surface *dest, const SliceRect *dRects, int count, unsigned int rgbaMask);
 		void blit(Surface *source, const SliceRectF &sRect, Surface *dest, const SliceRect &dRect, const Options &options);
+		void blit(Surface *source, const SliceRectF *sRects, Surface *dest, const SliceRect *dRects, int count, const Options &options);   // In order, like separate calls
 		void blit3D(Surface *source, Surface *dest);
 
 	private:
+		struct BlitTask;
+
 		bool fastClear(void *pixel, VkFormat format, Surface *dest, const SliceRect &dRect, unsigned int rgbaMask);
 
 		bool read(Float4 &color, Pointer<Byte> element, const State &state);
@@ -110,7 +124,9 @@ namespace sw
 		static Int ComputeOffset(Int &x, Int &y, Int &pitchB, int bytes, bool quadLayout);
 		static Float4 LinearToSRGB(Float4 &color);
 		static Float4 sRGBtoLinear(Float4 &color);
-		bool blitReactor(Surface *source, const SliceRectF &sRect, Surface *dest, const SliceRect &dRect, const Options &options);
+		bool blitReactor(Surface *source, const SliceRectF *sRects, Surface *dest, const SliceRect *dRects, int count, const Options &options);
+		static void blitBand(void *parameters, int band);
+		Routine *getRoutine(const State &state);
 		Routine *generate(const State &state);
 
 		RoutineCache<State> *blitCache;
@@ -76,6 +76,8 @@ namespace sw
 	enum
 	{
 		OUTLINE_RESOLUTION = 8192,   // Maximum vertical resolution of the render target
+		ASTC_DECODE_CACHE_LEVELS = 16,              // Decoded ASTC levels kept for repeated uploads of the same blocks (0 disables caching)
+		ASTC_DECODE_CACHE_LEVEL_SIZE = 0x400000,    // Largest decoded ASTC level in bytes which gets cached
 		MIPMAP_LEVELS = 14,
 		TEXTURE_IMAGE_UNITS = 16,
 		VERTEX_TEXTURE_IMAGE_UNITS = 16,
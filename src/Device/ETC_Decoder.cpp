@@ -14,6 +14,14 @@
 
 #include "ETC_Decoder.hpp"
 
+#include "System/CPUID.hpp"
+
+#if defined(__i386__) || defined(__x86_64__)
+	#include <emmintrin.h>
+#endif
+
+#include <string.h>
+
 namespace
 {
 	inline int clampByte(int value)
@@ -21,11 +29,6 @@ namespace
 		return (value < 0) ? 0 : ((value > 255) ? 255 : value);
 	}
 
-	inline int clampSByte(int value)
-	{
-		return (value < -128) ? -128 : ((value > 127) ? 127 : value);
-	}
-
 	inline int clampEAC(int value, bool isSigned)
 	{
 		int min = isSigned ? -1023 : 0;
@@ -33,39 +36,6 @@ namespace
 		return (value < min) ? min : ((value > max) ? max : value);
 	}
 
-	struct bgra8
-	{
-		unsigned char b;
-		unsigned char g;
-		unsigned char r;
-		unsigned char a;
-
-		inline bgra8()
-		{
-		}
-
-		inline void set(int red, int green, int blue)
-		{
-			r = static_cast<unsigned char>(clampByte(red));
-			g = static_cast<unsigned char>(clampByte(green));
-			b = static_cast<unsigned char>(clampByte(blue));
-		}
-
-		inline void set(int red, int green, int blue, int alpha)
-		{
-			r = static_cast<unsigned char>(clampByte(red));
-			g = static_cast<unsigned char>(clampByte(green));
-			b = static_cast<unsigned char>(clampByte(blue));
-			a = static_cast<unsigned char>(clampByte(alpha));
-		}
-
-		const bgra8& addA(int alpha)
-		{
-			a = alpha;
-			return *this;
-		}
-	};
-
 	inline int extend_4to8bits(int x)
 	{
 		return (x << 4) | x;
@@ -86,62 +56,99 @@ namespace
 		return (x << 1) | (x >> 6);
 	}
 
+	// Clamps the components of four colors to bytes, and packs them as BGRA with opaque alpha
+	inline void packColors(unsigned int colors[4], const int r[4], const int g[4], const int b[4])
+	{
+		#if defined(__i386__) || defined(__x86_64__)
+			if(sw::CPUID::supportsSSE2())
+			{
+				__m128i c01 = _mm_setr_epi16(b[0], g[0], r[0], 255, b[1], g[1], r[1], 255);
+				__m128i c23 = _mm_setr_epi16(b[2], g[2], r[2], 255, b[3], g[3], r[3], 255);
+				_mm_storeu_si128((__m128i*)colors, _mm_packus_epi16(c01, c23));
+
+				return;
+			}
+		#endif
+
+		for(int i = 0; i < 4; i++)
+		{
+			colors[i] = clampByte(b[i]) | (clampByte(g[i]) << 8) | (clampByte(r[i]) << 16) | 0xFF000000;
+		}
+	}
+
+	// Writes the texels of a block which fall inside the image, from rows of 4 texels
+	inline void storeBlock(const void *texels, int texelBytes, unsigned char *dest, int x, int y, int w, int h, int pitch)
+	{
+		int width = (w - x < 4) ? (w - x) : 4;
+		int height = (h - y < 4) ? (h - y) : 4;
+
+		for(int j = 0; j < height; j++)
+		{
+			memcpy(dest, static_cast<const unsigned char*>(texels) + j * 4 * texelBytes, width * texelBytes);
+			dest += pitch;
+		}
+	}
+
 	struct ETC2
 	{
-		// Decodes unsigned single or dual channel block to bytes
-		static void DecodeBlock(const ETC2** sources, unsigned char *dest, int nbChannels, int x, int y, int w, int h, int pitch, bool isSigned, bool isEAC)
+		// Decodes the 16 values of a single channel block, in rows of 4. EAC blocks decode to 11 bit values, others to bytes.
+		void decodeSingleChannelBlock(int values[16], bool isSigned, bool isEAC) const
 		{
-			if(isEAC)
+			static const int modifierTable[16][8] = { { -3, -6, -9, -15, 2, 5, 8, 14 },
+			{ -3, -7, -10, -13, 2, 6, 9, 12 },
+			{ -2, -5, -8, -13, 1, 4, 7, 12 },
+			{ -2, -4, -6, -13, 1, 3, 5, 12 },
+			{ -3, -6, -8, -12, 2, 5, 7, 11 },
+			{ -3, -7, -9, -11, 2, 6, 8, 10 },
+			{ -4, -7, -8, -11, 3, 6, 7, 10 },
+			{ -3, -5, -8, -11, 2, 4, 7, 10 },
+			{ -2, -6, -8, -10, 1, 5, 7, 9 },
+			{ -2, -5, -8, -10, 1, 4, 7, 9 },
+			{ -2, -4, -8, -10, 1, 3, 7, 9 },
+			{ -2, -5, -7, -10, 1, 4, 6, 9 },
+			{ -3, -4, -7, -10, 2, 3, 6, 9 },
+			{ -1, -2, -3, -10, 0, 1, 2, 9 },
+			{ -4, -6, -8, -9, 3, 5, 7, 8 },
+			{ -3, -5, -7, -9, 2, 4, 6, 8 } };
+
+			const int *modifier = modifierTable[table_index];
+			int codeword = isSigned ? signed_base_codeword : base_codeword;
+			int lut[8];
+
+			// Only the 8 values selectable by the block's indices need to be computed
+			for(int i = 0; i < 8; i++)
 			{
-				for(int j = 0; j < 4 && (y + j) < h; j++)
+				if(isEAC)
 				{
-					int* sDst = reinterpret_cast<int*>(dest);
-					for(int i = 0; i < 4 && (x + i) < w; i++)
-					{
-						for(int c = nbChannels - 1; c >= 0; c--)
-						{
-							sDst[i * nbChannels + c] = clampEAC(sources[c]->getSingleChannel(i, j, isSigned, true), isSigned);
-						}
-					}
-					dest += pitch;
+					int scale = (multiplier == 0) ? 1 : (multiplier * 8);
+					lut[i] = clampEAC(codeword * 8 + 4 + modifier[i] * scale, isSigned);
 				}
-			}
-			else
-			{
-				if(isSigned)
+				else
 				{
-					signed char* sDst = reinterpret_cast<signed char*>(dest);
-					for(int j = 0; j < 4 && (y + j) < h; j++)
-					{
-						for(int i = 0; i < 4 && (x + i) < w; i++)
-						{
-							for(int c = nbChannels - 1; c >= 0; c--)
-							{
-								sDst[i * nbChannels + c] = clampSByte(sources[c]->getSingleChannel(i, j, isSigned, false));
-							}
-						}
-						sDst += pitch;
-					}
+					lut[i] = clampByte(codeword + modifier[i] * multiplier);
 				}
-				else
+			}
+
+			// 3 bit indices, in column-major order from the most significant bits of the last 6 bytes
+			const unsigned char *bytes = reinterpret_cast<const unsigned char*>(this);
+			unsigned long long indices = 0;
+
+			for(int i = 2; i < 8; i++)
+			{
+				indices = (indices << 8) | bytes[i];
+			}
+
+			for(int i = 0; i < 4; i++)
+			{
+				for(int j = 0; j < 4; j++)
 				{
-					for(int j = 0; j < 4 && (y + j) < h; j++)
-					{
-						for(int i = 0; i < 4 && (x + i) < w; i++)
-						{
-							for(int c = nbChannels - 1; c >= 0; c--)
-							{
-								dest[i * nbChannels + c] = clampByte(sources[c]->getSingleChannel(i, j, isSigned, false));
-							}
-						}
-						dest += pitch;
-					}
+					values[j * 4 + i] = lut[(indices >> (45 - 3 * (i * 4 + j))) & 7];
 				}
 			}
 		}
 
-		// Decodes RGB block to bgra8
-		void decodeBlock(unsigned char *dest, int x, int y, int w, int h, int pitch, unsigned char alphaValues[4][4], bool punchThroughAlpha) const
+		// Decodes an RGB block to rows of 4 BGRA texels, with opaque alpha or punch-through alpha
+		void decodeBlock(unsigned int texels[16], bool punchThroughAlpha) const
 		{
 			bool opaqueBit = diffbit;
 			bool nonOpaquePunchThroughAlpha = punchThroughAlpha && !opaqueBit;
@@ -154,24 +161,30 @@ namespace
 				int b = (B + dB);
 				if(r < 0 || r > 31)
 				{
-					decodeTBlock(dest, x, y, w, h, pitch, alphaValues, nonOpaquePunchThroughAlpha);
+					decodeTBlock(texels);
 				}
 				else if(g < 0 || g > 31)
 				{
-					decodeHBlock(dest, x, y, w, h, pitch, alphaValues, nonOpaquePunchThroughAlpha);
+					decodeHBlock(texels);
 				}
 				else if(b < 0 || b > 31)
 				{
-					decodePlanarBlock(dest, x, y, w, h, pitch, alphaValues);
+					decodePlanarBlock(texels);
+					return;   // Planar blocks are always opaque
 				}
 				else
 				{
-					decodeDifferentialBlock(dest, x, y, w, h, pitch, alphaValues, nonOpaquePunchThroughAlpha);
+					decodeDifferentialBlock(texels, nonOpaquePunchThroughAlpha);
 				}
 			}
 			else
 			{
-				decodeIndividualBlock(dest, x, y, w, h, pitch, alphaValues, nonOpaquePunchThroughAlpha);
+				decodeIndividualBlock(texels, nonOpaquePunchThroughAlpha);
+			}
+
+			if(nonOpaquePunchThroughAlpha)
+			{
+				decodePunchThroughAlpha(texels);
 			}
 		}
 
@@ -357,7 +370,8 @@ namespace
 			};
 		};
 
-		void decodeIndividualBlock(unsigned char *dest, int x, int y, int w, int h, int pitch, unsigned char alphaValues[4][4], bool nonOpaquePunchThroughAlpha) const
+
+		void decodeIndividualBlock(unsigned int texels[16], bool nonOpaquePunchThroughAlpha) const
 		{
 			int r1 = extend_4to8bits(R1);
 			int g1 = extend_4to8bits(G1);
@@ -367,10 +381,10 @@ namespace
 			int g2 = extend_4to8bits(G2);
 			int b2 = extend_4to8bits(B2);
 
-			decodeIndividualOrDifferentialBlock(dest, x, y, w, h, pitch, r1, g1, b1, r2, g2, b2, alphaValues, nonOpaquePunchThroughAlpha);
+			decodeIndividualOrDifferentialBlock(texels, r1, g1, b1, r2, g2, b2, nonOpaquePunchThroughAlpha);
 		}
 
-		void decodeDifferentialBlock(unsigned char *dest, int x, int y, int w, int h, int pitch, unsigned char alphaValues[4][4], bool nonOpaquePunchThroughAlpha) const
+		void decodeDifferentialBlock(unsigned int texels[16], bool nonOpaquePunchThroughAlpha) const
 		{
 			int b1 = extend_5to8bits(B);
 			int g1 = extend_5to8bits(G);
@@ -380,10 +394,10 @@ namespace
 			int g2 = extend_5to8bits(G + dG);
 			int b2 = extend_5to8bits(B + dB);
 
-			decodeIndividualOrDifferentialBlock(dest, x, y, w, h, pitch, r1, g1, b1, r2, g2, b2, alphaValues, nonOpaquePunchThroughAlpha);
+			decodeIndividualOrDifferentialBlock(texels, r1, g1, b1, r2, g2, b2, nonOpaquePunchThroughAlpha);
 		}
 
-		void decodeIndividualOrDifferentialBlock(unsigned char *dest, int x, int y, int w, int h, int pitch, int r1, int g1, int b1, int r2, int g2, int b2, unsigned char alphaValues[4][4], bool nonOpaquePunchThroughAlpha) const
+		void decodeIndividualOrDifferentialBlock(unsigned int texels[16], int r1, int g1, int b1, int r2, int g2, int b2, bool nonOpaquePunchThroughAlpha) const
 		{
 			// Table 3.17.2 sorted according to table 3.17.3
 			static const int intensityModifierDefault[8][4] =
@@ -413,79 +427,39 @@ namespace
 
 			const int(&intensityModifier)[8][4] = nonOpaquePunchThroughAlpha ? intensityModifierNonOpaque : intensityModifierDefault;
 
-			bgra8 subblockColors0[4];
-			bgra8 subblockColors1[4];
+			// Colors of the first subblock, followed by those of the second
+			unsigned int subblockColors[8];
 
-			const int i10 = intensityModifier[cw1][0];
-			const int i11 = intensityModifier[cw1][1];
-			const int i12 = intensityModifier[cw1][2];
-			const int i13 = intensityModifier[cw1][3];
+			const int *i1 = intensityModifier[cw1];
+			const int red1[4] = { r1 + i1[0], r1 + i1[1], r1 + i1[2], r1 + i1[3] };
+			const int green1[4] = { g1 + i1[0], g1 + i1[1], g1 + i1[2], g1 + i1[3] };
+			const int blue1[4] = { b1 + i1[0], b1 + i1[1], b1 + i1[2], b1 + i1[3] };
+			packColors(subblockColors, red1, green1, blue1);
 
-			subblockColors0[0].set(r1 + i10, g1 + i10, b1 + i10);
-			subblockColors0[1].set(r1 + i11, g1 + i11, b1 + i11);
-			subblockColors0[2].set(r1 + i12, g1 + i12, b1 + i12);
-			subblockColors0[3].set(r1 + i13, g1 + i13, b1 + i13);
+			const int *i2 = intensityModifier[cw2];
+			const int red2[4] = { r2 + i2[0], r2 + i2[1], r2 + i2[2], r2 + i2[3] };
+			const int green2[4] = { g2 + i2[0], g2 + i2[1], g2 + i2[2], g2 + i2[3] };
+			const int blue2[4] = { b2 + i2[0], b2 + i2[1], b2 + i2[2], b2 + i2[3] };
+			packColors(subblockColors + 4, red2, green2, blue2);
 
-			const int i20 = intensityModifier[cw2][0];
-			const int i21 = intensityModifier[cw2][1];
-			const int i22 = intensityModifier[cw2][2];
-			const int i23 = intensityModifier[cw2][3];
+			unsigned int msb = getIndexMSBs();
+			unsigned int lsb = getIndexLSBs();
 
-			subblockColors1[0].set(r2 + i20, g2 + i20, b2 + i20);
-			subblockColors1[1].set(r2 + i21, g2 + i21, b2 + i21);
-			subblockColors1[2].set(r2 + i22, g2 + i22, b2 + i22);
-			subblockColors1[3].set(r2 + i23, g2 + i23, b2 + i23);
-
-			unsigned char* destStart = dest;
-
-			if(flipbit)
+			for(int j = 0; j < 4; j++)
 			{
-				for(int j = 0; j < 2 && (y + j) < h; j++)
-				{
-					bgra8* color = (bgra8*)dest;
-					if((x + 0) < w) color[0] = subblockColors0[getIndex(0, j)].addA(alphaValues[j][0]);
-					if((x + 1) < w) color[1] = subblockColors0[getIndex(1, j)].addA(alphaValues[j][1]);
-					if((x + 2) < w) color[2] = subblockColors0[getIndex(2, j)].addA(alphaValues[j][2]);
-					if((x + 3) < w) color[3] = subblockColors0[getIndex(3, j)].addA(alphaValues[j][3]);
-					dest += pitch;
-				}
-
-				for(int j = 2; j < 4 && (y + j) < h; j++)
+				for(int i = 0; i < 4; i++)
 				{
-					bgra8* color = (bgra8*)dest;
-					if((x + 0) < w) color[0] = subblockColors1[getIndex(0, j)].addA(alphaValues[j][0]);
-					if((x + 1) < w) color[1] = subblockColors1[getIndex(1, j)].addA(alphaValues[j][1]);
-					if((x + 2) < w) color[2] = subblockColors1[getIndex(2, j)].addA(alphaValues[j][2]);
-					if((x + 3) < w) color[3] = subblockColors1[getIndex(3, j)].addA(alphaValues[j][3]);
-					dest += pitch;
+					int subblock = flipbit ? (j >> 1) : (i >> 1);
+					texels[j * 4 + i] = subblockColors[subblock * 4 + getIndex(msb, lsb, i, j)];
 				}
 			}
-			else
-			{
-				for(int j = 0; j < 4 && (y + j) < h; j++)
-				{
-					bgra8* color = (bgra8*)dest;
-					if((x + 0) < w) color[0] = subblockColors0[getIndex(0, j)].addA(alphaValues[j][0]);
-					if((x + 1) < w) color[1] = subblockColors0[getIndex(1, j)].addA(alphaValues[j][1]);
-					if((x + 2) < w) color[2] = subblockColors1[getIndex(2, j)].addA(alphaValues[j][2]);
-					if((x + 3) < w) color[3] = subblockColors1[getIndex(3, j)].addA(alphaValues[j][3]);
-					dest += pitch;
-				}
-			}
-
-			if(nonOpaquePunchThroughAlpha)
-			{
-				decodePunchThroughAlphaBlock(destStart, x, y, w, h, pitch);
-			}
 		}
 
-		void decodeTBlock(unsigned char *dest, int x, int y, int w, int h, int pitch, unsigned char alphaValues[4][4], bool nonOpaquePunchThroughAlpha) const
+		void decodeTBlock(unsigned int texels[16]) const
 		{
 			// Table C.8, distance index fot T and H modes
 			static const int distance[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
 
-			bgra8 paintColors[4];
-
 			int r1 = extend_4to8bits(TR1a << 2 | TR1b);
 			int g1 = extend_4to8bits(TG1);
 			int b1 = extend_4to8bits(TB1);
@@ -496,36 +470,18 @@ namespace
 
 			const int d = distance[Tda << 1 | Tdb];
 
-			paintColors[0].set(r1, g1, b1);
-			paintColors[1].set(r2 + d, g2 + d, b2 + d);
-			paintColors[2].set(r2, g2, b2);
-			paintColors[3].set(r2 - d, g2 - d, b2 - d);
-
-			unsigned char* destStart = dest;
+			const int red[4] = { r1, r2 + d, r2, r2 - d };
+			const int green[4] = { g1, g2 + d, g2, g2 - d };
+			const int blue[4] = { b1, b2 + d, b2, b2 - d };
 
-			for(int j = 0; j < 4 && (y + j) < h; j++)
-			{
-				bgra8* color = (bgra8*)dest;
-				if((x + 0) < w) color[0] = paintColors[getIndex(0, j)].addA(alphaValues[j][0]);
-				if((x + 1) < w) color[1] = paintColors[getIndex(1, j)].addA(alphaValues[j][1]);
-				if((x + 2) < w) color[2] = paintColors[getIndex(2, j)].addA(alphaValues[j][2]);
-				if((x + 3) < w) color[3] = paintColors[getIndex(3, j)].addA(alphaValues[j][3]);
-				dest += pitch;
-			}
-
-			if(nonOpaquePunchThroughAlpha)
-			{
-				decodePunchThroughAlphaBlock(destStart, x, y, w, h, pitch);
-			}
+			decodePaintColors(texels, red, green, blue);
 		}
 
-		void decodeHBlock(unsigned char *dest, int x, int y, int w, int h, int pitch, unsigned char alphaValues[4][4], bool nonOpaquePunchThroughAlpha) const
+		void decodeHBlock(unsigned int texels[16]) const
 		{
 			// Table C.8, distance index fot T and H modes
 			static const int distance[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
 
-			bgra8 paintColors[4];
-
 			int r1 = extend_4to8bits(HR1);
 			int g1 = extend_4to8bits(HG1a << 1 | HG1b);
 			int b1 = extend_4to8bits(HB1a << 3 | HB1b << 1 | HB1c);
@@ -536,30 +492,31 @@ namespace
 
 			const int d = distance[(Hda << 2) | (Hdb << 1) | ((r1 << 16 | g1 << 8 | b1) >= (r2 << 16 | g2 << 8 | b2) ? 1 : 0)];
 
-			paintColors[0].set(r1 + d, g1 + d, b1 + d);
-			paintColors[1].set(r1 - d, g1 - d, b1 - d);
-			paintColors[2].set(r2 + d, g2 + d, b2 + d);
-			paintColors[3].set(r2 - d, g2 - d, b2 - d);
+			const int red[4] = { r1 + d, r1 - d, r2 + d, r2 - d };
+			const int green[4] = { g1 + d, g1 - d, g2 + d, g2 - d };
+			const int blue[4] = { b1 + d, b1 - d, b2 + d, b2 - d };
 
-			unsigned char* destStart = dest;
+			decodePaintColors(texels, red, green, blue);
+		}
 
-			for(int j = 0; j < 4 && (y + j) < h; j++)
-			{
-				bgra8* color = (bgra8*)dest;
-				if((x + 0) < w) color[0] = paintColors[getIndex(0, j)].addA(alphaValues[j][0]);
-				if((x + 1) < w) color[1] = paintColors[getIndex(1, j)].addA(alphaValues[j][1]);
-				if((x + 2) < w) color[2] = paintColors[getIndex(2, j)].addA(alphaValues[j][2]);
-				if((x + 3) < w) color[3] = paintColors[getIndex(3, j)].addA(alphaValues[j][3]);
-				dest += pitch;
-			}
+		void decodePaintColors(unsigned int texels[16], const int red[4], const int green[4], const int blue[4]) const
+		{
+			unsigned int paintColors[4];
+			packColors(paintColors, red, green, blue);
 
-			if(nonOpaquePunchThroughAlpha)
+			unsigned int msb = getIndexMSBs();
+			unsigned int lsb = getIndexLSBs();
+
+			for(int j = 0; j < 4; j++)
 			{
-				decodePunchThroughAlphaBlock(destStart, x, y, w, h, pitch);
+				for(int i = 0; i < 4; i++)
+				{
+					texels[j * 4 + i] = paintColors[getIndex(msb, lsb, i, j)];
+				}
 			}
 		}
 
-		void decodePlanarBlock(unsigned char *dest, int x, int y, int w, int h, int pitch, unsigned char alphaValues[4][4]) const
+		void decodePlanarBlock(unsigned int texels[16]) const
 		{
 			int ro = extend_6to8bits(RO);
 			int go = extend_7to8bits(GO1 << 6 | GO2);
@@ -573,102 +530,77 @@ namespace
 			int gv = extend_7to8bits(GVa << 2 | GVb);
 			int bv = extend_6to8bits(BV);
 
-			for(int j = 0; j < 4 && (y + j) < h; j++)
+			#if defined(__i386__) || defined(__x86_64__)
+				if(sw::CPUID::supportsSSE2())
+				{
+					// Two texels of BGRA 16 bit components per register, with an opaque alpha value
+					__m128i origin = _mm_setr_epi16(bo, go, ro, 255, bo, go, ro, 255);
+					__m128i dh = _mm_setr_epi16(bh - bo, gh - go, rh - ro, 0, bh - bo, gh - go, rh - ro, 0);
+					__m128i dv = _mm_setr_epi16(bv - bo, gv - go, rv - ro, 0, bv - bo, gv - go, rv - ro, 0);
+					__m128i h01 = _mm_add_epi16(_mm_slli_si128(dh, 8), _mm_set1_epi16(2));   // Horizontal offsets of texels 0 and 1, rounded
+					__m128i h23 = _mm_add_epi16(h01, _mm_add_epi16(dh, dh));
+
+					for(int j = 0; j < 4; j++)
+					{
+						__m128i c01 = _mm_add_epi16(_mm_srai_epi16(h01, 2), origin);
+						__m128i c23 = _mm_add_epi16(_mm_srai_epi16(h23, 2), origin);
+						_mm_storeu_si128((__m128i*)(texels + j * 4), _mm_packus_epi16(c01, c23));
+
+						h01 = _mm_add_epi16(h01, dv);
+						h23 = _mm_add_epi16(h23, dv);
+					}
+
+					return;
+				}
+			#endif
+
+			for(int j = 0; j < 4; j++)
 			{
 				int ry = j * (rv - ro) + 2;
 				int gy = j * (gv - go) + 2;
 				int by = j * (bv - bo) + 2;
-				for(int i = 0; i < 4 && (x + i) < w; i++)
+				for(int i = 0; i < 4; i++)
 				{
-					((bgra8*)(dest))[i].set(((i * (rh - ro) + ry) >> 2) + ro,
-						((i * (gh - go) + gy) >> 2) + go,
-						((i * (bh - bo) + by) >> 2) + bo,
-						alphaValues[j][i]);
+					texels[j * 4 + i] = clampByte(((i * (bh - bo) + by) >> 2) + bo) |
+					                    (clampByte(((i * (gh - go) + gy) >> 2) + go) << 8) |
+					                    (clampByte(((i * (rh - ro) + ry) >> 2) + ro) << 16) | 0xFF000000;
 				}
-				dest += pitch;
 			}
 		}
 
-		// Index for individual, differential, H and T modes
-		inline int getIndex(int x, int y) const
+		// Index bits for individual, differential, H and T modes, in column-major order
+		inline unsigned int getIndexMSBs() const
 		{
-			int bitIndex = x * 4 + y;
-			int bitOffset = bitIndex & 7;
-			int lsb = (pixelIndexLSB[1 - (bitIndex >> 3)] >> bitOffset) & 1;
-			int msb = (pixelIndexMSB[1 - (bitIndex >> 3)] >> bitOffset) & 1;
-
-			return (msb << 1) | lsb;
+			return (pixelIndexMSB[0] << 8) | pixelIndexMSB[1];
 		}
 
-		void decodePunchThroughAlphaBlock(unsigned char *dest, int x, int y, int w, int h, int pitch) const
+		inline unsigned int getIndexLSBs() const
 		{
-			for(int j = 0; j < 4 && (y + j) < h; j++)
-			{
-				for(int i = 0; i < 4 && (x + i) < w; i++)
-				{
-					if(getIndex(i, j) == 2) //  msb == 1 && lsb == 0
-					{
-						((bgra8*)dest)[i].set(0, 0, 0, 0);
-					}
-				}
-				dest += pitch;
-			}
+			return (pixelIndexLSB[0] << 8) | pixelIndexLSB[1];
 		}
 
-		// Single channel utility functions
-		inline int getSingleChannel(int x, int y, bool isSigned, bool isEAC) const
+		inline static int getIndex(unsigned int msb, unsigned int lsb, int x, int y)
 		{
-			int codeword = isSigned ? signed_base_codeword : base_codeword;
-			return isEAC ?
-			       ((multiplier == 0) ?
-			        (codeword * 8 + 4 + getSingleChannelModifier(x, y)) :
-			        (codeword * 8 + 4 + getSingleChannelModifier(x, y) * multiplier * 8)) :
-			       codeword + getSingleChannelModifier(x, y) * multiplier;
-		}
+			int bitIndex = x * 4 + y;
 
-		inline int getSingleChannelIndex(int x, int y) const
-		{
-			switch(x * 4 + y)
-			{
-			case 0: return ma;
-			case 1: return mb;
-			case 2: return mc1 << 1 | mc2;
-			case 3: return md;
-			case 4: return me;
-			case 5: return mf1 << 2 | mf2;
-			case 6: return mg;
-			case 7: return mh;
-			case 8: return mi;
-			case 9: return mj;
-			case 10: return mk1 << 1 | mk2;
-			case 11: return ml;
-			case 12: return mm;
-			case 13: return mn1 << 2 | mn2;
-			case 14: return mo;
-			default: return mp; // 15
-			}
+			return (((msb >> bitIndex) & 1) << 1) | ((lsb >> bitIndex) & 1);
 		}
 
-		inline int getSingleChannelModifier(int x, int y) const
+		void decodePunchThroughAlpha(unsigned int texels[16]) const
 		{
-			static const int modifierTable[16][8] = { { -3, -6, -9, -15, 2, 5, 8, 14 },
-			{ -3, -7, -10, -13, 2, 6, 9, 12 },
-			{ -2, -5, -8, -13, 1, 4, 7, 12 },
-			{ -2, -4, -6, -13, 1, 3, 5, 12 },
-			{ -3, -6, -8, -12, 2, 5, 7, 11 },
-			{ -3, -7, -9, -11, 2, 6, 8, 10 },
-			{ -4, -7, -8, -11, 3, 6, 7, 10 },
-			{ -3, -5, -8, -11, 2, 4, 7, 10 },
-			{ -2, -6, -8, -10, 1, 5, 7, 9 },
-			{ -2, -5, -8, -10, 1, 4, 7, 9 },
-			{ -2, -4, -8, -10, 1, 3, 7, 9 },
-			{ -2, -5, -7, -10, 1, 4, 6, 9 },
-			{ -3, -4, -7, -10, 2, 3, 6, 9 },
-			{ -1, -2, -3, -10, 0, 1, 2, 9 },
-			{ -4, -6, -8, -9, 3, 5, 7, 8 },
-			{ -3, -5, -7, -9, 2, 4, 6, 8 } };
+			unsigned int msb = getIndexMSBs();
+			unsigned int lsb = getIndexLSBs();
 
-			return modifierTable[table_index][getSingleChannelIndex(x, y)];
+			for(int j = 0; j < 4; j++)
+			{
+				for(int i = 0; i < 4; i++)
+				{
+					if(getIndex(msb, lsb, i, j) == 2) //  msb == 1 && lsb == 0
+					{
+						texels[j * 4 + i] = 0;
+					}
+				}
+			}
 		}
 	};
 }
@@ -676,10 +608,12 @@ namespace
 // Decodes 1 to 4 channel images to 8 bit output
 bool ETC_Decoder::Decode(const unsigned char* src, unsigned char *dst, int w, int h, int dstW, int dstH, int dstPitch, int dstBpp, InputType inputType)
 {
-	const ETC2* sources[2];
-	sources[0] = (const ETC2*)src;
+	const ETC2* sources = (const ETC2*)src;
 
-	unsigned char alphaValues[4][4] = { { 255, 255, 255, 255 }, { 255, 255, 255, 255 }, { 255, 255, 255, 255 }, { 255, 255, 255, 255 } };
+	// Blocks are decoded in full to rows of 4 texels, of which the ones inside the destination get stored
+	int values[2][16];
+	int channels[32];
+	unsigned int texels[16];
 
 	switch(inputType)
 	{
@@ -688,21 +622,30 @@ bool ETC_Decoder::Decode(const unsigned char* src, unsigned char *dst, int w, in
 		for(int y = 0; y < h; y += 4)
 		{
 			unsigned char *dstRow = dst + (y * dstPitch);
-			for(int x = 0; x < w; x += 4, sources[0]++)
+			for(int x = 0; x < w; x += 4, sources++)
 			{
-				ETC2::DecodeBlock(sources, dstRow + (x * dstBpp), 1, x, y, dstW, dstH, dstPitch, inputType == ETC_R_SIGNED, true);
+				sources->decodeSingleChannelBlock(values[0], inputType == ETC_R_SIGNED, true);
+				storeBlock(values[0], 4, dstRow + (x * dstBpp), x, y, dstW, dstH, dstPitch);
 			}
 		}
 		break;
 	case ETC_RG_SIGNED:
 	case ETC_RG_UNSIGNED:
-		sources[1] = sources[0] + 1;
 		for(int y = 0; y < h; y += 4)
 		{
 			unsigned char *dstRow = dst + (y * dstPitch);
-			for(int x = 0; x < w; x += 4, sources[0] += 2, sources[1] += 2)
+			for(int x = 0; x < w; x += 4, sources += 2)
 			{
-				ETC2::DecodeBlock(sources, dstRow + (x * dstBpp), 2, x, y, dstW, dstH, dstPitch, inputType == ETC_RG_SIGNED, true);
+				sources[0].decodeSingleChannelBlock(values[0], inputType == ETC_RG_SIGNED, true);
+				sources[1].decodeSingleChannelBlock(values[1], inputType == ETC_RG_SIGNED, true);
+
+				for(int i = 0; i < 16; i++)
+				{
+					channels[2 * i + 0] = values[0][i];
+					channels[2 * i + 1] = values[1][i];
+				}
+
+				storeBlock(channels, 8, dstRow + (x * dstBpp), x, y, dstW, dstH, dstPitch);
 			}
 		}
 		break;
@@ -711,9 +654,10 @@ bool ETC_Decoder::Decode(const unsigned char* src, unsigned char *dst, int w, in
 		for(int y = 0; y < h; y += 4)
 		{
 			unsigned char *dstRow = dst + (y * dstPitch);
-			for(int x = 0; x < w; x += 4, sources[0]++)
+			for(int x = 0; x < w; x += 4, sources++)
 			{
-				sources[0]->decodeBlock(dstRow + (x * dstBpp), x, y, dstW, dstH, dstPitch, alphaValues, inputType == ETC_RGB_PUNCHTHROUGH_ALPHA);
+				sources->decodeBlock(texels, inputType == ETC_RGB_PUNCHTHROUGH_ALPHA);
+				storeBlock(texels, 4, dstRow + (x * dstBpp), x, y, dstW, dstH, dstPitch);
 			}
 		}
 		break;
@@ -724,12 +668,19 @@ bool ETC_Decoder::Decode(const unsigned char* src, unsigned char *dst, int w, in
 			for(int x = 0; x < w; x += 4)
 			{
 				// Decode Alpha
-				ETC2::DecodeBlock(&sources[0], &(alphaValues[0][0]), 1, x, y, dstW, dstH, 4, false, false);
-				sources[0]++; // RGBA packets are 128 bits, so move on to the next 64 bit packet to decode the RGB color
+				sources->decodeSingleChannelBlock(values[0], false, false);
+				sources++; // RGBA packets are 128 bits, so move on to the next 64 bit packet to decode the RGB color
 
 				// Decode RGB
-				sources[0]->decodeBlock(dstRow + (x * dstBpp), x, y, dstW, dstH, dstPitch, alphaValues, false);
-				sources[0]++;
+				sources->decodeBlock(texels, false);
+				sources++;
+
+				for(int i = 0; i < 16; i++)
+				{
+					texels[i] = (texels[i] & 0x00FFFFFF) | ((unsigned int)values[0][i] << 24);
+				}
+
+				storeBlock(texels, 4, dstRow + (x * dstBpp), x, y, dstW, dstH, dstPitch);
 			}
 		}
 		break;
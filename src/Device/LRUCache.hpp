@@ -17,8 +17,14 @@
 
 #include "System/Math.hpp"
 
+#include <atomic>
+
 namespace sw
 {
+	// Keys are located through an open-addressed hash table, and entries are evicted in approximately
+	// least-recently-used order by a CLOCK sweep. Keys which carry a precomputed 'hash' member, like the
+	// processor states, are located by it. Other keys are located by the FNV-1a hash of their bytes.
+	// Queries may run concurrently with each other, but not with add().
 	template<class Key, class Data>
 	class LRUCache
 	{
@@ -29,19 +35,27 @@ namespace sw
 
 		Data *query(const Key &key) const;
 		Data *add(const Key &key, Data *data);
-	
+
 		int getSize() {return size;}
 		Key &getKey(int i) {return key[i];}
 
 	private:
+		static uint64_t hash(const Key &key);
+		template<class K> static auto hash(const K &key, int) -> decltype(uint64_t(key.hash));
+		template<class K> static uint64_t hash(const K &key, long);
+		int find(const Key &key, uint64_t hash) const;   // Returns the slot holding the key, or -1
+		void remove(int slot);
+
 		int size;
-		int mask;
-		int top;
+		int mask;    // Of the bucket table, which is twice the size to keep probe sequences short
 		int fill;
+		int clock;   // Next slot considered for eviction
 
 		Key *key;
-		Key **ref;
 		Data **data;
+		uint64_t *keyHash;
+		std::atomic<bool> *referenced;   // Since the clock hand last passed
+		int *bucket;   // Slot + 1, or 0 when empty
 	};
 }
 
@@ -51,19 +65,26 @@ namespace sw
 	LRUCache<Key, Data>::LRUCache(int n)
 	{
 		size = ceilPow2(n);
-		mask = size - 1;
-		top = 0;
+		mask = 2 * size - 1;
 		fill = 0;
+		clock = 0;
 
 		key = new Key[size];
-		ref = new Key*[size];
 		data = new Data*[size];
+		keyHash = new uint64_t[size];
+		referenced = new std::atomic<bool>[size];
+		bucket = new int[2 * size];
 
 		for(int i = 0; i < size; i++)
 		{
 			data[i] = nullptr;
+			keyHash[i] = 0;
+			referenced[i] = false;
+		}
 
-			ref[i] = &key[i];
+		for(int i = 0; i < 2 * size; i++)
+		{
+			bucket[i] = 0;
 		}
 	}
 
@@ -73,9 +94,6 @@ namespace sw
 		delete[] key;
 		key = nullptr;
 
-		delete[] ref;
-		ref = nullptr;
-
 		for(int i = 0; i < size; i++)
 		{
 			if(data[i])
@@ -87,56 +105,142 @@ namespace sw
 
 		delete[] data;
 		data = nullptr;
+
+		delete[] keyHash;
+		keyHash = nullptr;
+
+		delete[] referenced;
+		referenced = nullptr;
+
+		delete[] bucket;
+		bucket = nullptr;
 	}
 
 	template<class Key, class Data>
-	Data *LRUCache<Key, Data>::query(const Key &key) const
+	uint64_t LRUCache<Key, Data>::hash(const Key &key)
+	{
+		return hash(key, 0);   // Prefers the precomputed hash when the key has one
+	}
+
+	template<class Key, class Data>
+	template<class K>
+	auto LRUCache<Key, Data>::hash(const K &key, int) -> decltype(uint64_t(key.hash))
+	{
+		return key.hash;
+	}
+
+	template<class Key, class Data>
+	template<class K>
+	uint64_t LRUCache<Key, Data>::hash(const K &key, long)
+	{
+		return FNV_1a(reinterpret_cast<const unsigned char*>(&key), sizeof(K));
+	}
+
+	template<class Key, class Data>
+	int LRUCache<Key, Data>::find(const Key &key, uint64_t hash) const
 	{
-		for(int i = top; i > top - fill; i--)
+		for(int i = (int)hash & mask; bucket[i] != 0; i = (i + 1) & mask)
 		{
-			int j = i & mask;
+			int slot = bucket[i] - 1;
 
-			if(key == *ref[j])
+			if(keyHash[slot] == hash && key == this->key[slot])
 			{
-				Data *hit = data[j];
+				return slot;
+			}
+		}
 
-				if(i != top)
-				{
-					// Move one up
-					int k = (j + 1) & mask;
+		return -1;
+	}
 
-					Data *swapD = data[k];
-					data[k] = data[j];
-					data[j] = swapD;
+	template<class Key, class Data>
+	void LRUCache<Key, Data>::remove(int slot)
+	{
+		int i = (int)keyHash[slot] & mask;
 
-					Key *swapK = ref[k];
-					ref[k] = ref[j];
-					ref[j] = swapK;
-				}
+		while(bucket[i] != slot + 1)
+		{
+			i = (i + 1) & mask;
+		}
+
+		bucket[i] = 0;
+
+		// Shift back subsequent entries of the probe sequence which can't be found past the hole
+		for(int j = (i + 1) & mask; bucket[j] != 0; j = (j + 1) & mask)
+		{
+			int home = (int)keyHash[bucket[j] - 1] & mask;
 
-				return hit;
+			if(((j - home) & mask) >= ((j - i) & mask))
+			{
+				bucket[i] = bucket[j];
+				bucket[j] = 0;
+				i = j;
 			}
 		}
+	}
 
-		return nullptr;   // Not found
+	template<class Key, class Data>
+	Data *LRUCache<Key, Data>::query(const Key &key) const
+	{
+		int slot = find(key, hash(key));
+
+		if(slot < 0)
+		{
+			return nullptr;   // Not found
+		}
+
+		referenced[slot].store(true, std::memory_order_relaxed);
+
+		return data[slot];
 	}
 
 	template<class Key, class Data>
 	Data *LRUCache<Key, Data>::add(const Key &key, Data *data)
 	{
-		top = (top + 1) & mask;
-		fill = fill + 1 < size ? fill + 1 : size;
+		uint64_t keyHash = hash(key);
+		int slot = find(key, keyHash);
+
+		if(slot < 0)
+		{
+			if(fill < size)
+			{
+				slot = fill++;
+			}
+			else
+			{
+				// Skip entries which were used since the previous sweep
+				while(referenced[clock].exchange(false, std::memory_order_relaxed))
+				{
+					clock = (clock + 1) & (size - 1);
+				}
 
-		*ref[top] = key;
+				slot = clock;
+				clock = (clock + 1) & (size - 1);
+
+				remove(slot);
+			}
+
+			this->key[slot] = key;
+			this->keyHash[slot] = keyHash;
+
+			int i = (int)keyHash & mask;
+
+			while(bucket[i] != 0)
+			{
+				i = (i + 1) & mask;
+			}
+
+			bucket[i] = slot + 1;
+		}
 
 		data->bind();
 
-		if(this->data[top])
+		if(this->data[slot])
 		{
-			this->data[top]->unbind();
+			this->data[slot]->unbind();
 		}
 
-		this->data[top] = data;
+		this->data[slot] = data;
+		referenced[slot] = true;
 
 		return data;
 	}
@@ -33,15 +33,7 @@ namespace sw
 
 	unsigned int PixelProcessor::States::computeHash()
 	{
-		unsigned int *state = (unsigned int*)this;
-		unsigned int hash = 0;
-
-		for(unsigned int i = 0; i < sizeof(States) / 4; i++)
-		{
-			hash ^= state[i];
-		}
-
-		return hash;
+		return (unsigned int)FNV_1a(reinterpret_cast<const unsigned char*>(this), sizeof(States));
 	}
 
 	PixelProcessor::State::State()
@@ -628,10 +620,12 @@ namespace sw
 		if(context->pixelShader)
 		{
 			state.shaderID = context->pixelShader->getSerialID();
+			state.shaderHash = precachePixel ? context->pixelShader->getHash() : 0;
 		}
 		else
 		{
 			state.shaderID = 0;
+			state.shaderHash = 0;
 		}
 
 		state.depthOverride = context->pixelShader && context->pixelShader->depthOverride();
@@ -765,21 +759,65 @@ namespace sw
 		return state;
 	}
 
-	Routine *PixelProcessor::routine(const State &state)
+	Routine *PixelProcessor::routine(const State &state, bool optimize)
+	{
+		Routine *routine = cachedRoutine(state);
+
+		if(!routine)
+		{
+			routine = generate(state, context->pixelShader, optimize);
+			cacheRoutine(state, routine);
+		}
+
+		return routine;
+	}
+
+	Routine *PixelProcessor::cachedRoutine(const State &state)
 	{
 		Routine *routine = routineCache->query(state);
 
 		if(!routine)
 		{
-			const bool integerPipeline = (context->pixelShaderModel() <= 0x0104);
-			QuadRasterizer *generator = new PixelProgram(state, context->pixelShader);
-			generator->generate();
-			routine = (*generator)("PixelRoutine_%0.8X", state.shaderID);
-			delete generator;
+			routine = routineCache->load(persistentState(state));
 
-			routineCache->add(state, routine);
+			if(routine)
+			{
+				routineCache->add(state, routine);
+			}
 		}
 
 		return routine;
 	}
+
+	void PixelProcessor::cacheRoutine(const State &state, Routine *routine)
+	{
+		routineCache->add(state, routine);
+
+		if(routine->isOptimized())   // Unoptimized routines get replaced later
+		{
+			routineCache->store(persistentState(state), routine);
+		}
+	}
+
+	PixelProcessor::State PixelProcessor::persistentState(const State &state)
+	{
+		State persistent = state;
+
+		// Serial IDs differ between processes, the shader's contents are identified by its hash
+		persistent.shaderID = 0;
+		persistent.hash = 0;
+
+		return persistent;
+	}
+
+	Routine *PixelProcessor::generate(const State &state, const PixelShader *shader, bool optimize)
+	{
+		QuadRasterizer *generator = new PixelProgram(state, shader);
+		generator->generate();
+		generator->setOptimizations(optimize);
+		Routine *routine = (*generator)("PixelRoutine_%0.8X", state.hash);
+		delete generator;
+
+		return routine;
+	}
 }
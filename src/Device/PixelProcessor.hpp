@@ -33,6 +33,7 @@ namespace sw
 			unsigned int computeHash();
 
 			int shaderID;
+			uint64_t shaderHash;   // Only used by the routine precache
 
 			bool depthOverride                        : 1;   // TODO: Eliminate by querying shader.
 			bool shaderContainsKill                   : 1;   // TODO: Eliminate by querying shader.
@@ -256,7 +257,11 @@ namespace sw
 
 	protected:
 		const State update() const;
-		Routine *routine(const State &state);
+		Routine *routine(const State &state, bool optimize = true);
+		Routine *cachedRoutine(const State &state);   // Returns nullptr if the routine has not been generated yet
+		void cacheRoutine(const State &state, Routine *routine);
+		static Routine *generate(const State &state, const PixelShader *shader, bool optimize = true);
+		static State persistentState(const State &state);   // Key for the routine precache
 		void setRoutineCacheSize(int routineCacheSize);
 
 		// Shader constants
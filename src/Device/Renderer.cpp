@@ -31,6 +31,8 @@
 #include "System/Timer.hpp"
 #include "Vulkan/VkDebug.hpp"
 
+#include <algorithm>
+
 #undef max
 
 bool disableServer = true;
@@ -59,8 +61,18 @@ namespace sw
 	extern bool precacheVertex;
 	extern bool precacheSetup;
 	extern bool precachePixel;
+	extern bool precacheBlit;
+
+	extern int vertexCacheSize;
+	extern int vertexCacheAssociativity;
+	extern bool vertexCacheDeduplication;
 
 	static const int batchSize = 128;
+	static const int inlineDrawPrimitives = 16;   // Largest draw executed on the application thread when the renderer is idle
+	static const int inlineDrawPixels = 4096;     // Beyond this coverage worker threads take over the pixel processing
+	static bool asyncRoutineCompilation = false;
+	static bool tieredRoutineCompilation = false;
+	static const int upgradeRoutineDraws = 64;   // Draws using an unoptimized routine before it gets replaced
 	AtomicInt threadCount(1);
 	AtomicInt Renderer::unitCount(1);
 	AtomicInt Renderer::clusterCount(1);
@@ -88,6 +100,32 @@ namespace sw
 		}
 	}
 
+	// Returns the largest multiple of the viewport extents for which primitives
+	// can be rasterized without X and Y clipping. SetupRoutine::edge() multiplies
+	// horizontal and vertical 28.4 fixed-point deltas in 32-bit, which bounds
+	// how far vertices may lie outside of the viewport and scissor rectangle.
+	static float guardBand(float W, float H, float Y0, int scissorY0)
+	{
+		const float maxGuardBand = 8.0f;
+		const float maxProduct = (float)(1 << 30);   // Leaves a factor 2 margin for rounding and sample offsets
+
+		W = abs(W);
+		H = abs(H);
+
+		for(float g = maxGuardBand; g > 1.0f; g *= 0.5f)
+		{
+			float dx = 2.0f * g * W * 16.0f;
+			float dy = (max((float)scissorY0 - (Y0 - g * H), 0.0f) + 1.0f) * 16.0f;
+
+			if(dx * dy < maxProduct)
+			{
+				return g;
+			}
+		}
+
+		return 1.0f;
+	}
+
 	struct Parameters
 	{
 		Renderer *renderer;
@@ -97,6 +135,7 @@ namespace sw
 	DrawCall::DrawCall()
 	{
 		queries = 0;
+		routineJob = nullptr;
 
 		vsDirtyConstF = VERTEX_UNIFORM_VECTORS + 1;
 		vsDirtyConstI = 16;
@@ -119,13 +158,71 @@ namespace sw
 		deallocate(data);
 	}
 
+	RoutineJob::RoutineJob(const VertexProcessor::State &vertexState, const VertexShader *vertexShader, Routine *vertexRoutine,
+	                       const PixelProcessor::State &pixelState, const PixelShader *pixelShader, Routine *pixelRoutine,
+	                       bool optimize, bool upgrade)
+		: vertexState(vertexState), pixelState(pixelState),
+		  vertexShader((vertexShader && !vertexRoutine) ? new VertexShader(vertexShader) : nullptr),
+		  pixelShader((pixelShader && !pixelRoutine) ? new PixelShader(pixelShader) : nullptr),
+		  vertexRoutine(vertexRoutine), pixelRoutine(pixelRoutine), optimize(optimize), upgrade(upgrade), done(false), references(0)
+	{
+		if(vertexRoutine)
+		{
+			vertexRoutine->bind();
+		}
+
+		if(pixelRoutine)
+		{
+			pixelRoutine->bind();
+		}
+	}
+
+	RoutineJob::~RoutineJob()
+	{
+		delete vertexShader;
+		delete pixelShader;
+
+		if(vertexRoutine)
+		{
+			vertexRoutine->unbind();
+		}
+
+		if(pixelRoutine)
+		{
+			pixelRoutine->unbind();
+		}
+	}
+
+	void RoutineJob::bind()
+	{
+		references++;
+	}
+
+	void RoutineJob::unbind()
+	{
+		if(references-- == 0)   // Returns the decremented value
+		{
+			delete this;
+		}
+	}
+
+	static void bindRoutines(DrawCall *draw, Routine *vertexRoutine, Routine *pixelRoutine)
+	{
+		vertexRoutine->bind();
+		pixelRoutine->bind();
+
+		draw->vertexRoutine = vertexRoutine;
+		draw->pixelRoutine = pixelRoutine;
+		draw->vertexPointer = (VertexProcessor::RoutinePointer)vertexRoutine->getEntry();
+		draw->pixelPointer = (PixelProcessor::RoutinePointer)pixelRoutine->getEntry();
+	}
+
 	Renderer::Renderer(Context *context, Conventions conventions, bool exactColorRounding) : VertexProcessor(context), PixelProcessor(context), SetupProcessor(context), context(context), viewport()
 	{
 		setGlobalRenderingSettings(conventions, exactColorRounding);
 
 		setRenderTarget(0, nullptr);
 		clipper = new Clipper;
-		blitter = new Blitter;
 
 		updateClipPlanes = true;
 
@@ -136,6 +233,7 @@ namespace sw
 		for(int i = 0; i < 16; i++)
 		{
 			vertexTask[i] = nullptr;
+			dedupVertices[i] = nullptr;
 
 			worker[i] = nullptr;
 			resume[i] = nullptr;
@@ -143,6 +241,7 @@ namespace sw
 		}
 
 		threadsAwake = 0;
+		inlineExecution = false;
 		resumeApp = new Event();
 
 		currentDraw = 0;
@@ -178,7 +277,15 @@ namespace sw
 		swiftConfig = new SwiftConfig(disableServer);
 		updateConfiguration(true);
 
+		blitter = new Blitter;   // Created after the precache configuration is known
+
 		sync = new Resource(0);
+
+		routineJob = nullptr;
+		exitCompiler = false;
+		pendingCompiles = 0;
+		compileRequest = nullptr;
+		compiler = nullptr;   // Started by the first background compilation request
 	}
 
 	Renderer::~Renderer()
@@ -194,6 +301,25 @@ namespace sw
 		terminateThreads();
 		delete resumeApp;
 
+		if(compiler)
+		{
+			exitCompiler = true;
+			compileRequest->signal();
+			compiler->join();
+			delete compiler;
+			delete compileRequest;
+		}
+
+		for(RoutineJob *job : routineJobs)
+		{
+			job->unbind();
+		}
+
+		if(routineJob)
+		{
+			routineJob->unbind();
+		}
+
 		for(int draw = 0; draw < DRAW_COUNT; draw++)
 		{
 			delete drawCall[draw];
@@ -245,9 +371,36 @@ namespace sw
 			setupState = SetupProcessor::update();
 			pixelState = PixelProcessor::update();
 
-			vertexRoutine = VertexProcessor::routine(vertexState);
-			setupRoutine = SetupProcessor::routine(setupState);
-			pixelRoutine = PixelProcessor::routine(pixelState);
+			if(routineJob)
+			{
+				routineJob->unbind();
+				routineJob = nullptr;
+			}
+
+			if(asyncRoutineCompilation)
+			{
+				retireRoutineJobs();
+
+				vertexRoutine = VertexProcessor::cachedRoutine(vertexState);
+				setupRoutine = SetupProcessor::routine(setupState);
+				pixelRoutine = PixelProcessor::cachedRoutine(pixelState);
+
+				if(!vertexRoutine || !pixelRoutine)
+				{
+					routineJob = requestRoutines();
+				}
+			}
+			else
+			{
+				vertexRoutine = VertexProcessor::routine(vertexState, !tieredRoutineCompilation);
+				setupRoutine = SetupProcessor::routine(setupState);
+				pixelRoutine = PixelProcessor::routine(pixelState, !tieredRoutineCompilation);
+			}
+		}
+
+		if(tieredRoutineCompilation)
+		{
+			upgradeRoutines();
 		}
 
 		int batch = batchSize / ms;
@@ -308,31 +461,34 @@ namespace sw
 		draw->drawType = drawType;
 		draw->batchSize = batch;
 
-		vertexRoutine->bind();
 		setupRoutine->bind();
-		pixelRoutine->bind();
 
-		draw->vertexRoutine = vertexRoutine;
 		draw->setupRoutine = setupRoutine;
-		draw->pixelRoutine = pixelRoutine;
-		draw->vertexPointer = (VertexProcessor::RoutinePointer)vertexRoutine->getEntry();
 		draw->setupPointer = (SetupProcessor::RoutinePointer)setupRoutine->getEntry();
-		draw->pixelPointer = (PixelProcessor::RoutinePointer)pixelRoutine->getEntry();
+		draw->routineJob = routineJob;
+
+		if(routineJob)
+		{
+			routineJob->bind();
+		}
+		else
+		{
+			bindRoutines(draw, vertexRoutine, pixelRoutine);
+		}
+
 		draw->setupPrimitives = setupPrimitives;
 		draw->setupState = setupState;
+		draw->dedupVertices = vertexCacheDeduplication && (drawType & DRAW_INDEXED32) != DRAW_NONINDEXED && !vertexState.transformFeedbackEnabled;
 
 		for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
 		{
 			draw->vertexStream[i] = context->input[i].resource;
 			data->input[i] = context->input[i].buffer;
 			data->stride[i] = context->input[i].stride;
-
-			if(draw->vertexStream[i])
-			{
-				draw->vertexStream[i]->lock(PUBLIC, PRIVATE);
-			}
 		}
 
+		Resource::lockAll(draw->vertexStream, MAX_VERTEX_INPUTS, PUBLIC, PRIVATE);
+
 		if(context->indexBuffer)
 		{
 			data->indices = (unsigned char*)context->indexBuffer->lock(PUBLIC, PRIVATE) + indexOffset;
@@ -504,6 +660,8 @@ namespace sw
 			data->Y0x16 = replicate(Y0 * 16 - 8);
 			data->halfPixelX = replicate(0.5f / W);
 			data->halfPixelY = replicate(0.5f / H);
+
+			data->guardBand = replicate(guardBand(W, H, Y0, scissor.y0));
 			data->viewportHeight = abs(viewport.height);
 			data->slopeDepthBias = context->slopeDepthBias;
 			data->depthRange = Z;
@@ -584,18 +742,52 @@ namespace sw
 		else
 		#endif
 		{
-			if(!threadsAwake)
+			// The compiler thread resumes the workers under the same lock
+			resumeMutex.lock();
+
+			if(!threadsAwake && count <= inlineDrawPrimitives && draw->references == 1 && pendingCompiles == 0)
 			{
+				// Waking a worker takes longer than processing a handful of primitives, so take
+				// thread 0's place. All workers are suspended, so previous draws have completed.
 				suspend[0]->wait();
 
 				threadsAwake = 1;
 				task[0].type = Task::RESUME;
+				inlineExecution = true;
+
+				taskLoop(0);
+
+				inlineExecution = false;
+				suspend[0]->signal();   // Thread 0 itself remains suspended
 
-				resume[0]->signal();
+				resumeMutex.unlock();
+			}
+			else
+			{
+				resumeMutex.unlock();
+
+				resumeThreads();
 			}
 		}
 	}
 
+	void Renderer::resumeThreads()
+	{
+		resumeMutex.lock();
+
+		if(!threadsAwake)
+		{
+			suspend[0]->wait();
+
+			threadsAwake = 1;
+			task[0].type = Task::RESUME;
+
+			resume[0]->signal();
+		}
+
+		resumeMutex.unlock();
+	}
+
 	void Renderer::clear(void *value, VkFormat format, Surface *dest, const Rect &clearRect, unsigned int rgbaMask)
 	{
 		blitter->clear(value, format, dest, clearRect, rgbaMask);
@@ -636,6 +828,222 @@ namespace sw
 		}
 	}
 
+	void Renderer::compilerFunction(void *parameters)
+	{
+		Renderer *renderer = static_cast<Renderer*>(parameters);
+
+		renderer->compilerLoop();
+	}
+
+	void Renderer::compilerLoop()
+	{
+		while(!exitCompiler)
+		{
+			compileRequest->wait();
+
+			while(true)
+			{
+				compileMutex.lock();
+
+				if(compileQueue.empty())
+				{
+					compileMutex.unlock();
+					break;
+				}
+
+				RoutineJob *job = compileQueue.front();
+				compileQueue.pop_front();
+
+				compileMutex.unlock();
+
+				if(job->upgrade && exitCompiler)
+				{
+					job->unbind();
+					continue;
+				}
+
+				if(!job->vertexRoutine)
+				{
+					job->vertexRoutine = VertexProcessor::generate(job->vertexState, job->vertexShader, job->optimize);
+					job->vertexRoutine->bind();
+				}
+
+				if(!job->pixelRoutine)
+				{
+					job->pixelRoutine = PixelProcessor::generate(job->pixelState, job->pixelShader, job->optimize);
+					job->pixelRoutine->bind();
+				}
+
+				if(job->upgrade)   // Retired by the application thread
+				{
+					job->done = true;
+					job->unbind();
+					continue;
+				}
+
+				// Workers which found the job pending have suspended once the scheduler lock is released
+				schedulerMutex.lock();
+				job->done = true;
+				schedulerMutex.unlock();
+
+				job->unbind();
+
+				// Draws using the job's routines are held back by the scheduler
+				resumeThreads();
+				--pendingCompiles;
+			}
+		}
+	}
+
+	void Renderer::startCompiler()
+	{
+		if(!compiler)
+		{
+			compileRequest = new Event();
+			compiler = new Thread(compilerFunction, this);
+		}
+	}
+
+	RoutineJob *Renderer::requestRoutines()
+	{
+		for(RoutineJob *job : routineJobs)
+		{
+			if(!job->upgrade && job->vertexState == vertexState && job->pixelState == pixelState)
+			{
+				job->bind();
+				return job;
+			}
+		}
+
+		RoutineJob *job = new RoutineJob(vertexState, context->vertexShader, vertexRoutine, pixelState, context->pixelShader, pixelRoutine,
+		                                 !tieredRoutineCompilation, false);
+
+		job->bind();   // Compile queue
+		job->bind();   // Outstanding jobs
+		job->bind();   // Caller
+
+		routineJobs.push_back(job);
+		++pendingCompiles;
+
+		startCompiler();
+
+		compileMutex.lock();
+		// Ahead of the jobs which replace routines, since draws are waiting for this one
+		compileQueue.insert(std::find_if(compileQueue.begin(), compileQueue.end(), [](RoutineJob *job) { return job->upgrade; }), job);
+		compileMutex.unlock();
+
+		compileRequest->signal();
+
+		return job;
+	}
+
+	void Renderer::retireRoutineJobs()
+	{
+		for(auto job = routineJobs.begin(); job != routineJobs.end();)
+		{
+			if((*job)->done && (*job)->upgrade)
+			{
+				// Draws which already use the unoptimized routines have bound them
+				Routine *cached = VertexProcessor::cachedRoutine((*job)->vertexState);
+
+				if((*job)->vertexRoutine->isOptimized() && (!cached || !cached->isOptimized()))
+				{
+					bool current = cached && (vertexRoutine == cached);
+
+					VertexProcessor::cacheRoutine((*job)->vertexState, (*job)->vertexRoutine);
+
+					if(current)
+					{
+						vertexRoutine = (*job)->vertexRoutine;
+					}
+				}
+
+				cached = PixelProcessor::cachedRoutine((*job)->pixelState);
+
+				if((*job)->pixelRoutine->isOptimized() && (!cached || !cached->isOptimized()))
+				{
+					bool current = cached && (pixelRoutine == cached);
+
+					PixelProcessor::cacheRoutine((*job)->pixelState, (*job)->pixelRoutine);
+
+					if(current)
+					{
+						pixelRoutine = (*job)->pixelRoutine;
+					}
+				}
+
+				(*job)->unbind();
+				job = routineJobs.erase(job);
+			}
+			else if((*job)->done)
+			{
+				if(!VertexProcessor::cachedRoutine((*job)->vertexState))
+				{
+					VertexProcessor::cacheRoutine((*job)->vertexState, (*job)->vertexRoutine);
+				}
+
+				if(!PixelProcessor::cachedRoutine((*job)->pixelState))
+				{
+					PixelProcessor::cacheRoutine((*job)->pixelState, (*job)->pixelRoutine);
+				}
+
+				(*job)->unbind();
+				job = routineJobs.erase(job);
+			}
+			else
+			{
+				job++;
+			}
+		}
+	}
+
+	void Renderer::upgradeRoutines()
+	{
+		retireRoutineJobs();
+
+		if(routineJob && routineJob->done)
+		{
+			// Use the cached routines directly, so their uses get counted
+			Routine *cachedVertexRoutine = VertexProcessor::cachedRoutine(vertexState);
+			Routine *cachedPixelRoutine = PixelProcessor::cachedRoutine(pixelState);
+
+			if(cachedVertexRoutine && cachedPixelRoutine)
+			{
+				vertexRoutine = cachedVertexRoutine;
+				pixelRoutine = cachedPixelRoutine;
+
+				routineJob->unbind();
+				routineJob = nullptr;
+			}
+		}
+
+		bool hotVertexRoutine = vertexRoutine && !vertexRoutine->isOptimized() && vertexRoutine->use() == upgradeRoutineDraws;
+		bool hotPixelRoutine = pixelRoutine && !pixelRoutine->isOptimized() && pixelRoutine->use() == upgradeRoutineDraws;
+
+		if(!hotVertexRoutine && !hotPixelRoutine)
+		{
+			return;
+		}
+
+		// Draws keep using the unoptimized routines until the optimized ones are retired
+		RoutineJob *job = new RoutineJob(vertexState, context->vertexShader, hotVertexRoutine ? nullptr : vertexRoutine,
+		                                 pixelState, context->pixelShader, hotPixelRoutine ? nullptr : pixelRoutine,
+		                                 true, true);
+
+		job->bind();   // Compile queue
+		job->bind();   // Outstanding jobs
+
+		routineJobs.push_back(job);
+
+		startCompiler();
+
+		compileMutex.lock();
+		compileQueue.push_back(job);
+		compileMutex.unlock();
+
+		compileRequest->signal();
+	}
+
 	void Renderer::taskLoop(int threadIndex)
 	{
 		while(task[threadIndex].type != Task::SUSPEND)
@@ -704,6 +1112,18 @@ namespace sw
 				draw = drawList[currentDraw & DRAW_COUNT_BITS];
 			}
 
+			if(draw->routineJob)
+			{
+				if(!draw->routineJob->done)
+				{
+					return;   // The compiler thread resumes rendering once the routines are generated
+				}
+
+				bindRoutines(draw, draw->routineJob->vertexRoutine, draw->routineJob->pixelRoutine);
+				draw->routineJob->unbind();
+				draw->routineJob = nullptr;
+			}
+
 			if(!primitiveProgress[unit].references)   // Task not already being executed and not still in use by a pixel unit
 			{
 				primitive = draw->primitive;
@@ -745,7 +1165,7 @@ namespace sw
 			task[threadIndex] = taskQueue[(qHead - qSize) & TASK_COUNT_BITS];
 			qSize--;
 
-			if(curThreadsAwake != threadCount)
+			if(curThreadsAwake != threadCount && !inlineExecution)
 			{
 				int wakeup = qSize - curThreadsAwake + 1;
 
@@ -808,6 +1228,11 @@ namespace sw
 				primitiveProgress[unit].visible = visible;
 				primitiveProgress[unit].references = clusterCount;
 
+				if(inlineExecution && coverage(primitiveBatch[unit], visible, draw->setupState.multiSample) > inlineDrawPixels)
+				{
+					inlineExecution = false;   // Let the workers share the pixel processing
+				}
+
 				#if PERF_HUD
 					setupTime[threadIndex] += Timer::ticks() - startTick;
 				#endif
@@ -845,6 +1270,22 @@ namespace sw
 		}
 	}
 
+	int Renderer::coverage(const Primitive *primitive, int count, int multiSample)
+	{
+		int pixels = 0;
+
+		for(int i = 0; i < count; i++, primitive += multiSample)
+		{
+			for(int y = primitive->yMin; y < primitive->yMax; y++)
+			{
+				const Primitive::Span &span = primitive->outline[y];
+				pixels += max((int)span.right - (int)span.left, 0);
+			}
+		}
+
+		return pixels;
+	}
+
 	void Renderer::synchronize()
 	{
 		sync->lock(sw::PUBLIC);
@@ -932,46 +1373,17 @@ namespace sw
 					draw.stencilBuffer->unlockStencil();
 				}
 
-				for(int i = 0; i < TOTAL_IMAGE_UNITS; i++)
-				{
-					if(draw.texture[i])
-					{
-						draw.texture[i]->unlock();
-					}
-				}
-
-				for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
-				{
-					if(draw.vertexStream[i])
-					{
-						draw.vertexStream[i]->unlock();
-					}
-				}
+				Resource::unlockAll(draw.texture, TOTAL_IMAGE_UNITS);
+				Resource::unlockAll(draw.vertexStream, MAX_VERTEX_INPUTS);
 
 				if(draw.indexBuffer)
 				{
 					draw.indexBuffer->unlock();
 				}
 
-				for(int i = 0; i < MAX_UNIFORM_BUFFER_BINDINGS; i++)
-				{
-					if(draw.pUniformBuffers[i])
-					{
-						draw.pUniformBuffers[i]->unlock();
-					}
-					if(draw.vUniformBuffers[i])
-					{
-						draw.vUniformBuffers[i]->unlock();
-					}
-				}
-
-				for(int i = 0; i < MAX_TRANSFORM_FEEDBACK_INTERLEAVED_COMPONENTS; i++)
-				{
-					if(draw.transformFeedbackBuffers[i])
-					{
-						draw.transformFeedbackBuffers[i]->unlock();
-					}
-				}
+				Resource::unlockAll(draw.pUniformBuffers, MAX_UNIFORM_BUFFER_BINDINGS);
+				Resource::unlockAll(draw.vUniformBuffers, MAX_UNIFORM_BUFFER_BINDINGS);
+				Resource::unlockAll(draw.transformFeedbackBuffers, MAX_TRANSFORM_FEEDBACK_INTERLEAVED_COMPONENTS);
 
 				draw.vertexRoutine->unbind();
 				draw.setupRoutine->unbind();
@@ -1280,8 +1692,36 @@ namespace sw
 		}
 
 		task->primitiveStart = start;
-		task->vertexCount = triangleCount * 3;
-		vertexRoutine(&triangle->v0, (unsigned int*)&batch, task, data);
+
+		if(draw->dedupVertices)
+		{
+			// Shade each unique index once. Sorting keeps the indices of each quad
+			// adjacent, so they are all served by the cache line filled by the first.
+			unsigned int *indices = &batch[0][0];
+			unsigned int unique[128 * 3];
+			unsigned int count = triangleCount * 3;
+
+			memcpy(unique, indices, count * sizeof(unsigned int));
+			std::sort(unique, unique + count);
+			unsigned int uniqueCount = (unsigned int)(std::unique(unique, unique + count) - unique);
+
+			Vertex *shaded = dedupVertices[thread];
+			task->vertexCount = uniqueCount;
+			vertexRoutine(shaded, unique, task, data);
+
+			Vertex *vertex = &triangle->v0;
+
+			for(unsigned int i = 0; i < count; i++)
+			{
+				unsigned int slot = (unsigned int)(std::lower_bound(unique, unique + uniqueCount, indices[i]) - unique);
+				vertex[i] = shaded[slot];
+			}
+		}
+		else
+		{
+			task->vertexCount = triangleCount * 3;
+			vertexRoutine(&triangle->v0, (unsigned int*)&batch, task, data);
+		}
 	}
 
 	int Renderer::setupTriangles(int unit, int count)
@@ -1667,7 +2107,8 @@ namespace sw
 		for(int i = 0; i < threadCount; i++)
 		{
 			vertexTask[i] = (VertexTask*)allocate(sizeof(VertexTask));
-			vertexTask[i]->vertexCache.drawCall = -1;
+			vertexTask[i]->vertexCache.allocate(vertexCacheSize, vertexCacheAssociativity);
+			dedupVertices[i] = vertexCacheDeduplication ? (Vertex*)allocate(batchSize * 3 * sizeof(Vertex)) : nullptr;
 
 			task[i].type = Task::SUSPEND;
 
@@ -1688,7 +2129,7 @@ namespace sw
 
 	void Renderer::terminateThreads()
 	{
-		while(threadsAwake != 0)
+		while(pendingCompiles != 0 || threadsAwake != 0)
 		{
 			Thread::sleep(1);
 		}
@@ -1709,8 +2150,16 @@ namespace sw
 				suspend[thread] = 0;
 			}
 
+			if(vertexTask[thread])
+			{
+				vertexTask[thread]->vertexCache.deallocate();
+			}
+
 			deallocate(vertexTask[thread]);
 			vertexTask[thread] = 0;
+
+			deallocate(dedupVertices[thread]);
+			dedupVertices[thread] = nullptr;
 		}
 
 		for(int i = 0; i < 16; i++)
@@ -2334,11 +2783,17 @@ namespace sw
 			precacheVertex = !newConfiguration && configuration.precache;
 			precacheSetup = !newConfiguration && configuration.precache;
 			precachePixel = !newConfiguration && configuration.precache;
+			precacheBlit = !newConfiguration && configuration.precache;
+			rr::retainRoutineImages = !newConfiguration && configuration.precache;
 
 			VertexProcessor::setRoutineCacheSize(configuration.vertexRoutineCacheSize);
 			PixelProcessor::setRoutineCacheSize(configuration.pixelRoutineCacheSize);
 			SetupProcessor::setRoutineCacheSize(configuration.setupRoutineCacheSize);
 
+			vertexCacheSize = clamp(configuration.vertexCacheSize, 4, 4096);
+			vertexCacheAssociativity = configuration.vertexCacheAssociativity;
+			vertexCacheDeduplication = configuration.vertexCacheDeduplication;
+
 			switch(configuration.textureSampleQuality)
 			{
 			case 0:  Sampler::setFilterQuality(FILTER_POINT);       break;
@@ -2410,6 +2865,9 @@ namespace sw
 			default: threadCount = configuration.threadCount; break;
 			}
 
+			asyncRoutineCompilation = configuration.asyncCompilation && threadCount > 1;
+			tieredRoutineCompilation = configuration.tieredCompilation;
+
 			CPUID::setEnableSSE4_1(configuration.enableSSE4_1);
 			CPUID::setEnableSSSE3(configuration.enableSSSE3);
 			CPUID::setEnableSSE3(configuration.enableSSE3);
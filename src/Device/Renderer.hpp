@@ -25,6 +25,8 @@
 #include "Device/Config.hpp"
 
 #include <list>
+#include <deque>
+#include <vector>
 
 namespace sw
 {
@@ -165,6 +167,7 @@ namespace sw
 		float4 Y0x16;
 		float4 halfPixelX;
 		float4 halfPixelY;
+		float4 guardBand;   // Multiple of the viewport within which X and Y clipping is not needed
 		float viewportHeight;
 		float slopeDepthBias;
 		float depthRange;
@@ -192,6 +195,33 @@ namespace sw
 		float4 a2c3;
 	};
 
+	// Vertex and pixel routines which are generated on the compiler thread
+	struct RoutineJob
+	{
+		RoutineJob(const VertexProcessor::State &vertexState, const VertexShader *vertexShader, Routine *vertexRoutine,
+		           const PixelProcessor::State &pixelState, const PixelShader *pixelShader, Routine *pixelRoutine,
+		           bool optimize, bool upgrade);
+
+		~RoutineJob();
+
+		void bind();
+		void unbind();
+
+		const VertexProcessor::State vertexState;
+		const PixelProcessor::State pixelState;
+		const VertexShader *const vertexShader;   // Copies, as the application may delete its shaders
+		const PixelShader *const pixelShader;     // before their routines get generated
+
+		Routine *vertexRoutine;   // Null until generated
+		Routine *pixelRoutine;    // Null until generated
+
+		const bool optimize;
+		const bool upgrade;   // Replaces unoptimized routines in the caches, and isn't waited for by draws
+
+		AtomicInt done;
+		AtomicInt references;
+	};
+
 	class Renderer : public VertexProcessor, public PixelProcessor, public SetupProcessor
 	{
 		struct Task
@@ -336,6 +366,13 @@ namespace sw
 	private:
 		static void threadFunction(void *parameters);
 		void threadLoop(int threadIndex);
+		static void compilerFunction(void *parameters);
+		void compilerLoop();
+		void startCompiler();
+		RoutineJob *requestRoutines();
+		void retireRoutineJobs();
+		void upgradeRoutines();
+		void resumeThreads();
 		void taskLoop(int threadIndex);
 		void findAvailableTasks();
 		void scheduleTask(int threadIndex);
@@ -343,6 +380,7 @@ namespace sw
 		void finishRendering(Task &pixelTask);
 
 		void processPrimitiveVertices(int unit, unsigned int start, unsigned int count, unsigned int loop, int thread);
+		static int coverage(const Primitive *primitive, int count, int multiSample);
 
 		int setupTriangles(int batch, int count);
 		int setupLines(int batch, int count);
@@ -377,6 +415,7 @@ namespace sw
 
 		AtomicInt exitThreads;
 		AtomicInt threadsAwake;
+		AtomicInt inlineExecution;   // The application thread executes a small draw while all workers are suspended
 		Thread *worker[16];
 		Event *resume[16];         // Events for resuming threads
 		Event *suspend[16];        // Events for suspending threads
@@ -416,6 +455,7 @@ namespace sw
 		#endif
 
 		VertexTask *vertexTask[16];
+		Vertex *dedupVertices[16];   // Per-thread output of the vertex deduplication pass
 
 		SwiftConfig *swiftConfig;
 
@@ -429,6 +469,16 @@ namespace sw
 		Routine *vertexRoutine;
 		Routine *setupRoutine;
 		Routine *pixelRoutine;
+		RoutineJob *routineJob;   // Provides the vertex and pixel routines while they are being generated
+
+		Thread *compiler;
+		Event *compileRequest;
+		AtomicInt exitCompiler;
+		AtomicInt pendingCompiles;   // Jobs which have not resumed the renderer after generating their routines
+		MutexLock compileMutex;
+		MutexLock resumeMutex;   // Both the application and the compiler thread can wake the workers
+		std::deque<RoutineJob*> compileQueue;
+		std::vector<RoutineJob*> routineJobs;   // Jobs whose routines have not been added to the caches yet
 	};
 
 	struct DrawCall
@@ -447,9 +497,11 @@ namespace sw
 		VertexProcessor::RoutinePointer vertexPointer;
 		SetupProcessor::RoutinePointer setupPointer;
 		PixelProcessor::RoutinePointer pixelPointer;
+		RoutineJob *routineJob;   // Vertex and pixel routines are bound when the draw gets scheduled
 
 		int (Renderer::*setupPrimitives)(int batch, int count);
 		SetupProcessor::State setupState;
+		bool dedupVertices;
 
 		Resource *vertexStream[MAX_VERTEX_INPUTS];
 		Resource *indexBuffer;
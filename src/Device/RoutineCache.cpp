@@ -0,0 +1,331 @@
+// Copyright 2018 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RoutineCache.hpp"
+
+#include "System/CPUID.hpp"
+#include "System/MutexLock.hpp"
+#include "Reactor/CPUID.hpp"
+
+#if !defined(_WIN32)
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace sw
+{
+	struct RoutineStore::Record
+	{
+		uint64_t keyHash;
+		uint64_t imageHash;
+		uint32_t keySize;
+		uint32_t imageSize;
+
+		// Followed by the key and the image, padded to a multiple of 8 bytes
+		const unsigned char *key() const { return reinterpret_cast<const unsigned char*>(this + 1); }
+		const unsigned char *image() const { return key() + keySize; }
+		size_t size() const { return (sizeof(Record) + keySize + imageSize + 7) & ~size_t(7); }
+	};
+
+	namespace
+	{
+		const uint32_t storeMagic = 0x43525753;   // "SWRC"
+		const uint32_t storeVersion = 1;
+
+		struct Header
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint64_t fingerprint;
+		};
+
+		uint64_t hash64(const void *data, size_t size, uint64_t hash = 0xCBF29CE484222325ull)
+		{
+			const unsigned char *bytes = static_cast<const unsigned char*>(data);
+
+			// 64-bit FNV-1a
+			for(size_t i = 0; i < size; i++)
+			{
+				hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+			}
+
+			return hash;
+		}
+
+		#if !defined(_WIN32)
+			// Identifies the code generators and the CPU features they use. Images stored by
+			// a different build or on a different CPU are discarded.
+			uint64_t fingerprint(size_t keySize)
+			{
+				uint64_t features = (uint64_t)rr::CPUID::supportsMMX()     << 0 |
+				                    (uint64_t)rr::CPUID::supportsCMOV()    << 1 |
+				                    (uint64_t)rr::CPUID::supportsSSE()     << 2 |
+				                    (uint64_t)rr::CPUID::supportsSSE2()    << 3 |
+				                    (uint64_t)rr::CPUID::supportsSSE3()    << 4 |
+				                    (uint64_t)rr::CPUID::supportsSSSE3()   << 5 |
+				                    (uint64_t)rr::CPUID::supportsSSE4_1()  << 6 |
+				                    (uint64_t)rr::CPUID::supportsAVX()     << 7 |
+				                    (uint64_t)rr::CPUID::supportsAVX2()    << 8 |
+				                    (uint64_t)rr::CPUID::supportsAVX512F() << 9 |
+				                    (uint64_t)rr::CPUID::supportsFMA()     << 10 |
+				                    (uint64_t)sw::CPUID::supportsSSE()     << 16 |
+				                    (uint64_t)sw::CPUID::supportsSSE2()    << 17 |
+				                    (uint64_t)sw::CPUID::supportsSSE3()    << 18 |
+				                    (uint64_t)sw::CPUID::supportsSSSE3()   << 19 |
+				                    (uint64_t)sw::CPUID::supportsSSE4_1()  << 20;
+
+				uint64_t identity[] = {storeVersion, sizeof(void*), keySize, features, 0, 0, 0};
+
+				static int symbol = 0;
+				Dl_info info;
+				struct stat library;
+
+				if(dladdr(&symbol, &info) != 0 && stat(info.dli_fname, &library) == 0)
+				{
+					identity[4] = (uint64_t)library.st_size;
+					identity[5] = (uint64_t)library.st_mtime;
+					identity[6] = (uint64_t)library.st_ino;
+				}
+
+				return hash64(identity, sizeof(identity));
+			}
+
+			std::string cacheDirectory()
+			{
+				std::string directory;
+
+				if(const char *cacheHome = getenv("XDG_CACHE_HOME"))
+				{
+					directory = cacheHome;
+				}
+				else if(const char *home = getenv("HOME"))
+				{
+					directory = std::string(home) + "/.cache";
+					mkdir(directory.c_str(), 0700);
+				}
+				else
+				{
+					return "";
+				}
+
+				directory += "/swiftshader";
+				mkdir(directory.c_str(), 0700);
+
+				return directory;
+			}
+
+			// Writes the header to a file of its own and moves it into place, so processes racing to
+			// create or replace the store never see a partial header, nor truncate each other's records.
+			int createStore(const std::string &path, const Header &header)
+			{
+				std::string temporary = path + "." + std::to_string(getpid());
+				int file = ::open(temporary.c_str(), O_RDWR | O_CREAT | O_EXCL | O_APPEND | O_CLOEXEC, 0600);
+
+				if(file < 0)
+				{
+					return -1;
+				}
+
+				if(write(file, &header, sizeof(Header)) != (ssize_t)sizeof(Header) || rename(temporary.c_str(), path.c_str()) != 0)
+				{
+					::close(file);
+					unlink(temporary.c_str());
+
+					return -1;
+				}
+
+				return file;
+			}
+		#endif
+
+		MutexLock storesMutex;
+
+		std::unordered_map<std::string, RoutineStore*> &openStores()
+		{
+			static std::unordered_map<std::string, RoutineStore*> stores;
+
+			return stores;
+		}
+	}
+
+	RoutineStore *RoutineStore::open(const char *name, size_t keySize)
+	{
+		#if defined(_WIN32)
+			return nullptr;
+		#else
+			std::string directory = cacheDirectory();
+
+			if(directory.empty())
+			{
+				return nullptr;
+			}
+
+			std::string path = directory + "/" + name + ".bin";
+
+			storesMutex.lock();
+
+			RoutineStore *&store = openStores()[path];
+
+			if(!store)
+			{
+				store = new RoutineStore(path, keySize);
+			}
+
+			store->references++;
+
+			storesMutex.unlock();
+
+			return store;
+		#endif
+	}
+
+	void RoutineStore::close(RoutineStore *store)
+	{
+		storesMutex.lock();
+
+		if(--store->references == 0)
+		{
+			openStores().erase(store->path);
+			delete store;
+		}
+
+		storesMutex.unlock();
+	}
+
+	RoutineStore::RoutineStore(const std::string &path, size_t keySize) : path(path), keySize(keySize), references(0)
+	{
+		file = -1;
+		mapping = nullptr;
+		mappingSize = 0;
+
+		#if !defined(_WIN32)
+			file = ::open(path.c_str(), O_RDWR | O_APPEND | O_CLOEXEC);
+
+			Header header = {storeMagic, storeVersion, fingerprint(keySize)};
+			struct stat status;
+
+			if(file >= 0 && fstat(file, &status) == 0 && status.st_size >= (off_t)sizeof(Header))
+			{
+				mappingSize = (size_t)status.st_size;
+				void *memory = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, file, 0);
+				mapping = (memory != MAP_FAILED) ? static_cast<const unsigned char*>(memory) : nullptr;
+			}
+
+			if(mapping && memcmp(mapping, &header, sizeof(Header)) != 0)
+			{
+				munmap(const_cast<unsigned char*>(mapping), mappingSize);
+				mapping = nullptr;
+			}
+
+			if(!mapping)   // Missing, stale or unreadable
+			{
+				mappingSize = 0;
+
+				if(file >= 0)
+				{
+					::close(file);
+				}
+
+				file = createStore(path, header);
+
+				return;
+			}
+
+			size_t offset = sizeof(Header);
+
+			while(offset + sizeof(Record) <= mappingSize)
+			{
+				const Record *record = reinterpret_cast<const Record*>(mapping + offset);
+
+				if(record->keySize != keySize || record->size() > mappingSize - offset)
+				{
+					break;   // Interrupted write
+				}
+
+				index.emplace(record->keyHash, record);
+				offset += record->size();
+			}
+		#endif
+	}
+
+	RoutineStore::~RoutineStore()
+	{
+		#if !defined(_WIN32)
+			if(mapping)
+			{
+				munmap(const_cast<unsigned char*>(mapping), mappingSize);
+			}
+
+			if(file >= 0)
+			{
+				::close(file);
+			}
+		#endif
+	}
+
+	Routine *RoutineStore::load(const void *key) const
+	{
+		auto range = index.equal_range(hash64(key, keySize));
+
+		for(auto entry = range.first; entry != range.second; entry++)
+		{
+			const Record *record = entry->second;
+
+			if(memcmp(record->key(), key, keySize) == 0 &&
+			   hash64(record->image(), record->imageSize) == record->imageHash)
+			{
+				return Nucleus::loadRoutine(record->image(), record->imageSize);
+			}
+		}
+
+		return nullptr;
+	}
+
+	void RoutineStore::store(const void *key, Routine *routine)
+	{
+		#if !defined(_WIN32)
+			size_t imageSize = 0;
+			const void *image = routine->getImage(imageSize);
+
+			if(!image)
+			{
+				return;
+			}
+
+			Record header = {hash64(key, keySize), hash64(image, imageSize), (uint32_t)keySize, (uint32_t)imageSize};
+			std::string record(header.size(), '\0');
+
+			memcpy(&record[0], &header, sizeof(Record));
+			memcpy(&record[sizeof(Record)], key, keySize);
+			memcpy(&record[sizeof(Record) + keySize], image, imageSize);
+
+			mutex.lock();
+
+			// A single appending write keeps records from concurrent processes intact
+			if(file >= 0 && write(file, record.data(), record.size()) != (ssize_t)record.size())
+			{
+				::close(file);
+				file = -1;
+			}
+
+			mutex.unlock();
+		#endif
+	}
+}
@@ -18,11 +18,43 @@
 #include "LRUCache.hpp"
 
 #include "Reactor/Reactor.hpp"
+#include "System/MutexLock.hpp"
+
+#include <string>
+#include <unordered_map>
 
 namespace sw
 {
 	using namespace rr;
 
+	// Routine images stored in a file, so later processes can load them instead of generating them again.
+	// The file is mapped read-only when opened. Routines stored afterwards are appended for the next process.
+	class RoutineStore
+	{
+	public:
+		static RoutineStore *open(const char *name, size_t keySize);
+		static void close(RoutineStore *store);
+
+		Routine *load(const void *key) const;   // Returns null if the key was not stored
+		void store(const void *key, Routine *routine);
+
+	private:
+		RoutineStore(const std::string &path, size_t keySize);
+		~RoutineStore();
+
+		struct Record;
+
+		const std::string path;
+		const size_t keySize;
+		int references;
+
+		MutexLock mutex;   // Guards file, which is closed when a write fails
+		int file;
+		const unsigned char *mapping;
+		size_t mappingSize;
+		std::unordered_multimap<uint64_t, const Record*> index;   // Stored records by key hash
+	};
+
 	template<class State>
 	class RoutineCache : public LRUCache<State, Routine>
 	{
@@ -30,21 +62,45 @@ namespace sw
 		RoutineCache(int n, const char *precache = 0);
 		~RoutineCache();
 
+		// On-disk routines. The state must not contain values which differ between processes.
+		Routine *load(const State &state) const;
+		void store(const State &state, Routine *routine);
+
 	private:
-		const char *precache;
-		#if defined(_WIN32)
-		HMODULE precacheDLL;
-		#endif
+		RoutineStore *precache;
 	};
 
 	template<class State>
-	RoutineCache<State>::RoutineCache(int n, const char *precache) : LRUCache<State, Routine>(n), precache(precache)
+	RoutineCache<State>::RoutineCache(int n, const char *precache) : LRUCache<State, Routine>(n), precache(nullptr)
 	{
+		if(precache)
+		{
+			this->precache = RoutineStore::open(precache, sizeof(State));
+		}
 	}
 
 	template<class State>
 	RoutineCache<State>::~RoutineCache()
 	{
+		if(precache)
+		{
+			RoutineStore::close(precache);
+		}
+	}
+
+	template<class State>
+	Routine *RoutineCache<State>::load(const State &state) const
+	{
+		return precache ? precache->load(&state) : nullptr;
+	}
+
+	template<class State>
+	void RoutineCache<State>::store(const State &state, Routine *routine)
+	{
+		if(precache)
+		{
+			precache->store(&state, routine);
+		}
 	}
 }
 
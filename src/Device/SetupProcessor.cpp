@@ -31,15 +31,7 @@ namespace sw
 
 	unsigned int SetupProcessor::States::computeHash()
 	{
-		unsigned int *state = (unsigned int*)this;
-		unsigned int hash = 0;
-
-		for(unsigned int i = 0; i < sizeof(States) / 4; i++)
-		{
-			hash ^= state[i];
-		}
-
-		return hash;
+		return (unsigned int)FNV_1a(reinterpret_cast<const unsigned char*>(this), sizeof(States));
 	}
 
 	SetupProcessor::State::State(int i)
@@ -148,6 +140,16 @@ namespace sw
 	{
 		Routine *routine = routineCache->query(state);
 
+		if(!routine)
+		{
+			routine = routineCache->load(state);
+
+			if(routine)
+			{
+				routineCache->add(state, routine);
+			}
+		}
+
 		if(!routine)
 		{
 			SetupRoutine *generator = new SetupRoutine(state);
@@ -156,6 +158,7 @@ namespace sw
 			delete generator;
 
 			routineCache->add(state, routine);
+			routineCache->store(state, routine);
 		}
 
 		return routine;
@@ -14,12 +14,15 @@
 
 #include "Surface.hpp"
 
+#include "ASTC_Decoder.hpp"
 #include "Color.hpp"
 #include "Context.hpp"
 #include "ETC_Decoder.hpp"
+#include "LRUCache.hpp"
 #include "Renderer.hpp"
 #include "System/Half.hpp"
 #include "System/Memory.hpp"
+#include "System/MutexLock.hpp"
 #include "System/CPUID.hpp"
 #include "System/Resource.hpp"
 #include "Vulkan/VkDebug.hpp"
@@ -38,6 +41,119 @@ namespace sw
 	extern bool quadLayoutEnabled;
 	extern bool complementaryDepthBuffer;
 	extern TranscendentalPrecision logPrecision;
+	extern AtomicInt threadCount;
+
+	struct Surface::DecodeTask
+	{
+		BlockDecoder decoder;
+		const Buffer *internal;
+		byte *dest;
+		const byte *source;
+		int blockRowB;
+		int width;
+		int rowsPerLayer;   // Of blocks
+		int rows;
+	};
+
+	struct Surface::ASTCDecodeTask
+	{
+		const Buffer *internal;
+		const byte *source;
+		byte *dest;
+		int width;    // Of the encoded image
+		int height;
+		int xBlockSize;
+		int yBlockSize;
+		int zBlockSize;
+		bool isSRGB;
+		const byte *toLinear;   // 8-bit linear values of sRGB values
+		int rows;   // Of blocks, through all layers
+	};
+
+	namespace
+	{
+		// 8-bit linear intensities of 8-bit sRGB values
+		struct SRGBTables
+		{
+			SRGBTables()
+			{
+				for(int i = 0; i < 256; i++)
+				{
+					toLinear8[i] = (unsigned char)(sRGBtoLinear(i / 255.0f) * 255.0f + 0.5f);
+				}
+			}
+
+			unsigned char toLinear8[256];
+		};
+
+		const SRGBTables &sRGBTables()
+		{
+			static const SRGBTables tables;
+
+			return tables;
+		}
+
+		// Identifies a decoded ASTC level by the hash of its blocks and the layout of the decoded texels
+		struct ASTCLevelKey
+		{
+			bool operator==(const ASTCLevelKey &key) const
+			{
+				return memcmp(this, &key, sizeof(ASTCLevelKey)) == 0;
+			}
+
+			uint64_t blocksHash;
+			int format;
+			int width;
+			int height;
+			int depth;
+			int pitchB;
+			int sliceB;
+		};
+
+		class ASTCLevel
+		{
+		public:
+			ASTCLevel(const byte *texels, size_t size) : size(size), bindCount(0)
+			{
+				data = new byte[size];
+				memcpy(data, texels, size);
+			}
+
+			void bind()
+			{
+				++bindCount;
+			}
+
+			void unbind()
+			{
+				if(bindCount-- == 0)
+				{
+					delete this;
+				}
+			}
+
+			byte *data;
+			const size_t size;
+
+		private:
+			~ASTCLevel()
+			{
+				delete[] data;
+			}
+
+			AtomicInt bindCount;
+		};
+
+		// Applications commonly upload the same ASTC assets repeatedly, which only get decoded the first time
+		MutexLock astcCacheMutex;
+
+		LRUCache<ASTCLevelKey, ASTCLevel> &astcCache()
+		{
+			static LRUCache<ASTCLevelKey, ASTCLevel> cache(ASTC_DECODE_CACHE_LEVELS);
+
+			return cache;
+		}
+	}
 
 	void Surface::Buffer::write(int x, int y, int z, const Color<float> &color)
 	{
@@ -1445,34 +1561,34 @@ namespace sw
 			case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK: decodeETC2(destination, source, 1, true);  break; // FIXME: Check destination format
 			case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:                 decodeETC2(destination, source, 8, false); break; // FIXME: Check destination format
 			case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:          decodeETC2(destination, source, 8, true);  break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:           decodeASTC(destination, source, 4,  4,  1, false); break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_5x4_UNORM_BLOCK:           decodeASTC(destination, source, 5,  4,  1, false); break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_5x5_UNORM_BLOCK:           decodeASTC(destination, source, 5,  5,  1, false); break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_6x5_UNORM_BLOCK:           decodeASTC(destination, source, 6,  5,  1, false); break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_6x6_UNORM_BLOCK:           decodeASTC(destination, source, 6,  6,  1, false); break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_8x5_UNORM_BLOCK:           decodeASTC(destination, source, 8,  5,  1, false); break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_8x6_UNORM_BLOCK:           decodeASTC(destination, source, 8,  6,  1, false); break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_8x8_UNORM_BLOCK:           decodeASTC(destination, source, 8,  8,  1, false); break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_10x5_UNORM_BLOCK:          decodeASTC(destination, source, 10, 5,  1, false); break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_10x6_UNORM_BLOCK:          decodeASTC(destination, source, 10, 6,  1, false); break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_10x8_UNORM_BLOCK:          decodeASTC(destination, source, 10, 8,  1, false); break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_10x10_UNORM_BLOCK:         decodeASTC(destination, source, 10, 10, 1, false); break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_12x10_UNORM_BLOCK:         decodeASTC(destination, source, 12, 10, 1, false); break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_12x12_UNORM_BLOCK:         decodeASTC(destination, source, 12, 12, 1, false); break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:   decodeASTC(destination, source, 4,  4,  1, true);  break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_5x4_SRGB_BLOCK:   decodeASTC(destination, source, 5,  4,  1, true);  break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_5x5_SRGB_BLOCK:   decodeASTC(destination, source, 5,  5,  1, true);  break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_6x5_SRGB_BLOCK:   decodeASTC(destination, source, 6,  5,  1, true);  break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_6x6_SRGB_BLOCK:   decodeASTC(destination, source, 6,  6,  1, true);  break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_8x5_SRGB_BLOCK:   decodeASTC(destination, source, 8,  5,  1, true);  break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_8x6_SRGB_BLOCK:   decodeASTC(destination, source, 8,  6,  1, true);  break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_8x8_SRGB_BLOCK:   decodeASTC(destination, source, 8,  8,  1, true);  break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_10x5_SRGB_BLOCK:  decodeASTC(destination, source, 10, 5,  1, true);  break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_10x6_SRGB_BLOCK:  decodeASTC(destination, source, 10, 6,  1, true);  break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_10x8_SRGB_BLOCK:  decodeASTC(destination, source, 10, 8,  1, true);  break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_10x10_SRGB_BLOCK: decodeASTC(destination, source, 10, 10, 1, true);  break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_12x10_SRGB_BLOCK: decodeASTC(destination, source, 12, 10, 1, true);  break; // FIXME: Check destination format
-			case VK_FORMAT_ASTC_12x12_SRGB_BLOCK: decodeASTC(destination, source, 12, 12, 1, true);  break; // FIXME: Check destination format
+			case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:           decodeASTC(destination, source, 4,  4,  1, false); break;
+			case VK_FORMAT_ASTC_5x4_UNORM_BLOCK:           decodeASTC(destination, source, 5,  4,  1, false); break;
+			case VK_FORMAT_ASTC_5x5_UNORM_BLOCK:           decodeASTC(destination, source, 5,  5,  1, false); break;
+			case VK_FORMAT_ASTC_6x5_UNORM_BLOCK:           decodeASTC(destination, source, 6,  5,  1, false); break;
+			case VK_FORMAT_ASTC_6x6_UNORM_BLOCK:           decodeASTC(destination, source, 6,  6,  1, false); break;
+			case VK_FORMAT_ASTC_8x5_UNORM_BLOCK:           decodeASTC(destination, source, 8,  5,  1, false); break;
+			case VK_FORMAT_ASTC_8x6_UNORM_BLOCK:           decodeASTC(destination, source, 8,  6,  1, false); break;
+			case VK_FORMAT_ASTC_8x8_UNORM_BLOCK:           decodeASTC(destination, source, 8,  8,  1, false); break;
+			case VK_FORMAT_ASTC_10x5_UNORM_BLOCK:          decodeASTC(destination, source, 10, 5,  1, false); break;
+			case VK_FORMAT_ASTC_10x6_UNORM_BLOCK:          decodeASTC(destination, source, 10, 6,  1, false); break;
+			case VK_FORMAT_ASTC_10x8_UNORM_BLOCK:          decodeASTC(destination, source, 10, 8,  1, false); break;
+			case VK_FORMAT_ASTC_10x10_UNORM_BLOCK:         decodeASTC(destination, source, 10, 10, 1, false); break;
+			case VK_FORMAT_ASTC_12x10_UNORM_BLOCK:         decodeASTC(destination, source, 12, 10, 1, false); break;
+			case VK_FORMAT_ASTC_12x12_UNORM_BLOCK:         decodeASTC(destination, source, 12, 12, 1, false); break;
+			case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:   decodeASTC(destination, source, 4,  4,  1, true);  break;
+			case VK_FORMAT_ASTC_5x4_SRGB_BLOCK:   decodeASTC(destination, source, 5,  4,  1, true);  break;
+			case VK_FORMAT_ASTC_5x5_SRGB_BLOCK:   decodeASTC(destination, source, 5,  5,  1, true);  break;
+			case VK_FORMAT_ASTC_6x5_SRGB_BLOCK:   decodeASTC(destination, source, 6,  5,  1, true);  break;
+			case VK_FORMAT_ASTC_6x6_SRGB_BLOCK:   decodeASTC(destination, source, 6,  6,  1, true);  break;
+			case VK_FORMAT_ASTC_8x5_SRGB_BLOCK:   decodeASTC(destination, source, 8,  5,  1, true);  break;
+			case VK_FORMAT_ASTC_8x6_SRGB_BLOCK:   decodeASTC(destination, source, 8,  6,  1, true);  break;
+			case VK_FORMAT_ASTC_8x8_SRGB_BLOCK:   decodeASTC(destination, source, 8,  8,  1, true);  break;
+			case VK_FORMAT_ASTC_10x5_SRGB_BLOCK:  decodeASTC(destination, source, 10, 5,  1, true);  break;
+			case VK_FORMAT_ASTC_10x6_SRGB_BLOCK:  decodeASTC(destination, source, 10, 6,  1, true);  break;
+			case VK_FORMAT_ASTC_10x8_SRGB_BLOCK:  decodeASTC(destination, source, 10, 8,  1, true);  break;
+			case VK_FORMAT_ASTC_10x10_SRGB_BLOCK: decodeASTC(destination, source, 10, 10, 1, true);  break;
+			case VK_FORMAT_ASTC_12x10_SRGB_BLOCK: decodeASTC(destination, source, 12, 10, 1, true);  break;
+			case VK_FORMAT_ASTC_12x12_SRGB_BLOCK: decodeASTC(destination, source, 12, 12, 1, true);  break;
 			default:				genericUpdate(destination, source);		break;
 			}
 		}
@@ -1856,60 +1972,69 @@ namespace sw
 
 	void Surface::decodeETC2(Buffer &internal, Buffer &external, int nbAlphaBits, bool isSRGB)
 	{
-		ETC_Decoder::Decode((const byte*)external.lockRect(0, 0, 0, LOCK_READONLY), (byte*)internal.lockRect(0, 0, 0, LOCK_UPDATE), external.width, external.height, internal.width, internal.height, internal.pitchB, internal.bytes,
-		                    (nbAlphaBits == 8) ? ETC_Decoder::ETC_RGBA : ((nbAlphaBits == 1) ? ETC_Decoder::ETC_RGB_PUNCHTHROUGH_ALPHA : ETC_Decoder::ETC_RGB));
-		external.unlockRect();
-		internal.unlockRect();
+		switch(nbAlphaBits)
+		{
+		case 8:  decodeBlocks(internal, external, 16, isSRGB ? decodeETC2Blocks<ETC_Decoder::ETC_RGBA, true> : decodeETC2Blocks<ETC_Decoder::ETC_RGBA, false>); break;
+		case 1:  decodeBlocks(internal, external, 8, isSRGB ? decodeETC2Blocks<ETC_Decoder::ETC_RGB_PUNCHTHROUGH_ALPHA, true> : decodeETC2Blocks<ETC_Decoder::ETC_RGB_PUNCHTHROUGH_ALPHA, false>); break;
+		default: decodeBlocks(internal, external, 8, isSRGB ? decodeETC2Blocks<ETC_Decoder::ETC_RGB, true> : decodeETC2Blocks<ETC_Decoder::ETC_RGB, false>); break;
+		}
+	}
 
-		if(isSRGB)
+	void Surface::decodeEAC(Buffer &internal, Buffer &external, int nbChannels, bool isSigned)
+	{
+		ASSERT(nbChannels == 1 || nbChannels == 2);
+
+		if(nbChannels == 1)
 		{
-			static byte sRGBtoLinearTable[256];
-			static bool sRGBtoLinearTableDirty = true;
-			if(sRGBtoLinearTableDirty)
-			{
-				for(int i = 0; i < 256; i++)
-				{
-					sRGBtoLinearTable[i] = static_cast<byte>(sRGBtoLinear(static_cast<float>(i) / 255.0f) * 255.0f + 0.5f);
-				}
-				sRGBtoLinearTableDirty = false;
-			}
+			decodeBlocks(internal, external, 8, isSigned ? decodeEACBlocks<ETC_Decoder::ETC_R_SIGNED> : decodeEACBlocks<ETC_Decoder::ETC_R_UNSIGNED>);
+		}
+		else
+		{
+			decodeBlocks(internal, external, 16, isSigned ? decodeEACBlocks<ETC_Decoder::ETC_RG_SIGNED> : decodeEACBlocks<ETC_Decoder::ETC_RG_UNSIGNED>);
+		}
+	}
 
+	template<int inputType, bool isSRGB>
+	void Surface::decodeETC2Blocks(byte *dest, int pitchB, const byte *source, int width, int height)
+	{
+		ETC_Decoder::Decode(source, dest, width, height, width, height, pitchB, 4, static_cast<ETC_Decoder::InputType>(inputType));
+
+		if(isSRGB)
+		{
 			// Perform sRGB conversion in place after decoding
-			byte *src = (byte*)internal.lockRect(0, 0, 0, LOCK_READWRITE);
-			for(int y = 0; y < internal.height; y++)
+			const unsigned char *toLinear = sRGBTables().toLinear8;
+
+			for(int y = 0; y < height; y++)
 			{
-				byte *srcRow = src + y * internal.pitchB;
-				for(int x = 0; x <  internal.width; x++)
+				byte *texel = dest + y * pitchB;
+
+				for(int x = 0; x < width; x++, texel += 4)
 				{
-					byte *srcPix = srcRow + x * internal.bytes;
-					for(int i = 0; i < 3; i++)
-					{
-						srcPix[i] = sRGBtoLinearTable[srcPix[i]];
-					}
+					texel[0] = toLinear[texel[0]];
+					texel[1] = toLinear[texel[1]];
+					texel[2] = toLinear[texel[2]];
 				}
 			}
-			internal.unlockRect();
 		}
 	}
 
-	void Surface::decodeEAC(Buffer &internal, Buffer &external, int nbChannels, bool isSigned)
+	template<int inputType>
+	void Surface::decodeEACBlocks(byte *dest, int pitchB, const byte *source, int width, int height)
 	{
-		ASSERT(nbChannels == 1 || nbChannels == 2);
+		const bool isSigned = (inputType == ETC_Decoder::ETC_R_SIGNED) || (inputType == ETC_Decoder::ETC_RG_SIGNED);
+		const int nbChannels = ((inputType == ETC_Decoder::ETC_RG_SIGNED) || (inputType == ETC_Decoder::ETC_RG_UNSIGNED)) ? 2 : 1;
 
-		byte *src = (byte*)internal.lockRect(0, 0, 0, LOCK_READWRITE);
-		ETC_Decoder::Decode((const byte*)external.lockRect(0, 0, 0, LOCK_READONLY), src, external.width, external.height, internal.width, internal.height, internal.pitchB, internal.bytes,
-		                    (nbChannels == 1) ? (isSigned ? ETC_Decoder::ETC_R_SIGNED : ETC_Decoder::ETC_R_UNSIGNED) : (isSigned ? ETC_Decoder::ETC_RG_SIGNED : ETC_Decoder::ETC_RG_UNSIGNED));
-		external.unlockRect();
+		ETC_Decoder::Decode(source, dest, width, height, width, height, pitchB, 4 * nbChannels, static_cast<ETC_Decoder::InputType>(inputType));
 
 		// FIXME: We convert EAC data to float, until signed short internal formats are supported
 		//        This code can be removed if ETC2 images are decoded to internal 16 bit signed R/RG formats
 		const float normalization = isSigned ? (1.0f / (8.0f * 127.875f)) : (1.0f / (8.0f * 255.875f));
-		for(int y = 0; y < internal.height; y++)
+		for(int y = 0; y < height; y++)
 		{
-			byte* srcRow = src + y * internal.pitchB;
-			for(int x = internal.width - 1; x >= 0; x--)
+			byte* srcRow = dest + y * pitchB;
+			for(int x = width - 1; x >= 0; x--)
 			{
-				int* srcPix = reinterpret_cast<int*>(srcRow + x * internal.bytes);
+				int* srcPix = reinterpret_cast<int*>(srcRow + x * 4 * nbChannels);
 				float* dstPix = reinterpret_cast<float*>(srcPix);
 				for(int c = nbChannels - 1; c >= 0; c--)
 				{
@@ -1917,12 +2042,145 @@ namespace sw
 				}
 			}
 		}
+	}
+
+	void Surface::decodeBlocks(Buffer &internal, Buffer &external, int blockBytes, BlockDecoder decoder)
+	{
+		DecodeTask task;
+		task.decoder = decoder;
+		task.internal = &internal;
+		task.dest = (byte*)internal.lockRect(0, 0, 0, LOCK_UPDATE);
+		task.source = (const byte*)external.lockRect(0, 0, 0, LOCK_READONLY);
+		task.blockRowB = blockBytes * ((external.width + 3) / 4);
+		task.width = min(internal.width, external.width);
+		task.rowsPerLayer = (external.height + 3) / 4;
+		task.rows = min(external.depth, internal.depth) * task.rowsPerLayer;
+
+		parallelRows(task.rows, min((int)threadCount, task.rows * task.width / 16384), decodeBlockRow, &task);   // A thread per 64k texels
 
+		external.unlockRect();
 		internal.unlockRect();
 	}
 
+	void Surface::decodeBlockRow(void *parameters, int row)
+	{
+		const DecodeTask *task = static_cast<const DecodeTask*>(parameters);
+		const Buffer &internal = *task->internal;
+
+		int z = row / task->rowsPerLayer;
+		int y = 4 * (row % task->rowsPerLayer);
+
+		if(y < internal.height)
+		{
+			byte *dest = task->dest + z * internal.sliceB + y * internal.pitchB;
+
+			task->decoder(dest, internal.pitchB, task->source + row * task->blockRowB, task->width, min(internal.height - y, 4));
+		}
+	}
+
 	void Surface::decodeASTC(Buffer &internal, Buffer &external, int xBlockSize, int yBlockSize, int zBlockSize, bool isSRGB)
 	{
+		const byte *source = (const byte*)external.lockRect(0, 0, 0, LOCK_READONLY);
+		byte *dest = (byte*)internal.lockRect(0, 0, 0, LOCK_UPDATE);
+		size_t size = (size_t)(internal.depth - 1) * internal.sliceB + (internal.height - 1) * internal.pitchB + internal.width * internal.bytes;
+		bool cacheable = (ASTC_DECODE_CACHE_LEVELS > 0) && (size <= (size_t)ASTC_DECODE_CACHE_LEVEL_SIZE);
+
+		ASTCLevelKey key;
+
+		if(cacheable)
+		{
+			key.blocksHash = FNV_1a(source, external.sliceB * external.depth);
+			key.format = external.format;
+			key.width = internal.width;
+			key.height = internal.height;
+			key.depth = internal.depth;
+			key.pitchB = internal.pitchB;
+			key.sliceB = internal.sliceB;
+
+			astcCacheMutex.lock();
+			ASTCLevel *level = astcCache().query(key);
+
+			if(level)
+			{
+				level->bind();
+			}
+
+			astcCacheMutex.unlock();
+
+			if(level)
+			{
+				memcpy(dest, level->data, size);
+				level->unbind();
+
+				external.unlockRect();
+				internal.unlockRect();
+
+				return;
+			}
+		}
+
+		int xBlocks = (external.width + xBlockSize - 1) / xBlockSize;
+		int yBlocks = (external.height + yBlockSize - 1) / yBlockSize;
+		int zBlocks = (external.depth + zBlockSize - 1) / zBlockSize;
+
+		ASTCDecodeTask task;
+		task.internal = &internal;
+		task.source = source;
+		task.dest = dest;
+		task.width = external.width;
+		task.height = external.height;
+		task.xBlockSize = xBlockSize;
+		task.yBlockSize = yBlockSize;
+		task.zBlockSize = zBlockSize;
+		task.isSRGB = isSRGB;
+		task.toLinear = isSRGB ? sRGBTables().toLinear8 : nullptr;
+		task.rows = yBlocks * zBlocks;
+
+		// Rows of blocks are decoded concurrently, with a thread per 4096 blocks
+		parallelRows(task.rows, min((int)threadCount, task.rows * xBlocks / 4096), decodeASTCRow, &task);
+
+		if(cacheable)
+		{
+			astcCacheMutex.lock();
+			astcCache().add(key, new ASTCLevel(dest, size));
+			astcCacheMutex.unlock();
+		}
+
+		external.unlockRect();
+		internal.unlockRect();
+	}
+
+	void Surface::decodeASTCRow(void *parameters, int row)
+	{
+		const ASTCDecodeTask *task = static_cast<const ASTCDecodeTask*>(parameters);
+		const Buffer &internal = *task->internal;
+		int yBlocks = (task->height + task->yBlockSize - 1) / task->yBlockSize;
+
+		ASTC_Decoder::Decode(task->source, task->dest, task->width, task->height, internal.width, internal.height, internal.depth, internal.pitchB, internal.sliceB,
+		                     task->xBlockSize, task->yBlockSize, task->zBlockSize, task->isSRGB, row, 1);
+
+		if(task->isSRGB)   // Decoded as sRGB encoded BGRA, linearized in place like ETC2
+		{
+			int y0 = (row % yBlocks) * task->yBlockSize;
+			int z0 = (row / yBlocks) * task->zBlockSize;
+			int y1 = min(y0 + task->yBlockSize, internal.height);
+			int z1 = min(z0 + task->zBlockSize, internal.depth);
+
+			for(int z = z0; z < z1; z++)
+			{
+				for(int y = y0; y < y1; y++)
+				{
+					byte *texel = task->dest + z * internal.sliceB + y * internal.pitchB;
+
+					for(int x = 0; x < internal.width; x++, texel += 4)
+					{
+						texel[0] = task->toLinear[texel[0]];
+						texel[1] = task->toLinear[texel[1]];
+						texel[2] = task->toLinear[texel[2]];
+					}
+				}
+			}
+		}
 	}
 
 	size_t Surface::size(int width, int height, int depth, int border, int samples, VkFormat format)
@@ -302,7 +302,21 @@ namespace sw
 		static void decodeATI2(Buffer &internal, Buffer &external);
 		static void decodeEAC(Buffer &internal, Buffer &external, int nbChannels, bool isSigned);
 		static void decodeETC2(Buffer &internal, Buffer &external, int nbAlphaBits, bool isSRGB);
+
+		// Decodes one row of 4x4 blocks, clipped to the given texel width and height
+		typedef void (*BlockDecoder)(byte *dest, int pitchB, const byte *source, int width, int height);
+
+		static void decodeBlocks(Buffer &internal, Buffer &external, int blockBytes, BlockDecoder decoder);
+		static void decodeBlockRow(void *parameters, int row);
+		template<int inputType, bool isSRGB>
+		static void decodeETC2Blocks(byte *dest, int pitchB, const byte *source, int width, int height);
+		template<int inputType>
+		static void decodeEACBlocks(byte *dest, int pitchB, const byte *source, int width, int height);
+
+		struct DecodeTask;
+
 		static void decodeASTC(Buffer &internal, Buffer &external, int xSize, int ySize, int zSize, bool isSRGB);
+		static void decodeASTCRow(void *parameters, int row);
 
 		static void update(Buffer &destination, Buffer &source);
 		static void genericUpdate(Buffer &destination, Buffer &source);
@@ -313,6 +327,7 @@ namespace sw
 		VkFormat selectInternalFormat(VkFormat format) const;
 
 		void resolve();
+		struct ASTCDecodeTask;
 
 		Buffer external;
 		Buffer internal;
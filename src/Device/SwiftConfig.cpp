@@ -336,8 +336,19 @@ namespace sw
 		html += "</tr>\n";
 		html += "<tr><td>Vertex cache size:</td><td><select name='vertexCacheSize' title='The number of processed vertices being cached for reuse. Lower numbers save memory but require more vertices to be reprocessed.'>\n";
 		html += "<option value='64'"   + (config.vertexCacheSize == 64   ? selected : empty) + ">64 (default)</option>\n";
+		html += "<option value='128'"  + (config.vertexCacheSize == 128  ? selected : empty) + ">128</option>\n";
+		html += "<option value='256'"  + (config.vertexCacheSize == 256  ? selected : empty) + ">256</option>\n";
+		html += "<option value='512'"  + (config.vertexCacheSize == 512  ? selected : empty) + ">512</option>\n";
 		html += "</select></td>\n";
 		html += "</tr>\n";
+		html += "<tr><td>Vertex cache associativity:</td><td><select name='vertexCacheAssociativity' title='The number of cache lines each vertex can be stored in. Higher numbers reduce conflicts between indices but make lookups slower.'>\n";
+		html += "<option value='1'" + (config.vertexCacheAssociativity == 1 ? selected : empty) + ">Direct mapped</option>\n";
+		html += "<option value='2'" + (config.vertexCacheAssociativity == 2 ? selected : empty) + ">2-way</option>\n";
+		html += "<option value='4'" + (config.vertexCacheAssociativity == 4 ? selected : empty) + ">4-way (default)</option>\n";
+		html += "<option value='8'" + (config.vertexCacheAssociativity == 8 ? selected : empty) + ">8-way</option>\n";
+		html += "</select></td>\n";
+		html += "</tr>\n";
+		html += "<tr><td>Vertex deduplication:</td><td><input name = 'vertexCacheDeduplication' type='checkbox'" + (config.vertexCacheDeduplication == true ? checked : empty) + " title='If checked each unique index in a batch of indexed primitives is processed exactly once, regardless of the vertex cache size.'></td></tr>\n";
 		html += "</table>\n";
 		html += "<h2><em>Quality</em></h2>\n";
 		html += "<table>\n";
@@ -431,7 +442,9 @@ namespace sw
 		html += "<option value='0'" + (config.frameBufferAPI == 0 ? selected : empty) + ">DirectDraw (default)</option>\n";
 		html += "<option value='1'" + (config.frameBufferAPI == 1 ? selected : empty) + ">GDI</option>\n";
 		html += "</select></td>\n";
-		html += "<tr><td>DLL precaching:</td><td><input name = 'precache' type='checkbox'" + (config.precache == true ? checked : empty) + " title='If checked dynamically generated routines will be stored in a DLL for faster loading on application restart.'></td></tr>";
+		html += "<tr><td>Routine precaching:</td><td><input name = 'precache' type='checkbox'" + (config.precache == true ? checked : empty) + " title='If checked dynamically generated routines will be stored on disk for faster loading on application restart.'></td></tr>";
+		html += "<tr><td>Asynchronous compilation:</td><td><input name = 'asyncCompilation' type='checkbox'" + (config.asyncCompilation == true ? checked : empty) + " title='If checked vertex and pixel routines are generated on a background thread, so the application does not wait for them when issuing draw calls. Draws which need a routine that is still being generated are deferred until it is ready; nothing is rendered with a fallback routine in the meantime.'></td></tr>";
+		html += "<tr><td>Tiered compilation:</td><td><input name = 'tieredCompilation' type='checkbox'" + (config.tieredCompilation == true ? checked : empty) + " title='If checked vertex and pixel routines are first generated without optimizations, and replaced by optimized ones in the background once they have been used by many draw calls.'></td></tr>";
 		html += "<tr><td>Shadow mapping extensions:</td><td><select name='shadowMapping' title='Features that may accelerate or improve the quality of shadow mapping.'>\n";
 		html += "<option value='0'" + (config.shadowMapping == 0 ? selected : empty) + ">None</option>\n";
 		html += "<option value='1'" + (config.shadowMapping == 1 ? selected : empty) + ">Fetch4</option>\n";
@@ -547,7 +560,10 @@ namespace sw
 		config.disableAlphaMode = false;
 		config.disable10BitMode = false;
 		config.precache = false;
+		config.asyncCompilation = false;
+		config.tieredCompilation = false;
 		config.forceClearRegisters = false;
+		config.vertexCacheDeduplication = false;
 
 		while(*post != 0)
 		{
@@ -586,6 +602,14 @@ namespace sw
 			{
 				config.vertexCacheSize = integer;
 			}
+			else if(sscanf(post, "vertexCacheAssociativity=%d", &integer))
+			{
+				config.vertexCacheAssociativity = integer;
+			}
+			else if(strstr(post, "vertexCacheDeduplication=on"))
+			{
+				config.vertexCacheDeduplication = true;
+			}
 			else if(sscanf(post, "textureSampleQuality=%d", &integer))
 			{
 				config.textureSampleQuality = integer;
@@ -686,6 +710,14 @@ namespace sw
 			{
 				config.precache = true;
 			}
+			else if(strstr(post, "asyncCompilation=on"))
+			{
+				config.asyncCompilation = true;
+			}
+			else if(strstr(post, "tieredCompilation=on"))
+			{
+				config.tieredCompilation = true;
+			}
 			else if(strstr(post, "forceClearRegisters=on"))
 			{
 				config.forceClearRegisters = true;
@@ -725,6 +757,8 @@ namespace sw
 		config.pixelRoutineCacheSize = ini.getInteger("Caches", "PixelRoutineCacheSize", 1024);
 		config.setupRoutineCacheSize = ini.getInteger("Caches", "SetupRoutineCacheSize", 1024);
 		config.vertexCacheSize = ini.getInteger("Caches", "VertexCacheSize", 64);
+		config.vertexCacheAssociativity = ini.getInteger("Caches", "VertexCacheAssociativity", 4);
+		config.vertexCacheDeduplication = ini.getBoolean("Caches", "VertexCacheDeduplication", false);
 		config.textureSampleQuality = ini.getInteger("Quality", "TextureSampleQuality", 2);
 		config.mipmapQuality = ini.getInteger("Quality", "MipmapQuality", 1);
 		config.perspectiveCorrection = ini.getBoolean("Quality", "PerspectiveCorrection", true);
@@ -751,6 +785,8 @@ namespace sw
 		config.disable10BitMode = ini.getBoolean("Testing", "Disable10BitMode", false);
 		config.frameBufferAPI = ini.getInteger("Testing", "FrameBufferAPI", 0);
 		config.precache = ini.getBoolean("Testing", "Precache", false);
+		config.asyncCompilation = ini.getBoolean("Testing", "AsyncCompilation", false);
+		config.tieredCompilation = ini.getBoolean("Testing", "TieredCompilation", false);
 		config.shadowMapping = ini.getInteger("Testing", "ShadowMapping", 3);
 		config.forceClearRegisters = ini.getBoolean("Testing", "ForceClearRegisters", false);
 
@@ -783,6 +819,8 @@ namespace sw
 		ini.addValue("Caches", "PixelRoutineCacheSize", itoa(config.pixelRoutineCacheSize));
 		ini.addValue("Caches", "SetupRoutineCacheSize", itoa(config.setupRoutineCacheSize));
 		ini.addValue("Caches", "VertexCacheSize", itoa(config.vertexCacheSize));
+		ini.addValue("Caches", "VertexCacheAssociativity", itoa(config.vertexCacheAssociativity));
+		ini.addValue("Caches", "VertexCacheDeduplication", itoa(config.vertexCacheDeduplication));
 		ini.addValue("Quality", "TextureSampleQuality", itoa(config.textureSampleQuality));
 		ini.addValue("Quality", "MipmapQuality", itoa(config.mipmapQuality));
 		ini.addValue("Quality", "PerspectiveCorrection", itoa(config.perspectiveCorrection));
@@ -809,6 +847,8 @@ namespace sw
 		ini.addValue("Testing", "Disable10BitMode", itoa(config.disable10BitMode));
 		ini.addValue("Testing", "FrameBufferAPI", itoa(config.frameBufferAPI));
 		ini.addValue("Testing", "Precache", itoa(config.precache));
+		ini.addValue("Testing", "AsyncCompilation", itoa(config.asyncCompilation));
+		ini.addValue("Testing", "TieredCompilation", itoa(config.tieredCompilation));
 		ini.addValue("Testing", "ShadowMapping", itoa(config.shadowMapping));
 		ini.addValue("Testing", "ForceClearRegisters", itoa(config.forceClearRegisters));
 		ini.addValue("LastModified", "Time", itoa((int)time(0)));
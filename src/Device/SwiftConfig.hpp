@@ -38,6 +38,8 @@ namespace sw
 			int pixelRoutineCacheSize;
 			int setupRoutineCacheSize;
 			int vertexCacheSize;
+			int vertexCacheAssociativity;
+			bool vertexCacheDeduplication;
 			int textureSampleQuality;
 			int mipmapQuality;
 			bool perspectiveCorrection;
@@ -60,6 +62,8 @@ namespace sw
 			int transparencyAntialiasing;
 			int frameBufferAPI;
 			bool precache;
+			bool asyncCompilation;
+			bool tieredCompilation;
 			int shadowMapping;
 			bool forceClearRegisters;
 		#ifndef NDEBUG
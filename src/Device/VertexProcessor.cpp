@@ -19,6 +19,7 @@
 #include "Pipeline/PixelShader.hpp"
 #include "Pipeline/Constants.hpp"
 #include "System/Math.hpp"
+#include "System/Memory.hpp"
 #include "Vulkan/VkDebug.hpp"
 
 #include <string.h>
@@ -26,26 +27,63 @@
 namespace sw
 {
 	bool precacheVertex = false;
+	int vertexCacheSize = 64;
+	int vertexCacheAssociativity = 4;
+	bool vertexCacheDeduplication = false;
 
-	void VertexCache::clear()
+	void VertexCache::allocate(int size, int associativity)
 	{
-		for(int i = 0; i < 16; i++)
+		ways = 1;
+		while(ways < 8 && ways * 2 <= (unsigned int)associativity)
 		{
-			tag[i] = 0x80000000;
+			ways *= 2;
 		}
+
+		unsigned int sets = 1;
+		while(sets * 2 * ways * 4 <= (unsigned int)size && sets < 1024)
+		{
+			sets *= 2;
+		}
+
+		setMask = sets - 1;
+
+		vertex = (Vertex(*)[4])sw::allocate(sets * ways * sizeof(Vertex[4]));
+		tag = (unsigned int*)sw::allocate(sets * ways * sizeof(unsigned int));
+		victim = (unsigned int*)sw::allocate(sets * sizeof(unsigned int));
+
+		drawCall = -1;
+		clear();
 	}
 
-	unsigned int VertexProcessor::States::computeHash()
+	void VertexCache::deallocate()
 	{
-		unsigned int *state = (unsigned int*)this;
-		unsigned int hash = 0;
+		sw::deallocate(vertex);
+		sw::deallocate(tag);
+		sw::deallocate(victim);
+
+		vertex = nullptr;
+		tag = nullptr;
+		victim = nullptr;
+	}
 
-		for(unsigned int i = 0; i < sizeof(States) / 4; i++)
+	void VertexCache::clear()
+	{
+		unsigned int sets = setMask + 1;
+
+		for(unsigned int i = 0; i < sets * ways; i++)
+		{
+			tag[i] = 0x80000000;
+		}
+
+		for(unsigned int i = 0; i < sets; i++)
 		{
-			hash ^= state[i];
+			victim[i] = 0;
 		}
+	}
 
-		return hash;
+	unsigned int VertexProcessor::States::computeHash()
+	{
+		return (unsigned int)FNV_1a(reinterpret_cast<const unsigned char*>(this), sizeof(States));
 	}
 
 	VertexProcessor::State::State()
@@ -391,6 +429,7 @@ namespace sw
 		State state;
 
 		state.shaderID = context->vertexShader->getSerialID();
+		state.shaderHash = precacheVertex ? context->vertexShader->getHash() : 0;
 
 		state.fixedFunction = !context->vertexShader && context->pixelShaderModel() < 0x0300;
 		state.textureSampling = context->vertexShader ? context->vertexShader->containsTextureSampling() : false;
@@ -439,19 +478,64 @@ namespace sw
 		return state;
 	}
 
-	Routine *VertexProcessor::routine(const State &state)
+	Routine *VertexProcessor::routine(const State &state, bool optimize)
 	{
-		Routine *routine = routineCache->query(state);
+		Routine *routine = cachedRoutine(state);
 
 		if(!routine)   // Create one
 		{
-			VertexRoutine *generator = new VertexProgram(state, context->vertexShader);
-			generator->generate();
-			routine = (*generator)("VertexRoutine_%0.8X", state.shaderID);
-			delete generator;
+			routine = generate(state, context->vertexShader, optimize);
+			cacheRoutine(state, routine);
+		}
 
-			routineCache->add(state, routine);
+		return routine;
+	}
+
+	Routine *VertexProcessor::cachedRoutine(const State &state)
+	{
+		Routine *routine = routineCache->query(state);
+
+		if(!routine)
+		{
+			routine = routineCache->load(persistentState(state));
+
+			if(routine)
+			{
+				routineCache->add(state, routine);
+			}
+		}
+
+		return routine;
+	}
+
+	void VertexProcessor::cacheRoutine(const State &state, Routine *routine)
+	{
+		routineCache->add(state, routine);
+
+		if(routine->isOptimized())   // Unoptimized routines get replaced later
+		{
+			routineCache->store(persistentState(state), routine);
 		}
+	}
+
+	VertexProcessor::State VertexProcessor::persistentState(const State &state)
+	{
+		State persistent = state;
+
+		// Serial IDs differ between processes, the shader's contents are identified by its hash
+		persistent.shaderID = 0;
+		persistent.hash = 0;
+
+		return persistent;
+	}
+
+	Routine *VertexProcessor::generate(const State &state, const VertexShader *shader, bool optimize)
+	{
+		VertexRoutine *generator = new VertexProgram(state, shader);
+		generator->generate();
+		generator->setOptimizations(optimize);
+		Routine *routine = (*generator)("VertexRoutine_%0.8X", state.hash);
+		delete generator;
 
 		return routine;
 	}
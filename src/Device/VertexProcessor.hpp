@@ -25,12 +25,21 @@ namespace sw
 {
 	struct DrawData;
 
-	struct VertexCache   // FIXME: Variable size
+	// Set-associative post-transform vertex cache. Each line holds the four
+	// vertices of a quad-aligned index group, since the vertex routine shades
+	// four vertices at a time. Lines are replaced round-robin within a set.
+	struct VertexCache
 	{
+		void allocate(int size, int associativity);
+		void deallocate();
 		void clear();
 
-		Vertex vertex[16][4];
-		unsigned int tag[16];
+		Vertex (*vertex)[4];    // [sets * ways] lines
+		unsigned int *tag;      // [sets * ways]
+		unsigned int *victim;   // [sets] next way to replace
+
+		unsigned int setMask;
+		unsigned int ways;
 
 		int drawCall;
 	};
@@ -50,6 +59,7 @@ namespace sw
 			unsigned int computeHash();
 
 			uint64_t shaderID;
+			uint64_t shaderHash;   // Only used by the routine precache
 
 			bool fixedFunction             : 1;   // TODO: Eliminate by querying shader.
 			bool textureSampling           : 1;   // TODO: Eliminate by querying shader.
@@ -169,7 +179,11 @@ namespace sw
 
 	protected:
 		const State update(DrawType drawType);
-		Routine *routine(const State &state);
+		Routine *routine(const State &state, bool optimize = true);
+		Routine *cachedRoutine(const State &state);   // Returns nullptr if the routine has not been generated yet
+		void cacheRoutine(const State &state, Routine *routine);
+		static Routine *generate(const State &state, const VertexShader *shader, bool optimize = true);
+		static State persistentState(const State &state);   // Key for the routine precache
 
 		void setRoutineCacheSize(int cacheSize);
 
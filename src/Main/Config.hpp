@@ -76,7 +76,10 @@ namespace sw
 	enum
 	{
 		OUTLINE_RESOLUTION = 8192,   // Maximum vertical resolution of the render target
+		HIZ_TILE_WIDTH = 32,         // Pixels per hierarchical depth tile row (tiles span the two rows processed per cluster step)
+		CLEAR_TILE_SIZE = 32,        // Width and height of the tiles whose clears are deferred until first access
 		MIPMAP_LEVELS = 14,
+		MIPMAP_TILE_LEVELS = 6,   // Levels generated from each 64x64 tile of a mipmap source level while it is cached
 		TEXTURE_IMAGE_UNITS = 16,
 		VERTEX_TEXTURE_IMAGE_UNITS = 16,
 		TOTAL_IMAGE_UNITS = TEXTURE_IMAGE_UNITS + VERTEX_TEXTURE_IMAGE_UNITS,
@@ -338,6 +338,15 @@ namespace sw
 		html += "<option value='64'"   + (config.vertexCacheSize == 64   ? selected : empty) + ">64 (default)</option>\n";
 		html += "</select></td>\n";
 		html += "</tr>\n";
+		html += "<tr><td>Decoded texture cache size:</td><td><select name='decodeCacheSize' title='The amount of memory used for decoded compressed textures. Lower numbers save memory but require more textures to be decoded again.'>\n";
+		html += "<option value='0'"    + (config.decodeCacheSize == 0    ? selected : empty) + ">Unlimited (default)</option>\n";
+		html += "<option value='16'"   + (config.decodeCacheSize == 16   ? selected : empty) + ">16 MB</option>\n";
+		html += "<option value='32'"   + (config.decodeCacheSize == 32   ? selected : empty) + ">32 MB</option>\n";
+		html += "<option value='64'"   + (config.decodeCacheSize == 64   ? selected : empty) + ">64 MB</option>\n";
+		html += "<option value='128'"  + (config.decodeCacheSize == 128  ? selected : empty) + ">128 MB</option>\n";
+		html += "<option value='256'"  + (config.decodeCacheSize == 256  ? selected : empty) + ">256 MB</option>\n";
+		html += "</select></td>\n";
+		html += "</tr>\n";
 		html += "</table>\n";
 		html += "<h2><em>Quality</em></h2>\n";
 		html += "<table>\n";
@@ -586,6 +595,10 @@ namespace sw
 			{
 				config.vertexCacheSize = integer;
 			}
+			else if(sscanf(post, "decodeCacheSize=%d", &integer))
+			{
+				config.decodeCacheSize = integer;
+			}
 			else if(sscanf(post, "textureSampleQuality=%d", &integer))
 			{
 				config.textureSampleQuality = integer;
@@ -725,6 +738,7 @@ namespace sw
 		config.pixelRoutineCacheSize = ini.getInteger("Caches", "PixelRoutineCacheSize", 1024);
 		config.setupRoutineCacheSize = ini.getInteger("Caches", "SetupRoutineCacheSize", 1024);
 		config.vertexCacheSize = ini.getInteger("Caches", "VertexCacheSize", 64);
+		config.decodeCacheSize = ini.getInteger("Caches", "DecodeCacheSize", 0);
 		config.textureSampleQuality = ini.getInteger("Quality", "TextureSampleQuality", 2);
 		config.mipmapQuality = ini.getInteger("Quality", "MipmapQuality", 1);
 		config.perspectiveCorrection = ini.getBoolean("Quality", "PerspectiveCorrection", true);
@@ -783,6 +797,7 @@ namespace sw
 		ini.addValue("Caches", "PixelRoutineCacheSize", itoa(config.pixelRoutineCacheSize));
 		ini.addValue("Caches", "SetupRoutineCacheSize", itoa(config.setupRoutineCacheSize));
 		ini.addValue("Caches", "VertexCacheSize", itoa(config.vertexCacheSize));
+		ini.addValue("Caches", "DecodeCacheSize", itoa(config.decodeCacheSize));
 		ini.addValue("Quality", "TextureSampleQuality", itoa(config.textureSampleQuality));
 		ini.addValue("Quality", "MipmapQuality", itoa(config.mipmapQuality));
 		ini.addValue("Quality", "PerspectiveCorrection", itoa(config.perspectiveCorrection));
@@ -38,6 +38,7 @@ namespace sw
 			int pixelRoutineCacheSize;
 			int setupRoutineCacheSize;
 			int vertexCacheSize;
+			int decodeCacheSize;
 			int textureSampleQuality;
 			int mipmapQuality;
 			bool perspectiveCorrection;
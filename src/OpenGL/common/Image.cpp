@@ -1745,6 +1745,25 @@ namespace egl
 		}
 	}
 
+	bool Image::adoptImageData(GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const gl::PixelStorageModes &unpackParameters, sw::Resource *owner, const void *pixels)
+	{
+		// Only whole images already in the texture's own layout can be used without a transfer
+		if(width != getWidth() || height != getHeight() || depth != getDepth() ||
+		   gl::GetSizedInternalFormat(format, type) != internalformat ||
+		   gl::ComputePixelSize(format, type) != sw::Surface::bytes(getExternalFormat()) ||
+		   isDepth(getExternalFormat()) || isStencil(getExternalFormat()))
+		{
+			return false;
+		}
+
+		GLsizei inputWidth = (unpackParameters.rowLength == 0) ? width : unpackParameters.rowLength;
+		GLsizei inputPitch = gl::ComputePitch(inputWidth, format, type, unpackParameters.alignment);
+		GLsizei inputHeight = (unpackParameters.imageHeight == 0) ? height : unpackParameters.imageHeight;
+		char *input = ((char*)pixels) + gl::ComputePackingOffset(format, type, inputWidth, inputHeight, unpackParameters);
+
+		return adopt(owner, input, inputPitch, inputPitch * inputHeight);
+	}
+
 	void Image::loadCompressedData(GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLsizei imageSize, const void *pixels)
 	{
 		int inputPitch = gl::ComputeCompressedPitch(width, internalformat);
@@ -207,6 +207,7 @@ public:
 
 	void loadImageData(GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const gl::PixelStorageModes &unpackParameters, const void *pixels);
 	void loadCompressedData(GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLsizei imageSize, const void *pixels);
+	bool adoptImageData(GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const gl::PixelStorageModes &unpackParameters, sw::Resource *owner, const void *pixels);   // Shares the owner's memory instead of copying it
 
 	void release() override = 0;
 	void unbind(const Texture *parent);   // Break parent ownership and release
@@ -21,6 +21,7 @@
 #include "main.h"
 #include "VertexDataManager.h"
 #include "IndexDataManager.h"
+#include "Renderer/Surface.hpp"
 
 namespace es2
 {
@@ -40,6 +41,7 @@ Buffer::~Buffer()
 {
 	if(mContents)
 	{
+		releaseImages();
 		mContents->destruct();
 	}
 }
@@ -48,6 +50,7 @@ void Buffer::bufferData(const void *data, GLsizeiptr size, GLenum usage)
 {
 	if(mContents)
 	{
+		releaseImages();
 		mContents->destruct();
 		mContents = 0;
 	}
@@ -77,6 +80,8 @@ void Buffer::bufferSubData(const void *data, GLsizeiptr size, GLintptr offset)
 {
 	if(mContents && data)
 	{
+		releaseImages();
+
 		char *buffer = (char*)mContents->lock(sw::PUBLIC);
 		memcpy(buffer + offset, data, size);
 		mContents->unlock();
@@ -87,6 +92,11 @@ void* Buffer::mapRange(GLintptr offset, GLsizeiptr length, GLbitfield access)
 {
 	if(mContents)
 	{
+		if(access & GL_MAP_WRITE_BIT)
+		{
+			releaseImages();
+		}
+
 		char* buffer = (char*)mContents->lock(sw::PUBLIC);
 		mIsMapped = true;
 		mOffset = offset;
@@ -115,4 +125,12 @@ sw::Resource *Buffer::getResource()
 	return mContents;
 }
 
+void Buffer::releaseImages()
+{
+	if(mContents)
+	{
+		sw::Surface::releaseAdopters(mContents);
+	}
+}
+
 }
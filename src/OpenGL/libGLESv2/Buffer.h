@@ -52,6 +52,7 @@ public:
 	void flushMappedRange(GLintptr offset, GLsizeiptr length) {}
 
 	sw::Resource *getResource();
+	void releaseImages();   // Texture images sharing the contents get their own copy before they change
 
 private:
 	sw::Resource *mContents;
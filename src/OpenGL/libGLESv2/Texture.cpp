@@ -346,6 +346,16 @@ void Texture::setImage(GLenum format, GLenum type, const gl::PixelStorageModes &
 	if(pixels && image)
 	{
 		GLsizei depth = (getTarget() == GL_TEXTURE_3D_OES || getTarget() == GL_TEXTURE_2D_ARRAY) ? image->getDepth() : 1;
+
+		// Images from a pixel unpack buffer use its memory until either gets written to
+		Context *context = getContextLocked();
+		Buffer *unpackBuffer = context ? context->getPixelUnpackBuffer() : nullptr;
+
+		if(unpackBuffer && image->adoptImageData(image->getWidth(), image->getHeight(), depth, format, type, unpackParameters, unpackBuffer->getResource(), pixels))
+		{
+			return;
+		}
+
 		image->loadImageData(0, 0, 0, image->getWidth(), image->getHeight(), depth, format, type, unpackParameters, pixels);
 	}
 }
@@ -792,7 +802,19 @@ void Texture2D::generateMipmaps()
 		{
 			return error(GL_OUT_OF_MEMORY);
 		}
+	}
+
+	sw::Surface *levels[IMPLEMENTATION_MAX_TEXTURE_LEVELS];
 
+	for(int i = mBaseLevel; i <= q; i++)
+	{
+		levels[i - mBaseLevel] = image[i];
+	}
+
+	int generated = getDevice()->generateMipmaps(levels, q - mBaseLevel + 1);
+
+	for(int i = mBaseLevel + 1 + generated; i <= q; i++)
+	{
 		getDevice()->stretchRect(image[i - 1], 0, image[i], 0, Device::ALL_BUFFERS | Device::USE_FILTER);
 	}
 }
@@ -1343,7 +1365,19 @@ void TextureCubeMap::generateMipmaps()
 			{
 				return error(GL_OUT_OF_MEMORY);
 			}
+		}
 
+		sw::Surface *levels[IMPLEMENTATION_MAX_TEXTURE_LEVELS];
+
+		for(int i = mBaseLevel; i <= q; i++)
+		{
+			levels[i - mBaseLevel] = image[f][i];
+		}
+
+		int generated = getDevice()->generateMipmaps(levels, q - mBaseLevel + 1);
+
+		for(int i = mBaseLevel + 1 + generated; i <= q; i++)
+		{
 			getDevice()->stretchRect(image[f][i - 1], 0, image[f][i], 0, Device::ALL_BUFFERS | Device::USE_FILTER);
 		}
 	}
@@ -1870,13 +1904,25 @@ void Texture2DArray::generateMipmaps()
 		{
 			return error(GL_OUT_OF_MEMORY);
 		}
+	}
+
+	sw::Surface *levels[IMPLEMENTATION_MAX_TEXTURE_LEVELS];
+
+	for(int i = mBaseLevel; i <= q; i++)
+	{
+		levels[i - mBaseLevel] = image[i];
+	}
+
+	for(int z = 0; z < depth; ++z)
+	{
+		int generated = getDevice()->generateMipmaps(levels, q - mBaseLevel + 1, z);
 
-		GLsizei srcw = image[i - 1]->getWidth();
-		GLsizei srch = image[i - 1]->getHeight();
-		for(int z = 0; z < depth; ++z)
+		for(int i = mBaseLevel + 1 + generated; i <= q; i++)
 		{
+			GLsizei srcw = image[i - 1]->getWidth();
+			GLsizei srch = image[i - 1]->getHeight();
 			sw::SliceRectF srcRect(0.0f, 0.0f, static_cast<float>(srcw), static_cast<float>(srch), z);
-			sw::SliceRect dstRect(0, 0, w, h, z);
+			sw::SliceRect dstRect(0, 0, image[i]->getWidth(), image[i]->getHeight(), z);
 			getDevice()->stretchRect(image[i - 1], &srcRect, image[i], &dstRect, Device::ALL_BUFFERS | Device::USE_FILTER);
 		}
 	}
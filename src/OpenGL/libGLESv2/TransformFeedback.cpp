@@ -94,6 +94,15 @@ GLenum TransformFeedback::primitiveMode() const
 void TransformFeedback::begin(GLenum primitiveMode)
 {
 	mActive = true; mPrimitiveMode = primitiveMode;
+
+	// The draws will write to the buffers
+	for(int i = 0; i < MAX_TRANSFORM_FEEDBACK_SEPARATE_ATTRIBS; ++i)
+	{
+		if(mBuffer[i].get())
+		{
+			mBuffer[i].get()->releaseImages();
+		}
+	}
 }
 
 void TransformFeedback::end()
@@ -151,6 +151,22 @@ namespace sw
 		return input[inputIdx][component];
 	}
 
+	uint64_t PixelShader::hashInterface(uint64_t hash) const
+	{
+		for(int i = 0; i < MAX_FRAGMENT_INPUTS; i++)
+		{
+			for(int c = 0; c < 4; c++)
+			{
+				hash = hashSemantic(hash, input[i][c]);
+			}
+		}
+
+		hash = hashValue(hash, vPosDeclared);
+		hash = hashValue(hash, vFaceDeclared);
+
+		return hash;
+	}
+
 	void PixelShader::analyze()
 	{
 		analyzeZOverride();
@@ -45,6 +45,8 @@ namespace sw
 		bool isVFaceDeclared() const { return vFaceDeclared; }
 
 	private:
+		uint64_t hashInterface(uint64_t hash) const override;
+
 		void analyze();
 		void analyzeZOverride();
 		void analyzeKill();
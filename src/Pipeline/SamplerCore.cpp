@@ -1635,7 +1635,7 @@ namespace sw
 		}
 	}
 
-	void SamplerCore::computeIndices(UInt index[4], Int4& uuuu, Int4& vvvv, Int4& wwww, const Pointer<Byte> &mipmap, SamplerFunction function)
+	UInt4 SamplerCore::computeIndices(UInt index[4], Int4& uuuu, Int4& vvvv, Int4& wwww, const Pointer<Byte> &mipmap, SamplerFunction function)
 	{
 		UInt4 indices = uuuu + vvvv;
 
@@ -1648,6 +1648,8 @@ namespace sw
 		{
 			index[i] = Extract(As<Int4>(indices), i);
 		}
+
+		return indices;
 	}
 
 	Vector4s SamplerCore::sampleTexel(UInt index[4], Pointer<Byte> buffer[4])
@@ -1974,10 +1976,13 @@ namespace sw
 		Vector4f c;
 
 		UInt index[4];
-		computeIndices(index, uuuu, vvvv, wwww, mipmap, function);
+		UInt4 indices = computeIndices(index, uuuu, vvvv, wwww, mipmap, function);
 
 		if(hasFloatTexture() || has32bitIntegerTextureComponents())
 		{
+			// All lanes read from the same face unless this is a cube texture
+			bool gather = state.textureType != TEXTURE_CUBE;
+
 			int f0 = state.textureType == TEXTURE_CUBE ? 0 : 0;
 			int f1 = state.textureType == TEXTURE_CUBE ? 1 : 0;
 			int f2 = state.textureType == TEXTURE_CUBE ? 2 : 0;
@@ -2001,6 +2006,14 @@ namespace sw
 				transpose4x3(c.x, c.y, c.z, c.w);
 				break;
 			case 2:
+				if(gather)
+				{
+					Int4 offsets = As<Int4>(indices) << 3;
+					c.x = Gather(Pointer<Float>(buffer[f0]), offsets, Int4(-1), 4);
+					c.y = Gather(Pointer<Float>(buffer[f0] + 4), offsets, Int4(-1), 4);
+					break;
+				}
+
 				// FIXME: Optimal shuffling?
 				c.x.xy = *Pointer<Float4>(buffer[f0] + index[0] * 8);
 				c.x.zw = *Pointer<Float4>(buffer[f1] + index[1] * 8 - 8);
@@ -2011,6 +2024,12 @@ namespace sw
 				c.y = Float4(c.y.yw, c.z.yw);
 				break;
 			case 1:
+				if(gather)
+				{
+					c.x = Gather(Pointer<Float>(buffer[f0]), As<Int4>(indices) << 2, Int4(-1), 4);
+					break;
+				}
+
 				// FIXME: Optimal shuffling?
 				c.x.x = *Pointer<Float>(buffer[f0] + index[0] * 4);
 				c.x.y = *Pointer<Float>(buffer[f1] + index[1] * 4);
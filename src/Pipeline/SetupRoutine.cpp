@@ -195,6 +195,11 @@ namespace sw
 			yMin = Max(yMin, *Pointer<Int>(data + OFFSET(DrawData,scissorY0)));
 			yMax = Min(yMax, *Pointer<Int>(data + OFFSET(DrawData,scissorY1)));
 
+			If(yMin >= yMax)   // Outside the scissor rectangle (possibly within the guard band)
+			{
+				Return(false);
+			}
+
 			For(Int q = 0, q < state.multiSample, q++)
 			{
 				Array<Int> Xq(16);
@@ -469,7 +474,7 @@ namespace sw
 			Return(true);
 		}
 
-		routine = function("SetupRoutine");
+		routine = function("SetupRoutine_%0.8X", state.hash);
 	}
 
 	void SetupRoutine::setupGradient(Pointer<Byte> &primitive, Pointer<Byte> &triangle, Float4 &w012, Float4 (&m)[3], Pointer<Byte> &v0, Pointer<Byte> &v1, Pointer<Byte> &v2, int attribute, int planeEquation, bool flat, bool sprite, bool perspective, bool wrap, int component)
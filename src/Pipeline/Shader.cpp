@@ -1132,6 +1132,7 @@ namespace sw
 	Shader::Shader() : serialID(serialCounter++)
 	{
 		usedSamplers = 0;
+		hash = 0;
 	}
 
 	Shader::~Shader()
@@ -1428,6 +1429,107 @@ namespace sw
 		return serialID;
 	}
 
+	uint64_t Shader::hashValue(uint64_t hash, uint64_t value)
+	{
+		// 64-bit FNV-1a, one byte at a time
+		for(int i = 0; i < 8; i++)
+		{
+			hash = (hash ^ ((value >> (i * 8)) & 0xFF)) * 0x100000001B3ull;
+		}
+
+		return hash;
+	}
+
+	uint64_t Shader::hashParameter(uint64_t hash, const Parameter &parameter)
+	{
+		hash = hashValue(hash, parameter.type);
+
+		switch(parameter.type)
+		{
+		case PARAMETER_FLOAT4LITERAL:
+		case PARAMETER_BOOL1LITERAL:
+		case PARAMETER_INT4LITERAL:
+			for(int i = 0; i < 4; i++)
+			{
+				hash = hashValue(hash, parameter.integer[i]);
+			}
+			break;
+		case PARAMETER_LABEL:
+			hash = hashValue(hash, parameter.label);
+			hash = hashValue(hash, parameter.callSite);
+			break;
+		default:
+			hash = hashValue(hash, parameter.index);
+			hash = hashValue(hash, parameter.rel.type);
+			hash = hashValue(hash, parameter.rel.index);
+			hash = hashValue(hash, parameter.rel.swizzle);
+			hash = hashValue(hash, parameter.rel.scale);
+			hash = hashValue(hash, parameter.rel.dynamic);
+		}
+
+		return hash;
+	}
+
+	uint64_t Shader::getHash() const
+	{
+		if(hash != 0)
+		{
+			return hash;
+		}
+
+		uint64_t h = hashValue(0xCBF29CE484222325ull, shaderType);
+		h = hashValue(h, shaderModel);
+
+		for(const Instruction *inst : instruction)
+		{
+			h = hashValue(h, inst->opcode);
+			h = hashValue(h, inst->control);
+			h = hashValue(h, inst->predicate);
+			h = hashValue(h, inst->predicateNot);
+			h = hashValue(h, inst->predicateSwizzle);
+			h = hashValue(h, inst->coissue);
+			h = hashValue(h, inst->samplerType);
+			h = hashValue(h, inst->usage);
+			h = hashValue(h, inst->usageIndex);
+
+			h = hashParameter(h, inst->dst);
+			h = hashValue(h, inst->dst.mask);
+			h = hashValue(h, inst->dst.saturate);
+			h = hashValue(h, inst->dst.partialPrecision);
+			h = hashValue(h, inst->dst.centroid);
+			h = hashValue(h, inst->dst.shift);
+
+			for(const SourceParameter &src : inst->src)
+			{
+				h = hashParameter(h, src);
+				h = hashValue(h, src.swizzle);
+				h = hashValue(h, src.modifier);
+				h = hashValue(h, src.bufferIndex);
+			}
+		}
+
+		h = hashInterface(h);
+
+		hash = (h != 0) ? h : 1;
+
+		return hash;
+	}
+
+	uint64_t Shader::hashInterface(uint64_t hash) const
+	{
+		return hash;
+	}
+
+	uint64_t Shader::hashSemantic(uint64_t hash, const Semantic &semantic)
+	{
+		hash = hashValue(hash, semantic.usage);
+		hash = hashValue(hash, semantic.index);
+		hash = hashValue(hash, semantic.centroid);
+		hash = hashValue(hash, semantic.flat);
+
+		return hash;
+	}
+
 	size_t Shader::getLength() const
 	{
 		return instruction.size();
@@ -1470,6 +1572,7 @@ namespace sw
 	void Shader::append(Instruction *instruction)
 	{
 		this->instruction.push_back(instruction);
+		hash = 0;
 	}
 
 	void Shader::declareSampler(int i)
@@ -1492,6 +1595,7 @@ namespace sw
 		optimizeLeave();
 		optimizeCall();
 		removeNull();
+		hash = 0;
 	}
 
 	void Shader::optimizeLeave()
@@ -558,6 +558,7 @@ namespace sw
 		virtual ~Shader();
 
 		int getSerialID() const;
+		uint64_t getHash() const;   // Identifies the contents, unlike the serial ID it is the same in every process
 		size_t getLength() const;
 		ShaderType getShaderType() const;
 		unsigned short getShaderModel() const;
@@ -630,6 +631,11 @@ namespace sw
 		void analyzeIndirectAddressing();
 		void markFunctionAnalysis(unsigned int functionLabel, Analysis flag);
 
+		virtual uint64_t hashInterface(uint64_t hash) const;   // Folds in declarations which are not instructions
+		static uint64_t hashValue(uint64_t hash, uint64_t value);
+		static uint64_t hashParameter(uint64_t hash, const Parameter &parameter);
+		static uint64_t hashSemantic(uint64_t hash, const Semantic &semantic);
+
 		ShaderType shaderType;
 
 		union
@@ -651,6 +657,8 @@ namespace sw
 		const int serialID;
 		static volatile int serialCounter;
 
+		mutable uint64_t hash;   // Zero until computed
+
 		bool dynamicBranching;
 		bool containsBreak;
 		bool containsContinue;
@@ -42,8 +42,11 @@ namespace sw
 		const bool textureSampling = state.textureSampling;
 
 		Pointer<Byte> cache = task + OFFSET(VertexTask,vertexCache);
-		Pointer<Byte> vertexCache = cache + OFFSET(VertexCache,vertex);
-		Pointer<Byte> tagCache = cache + OFFSET(VertexCache,tag);
+		Pointer<Byte> vertexCache = *Pointer<Pointer<Byte>>(cache + OFFSET(VertexCache,vertex));
+		Pointer<UInt> tagCache = *Pointer<Pointer<UInt>>(cache + OFFSET(VertexCache,tag));
+		Pointer<UInt> victimCache = *Pointer<Pointer<UInt>>(cache + OFFSET(VertexCache,victim));
+		UInt setMask = *Pointer<UInt>(cache + OFFSET(VertexCache,setMask));
+		UInt ways = *Pointer<UInt>(cache + OFFSET(VertexCache,ways));
 
 		UInt vertexCount = *Pointer<UInt>(task + OFFSET(VertexTask,vertexCount));
 		UInt primitiveNumber = *Pointer<UInt>(task + OFFSET(VertexTask, primitiveStart));
@@ -54,23 +57,35 @@ namespace sw
 		Do
 		{
 			UInt index = *Pointer<UInt>(batch);
-			UInt tagIndex = index & 0x0000003C;
 			UInt indexQ = !textureSampling ? UInt(index & 0xFFFFFFFC) : index;   // FIXME: TEXLDL hack to have independent LODs, hurts performance.
+			UInt set = (index >> 2) & setMask;
+			UInt line = set * ways;
+			UInt way = ways;
 
-			If(*Pointer<UInt>(tagCache + tagIndex) != indexQ)
+			For(UInt w = 0, w < ways, w++)
 			{
-				*Pointer<UInt>(tagCache + tagIndex) = indexQ;
+				If(tagCache[line + w] == indexQ)
+				{
+					way = w;
+				}
+			}
+
+			If(way == ways)
+			{
+				way = victimCache[set];
+				victimCache[set] = (way + 1) & (ways - 1);
+				tagCache[line + way] = indexQ;
 
 				readInput(indexQ);
 				program(indexQ);
 				postTransform();
 				computeClipFlags();
 
-				Pointer<Byte> cacheLine0 = vertexCache + tagIndex * UInt((int)sizeof(Vertex));
+				Pointer<Byte> cacheLine0 = vertexCache + (line + way) * UInt((int)sizeof(Vertex) * 4);
 				writeCache(cacheLine0);
 			}
 
-			UInt cacheIndex = index & 0x0000003F;
+			UInt cacheIndex = (line + way) * 4 + (index & 3);
 			Pointer<Byte> cacheLine = vertexCache + cacheIndex * UInt((int)sizeof(Vertex));
 			writeVertex(vertex, cacheLine);
 
@@ -110,11 +125,15 @@ namespace sw
 	{
 		int pos = state.positionRegister;
 
-		Int4 maxX = CmpLT(o[pos].w, o[pos].x);
-		Int4 maxY = CmpLT(o[pos].w, o[pos].y);
+		// X and Y are only clipped against the guard band, outside of which
+		// the rasterizer's fixed-point setup could overflow.
+		Float4 guardBand = o[pos].w * *Pointer<Float4>(data + OFFSET(DrawData,guardBand));
+
+		Int4 maxX = CmpLT(guardBand, o[pos].x);
+		Int4 maxY = CmpLT(guardBand, o[pos].y);
 		Int4 maxZ = CmpLT(o[pos].w, o[pos].z);
-		Int4 minX = CmpNLE(-o[pos].w, o[pos].x);
-		Int4 minY = CmpNLE(-o[pos].w, o[pos].y);
+		Int4 minX = CmpNLE(-guardBand, o[pos].x);
+		Int4 minY = CmpNLE(-guardBand, o[pos].y);
 		Int4 minZ = CmpNLE(Float4(0.0f), o[pos].z);
 
 		clipFlags = *Pointer<Int>(constants + OFFSET(Constants,maxX) + SignMask(maxX) * 4);   // FIXME: Array indexing
@@ -157,10 +176,14 @@ namespace sw
 				{
 					if(stream.count == 1)
 					{
-						v.x.x = *Pointer<Float>(source0);
-						v.x.y = *Pointer<Float>(source1);
-						v.x.z = *Pointer<Float>(source2);
-						v.x.w = *Pointer<Float>(source3);
+						Int4 offsets = Int4(0);
+
+						if(!textureSampling)
+						{
+							offsets = Int4(0, 1, 2, 3) * Int4(Int(stride));
+						}
+
+						v.x = Gather(Pointer<Float>(source0), offsets, Int4(-1), sizeof(float));
 					}
 					else
 					{
@@ -198,6 +198,30 @@ namespace sw
 		return output[outputIdx][component];
 	}
 
+	uint64_t VertexShader::hashInterface(uint64_t hash) const
+	{
+		for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
+		{
+			hash = hashSemantic(hash, input[i]);
+			hash = hashValue(hash, attribType[i]);
+		}
+
+		for(int i = 0; i < MAX_VERTEX_OUTPUTS; i++)
+		{
+			for(int c = 0; c < 4; c++)
+			{
+				hash = hashSemantic(hash, output[i][c]);
+			}
+		}
+
+		hash = hashValue(hash, positionRegister);
+		hash = hashValue(hash, pointSizeRegister);
+		hash = hashValue(hash, instanceIdDeclared);
+		hash = hashValue(hash, vertexIdDeclared);
+
+		return hash;
+	}
+
 	void VertexShader::analyze()
 	{
 		analyzeInput();
@@ -48,6 +48,8 @@ namespace sw
 		bool isVertexIdDeclared() const { return vertexIdDeclared; }
 
 	private:
+		uint64_t hashInterface(uint64_t hash) const override;
+
 		void analyze();
 		void analyzeInput();
 		void analyzeOutput();
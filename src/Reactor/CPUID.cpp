@@ -36,6 +36,10 @@ namespace rr
 	bool CPUID::SSE3 = detectSSE3();
 	bool CPUID::SSSE3 = detectSSSE3();
 	bool CPUID::SSE4_1 = detectSSE4_1();
+	bool CPUID::AVX = detectAVX();
+	bool CPUID::AVX2 = detectAVX2();
+	bool CPUID::AVX512F = detectAVX512F();
+	bool CPUID::FMA = detectFMA();
 
 	bool CPUID::enableMMX = true;
 	bool CPUID::enableCMOV = true;
@@ -44,6 +48,10 @@ namespace rr
 	bool CPUID::enableSSE3 = true;
 	bool CPUID::enableSSSE3 = true;
 	bool CPUID::enableSSE4_1 = true;
+	bool CPUID::enableAVX = true;
+	bool CPUID::enableAVX2 = true;
+	bool CPUID::enableAVX512F = true;
+	bool CPUID::enableFMA = true;
 
 	void CPUID::setEnableMMX(bool enable)
 	{
@@ -56,6 +64,10 @@ namespace rr
 			enableSSE3 = false;
 			enableSSSE3 = false;
 			enableSSE4_1 = false;
+			enableAVX = false;
+			enableAVX2 = false;
+			enableAVX512F = false;
+			enableFMA = false;
 		}
 	}
 
@@ -70,6 +82,10 @@ namespace rr
 			enableSSE3 = false;
 			enableSSSE3 = false;
 			enableSSE4_1 = false;
+			enableAVX = false;
+			enableAVX2 = false;
+			enableAVX512F = false;
+			enableFMA = false;
 		}
 	}
 
@@ -88,6 +104,10 @@ namespace rr
 			enableSSE3 = false;
 			enableSSSE3 = false;
 			enableSSE4_1 = false;
+			enableAVX = false;
+			enableAVX2 = false;
+			enableAVX512F = false;
+			enableFMA = false;
 		}
 	}
 
@@ -106,6 +126,10 @@ namespace rr
 			enableSSE3 = false;
 			enableSSSE3 = false;
 			enableSSE4_1 = false;
+			enableAVX = false;
+			enableAVX2 = false;
+			enableAVX512F = false;
+			enableFMA = false;
 		}
 	}
 
@@ -124,6 +148,10 @@ namespace rr
 		{
 			enableSSSE3 = false;
 			enableSSE4_1 = false;
+			enableAVX = false;
+			enableAVX2 = false;
+			enableAVX512F = false;
+			enableFMA = false;
 		}
 	}
 
@@ -142,6 +170,10 @@ namespace rr
 		else
 		{
 			enableSSE4_1 = false;
+			enableAVX = false;
+			enableAVX2 = false;
+			enableAVX512F = false;
+			enableFMA = false;
 		}
 	}
 
@@ -158,15 +190,100 @@ namespace rr
 			enableSSE3 = true;
 			enableSSSE3 = true;
 		}
+		else
+		{
+			enableAVX = false;
+			enableAVX2 = false;
+			enableAVX512F = false;
+			enableFMA = false;
+		}
+	}
+
+	void CPUID::setEnableAVX(bool enable)
+	{
+		enableAVX = enable;
+
+		if(enableAVX)
+		{
+			enableMMX = true;
+			enableCMOV = true;
+			enableSSE = true;
+			enableSSE2 = true;
+			enableSSE3 = true;
+			enableSSSE3 = true;
+			enableSSE4_1 = true;
+		}
+		else
+		{
+			enableAVX2 = false;
+			enableAVX512F = false;
+			enableFMA = false;
+		}
+	}
+
+	void CPUID::setEnableAVX2(bool enable)
+	{
+		enableAVX2 = enable;
+
+		if(enableAVX2)
+		{
+			enableMMX = true;
+			enableCMOV = true;
+			enableSSE = true;
+			enableSSE2 = true;
+			enableSSE3 = true;
+			enableSSSE3 = true;
+			enableSSE4_1 = true;
+			enableAVX = true;
+		}
+		else
+		{
+			enableAVX512F = false;
+		}
+	}
+
+	void CPUID::setEnableAVX512F(bool enable)
+	{
+		enableAVX512F = enable;
+
+		if(enableAVX512F)
+		{
+			enableMMX = true;
+			enableCMOV = true;
+			enableSSE = true;
+			enableSSE2 = true;
+			enableSSE3 = true;
+			enableSSSE3 = true;
+			enableSSE4_1 = true;
+			enableAVX = true;
+			enableAVX2 = true;
+		}
+	}
+
+	void CPUID::setEnableFMA(bool enable)
+	{
+		enableFMA = enable;
+
+		if(enableFMA)
+		{
+			enableMMX = true;
+			enableCMOV = true;
+			enableSSE = true;
+			enableSSE2 = true;
+			enableSSE3 = true;
+			enableSSSE3 = true;
+			enableSSE4_1 = true;
+			enableAVX = true;
+		}
 	}
 
-	static void cpuid(int registers[4], int info)
+	static void cpuid(int registers[4], int info, int subleaf = 0)
 	{
 		#if defined(__i386__) || defined(__x86_64__)
 			#if defined(_WIN32)
-				__cpuid(registers, info);
+				__cpuidex(registers, info, subleaf);
 			#else
-				__asm volatile("cpuid": "=a" (registers[0]), "=b" (registers[1]), "=c" (registers[2]), "=d" (registers[3]): "a" (info));
+				__asm volatile("cpuid": "=a" (registers[0]), "=b" (registers[1]), "=c" (registers[2]), "=d" (registers[3]): "a" (info), "c" (subleaf));
 			#endif
 		#else
 			registers[0] = 0;
@@ -224,4 +341,68 @@ namespace rr
 		cpuid(registers, 1);
 		return SSE4_1 = (registers[2] & 0x00080000) != 0;
 	}
+
+	// Register state enabled by the OS for XSAVE, as reported by XCR0
+	static unsigned int xgetbv()
+	{
+		int registers[4];
+		cpuid(registers, 1);
+
+		if((registers[2] & 0x08000000) == 0)   // OSXSAVE
+		{
+			return 0;
+		}
+
+		#if defined(__i386__) || defined(__x86_64__)
+			#if defined(_WIN32)
+				return (unsigned int)_xgetbv(0);
+			#else
+				unsigned int eax, edx;
+				__asm volatile("xgetbv": "=a" (eax), "=d" (edx): "c" (0));
+				return eax;
+			#endif
+		#else
+			return 0;
+		#endif
+	}
+
+	static int extendedFeatures()
+	{
+		int registers[4];
+		cpuid(registers, 0);
+
+		if(registers[0] < 7)
+		{
+			return 0;
+		}
+
+		cpuid(registers, 7, 0);
+		return registers[1];
+	}
+
+	bool CPUID::detectAVX()
+	{
+		int registers[4];
+		cpuid(registers, 1);
+		bool ymm = (xgetbv() & 0x06) == 0x06;   // XMM and YMM state
+		return AVX = (registers[2] & 0x10000000) != 0 && ymm;
+	}
+
+	bool CPUID::detectAVX2()
+	{
+		return AVX2 = detectAVX() && (extendedFeatures() & 0x00000020) != 0;
+	}
+
+	bool CPUID::detectAVX512F()
+	{
+		bool zmm = (xgetbv() & 0xE6) == 0xE6;   // Opmask, ZMM0-15 and ZMM16-31 state
+		return AVX512F = detectAVX2() && (extendedFeatures() & 0x00010000) != 0 && zmm;
+	}
+
+	bool CPUID::detectFMA()
+	{
+		int registers[4];
+		cpuid(registers, 1);
+		return FMA = detectAVX() && (registers[2] & 0x00001000) != 0;
+	}
 }
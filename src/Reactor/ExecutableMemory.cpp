@@ -15,6 +15,7 @@
 #include "ExecutableMemory.hpp"
 
 #include "Debug.hpp"
+#include "MutexLock.hpp"
 
 #if defined(_WIN32)
 	#ifndef WIN32_LEAN_AND_MEAN
@@ -35,6 +36,11 @@
 
 #include <memory.h>
 
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <vector>
+
 #undef allocate
 #undef deallocate
 
@@ -82,7 +88,7 @@ void *allocateRaw(size_t bytes, size_t alignment)
 	#endif
 }
 
-#if defined(LINUX_ENABLE_NAMED_MMAP)
+#if defined(__linux__)
 // Create a file descriptor for anonymous memory with the given
 // name. Returns -1 on failure.
 // TODO: remove once libc wrapper exists.
@@ -107,7 +113,9 @@ int memfd_create(const char* name, unsigned int flags)
 		return -1;
 	#endif
 }
+#endif  // defined(__linux__)
 
+#if defined(LINUX_ENABLE_NAMED_MMAP)
 // Returns a file descriptor for use with an anonymous mmap, if
 // memfd_create fails, -1 is returned. Note, the mappings should be
 // MAP_PRIVATE so that underlying pages aren't shared.
@@ -129,6 +137,234 @@ void ensureAnonFileSize(int anonFd, size_t length)
 }
 #endif  // defined(LINUX_ENABLE_NAMED_MMAP)
 
+// Rounds |x| up to a multiple of |m|, where |m| is a power of 2.
+inline uintptr_t roundUp(uintptr_t x, uintptr_t m)
+{
+	ASSERT(m > 0 && (m & (m - 1)) == 0); // |m| must be a power of 2.
+	return (x + m - 1) & ~(m - 1);
+}
+
+#if defined(__linux__)
+#if !defined(MFD_CLOEXEC)
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+// Hands out code memory from arenas which are mapped both read-write and
+// read-execute. Small routines share pages, and no page ever has to change
+// its protection.
+class CodePool
+{
+public:
+	void *allocate(size_t bytes, void *&writable)
+	{
+		size_t size = roundUp(bytes, granularity);
+		void *code = nullptr;
+
+		mutex.lock();
+
+		for(Arena *arena : arenas)
+		{
+			if((code = arena->allocate(size, writable)))
+			{
+				break;
+			}
+		}
+
+		if(!code && !unavailable)
+		{
+			Arena *arena = Arena::create(size > arenaSize ? roundUp(size, memoryPageSize()) : arenaSize);
+
+			if(arena)
+			{
+				arenas.push_back(arena);
+				code = arena->allocate(size, writable);
+			}
+			else
+			{
+				unavailable = true;   // Don't retry failing system calls for every routine
+			}
+		}
+
+		mutex.unlock();
+
+		return code;
+	}
+
+	bool contains(const void *code)
+	{
+		mutex.lock();
+		bool found = find(code) != nullptr;
+		mutex.unlock();
+
+		return found;
+	}
+
+	bool deallocate(void *code, size_t bytes)
+	{
+		mutex.lock();
+
+		Arena *arena = find(code);
+
+		if(arena)
+		{
+			arena->deallocate(code, roundUp(bytes, granularity));
+
+			if(arena->empty() && arenas.size() > 1)   // Keep one arena around for the next routine
+			{
+				arenas.erase(std::find(arenas.begin(), arenas.end(), arena));
+				delete arena;
+			}
+		}
+
+		mutex.unlock();
+
+		return arena != nullptr;
+	}
+
+private:
+	static const size_t granularity = 64;         // Cache line aligned
+	static const size_t arenaSize = 0x100000;
+
+	class Arena
+	{
+	public:
+		static Arena *create(size_t size)
+		{
+			int fd = memfd_create("SwiftShader JIT", MFD_CLOEXEC);
+
+			if(fd == -1)
+			{
+				return nullptr;
+			}
+
+			void *writable = MAP_FAILED;
+			void *code = MAP_FAILED;
+
+			if(ftruncate(fd, size) == 0)
+			{
+				writable = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+				code = mmap(nullptr, size, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+			}
+
+			close(fd);   // The mappings keep the memory alive
+
+			if(writable == MAP_FAILED || code == MAP_FAILED)
+			{
+				if(writable != MAP_FAILED) munmap(writable, size);
+				if(code != MAP_FAILED) munmap(code, size);
+
+				return nullptr;
+			}
+
+			return new Arena((unsigned char*)code, (unsigned char*)writable, size);
+		}
+
+		~Arena()
+		{
+			munmap(code, size);
+			munmap(writable, size);
+		}
+
+		bool contains(const void *address) const
+		{
+			return address >= code && address < code + size;
+		}
+
+		bool empty() const
+		{
+			return freeList.size() == 1 && freeList.begin()->second == size;
+		}
+
+		void *allocate(size_t bytes, void *&writable)
+		{
+			// First fit, which keeps long-lived routines packed at the start
+			for(auto range = freeList.begin(); range != freeList.end(); range++)
+			{
+				if(range->second >= bytes)
+				{
+					size_t offset = range->first;
+					size_t remaining = range->second - bytes;
+
+					freeList.erase(range);
+
+					if(remaining != 0)
+					{
+						freeList[offset + bytes] = remaining;
+					}
+
+					writable = this->writable + offset;
+
+					return code + offset;
+				}
+			}
+
+			return nullptr;
+		}
+
+		void deallocate(void *address, size_t bytes)
+		{
+			size_t offset = (unsigned char*)address - code;
+			auto range = freeList.emplace(offset, bytes).first;
+
+			auto next = std::next(range);
+
+			if(next != freeList.end() && offset + bytes == next->first)
+			{
+				range->second += next->second;
+				freeList.erase(next);
+			}
+
+			if(range != freeList.begin())
+			{
+				auto previous = std::prev(range);
+
+				if(previous->first + previous->second == offset)
+				{
+					previous->second += range->second;
+					freeList.erase(range);
+				}
+			}
+		}
+
+	private:
+		Arena(unsigned char *code, unsigned char *writable, size_t size) : code(code), writable(writable), size(size)
+		{
+			freeList[0] = size;
+		}
+
+		unsigned char *const code;       // Read-execute view
+		unsigned char *const writable;   // Read-write view of the same pages
+		const size_t size;
+
+		std::map<size_t, size_t> freeList;   // Offset to size of unallocated ranges
+	};
+
+	Arena *find(const void *code) const
+	{
+		for(Arena *arena : arenas)
+		{
+			if(arena->contains(code))
+			{
+				return arena;
+			}
+		}
+
+		return nullptr;
+	}
+
+	std::vector<Arena*> arenas;
+	bool unavailable = false;
+	MutexLock mutex;   // Routines are created and destroyed concurrently
+};
+
+CodePool &codePool()
+{
+	static CodePool *pool = new CodePool();   // Never destroyed, routines may outlive static destructors
+
+	return *pool;
+}
+#endif  // defined(__linux__)
+
 }  // anonymous namespace
 
 size_t memoryPageSize()
@@ -176,13 +412,6 @@ void deallocate(void *memory)
 	#endif
 }
 
-// Rounds |x| up to a multiple of |m|, where |m| is a power of 2.
-inline uintptr_t roundUp(uintptr_t x, uintptr_t m)
-{
-	ASSERT(m > 0 && (m & (m - 1)) == 0); // |m| must be a power of 2.
-	return (x + m - 1) & ~(m - 1);
-}
-
 void *allocateExecutable(size_t bytes)
 {
 	size_t pageSize = memoryPageSize();
@@ -285,4 +514,49 @@ void deallocateExecutable(void *memory, size_t bytes)
 		deallocate(memory);
 	#endif
 }
+
+void *allocateCode(size_t bytes, void *&writable)
+{
+	#if defined(__linux__)
+		if(void *code = codePool().allocate(bytes, writable))
+		{
+			return code;
+		}
+	#endif
+
+	void *code = allocateExecutable(bytes);
+	writable = code;
+
+	return code;
+}
+
+void finalizeCode(void *code, size_t bytes)
+{
+	#if defined(__linux__)
+		if(!codePool().contains(code))
+		{
+			markExecutable(code, bytes);
+		}
+	#else
+		markExecutable(code, bytes);
+	#endif
+
+	#if defined(_WIN32)
+		FlushInstructionCache(GetCurrentProcess(), code, bytes);
+	#else
+		__builtin___clear_cache((char*)code, (char*)code + bytes);
+	#endif
+}
+
+void deallocateCode(void *code, size_t bytes)
+{
+	#if defined(__linux__)
+		if(codePool().deallocate(code, bytes))
+		{
+			return;
+		}
+	#endif
+
+	deallocateExecutable(code, bytes);
+}
 }
@@ -27,6 +27,13 @@ void *allocateExecutable(size_t bytes);   // Allocates memory that can be made e
 void markExecutable(void *memory, size_t bytes);
 void deallocateExecutable(void *memory, size_t bytes);
 
+// Sub-allocates code from shared arenas. Where supported, each arena is mapped twice, so that code is written
+// through the returned writable view and executed from the returned address without ever being both writable
+// and executable. Elsewhere both addresses are the same and the memory is made executable by finalizeCode().
+void *allocateCode(size_t bytes, void *&writable);
+void finalizeCode(void *code, size_t bytes);   // Must be called before executing the code
+void deallocateCode(void *code, size_t bytes);
+
 template<typename P>
 P unaligned_read(P *address)
 {
@@ -19,6 +19,7 @@
 #include "Thread.hpp"
 #include "ExecutableMemory.hpp"
 #include "MutexLock.hpp"
+#include "Profiler.hpp"
 
 #undef min
 #undef max
@@ -47,6 +48,7 @@
 	#include "llvm/Analysis/LoopPass.h"
 	#include "llvm/ExecutionEngine/ExecutionEngine.h"
 	#include "llvm/ExecutionEngine/JITSymbol.h"
+	#include "llvm/ExecutionEngine/ObjectCache.h"
 	#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
 	#include "llvm/ExecutionEngine/Orc/IRCompileLayer.h"
 	#include "llvm/ExecutionEngine/Orc/LambdaResolver.h"
@@ -79,8 +81,10 @@
 	#include <unordered_map>
 #endif
 
+#include <cstring>
 #include <numeric>
 #include <fstream>
+#include <mutex>
 
 #if defined(__i386__) || defined(__x86_64__)
 #include <xmmintrin.h>
@@ -109,13 +113,20 @@ namespace rr
 
 namespace
 {
-	rr::LLVMReactorJIT *reactorJIT = nullptr;
-	llvm::IRBuilder<> *builder = nullptr;
-	llvm::LLVMContext *context = nullptr;
-	llvm::Module *module = nullptr;
-	llvm::Function *function = nullptr;
+	// Code generation state is kept per thread, so that routines can be built concurrently.
+	// It is freed when the thread exits, except for the JIT, which is reference counted by
+	// the thread and by the routines it generated, as these may still be in use.
+	thread_local rr::LLVMReactorJIT *reactorJIT = nullptr;
+	thread_local llvm::IRBuilder<> *builder = nullptr;
+	thread_local llvm::LLVMContext *context = nullptr;
+	thread_local llvm::Module *module = nullptr;
+	thread_local llvm::Function *function = nullptr;
+	thread_local rr::Routine::Stats *routineStats = nullptr;   // Counters of the function, when profiling it
+	thread_local llvm::Value *routineStartTicks = nullptr;
 
-	rr::MutexLock codegenMutex;
+#if REACTOR_LLVM_VERSION < 7
+	rr::MutexLock codegenMutex;   // The legacy JIT is not thread safe
+#endif
 
 #if REACTOR_LLVM_VERSION >= 7
 	llvm::Value *lowerPAVG(llvm::Value *x, llvm::Value *y)
@@ -457,6 +468,11 @@ namespace rr
 		{
 		}
 
+		void release()
+		{
+			delete this;   // Routines own their code, so only the thread refers to the JIT
+		}
+
 		void startSession()
 		{
 			std::string error;
@@ -485,10 +501,13 @@ namespace rr
 			::module = nullptr;
 		}
 
-		LLVMRoutine *acquireRoutine(llvm::Function *func)
+		LLVMRoutine *acquireRoutine(llvm::Function *func, bool optimize, size_t &codeSize)
 		{
 			void *entry = executionEngine->getPointerToFunction(::function);
-			return routineManager->acquireRoutine(entry);
+			LLVMRoutine *routine = routineManager->acquireRoutine(entry);
+			codeSize = routine->getCodeSize();
+
+			return routine;
 		}
 
 		void optimize(llvm::Module *module)
@@ -547,6 +566,46 @@ namespace rr
 		}
 	};
 
+	// Captures the object file of compiled modules, to retain routine images
+	class ObjectCapture : public llvm::ObjectCache
+	{
+	public:
+		void notifyObjectCompiled(const llvm::Module *module, llvm::MemoryBufferRef object) override
+		{
+			if(enabled)
+			{
+				image.insert(image.end(), object.getBufferStart(), object.getBufferEnd());
+			}
+		}
+
+		std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *module) override
+		{
+			return nullptr;
+		}
+
+		bool enabled = false;
+		std::vector<uint8_t> image;
+	};
+
+	// Records the size of the generated code, for profilers
+	class CodeMemoryManager : public llvm::SectionMemoryManager
+	{
+	public:
+		CodeMemoryManager(size_t &codeSize) : codeSize(codeSize)
+		{
+		}
+
+		uint8_t *allocateCodeSection(uintptr_t size, unsigned int alignment, unsigned int sectionID, llvm::StringRef sectionName) override
+		{
+			codeSize += size;
+
+			return llvm::SectionMemoryManager::allocateCodeSection(size, alignment, sectionID, sectionName);
+		}
+
+	private:
+		size_t &codeSize;
+	};
+
 	class LLVMReactorJIT
 	{
 	private:
@@ -558,9 +617,13 @@ namespace rr
 		std::shared_ptr<llvm::orc::SymbolResolver> resolver;
 		std::unique_ptr<llvm::TargetMachine> targetMachine;
 		const llvm::DataLayout dataLayout;
+		ObjectCapture objectCapture;
 		ObjLayer objLayer;
 		CompileLayer compileLayer;
 		size_t emittedFunctionsNum;
+		size_t emittedCodeSize;
+		rr::MutexLock layerMutex;   // Routines can be released by any thread
+		rr::AtomicInt references;   // The creating thread, until it exits, and each routine
 
 	public:
 		LLVMReactorJIT(const char *arch, const llvm::SmallVectorImpl<std::string>& mattrs,
@@ -594,12 +657,22 @@ namespace rr
 				session,
 				[this](llvm::orc::VModuleKey) {
 					return ObjLayer::Resources{
-						std::make_shared<llvm::SectionMemoryManager>(),
+						std::make_shared<CodeMemoryManager>(emittedCodeSize),
 						resolver};
 				}),
-			compileLayer(objLayer, llvm::orc::SimpleCompiler(*targetMachine)),
-			emittedFunctionsNum(0)
+			compileLayer(objLayer, llvm::orc::SimpleCompiler(*targetMachine, &objectCapture)),
+			emittedFunctionsNum(0),
+			emittedCodeSize(0),
+			references(1)
+		{
+		}
+
+		void release()
 		{
+			if(references-- == 0)   // Returns the decremented value
+			{
+				delete this;
+			}
 		}
 
 		void startSession()
@@ -613,7 +686,7 @@ namespace rr
 			::module = nullptr;
 		}
 
-		LLVMRoutine *acquireRoutine(llvm::Function *func)
+		LLVMRoutine *acquireRoutine(llvm::Function *func, bool optimize, size_t &codeSize)
 		{
 			std::string name = "f" + llvm::Twine(emittedFunctionsNum++).str();
 			func->setName(name);
@@ -624,25 +697,93 @@ namespace rr
 			::module = nullptr;
 			mod->setDataLayout(dataLayout);
 
-			auto moduleKey = session.allocateVModule();
-			llvm::cantFail(compileLayer.addModule(moduleKey, std::move(mod)));
-
 			std::string mangledName;
 			{
 				llvm::raw_string_ostream mangledNameStream(mangledName);
 				llvm::Mangler::getNameWithPrefix(mangledNameStream, name, dataLayout);
 			}
 
+			std::vector<uint8_t> image;
+			bool retainImage = retainRoutineImages && !::routineStats;   // Profiled routines refer to their counters by address
+
+			if(retainImage)
+			{
+				image.assign(mangledName.begin(), mangledName.end());
+				image.push_back('\0');
+			}
+
+			layerMutex.lock();
+			auto moduleKey = session.allocateVModule();
+			emittedCodeSize = 0;
+			objectCapture.enabled = retainImage;
+			objectCapture.image.swap(image);
+			targetMachine->setOptLevel(optimize ? llvm::CodeGenOpt::Aggressive : llvm::CodeGenOpt::None);
+			targetMachine->setFastISel(!optimize);   // Otherwise stays enabled after compiling at CodeGenOpt::None
+			llvm::cantFail(compileLayer.addModule(moduleKey, std::move(mod)));
+			objectCapture.image.swap(image);
+			objectCapture.enabled = false;
+
 			llvm::JITSymbol symbol = compileLayer.findSymbolIn(moduleKey, mangledName, false);
 
 			llvm::Expected<llvm::JITTargetAddress> expectAddr = symbol.getAddress();
+			codeSize = emittedCodeSize;
+			layerMutex.unlock();
+
 			if(!expectAddr)
 			{
 				return nullptr;
 			}
 
 			void *addr = reinterpret_cast<void *>(static_cast<intptr_t>(expectAddr.get()));
-			return new LLVMRoutine(addr, releaseRoutineCallback, this, moduleKey);
+			references++;
+			return new LLVMRoutine(addr, releaseRoutineCallback, this, moduleKey, std::move(image));
+		}
+
+		LLVMRoutine *loadRoutine(const void *image, size_t size)
+		{
+			const char *mangledName = static_cast<const char*>(image);
+			const char *nameEnd = static_cast<const char*>(memchr(mangledName, '\0', size));
+
+			if(!nameEnd || nameEnd + 1 == mangledName + size)
+			{
+				return nullptr;
+			}
+
+			llvm::StringRef object(nameEnd + 1, mangledName + size - (nameEnd + 1));
+
+			layerMutex.lock();
+			auto moduleKey = session.allocateVModule();
+			llvm::Error error = objLayer.addObject(moduleKey, llvm::MemoryBuffer::getMemBufferCopy(object));
+
+			if(error)
+			{
+				layerMutex.unlock();
+				llvm::consumeError(std::move(error));
+				return nullptr;
+			}
+
+			llvm::JITSymbol symbol = objLayer.findSymbolIn(moduleKey, mangledName, false);
+
+			llvm::Expected<llvm::JITTargetAddress> expectAddr = symbol.getAddress();
+
+			if(!expectAddr || !expectAddr.get())
+			{
+				if(!expectAddr)
+				{
+					llvm::consumeError(expectAddr.takeError());
+				}
+
+				llvm::cantFail(objLayer.removeObject(moduleKey));
+				layerMutex.unlock();
+
+				return nullptr;
+			}
+
+			layerMutex.unlock();
+
+			void *addr = reinterpret_cast<void *>(static_cast<intptr_t>(expectAddr.get()));
+			references++;
+			return new LLVMRoutine(addr, releaseRoutineCallback, this, moduleKey, std::vector<uint8_t>());
 		}
 
 		void optimize(llvm::Module *module)
@@ -677,7 +818,11 @@ namespace rr
 	private:
 		void releaseRoutineModule(llvm::orc::VModuleKey moduleKey)
 		{
+			layerMutex.lock();
 			llvm::cantFail(compileLayer.removeModule(moduleKey));
+			layerMutex.unlock();
+
+			release();
 		}
 
 		static void releaseRoutineCallback(LLVMReactorJIT *jit, uint64_t moduleKey)
@@ -687,7 +832,40 @@ namespace rr
 	};
 #endif
 
+	// Frees the code generation state of a thread when it exits
+	class ThreadCodegenState
+	{
+	public:
+		void attach()
+		{
+			attached = true;
+		}
+
+		~ThreadCodegenState()
+		{
+			if(!attached)
+			{
+				return;
+			}
+
+			delete ::builder;
+			delete ::context;
+			::builder = nullptr;
+			::context = nullptr;
+
+			::reactorJIT->release();
+			::reactorJIT = nullptr;
+		}
+
+	private:
+		bool attached = false;
+	};
+
+	static thread_local ThreadCodegenState threadCodegenState;
+
 	Optimization optimization[10] = {InstructionCombining, Disabled};
+	bool retainRoutineImages = false;
+	bool profileRoutines = false;
 
 	enum EmulatedType
 	{
@@ -796,20 +974,22 @@ namespace rr
 		return llvm::cast<llvm::VectorType>(T(type))->getNumElements();
 	}
 
-	Nucleus::Nucleus()
+	static void createReactorJIT()
 	{
-		::codegenMutex.lock();   // Reactor and LLVM are currently not thread safe
-
-		llvm::InitializeNativeTarget();
+		static std::once_flag targetInitialized;
+		std::call_once(targetInitialized, []()
+		{
+			llvm::InitializeNativeTarget();
 
 #if REACTOR_LLVM_VERSION >= 7
-		llvm::InitializeNativeTargetAsmPrinter();
-		llvm::InitializeNativeTargetAsmParser();
+			llvm::InitializeNativeTargetAsmPrinter();
+			llvm::InitializeNativeTargetAsmParser();
 #endif
+		});
 
-		if(!::context)
+		if(::reactorJIT)
 		{
-			::context = new llvm::LLVMContext();
+			return;
 		}
 
 		#if defined(__x86_64__)
@@ -840,8 +1020,13 @@ namespace rr
 		mattrs.push_back(CPUID::supportsSSSE3()  ? "+ssse3"  : "-ssse3");
 #if REACTOR_LLVM_VERSION < 7
 		mattrs.push_back(CPUID::supportsSSE4_1() ? "+sse41"  : "-sse41");
+		CPUID::setEnableAVX(false);   // The legacy JIT can't encode VEX prefixes
 #else
-		mattrs.push_back(CPUID::supportsSSE4_1() ? "+sse4.1" : "-sse4.1");
+		mattrs.push_back(CPUID::supportsSSE4_1()  ? "+sse4.1"  : "-sse4.1");
+		mattrs.push_back(CPUID::supportsAVX()     ? "+avx"     : "-avx");
+		mattrs.push_back(CPUID::supportsAVX2()    ? "+avx2"    : "-avx2");
+		mattrs.push_back(CPUID::supportsAVX512F() ? "+avx512f" : "-avx512f");
+		mattrs.push_back(CPUID::supportsFMA()     ? "+fma"     : "-fma");
 #endif
 #elif defined(__arm__)
 #if __ARM_ARCH >= 8
@@ -864,13 +1049,26 @@ namespace rr
 		// targetOpts.NoNaNsFPMath = true;
 #endif
 
-		if(!::reactorJIT)
-		{
 #if REACTOR_LLVM_VERSION < 7
-			::reactorJIT = new LLVMReactorJIT(arch, mattrs);
+		::reactorJIT = new LLVMReactorJIT(arch, mattrs);
 #else
-			::reactorJIT = new LLVMReactorJIT(arch, mattrs, targetOpts);
+		::reactorJIT = new LLVMReactorJIT(arch, mattrs, targetOpts);
+#endif
+
+		threadCodegenState.attach();   // Registers the destructor for this thread
+	}
+
+	Nucleus::Nucleus()
+	{
+#if REACTOR_LLVM_VERSION < 7
+		::codegenMutex.lock();
 #endif
+
+		createReactorJIT();
+
+		if(!::context)
+		{
+			::context = new llvm::LLVMContext();
 		}
 
 		::reactorJIT->startSession();
@@ -885,7 +1083,12 @@ namespace rr
 	{
 		::reactorJIT->endSession();
 
+		delete ::routineStats;   // Not acquired
+		::routineStats = nullptr;
+
+#if REACTOR_LLVM_VERSION < 7
 		::codegenMutex.unlock();
+#endif
 	}
 
 	Routine *Nucleus::acquireRoutine(const char *name, bool runOptimizations)
@@ -935,11 +1138,41 @@ namespace rr
 			::module->print(file, 0);
 		}
 
-		LLVMRoutine *routine = ::reactorJIT->acquireRoutine(::function);
+		size_t codeSize = 0;
+		LLVMRoutine *routine = ::reactorJIT->acquireRoutine(::function, runOptimizations, codeSize);
+
+		if(routine)
+		{
+			routine->optimized = runOptimizations;
+			routine->stats = ::routineStats;
+			::routineStats = nullptr;
+
+			registerRoutineCode(routine->getEntry(), codeSize, name);
+		}
 
 		return routine;
 	}
 
+	Routine *Nucleus::loadRoutine(const void *image, size_t size)
+	{
+#if REACTOR_LLVM_VERSION < 7
+		return nullptr;   // Routine images are not retained by the legacy JIT
+#else
+		createReactorJIT();
+
+		return ::reactorJIT->loadRoutine(image, size);
+#endif
+	}
+
+	bool Nucleus::supportsWideVectors()
+	{
+#if REACTOR_LLVM_VERSION >= 7 && (defined(__i386__) || defined(__x86_64__))
+		return CPUID::supportsAVX();
+#else
+		return false;
+#endif
+	}
+
 	void Nucleus::optimize()
 	{
 		::reactorJIT->optimize(::module);
@@ -1008,6 +1241,12 @@ namespace rr
 		#endif
 
 		::builder->SetInsertPoint(llvm::BasicBlock::Create(*::context, "", ::function));
+
+		if(profileRoutines)
+		{
+			::routineStats = new Routine::Stats();
+			::routineStartTicks = V(Ticks().value);
+		}
 	}
 
 	Value *Nucleus::getArgument(unsigned int index)
@@ -1023,13 +1262,32 @@ namespace rr
 		return V(&*args);
 	}
 
+	// Adds the call and its duration to the counters of a profiled routine
+	static void countRoutineCall()
+	{
+		if(::routineStats)
+		{
+			llvm::Type *counterType = llvm::Type::getInt64PtrTy(*::context);
+			llvm::Value *calls = ::builder->CreateIntToPtr(::builder->getInt64((uintptr_t)&::routineStats->calls), counterType);
+			llvm::Value *cycles = ::builder->CreateIntToPtr(::builder->getInt64((uintptr_t)&::routineStats->cycles), counterType);
+			llvm::Value *elapsed = ::builder->CreateSub(V(Ticks().value), ::routineStartTicks);
+
+			Nucleus::createAtomicAdd(V(calls), V(::builder->getInt64(1)));
+			Nucleus::createAtomicAdd(V(cycles), V(elapsed));
+		}
+	}
+
 	void Nucleus::createRetVoid()
 	{
+		countRoutineCall();
+
 		::builder->CreateRetVoid();
 	}
 
 	void Nucleus::createRet(Value *v)
 	{
+		countRoutineCall();
+
 		::builder->CreateRet(V(v));
 	}
 
@@ -1514,6 +1772,20 @@ namespace rr
 		return Nucleus::createShuffleVector(lhs, rhs, swizzle);
 	}
 
+	// Unlike Nucleus::createShuffleVector(), the result can have a different width than the operands
+	static Value *createResize(Value *v1, Value *v2, const int *select, int size)
+	{
+		llvm::Constant *shuffle[16];
+		assert(size <= 16);
+
+		for(int i = 0; i < size; i++)
+		{
+			shuffle[i] = llvm::ConstantInt::get(llvm::Type::getInt32Ty(*::context), select[i]);
+		}
+
+		return V(::builder->CreateShuffleVector(V(v1), V(v2), llvm::ConstantVector::get(llvm::ArrayRef<llvm::Constant*>(shuffle, size))));
+	}
+
 	Type *Nucleus::getPointerType(Type *ElementType)
 	{
 		return T(llvm::PointerType::get(T(ElementType), 0));
@@ -6877,126 +7149,870 @@ namespace rr
 		return T(llvm::VectorType::get(T(Float::getType()), 4));
 	}
 
-	RValue<Pointer<Byte>> operator+(RValue<Pointer<Byte>> lhs, int offset)
+	Int8::Int8(RValue<Float8> cast)
 	{
-		return lhs + RValue<Int>(Nucleus::createConstantInt(offset));
+		Value *xyzw = Nucleus::createFPToSI(cast.value, Int8::getType());
+
+		storeValue(xyzw);
 	}
 
-	RValue<Pointer<Byte>> operator+(RValue<Pointer<Byte>> lhs, RValue<Int> offset)
+	Int8::Int8(int xyzw)
 	{
-		return RValue<Pointer<Byte>>(Nucleus::createGEP(lhs.value, Byte::getType(), offset.value, false));
+		int64_t constantVector[8] = {xyzw, xyzw, xyzw, xyzw, xyzw, xyzw, xyzw, xyzw};
+		storeValue(Nucleus::createConstantVector(constantVector, getType()));
 	}
 
-	RValue<Pointer<Byte>> operator+(RValue<Pointer<Byte>> lhs, RValue<UInt> offset)
+	Int8::Int8(int x0, int x1, int x2, int x3, int x4, int x5, int x6, int x7)
 	{
-		return RValue<Pointer<Byte>>(Nucleus::createGEP(lhs.value, Byte::getType(), offset.value, true));
+		int64_t constantVector[8] = {x0, x1, x2, x3, x4, x5, x6, x7};
+		storeValue(Nucleus::createConstantVector(constantVector, getType()));
 	}
 
-	RValue<Pointer<Byte>> operator+=(Pointer<Byte> &lhs, int offset)
+	Int8::Int8(RValue<Int8> rhs)
 	{
-		return lhs = lhs + offset;
+		storeValue(rhs.value);
 	}
 
-	RValue<Pointer<Byte>> operator+=(Pointer<Byte> &lhs, RValue<Int> offset)
+	Int8::Int8(const Int8 &rhs)
 	{
-		return lhs = lhs + offset;
+		Value *value = rhs.loadValue();
+		storeValue(value);
 	}
 
-	RValue<Pointer<Byte>> operator+=(Pointer<Byte> &lhs, RValue<UInt> offset)
+	Int8::Int8(const Reference<Int8> &rhs)
 	{
-		return lhs = lhs + offset;
+		Value *value = rhs.loadValue();
+		storeValue(value);
 	}
 
-	RValue<Pointer<Byte>> operator-(RValue<Pointer<Byte>> lhs, int offset)
+	Int8::Int8(RValue<Int4> lo, RValue<Int4> hi)
 	{
-		return lhs + -offset;
+		int shuffle[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+		Value *packed = createResize(lo.value, hi.value, shuffle, 8);
+
+		storeValue(packed);
 	}
 
-	RValue<Pointer<Byte>> operator-(RValue<Pointer<Byte>> lhs, RValue<Int> offset)
+	Int8::Int8(RValue<Int> rhs)
 	{
-		return lhs + -offset;
+		Value *vector = V(llvm::UndefValue::get(T(getType())));
+		Value *insert = Nucleus::createInsertElement(vector, rhs.value, 0);
+
+		int swizzle[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+		Value *replicate = Nucleus::createShuffleVector(insert, insert, swizzle);
+
+		storeValue(replicate);
 	}
 
-	RValue<Pointer<Byte>> operator-(RValue<Pointer<Byte>> lhs, RValue<UInt> offset)
+	Int8::Int8(const Int &rhs)
 	{
-		return lhs + -offset;
+		*this = Int8(RValue<Int>(rhs.loadValue()));
 	}
 
-	RValue<Pointer<Byte>> operator-=(Pointer<Byte> &lhs, int offset)
+	Int8::Int8(const Reference<Int> &rhs)
 	{
-		return lhs = lhs - offset;
+		*this = Int8(RValue<Int>(rhs.loadValue()));
 	}
 
-	RValue<Pointer<Byte>> operator-=(Pointer<Byte> &lhs, RValue<Int> offset)
+	RValue<Int8> Int8::operator=(RValue<Int8> rhs)
 	{
-		return lhs = lhs - offset;
+		storeValue(rhs.value);
+
+		return rhs;
 	}
 
-	RValue<Pointer<Byte>> operator-=(Pointer<Byte> &lhs, RValue<UInt> offset)
+	RValue<Int8> Int8::operator=(const Int8 &rhs)
 	{
-		return lhs = lhs - offset;
+		Value *value = rhs.loadValue();
+		storeValue(value);
+
+		return RValue<Int8>(value);
 	}
 
-	void Return()
+	RValue<Int8> Int8::operator=(const Reference<Int8> &rhs)
 	{
-		Nucleus::createRetVoid();
-		Nucleus::setInsertBlock(Nucleus::createBasicBlock());
-		Nucleus::createUnreachable();
+		Value *value = rhs.loadValue();
+		storeValue(value);
+
+		return RValue<Int8>(value);
 	}
 
-	void Return(RValue<Int> ret)
+	RValue<Int8> operator+(RValue<Int8> lhs, RValue<Int8> rhs)
 	{
-		Nucleus::createRet(ret.value);
-		Nucleus::setInsertBlock(Nucleus::createBasicBlock());
-		Nucleus::createUnreachable();
+		return RValue<Int8>(Nucleus::createAdd(lhs.value, rhs.value));
 	}
 
-	void branch(RValue<Bool> cmp, BasicBlock *bodyBB, BasicBlock *endBB)
+	RValue<Int8> operator-(RValue<Int8> lhs, RValue<Int8> rhs)
 	{
-		Nucleus::createCondBr(cmp.value, bodyBB, endBB);
-		Nucleus::setInsertBlock(bodyBB);
+		return RValue<Int8>(Nucleus::createSub(lhs.value, rhs.value));
 	}
 
-	RValue<Long> Ticks()
+	RValue<Int8> operator*(RValue<Int8> lhs, RValue<Int8> rhs)
 	{
-		llvm::Function *rdtsc = llvm::Intrinsic::getDeclaration(::module, llvm::Intrinsic::readcyclecounter);
+		return RValue<Int8>(Nucleus::createMul(lhs.value, rhs.value));
+	}
 
-		return RValue<Long>(V(::builder->CreateCall(rdtsc)));
+	RValue<Int8> operator&(RValue<Int8> lhs, RValue<Int8> rhs)
+	{
+		return RValue<Int8>(Nucleus::createAnd(lhs.value, rhs.value));
 	}
-}
 
-namespace rr
-{
-#if defined(__i386__) || defined(__x86_64__)
-	namespace x86
+	RValue<Int8> operator|(RValue<Int8> lhs, RValue<Int8> rhs)
 	{
-		RValue<Int> cvtss2si(RValue<Float> val)
-		{
-			llvm::Function *cvtss2si = llvm::Intrinsic::getDeclaration(::module, llvm::Intrinsic::x86_sse_cvtss2si);
+		return RValue<Int8>(Nucleus::createOr(lhs.value, rhs.value));
+	}
 
-			Float4 vector;
-			vector.x = val;
+	RValue<Int8> operator^(RValue<Int8> lhs, RValue<Int8> rhs)
+	{
+		return RValue<Int8>(Nucleus::createXor(lhs.value, rhs.value));
+	}
 
-			return RValue<Int>(V(::builder->CreateCall(cvtss2si, ARGS(V(RValue<Float4>(vector).value)))));
-		}
+	RValue<Int8> operator<<(RValue<Int8> lhs, unsigned char rhs)
+	{
+		return RValue<Int8>(Nucleus::createShl(lhs.value, Int8(rhs).loadValue()));
+	}
 
-		RValue<Int4> cvtps2dq(RValue<Float4> val)
-		{
-			llvm::Function *cvtps2dq = llvm::Intrinsic::getDeclaration(::module, llvm::Intrinsic::x86_sse2_cvtps2dq);
+	RValue<Int8> operator>>(RValue<Int8> lhs, unsigned char rhs)
+	{
+		return RValue<Int8>(Nucleus::createAShr(lhs.value, Int8(rhs).loadValue()));
+	}
 
-			return RValue<Int4>(V(::builder->CreateCall(cvtps2dq, ARGS(V(val.value)))));
-		}
+	RValue<Int8> operator+=(Int8 &lhs, RValue<Int8> rhs)
+	{
+		return lhs = lhs + rhs;
+	}
 
-		RValue<Float> rcpss(RValue<Float> val)
-		{
-			llvm::Function *rcpss = llvm::Intrinsic::getDeclaration(::module, llvm::Intrinsic::x86_sse_rcp_ss);
+	RValue<Int8> operator-=(Int8 &lhs, RValue<Int8> rhs)
+	{
+		return lhs = lhs - rhs;
+	}
 
-			Value *vector = Nucleus::createInsertElement(V(llvm::UndefValue::get(T(Float4::getType()))), val.value, 0);
+	RValue<Int8> operator*=(Int8 &lhs, RValue<Int8> rhs)
+	{
+		return lhs = lhs * rhs;
+	}
 
-			return RValue<Float>(Nucleus::createExtractElement(V(::builder->CreateCall(rcpss, ARGS(V(vector)))), Float::getType(), 0));
-		}
+	RValue<Int8> operator&=(Int8 &lhs, RValue<Int8> rhs)
+	{
+		return lhs = lhs & rhs;
+	}
 
-		RValue<Float> sqrtss(RValue<Float> val)
+	RValue<Int8> operator|=(Int8 &lhs, RValue<Int8> rhs)
+	{
+		return lhs = lhs | rhs;
+	}
+
+	RValue<Int8> operator^=(Int8 &lhs, RValue<Int8> rhs)
+	{
+		return lhs = lhs ^ rhs;
+	}
+
+	RValue<Int8> operator<<=(Int8 &lhs, unsigned char rhs)
+	{
+		return lhs = lhs << rhs;
+	}
+
+	RValue<Int8> operator>>=(Int8 &lhs, unsigned char rhs)
+	{
+		return lhs = lhs >> rhs;
+	}
+
+	RValue<Int8> operator+(RValue<Int8> val)
+	{
+		return val;
+	}
+
+	RValue<Int8> operator-(RValue<Int8> val)
+	{
+		return RValue<Int8>(Nucleus::createNeg(val.value));
+	}
+
+	RValue<Int8> operator~(RValue<Int8> val)
+	{
+		return RValue<Int8>(Nucleus::createNot(val.value));
+	}
+
+	RValue<Int8> CmpEQ(RValue<Int8> x, RValue<Int8> y)
+	{
+		return RValue<Int8>(Nucleus::createSExt(Nucleus::createICmpEQ(x.value, y.value), Int8::getType()));
+	}
+
+	RValue<Int8> CmpLT(RValue<Int8> x, RValue<Int8> y)
+	{
+		return RValue<Int8>(Nucleus::createSExt(Nucleus::createICmpSLT(x.value, y.value), Int8::getType()));
+	}
+
+	RValue<Int8> CmpLE(RValue<Int8> x, RValue<Int8> y)
+	{
+		return RValue<Int8>(Nucleus::createSExt(Nucleus::createICmpSLE(x.value, y.value), Int8::getType()));
+	}
+
+	RValue<Int8> CmpNEQ(RValue<Int8> x, RValue<Int8> y)
+	{
+		return RValue<Int8>(Nucleus::createSExt(Nucleus::createICmpNE(x.value, y.value), Int8::getType()));
+	}
+
+	RValue<Int8> CmpNLT(RValue<Int8> x, RValue<Int8> y)
+	{
+		return RValue<Int8>(Nucleus::createSExt(Nucleus::createICmpSGE(x.value, y.value), Int8::getType()));
+	}
+
+	RValue<Int8> CmpNLE(RValue<Int8> x, RValue<Int8> y)
+	{
+		return RValue<Int8>(Nucleus::createSExt(Nucleus::createICmpSGT(x.value, y.value), Int8::getType()));
+	}
+
+	RValue<Int8> Max(RValue<Int8> x, RValue<Int8> y)
+	{
+		return RValue<Int8>(Nucleus::createSelect(Nucleus::createICmpSGT(x.value, y.value), x.value, y.value));
+	}
+
+	RValue<Int8> Min(RValue<Int8> x, RValue<Int8> y)
+	{
+		return RValue<Int8>(Nucleus::createSelect(Nucleus::createICmpSLT(x.value, y.value), x.value, y.value));
+	}
+
+	RValue<Int8> RoundInt(RValue<Float8> cast)
+	{
+#if defined(__i386__) || defined(__x86_64__)
+		if(CPUID::supportsAVX())
+		{
+			return x86::cvtps2dq(cast);
+		}
+		else
+#endif
+		{
+			return Int8(RoundInt(Extract4(cast, 0)), RoundInt(Extract4(cast, 1)));
+		}
+	}
+
+	RValue<Int> Extract(RValue<Int8> x, int i)
+	{
+		return RValue<Int>(Nucleus::createExtractElement(x.value, Int::getType(), i));
+	}
+
+	RValue<Int8> Insert(RValue<Int8> x, RValue<Int> element, int i)
+	{
+		return RValue<Int8>(Nucleus::createInsertElement(x.value, element.value, i));
+	}
+
+	RValue<Int4> Extract4(RValue<Int8> val, int i)
+	{
+		int shuffle[4] = {4 * i + 0, 4 * i + 1, 4 * i + 2, 4 * i + 3};
+
+		return RValue<Int4>(createResize(val.value, val.value, shuffle, 4));
+	}
+
+	RValue<Int8> Insert4(RValue<Int8> val, RValue<Int4> element, int i)
+	{
+		return i == 0 ? Int8(element, Extract4(val, 1)) : Int8(Extract4(val, 0), element);
+	}
+
+	RValue<Int> SignMask(RValue<Int8> x)
+	{
+		return SignMask(As<Float8>(x));
+	}
+
+	Type *Int8::getType()
+	{
+		return T(llvm::VectorType::get(T(Int::getType()), 8));
+	}
+
+	Float8::Float8(RValue<Int8> cast)
+	{
+		Value *xyzw = Nucleus::createSIToFP(cast.value, Float8::getType());
+
+		storeValue(xyzw);
+	}
+
+	Float8::Float8(float xyzw)
+	{
+		double constantVector[8] = {xyzw, xyzw, xyzw, xyzw, xyzw, xyzw, xyzw, xyzw};
+		storeValue(Nucleus::createConstantVector(constantVector, getType()));
+	}
+
+	Float8::Float8(float x0, float x1, float x2, float x3, float x4, float x5, float x6, float x7)
+	{
+		double constantVector[8] = {x0, x1, x2, x3, x4, x5, x6, x7};
+		storeValue(Nucleus::createConstantVector(constantVector, getType()));
+	}
+
+	Float8::Float8(RValue<Float8> rhs)
+	{
+		storeValue(rhs.value);
+	}
+
+	Float8::Float8(const Float8 &rhs)
+	{
+		Value *value = rhs.loadValue();
+		storeValue(value);
+	}
+
+	Float8::Float8(const Reference<Float8> &rhs)
+	{
+		Value *value = rhs.loadValue();
+		storeValue(value);
+	}
+
+	Float8::Float8(RValue<Float4> lo, RValue<Float4> hi)
+	{
+		int shuffle[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+		Value *packed = createResize(lo.value, hi.value, shuffle, 8);
+
+		storeValue(packed);
+	}
+
+	Float8::Float8(RValue<Float> rhs)
+	{
+		Value *vector = V(llvm::UndefValue::get(T(getType())));
+		Value *insert = Nucleus::createInsertElement(vector, rhs.value, 0);
+
+		int swizzle[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+		Value *replicate = Nucleus::createShuffleVector(insert, insert, swizzle);
+
+		storeValue(replicate);
+	}
+
+	Float8::Float8(const Float &rhs)
+	{
+		*this = Float8(RValue<Float>(rhs.loadValue()));
+	}
+
+	Float8::Float8(const Reference<Float> &rhs)
+	{
+		*this = Float8(RValue<Float>(rhs.loadValue()));
+	}
+
+	RValue<Float8> Float8::operator=(RValue<Float8> rhs)
+	{
+		storeValue(rhs.value);
+
+		return rhs;
+	}
+
+	RValue<Float8> Float8::operator=(const Float8 &rhs)
+	{
+		Value *value = rhs.loadValue();
+		storeValue(value);
+
+		return RValue<Float8>(value);
+	}
+
+	RValue<Float8> Float8::operator=(const Reference<Float8> &rhs)
+	{
+		Value *value = rhs.loadValue();
+		storeValue(value);
+
+		return RValue<Float8>(value);
+	}
+
+	RValue<Float8> operator+(RValue<Float8> lhs, RValue<Float8> rhs)
+	{
+		return RValue<Float8>(Nucleus::createFAdd(lhs.value, rhs.value));
+	}
+
+	RValue<Float8> operator-(RValue<Float8> lhs, RValue<Float8> rhs)
+	{
+		return RValue<Float8>(Nucleus::createFSub(lhs.value, rhs.value));
+	}
+
+	RValue<Float8> operator*(RValue<Float8> lhs, RValue<Float8> rhs)
+	{
+		return RValue<Float8>(Nucleus::createFMul(lhs.value, rhs.value));
+	}
+
+	RValue<Float8> operator/(RValue<Float8> lhs, RValue<Float8> rhs)
+	{
+		return RValue<Float8>(Nucleus::createFDiv(lhs.value, rhs.value));
+	}
+
+	RValue<Float8> operator+=(Float8 &lhs, RValue<Float8> rhs)
+	{
+		return lhs = lhs + rhs;
+	}
+
+	RValue<Float8> operator-=(Float8 &lhs, RValue<Float8> rhs)
+	{
+		return lhs = lhs - rhs;
+	}
+
+	RValue<Float8> operator*=(Float8 &lhs, RValue<Float8> rhs)
+	{
+		return lhs = lhs * rhs;
+	}
+
+	RValue<Float8> operator/=(Float8 &lhs, RValue<Float8> rhs)
+	{
+		return lhs = lhs / rhs;
+	}
+
+	RValue<Float8> operator+(RValue<Float8> val)
+	{
+		return val;
+	}
+
+	RValue<Float8> operator-(RValue<Float8> val)
+	{
+		return RValue<Float8>(Nucleus::createFNeg(val.value));
+	}
+
+	RValue<Float8> Abs(RValue<Float8> x)
+	{
+		return As<Float8>(As<Int8>(x) & Int8(0x7FFFFFFF));
+	}
+
+	RValue<Float8> Max(RValue<Float8> x, RValue<Float8> y)
+	{
+#if defined(__i386__) || defined(__x86_64__)
+		if(CPUID::supportsAVX())
+		{
+			return x86::maxps(x, y);
+		}
+		else
+#endif
+		{
+			return Float8(Max(Extract4(x, 0), Extract4(y, 0)), Max(Extract4(x, 1), Extract4(y, 1)));
+		}
+	}
+
+	RValue<Float8> Min(RValue<Float8> x, RValue<Float8> y)
+	{
+#if defined(__i386__) || defined(__x86_64__)
+		if(CPUID::supportsAVX())
+		{
+			return x86::minps(x, y);
+		}
+		else
+#endif
+		{
+			return Float8(Min(Extract4(x, 0), Extract4(y, 0)), Min(Extract4(x, 1), Extract4(y, 1)));
+		}
+	}
+
+	RValue<Float8> Sqrt(RValue<Float8> x)
+	{
+#if REACTOR_LLVM_VERSION < 7
+		return Float8(Sqrt(Extract4(x, 0)), Sqrt(Extract4(x, 1)));
+#else
+		llvm::Function *sqrt = llvm::Intrinsic::getDeclaration(::module, llvm::Intrinsic::sqrt, {V(x.value)->getType()});
+		return RValue<Float8>(V(::builder->CreateCall(sqrt, ARGS(V(x.value)))));
+#endif
+	}
+
+	RValue<Float8> Insert(RValue<Float8> x, RValue<Float> element, int i)
+	{
+		return RValue<Float8>(Nucleus::createInsertElement(x.value, element.value, i));
+	}
+
+	RValue<Float> Extract(RValue<Float8> x, int i)
+	{
+		return RValue<Float>(Nucleus::createExtractElement(x.value, Float::getType(), i));
+	}
+
+	RValue<Float4> Extract4(RValue<Float8> val, int i)
+	{
+		int shuffle[4] = {4 * i + 0, 4 * i + 1, 4 * i + 2, 4 * i + 3};
+
+		return RValue<Float4>(createResize(val.value, val.value, shuffle, 4));
+	}
+
+	RValue<Float8> Insert4(RValue<Float8> val, RValue<Float4> element, int i)
+	{
+		return i == 0 ? Float8(element, Extract4(val, 1)) : Float8(Extract4(val, 0), element);
+	}
+
+	RValue<Int> SignMask(RValue<Float8> x)
+	{
+#if defined(__i386__) || defined(__x86_64__)
+		if(CPUID::supportsAVX())
+		{
+			return x86::movmskps(x);
+		}
+		else
+#endif
+		{
+			return SignMask(Extract4(x, 0)) | (SignMask(Extract4(x, 1)) << 4);
+		}
+	}
+
+	RValue<Int8> CmpEQ(RValue<Float8> x, RValue<Float8> y)
+	{
+		return RValue<Int8>(Nucleus::createSExt(Nucleus::createFCmpOEQ(x.value, y.value), Int8::getType()));
+	}
+
+	RValue<Int8> CmpLT(RValue<Float8> x, RValue<Float8> y)
+	{
+		return RValue<Int8>(Nucleus::createSExt(Nucleus::createFCmpOLT(x.value, y.value), Int8::getType()));
+	}
+
+	RValue<Int8> CmpLE(RValue<Float8> x, RValue<Float8> y)
+	{
+		return RValue<Int8>(Nucleus::createSExt(Nucleus::createFCmpOLE(x.value, y.value), Int8::getType()));
+	}
+
+	RValue<Int8> CmpNEQ(RValue<Float8> x, RValue<Float8> y)
+	{
+		return RValue<Int8>(Nucleus::createSExt(Nucleus::createFCmpONE(x.value, y.value), Int8::getType()));
+	}
+
+	RValue<Int8> CmpNLT(RValue<Float8> x, RValue<Float8> y)
+	{
+		return RValue<Int8>(Nucleus::createSExt(Nucleus::createFCmpOGE(x.value, y.value), Int8::getType()));
+	}
+
+	RValue<Int8> CmpNLE(RValue<Float8> x, RValue<Float8> y)
+	{
+		return RValue<Int8>(Nucleus::createSExt(Nucleus::createFCmpOGT(x.value, y.value), Int8::getType()));
+	}
+
+	RValue<Float8> Round(RValue<Float8> x)
+	{
+#if defined(__i386__) || defined(__x86_64__)
+		if(CPUID::supportsAVX())
+		{
+			return x86::roundps(x, 0);
+		}
+		else
+#endif
+		{
+			return Float8(Round(Extract4(x, 0)), Round(Extract4(x, 1)));
+		}
+	}
+
+	RValue<Float8> Trunc(RValue<Float8> x)
+	{
+#if defined(__i386__) || defined(__x86_64__)
+		if(CPUID::supportsAVX())
+		{
+			return x86::roundps(x, 3);
+		}
+		else
+#endif
+		{
+			return Float8(Trunc(Extract4(x, 0)), Trunc(Extract4(x, 1)));
+		}
+	}
+
+	RValue<Float8> Frac(RValue<Float8> x)
+	{
+#if defined(__i386__) || defined(__x86_64__)
+		if(CPUID::supportsAVX())
+		{
+			// x - floor(x) can be 1.0 for very small negative x.
+			// Clamp against the value just below 1.0.
+			return Min(x - Floor(x), As<Float8>(Int8(0x3F7FFFFF)));
+		}
+		else
+#endif
+		{
+			return Float8(Frac(Extract4(x, 0)), Frac(Extract4(x, 1)));
+		}
+	}
+
+	RValue<Float8> Floor(RValue<Float8> x)
+	{
+#if defined(__i386__) || defined(__x86_64__)
+		if(CPUID::supportsAVX())
+		{
+			return x86::roundps(x, 1);
+		}
+		else
+#endif
+		{
+			return Float8(Floor(Extract4(x, 0)), Floor(Extract4(x, 1)));
+		}
+	}
+
+	RValue<Float8> Ceil(RValue<Float8> x)
+	{
+#if defined(__i386__) || defined(__x86_64__)
+		if(CPUID::supportsAVX())
+		{
+			return x86::roundps(x, 2);
+		}
+		else
+#endif
+		{
+			return Float8(Ceil(Extract4(x, 0)), Ceil(Extract4(x, 1)));
+		}
+	}
+
+	Type *Float8::getType()
+	{
+		return T(llvm::VectorType::get(T(Float::getType()), 8));
+	}
+
+	static llvm::Value *createMask(Value *mask)
+	{
+		llvm::Value *zero = llvm::Constant::getNullValue(V(mask)->getType());
+		return ::builder->CreateICmpNE(V(mask), zero);
+	}
+
+	static Value *createGather(Value *base, Type *elementType, Value *offsets, Value *mask, unsigned int alignment, bool zeroMaskedLanes)
+	{
+		unsigned int numElements = llvm::cast<llvm::VectorType>(V(mask)->getType())->getNumElements();
+		llvm::Type *vectorType = llvm::VectorType::get(T(elementType), numElements);
+		llvm::Value *passthrough = zeroMaskedLanes ? llvm::Constant::getNullValue(vectorType) : llvm::UndefValue::get(vectorType);
+		llvm::Value *bytes = ::builder->CreatePointerCast(V(base), llvm::Type::getInt8PtrTy(*::context));
+		llvm::Value *active = createMask(mask);
+
+#if REACTOR_LLVM_VERSION < 7
+		// Masked off lanes load a zeroed local variable instead, so they can't fault
+		llvm::Value *dummy = V(Nucleus::allocateStackVariable(elementType));
+		::builder->CreateStore(llvm::Constant::getNullValue(T(elementType)), dummy);
+
+		llvm::Value *result = passthrough;
+
+		for(unsigned int i = 0; i < numElements; i++)
+		{
+			llvm::Value *index = ::builder->getInt32(i);
+			llvm::Value *address = ::builder->CreateGEP(bytes, ::builder->CreateExtractElement(V(offsets), index));
+			address = ::builder->CreatePointerCast(address, T(elementType)->getPointerTo());
+			address = ::builder->CreateSelect(::builder->CreateExtractElement(active, index), address, dummy);
+
+			llvm::LoadInst *element = ::builder->CreateLoad(address);
+			element->setAlignment(alignment);
+			result = ::builder->CreateInsertElement(result, element, index);
+		}
+
+		return V(result);
+#else
+		// Lowered to scalar loads on targets without a native gather
+		llvm::Value *addresses = ::builder->CreateGEP(bytes, V(offsets));
+		addresses = ::builder->CreatePointerCast(addresses, llvm::VectorType::get(T(elementType)->getPointerTo(), numElements));
+
+		return V(::builder->CreateMaskedGather(addresses, alignment, active, passthrough));
+#endif
+	}
+
+	static Value *createMaskedLoad(Value *base, Type *vectorType, Value *mask, unsigned int alignment, bool zeroMaskedLanes)
+	{
+#if REACTOR_LLVM_VERSION < 7
+		Type *elementType = T(llvm::cast<llvm::VectorType>(T(vectorType))->getElementType());
+		unsigned int elementSize = T(elementType)->getPrimitiveSizeInBits() / 8;
+		unsigned int numElements = llvm::cast<llvm::VectorType>(T(vectorType))->getNumElements();
+		std::vector<llvm::Constant*> offsets;
+
+		for(unsigned int i = 0; i < numElements; i++)
+		{
+			offsets.push_back(::builder->getInt32(i * elementSize));
+		}
+
+		return createGather(base, elementType, V(llvm::ConstantVector::get(offsets)), mask, alignment, zeroMaskedLanes);
+#else
+		llvm::Value *passthrough = zeroMaskedLanes ? llvm::Constant::getNullValue(T(vectorType)) : llvm::UndefValue::get(T(vectorType));
+		return V(::builder->CreateMaskedLoad(V(base), alignment, createMask(mask), passthrough));
+#endif
+	}
+
+	static void createMaskedStore(Value *base, Value *val, Value *mask, unsigned int alignment)
+	{
+#if REACTOR_LLVM_VERSION < 7
+		// Masked off lanes store to a local variable instead
+		llvm::VectorType *vectorType = llvm::cast<llvm::VectorType>(V(val)->getType());
+		llvm::Value *dummy = V(Nucleus::allocateStackVariable(T(vectorType->getElementType())));
+		llvm::Value *elements = ::builder->CreatePointerCast(V(base), vectorType->getElementType()->getPointerTo());
+		llvm::Value *active = createMask(mask);
+
+		for(unsigned int i = 0; i < vectorType->getNumElements(); i++)
+		{
+			llvm::Value *index = ::builder->getInt32(i);
+			llvm::Value *address = ::builder->CreateSelect(::builder->CreateExtractElement(active, index), ::builder->CreateGEP(elements, index), dummy);
+
+			llvm::StoreInst *element = ::builder->CreateStore(::builder->CreateExtractElement(V(val), index), address);
+			element->setAlignment(alignment);
+		}
+#else
+		::builder->CreateMaskedStore(V(val), V(base), alignment, createMask(mask));
+#endif
+	}
+
+	RValue<Float4> Gather(RValue<Pointer<Float>> base, RValue<Int4> offsets, RValue<Int4> mask, unsigned int alignment, bool zeroMaskedLanes)
+	{
+		return RValue<Float4>(createGather(base.value, Float::getType(), offsets.value, mask.value, alignment, zeroMaskedLanes));
+	}
+
+	RValue<Int4> Gather(RValue<Pointer<Int>> base, RValue<Int4> offsets, RValue<Int4> mask, unsigned int alignment, bool zeroMaskedLanes)
+	{
+		return RValue<Int4>(createGather(base.value, Int::getType(), offsets.value, mask.value, alignment, zeroMaskedLanes));
+	}
+
+	RValue<Float8> Gather(RValue<Pointer<Float>> base, RValue<Int8> offsets, RValue<Int8> mask, unsigned int alignment, bool zeroMaskedLanes)
+	{
+		return RValue<Float8>(createGather(base.value, Float::getType(), offsets.value, mask.value, alignment, zeroMaskedLanes));
+	}
+
+	RValue<Int8> Gather(RValue<Pointer<Int>> base, RValue<Int8> offsets, RValue<Int8> mask, unsigned int alignment, bool zeroMaskedLanes)
+	{
+		return RValue<Int8>(createGather(base.value, Int::getType(), offsets.value, mask.value, alignment, zeroMaskedLanes));
+	}
+
+	RValue<Float4> MaskedLoad(RValue<Pointer<Float4>> base, RValue<Int4> mask, unsigned int alignment, bool zeroMaskedLanes)
+	{
+		return RValue<Float4>(createMaskedLoad(base.value, Float4::getType(), mask.value, alignment, zeroMaskedLanes));
+	}
+
+	RValue<Int4> MaskedLoad(RValue<Pointer<Int4>> base, RValue<Int4> mask, unsigned int alignment, bool zeroMaskedLanes)
+	{
+		return RValue<Int4>(createMaskedLoad(base.value, Int4::getType(), mask.value, alignment, zeroMaskedLanes));
+	}
+
+	void MaskedStore(RValue<Pointer<Float4>> base, RValue<Float4> val, RValue<Int4> mask, unsigned int alignment)
+	{
+		createMaskedStore(base.value, val.value, mask.value, alignment);
+	}
+
+	void MaskedStore(RValue<Pointer<Int4>> base, RValue<Int4> val, RValue<Int4> mask, unsigned int alignment)
+	{
+		createMaskedStore(base.value, val.value, mask.value, alignment);
+	}
+
+	static Value *createFMA(Value *x, Value *y, Value *z)
+	{
+#if REACTOR_LLVM_VERSION < 7
+		return Nucleus::createFAdd(Nucleus::createFMul(x, y), z);
+#else
+		// Fused on targets with FMA instructions, and a separate multiply and add elsewhere
+		llvm::Function *fmuladd = llvm::Intrinsic::getDeclaration(::module, llvm::Intrinsic::fmuladd, {V(x)->getType()});
+		return V(::builder->CreateCall(fmuladd, ARGS(V(x), V(y), V(z))));
+#endif
+	}
+
+	RValue<Float> FMA(RValue<Float> x, RValue<Float> y, RValue<Float> z)
+	{
+		return RValue<Float>(createFMA(x.value, y.value, z.value));
+	}
+
+	RValue<Float4> FMA(RValue<Float4> x, RValue<Float4> y, RValue<Float4> z)
+	{
+		return RValue<Float4>(createFMA(x.value, y.value, z.value));
+	}
+
+	RValue<Float8> FMA(RValue<Float8> x, RValue<Float8> y, RValue<Float8> z)
+	{
+		return RValue<Float8>(createFMA(x.value, y.value, z.value));
+	}
+
+	RValue<Pointer<Byte>> operator+(RValue<Pointer<Byte>> lhs, int offset)
+	{
+		return lhs + RValue<Int>(Nucleus::createConstantInt(offset));
+	}
+
+	RValue<Pointer<Byte>> operator+(RValue<Pointer<Byte>> lhs, RValue<Int> offset)
+	{
+		return RValue<Pointer<Byte>>(Nucleus::createGEP(lhs.value, Byte::getType(), offset.value, false));
+	}
+
+	RValue<Pointer<Byte>> operator+(RValue<Pointer<Byte>> lhs, RValue<UInt> offset)
+	{
+		return RValue<Pointer<Byte>>(Nucleus::createGEP(lhs.value, Byte::getType(), offset.value, true));
+	}
+
+	RValue<Pointer<Byte>> operator+=(Pointer<Byte> &lhs, int offset)
+	{
+		return lhs = lhs + offset;
+	}
+
+	RValue<Pointer<Byte>> operator+=(Pointer<Byte> &lhs, RValue<Int> offset)
+	{
+		return lhs = lhs + offset;
+	}
+
+	RValue<Pointer<Byte>> operator+=(Pointer<Byte> &lhs, RValue<UInt> offset)
+	{
+		return lhs = lhs + offset;
+	}
+
+	RValue<Pointer<Byte>> operator-(RValue<Pointer<Byte>> lhs, int offset)
+	{
+		return lhs + -offset;
+	}
+
+	RValue<Pointer<Byte>> operator-(RValue<Pointer<Byte>> lhs, RValue<Int> offset)
+	{
+		return lhs + -offset;
+	}
+
+	RValue<Pointer<Byte>> operator-(RValue<Pointer<Byte>> lhs, RValue<UInt> offset)
+	{
+		return lhs + -offset;
+	}
+
+	RValue<Pointer<Byte>> operator-=(Pointer<Byte> &lhs, int offset)
+	{
+		return lhs = lhs - offset;
+	}
+
+	RValue<Pointer<Byte>> operator-=(Pointer<Byte> &lhs, RValue<Int> offset)
+	{
+		return lhs = lhs - offset;
+	}
+
+	RValue<Pointer<Byte>> operator-=(Pointer<Byte> &lhs, RValue<UInt> offset)
+	{
+		return lhs = lhs - offset;
+	}
+
+	void Return()
+	{
+		Nucleus::createRetVoid();
+		Nucleus::setInsertBlock(Nucleus::createBasicBlock());
+		Nucleus::createUnreachable();
+	}
+
+	void Return(RValue<Int> ret)
+	{
+		Nucleus::createRet(ret.value);
+		Nucleus::setInsertBlock(Nucleus::createBasicBlock());
+		Nucleus::createUnreachable();
+	}
+
+	void branch(RValue<Bool> cmp, BasicBlock *bodyBB, BasicBlock *endBB)
+	{
+		Nucleus::createCondBr(cmp.value, bodyBB, endBB);
+		Nucleus::setInsertBlock(bodyBB);
+	}
+
+	RValue<Long> Ticks()
+	{
+		llvm::Function *rdtsc = llvm::Intrinsic::getDeclaration(::module, llvm::Intrinsic::readcyclecounter);
+
+		return RValue<Long>(V(::builder->CreateCall(rdtsc)));
+	}
+}
+
+namespace rr
+{
+#if defined(__i386__) || defined(__x86_64__)
+	namespace x86
+	{
+		RValue<Int> cvtss2si(RValue<Float> val)
+		{
+			llvm::Function *cvtss2si = llvm::Intrinsic::getDeclaration(::module, llvm::Intrinsic::x86_sse_cvtss2si);
+
+			Float4 vector;
+			vector.x = val;
+
+			return RValue<Int>(V(::builder->CreateCall(cvtss2si, ARGS(V(RValue<Float4>(vector).value)))));
+		}
+
+		RValue<Int4> cvtps2dq(RValue<Float4> val)
+		{
+			llvm::Function *cvtps2dq = llvm::Intrinsic::getDeclaration(::module, llvm::Intrinsic::x86_sse2_cvtps2dq);
+
+			return RValue<Int4>(V(::builder->CreateCall(cvtps2dq, ARGS(V(val.value)))));
+		}
+
+		RValue<Float> rcpss(RValue<Float> val)
+		{
+			llvm::Function *rcpss = llvm::Intrinsic::getDeclaration(::module, llvm::Intrinsic::x86_sse_rcp_ss);
+
+			Value *vector = Nucleus::createInsertElement(V(llvm::UndefValue::get(T(Float4::getType()))), val.value, 0);
+
+			return RValue<Float>(Nucleus::createExtractElement(V(::builder->CreateCall(rcpss, ARGS(V(vector)))), Float::getType(), 0));
+		}
+
+		RValue<Float> sqrtss(RValue<Float> val)
 		{
 #if REACTOR_LLVM_VERSION < 7
 			llvm::Function *sqrtss = llvm::Intrinsic::getDeclaration(::module, llvm::Intrinsic::x86_sse_sqrt_ss);
@@ -7094,6 +8110,34 @@ namespace rr
 			return roundps(val, 2);
 		}
 
+		RValue<Int8> cvtps2dq(RValue<Float8> val)
+		{
+			llvm::Function *cvtps2dq = llvm::Intrinsic::getDeclaration(::module, llvm::Intrinsic::x86_avx_cvt_ps2dq_256);
+
+			return RValue<Int8>(V(::builder->CreateCall(cvtps2dq, ARGS(V(val.value)))));
+		}
+
+		RValue<Float8> maxps(RValue<Float8> x, RValue<Float8> y)
+		{
+			llvm::Function *maxps = llvm::Intrinsic::getDeclaration(::module, llvm::Intrinsic::x86_avx_max_ps_256);
+
+			return RValue<Float8>(V(::builder->CreateCall2(maxps, ARGS(V(x.value), V(y.value)))));
+		}
+
+		RValue<Float8> minps(RValue<Float8> x, RValue<Float8> y)
+		{
+			llvm::Function *minps = llvm::Intrinsic::getDeclaration(::module, llvm::Intrinsic::x86_avx_min_ps_256);
+
+			return RValue<Float8>(V(::builder->CreateCall2(minps, ARGS(V(x.value), V(y.value)))));
+		}
+
+		RValue<Float8> roundps(RValue<Float8> val, unsigned char imm)
+		{
+			llvm::Function *roundps = llvm::Intrinsic::getDeclaration(::module, llvm::Intrinsic::x86_avx_round_ps_256);
+
+			return RValue<Float8>(V(::builder->CreateCall2(roundps, ARGS(V(val.value), V(Nucleus::createConstantInt(imm))))));
+		}
+
 		RValue<Int4> pabsd(RValue<Int4> x)
 		{
 #if REACTOR_LLVM_VERSION < 7
@@ -7460,6 +8504,13 @@ namespace rr
 			return RValue<Int>(V(::builder->CreateCall(movmskps, ARGS(V(x.value)))));
 		}
 
+		RValue<Int> movmskps(RValue<Float8> x)
+		{
+			llvm::Function *movmskps = llvm::Intrinsic::getDeclaration(::module, llvm::Intrinsic::x86_avx_movmsk_ps_256);
+
+			return RValue<Int>(V(::builder->CreateCall(movmskps, ARGS(V(x.value)))));
+		}
+
 		RValue<Int> pmovmskb(RValue<Byte8> x)
 		{
 			llvm::Function *pmovmskb = llvm::Intrinsic::getDeclaration(::module, llvm::Intrinsic::x86_sse2_pmovmskb_128);
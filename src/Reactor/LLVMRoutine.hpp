@@ -18,6 +18,8 @@
 #include "Routine.hpp"
 
 #include <cstdint>
+#include <utility>
+#include <vector>
 
 namespace rr
 {
@@ -58,8 +60,8 @@ namespace rr
 	{
 	public:
 		LLVMRoutine(void *ent, void (*callback)(LLVMReactorJIT *, uint64_t),
-		            LLVMReactorJIT *jit, uint64_t key)
-			: entry(ent), dtor(callback), reactorJIT(jit), moduleKey(key)
+		            LLVMReactorJIT *jit, uint64_t key, std::vector<uint8_t> &&image)
+			: entry(ent), dtor(callback), reactorJIT(jit), moduleKey(key), image(std::move(image))
 		{ }
 
 		virtual ~LLVMRoutine();
@@ -69,12 +71,21 @@ namespace rr
 			return entry;
 		}
 
+		const void *getImage(size_t &size)
+		{
+			size = image.size();
+
+			return image.empty() ? nullptr : &image[0];
+		}
+
 	private:
 		const void *entry;
 
 		void (*dtor)(LLVMReactorJIT *, uint64_t);
 		LLVMReactorJIT *reactorJIT;
 		uint64_t moduleKey;
+
+		std::vector<uint8_t> image;   // Entry point name followed by the object file
 	};
 #endif  // REACTOR_LLVM_VERSION < 7
 }
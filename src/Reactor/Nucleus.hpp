@@ -17,6 +17,7 @@
 
 #include <cassert>
 #include <cstdarg>
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
@@ -45,6 +46,8 @@ namespace rr
 	};
 
 	extern Optimization optimization[10];
+	extern bool retainRoutineImages;   // Keep relocatable images of generated routines, see Routine::getImage()
+	extern bool profileRoutines;       // Count the calls and cycles of generated routines, see Routine::getStats()
 
 	class Nucleus
 	{
@@ -54,6 +57,8 @@ namespace rr
 		virtual ~Nucleus();
 
 		Routine *acquireRoutine(const char *name, bool runOptimizations = true);
+		static Routine *loadRoutine(const void *image, size_t size);   // Returns null if the image can't be loaded
+		static bool supportsWideVectors();   // Float8 and Int8 are implemented using 256-bit instructions
 
 		static Value *allocateStackVariable(Type *type, int arraySize = 0);
 		static BasicBlock *createBasicBlock();
@@ -17,10 +17,140 @@
 #include "src/IceCfg.h"
 #include "src/IceCfgNode.h"
 
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
 #include <vector>
 
 namespace
 {
+	int bitWidth(Ice::Type type)
+	{
+		return (type == Ice::IceType_i1) ? 1 : 8 * (int)Ice::typeWidthInBytes(type);
+	}
+
+	uint64_t zeroExtend(int64_t value, int width)
+	{
+		return (width == 64) ? (uint64_t)value : (uint64_t)value & ((uint64_t(1) << width) - 1);
+	}
+
+	int64_t signExtend(int64_t value, int width)
+	{
+		return (int64_t)(zeroExtend(value, width) << (64 - width)) >> (64 - width);
+	}
+
+	bool getInteger(const Ice::Operand *operand, int64_t &value)
+	{
+		if(auto *constant = llvm::dyn_cast<Ice::ConstantInteger32>(operand))
+		{
+			value = constant->getValue();
+			return true;
+		}
+
+		if(auto *constant = llvm::dyn_cast<Ice::ConstantInteger64>(operand))
+		{
+			value = constant->getValue();
+			return true;
+		}
+
+		return false;
+	}
+
+	bool foldInteger(Ice::InstArithmetic::OpKind op, int width, int64_t x, int64_t y, int64_t &result)
+	{
+		uint64_t ux = zeroExtend(x, width);
+		uint64_t uy = zeroExtend(y, width);
+		int64_t sx = signExtend(x, width);
+		int64_t sy = signExtend(y, width);
+		int64_t minimum = signExtend(int64_t(uint64_t(1) << (width - 1)), width);
+
+		switch(op)
+		{
+		case Ice::InstArithmetic::Add:  result = (int64_t)(ux + uy); break;
+		case Ice::InstArithmetic::Sub:  result = (int64_t)(ux - uy); break;
+		case Ice::InstArithmetic::Mul:  result = (int64_t)(ux * uy); break;
+		case Ice::InstArithmetic::And:  result = (int64_t)(ux & uy); break;
+		case Ice::InstArithmetic::Or:   result = (int64_t)(ux | uy); break;
+		case Ice::InstArithmetic::Xor:  result = (int64_t)(ux ^ uy); break;
+		case Ice::InstArithmetic::Udiv:
+			if(uy == 0) return false;
+			result = (int64_t)(ux / uy);
+			break;
+		case Ice::InstArithmetic::Urem:
+			if(uy == 0) return false;
+			result = (int64_t)(ux % uy);
+			break;
+		case Ice::InstArithmetic::Sdiv:
+			if(sy == 0 || (sy == -1 && sx == minimum)) return false;
+			result = sx / sy;
+			break;
+		case Ice::InstArithmetic::Srem:
+			if(sy == 0 || (sy == -1 && sx == minimum)) return false;
+			result = sx % sy;
+			break;
+		case Ice::InstArithmetic::Shl:
+			if(uy >= (uint64_t)width) return false;
+			result = (int64_t)(ux << uy);
+			break;
+		case Ice::InstArithmetic::Lshr:
+			if(uy >= (uint64_t)width) return false;
+			result = (int64_t)(ux >> uy);
+			break;
+		case Ice::InstArithmetic::Ashr:
+			if(uy >= (uint64_t)width) return false;
+			result = sx >> uy;
+			break;
+		default:
+			return false;
+		}
+
+		return true;
+	}
+
+	template<typename T>
+	bool foldFloatingPoint(Ice::InstArithmetic::OpKind op, T x, T y, T &result)
+	{
+		switch(op)
+		{
+		case Ice::InstArithmetic::Fadd: result = x + y; break;
+		case Ice::InstArithmetic::Fsub: result = x - y; break;
+		case Ice::InstArithmetic::Fmul: result = x * y; break;
+		case Ice::InstArithmetic::Fdiv: result = x / y; break;
+		default:
+			return false;
+		}
+
+		// Denormals may get flushed to zero at run time
+		return std::fpclassify(x) != FP_SUBNORMAL &&
+		       std::fpclassify(y) != FP_SUBNORMAL &&
+		       std::fpclassify(result) != FP_SUBNORMAL;
+	}
+
+	bool compare(Ice::InstIcmp::ICond condition, int width, int64_t x, int64_t y)
+	{
+		uint64_t ux = zeroExtend(x, width);
+		uint64_t uy = zeroExtend(y, width);
+		int64_t sx = signExtend(x, width);
+		int64_t sy = signExtend(y, width);
+
+		switch(condition)
+		{
+		case Ice::InstIcmp::Eq:  return ux == uy;
+		case Ice::InstIcmp::Ne:  return ux != uy;
+		case Ice::InstIcmp::Ugt: return ux > uy;
+		case Ice::InstIcmp::Uge: return ux >= uy;
+		case Ice::InstIcmp::Ult: return ux < uy;
+		case Ice::InstIcmp::Ule: return ux <= uy;
+		case Ice::InstIcmp::Sgt: return sx > sy;
+		case Ice::InstIcmp::Sge: return sx >= sy;
+		case Ice::InstIcmp::Slt: return sx < sy;
+		case Ice::InstIcmp::Sle: return sx <= sy;
+		default:
+			assert(false);
+			return false;
+		}
+	}
+
 	class Optimizer
 	{
 	public:
@@ -32,6 +162,12 @@ namespace
 		void eliminateUnitializedLoads();
 		void eliminateLoadsFollowingSingleStore();
 		void optimizeStoresInSingleBasicBlock();
+		void foldConstants();
+		void eliminateCommonSubexpressions();
+		void hoistLoopInvariants();
+
+		void analyzeControlFlow();
+		bool dominates(Ice::CfgNode *dominator, Ice::CfgNode *node) const;
 
 		void replace(Ice::Inst *instruction, Ice::Operand *newValue);
 		void deleteInstruction(Ice::Inst *instruction);
@@ -47,6 +183,13 @@ namespace
 		static std::size_t storeSize(const Ice::Inst *instruction);
 		static bool loadTypeMatchesStore(const Ice::Inst *load, const Ice::Inst *store);
 
+		Ice::Operand *fold(const Ice::Inst *instruction);   // Returns the value the instruction simplifies to, or null
+		bool acceptsConstant(Ice::Operand *value);   // Whether all uses of the value can take a constant instead
+		bool isInvariant(Ice::Operand *value, const std::vector<bool> &inLoop);
+		static bool isPure(const Ice::Inst *instruction);   // No side effects, and only depends on its operands
+		static bool isEquivalent(const Ice::Inst *a, const Ice::Inst *b);
+		static size_t hash(const Ice::Inst *instruction);
+
 		Ice::Cfg *function;
 		Ice::GlobalContext *context;
 
@@ -89,6 +232,13 @@ namespace
 		bool hasLoadStoreInsts(Ice::CfgNode* node) const;
 
 		std::vector<Optimizer::Uses*> allocatedUses;
+
+		// Control flow of the reachable basic blocks, indexed by node index
+		std::vector<Ice::CfgNode*> order;   // Reverse post-order
+		std::vector<int> orderIndex;   // -1 for unreachable blocks
+		std::vector<std::vector<Ice::CfgNode*>> successors;
+		std::vector<std::vector<Ice::CfgNode*>> predecessors;
+		std::vector<int> immediateDominator;   // By order index
 	};
 
 	void Optimizer::run(Ice::Cfg *function)
@@ -96,12 +246,21 @@ namespace
 		this->function = function;
 		this->context = function->getContext();
 
+		// Subzero's liveness analysis needs the edges, once values are used outside of the block
+		// defining them. This also removes unreachable blocks, before their uses get recorded.
+		function->computeInOutEdges();
+
 		analyzeUses(function);
 
 		eliminateDeadCode();
 		eliminateUnitializedLoads();
 		eliminateLoadsFollowingSingleStore();
 		optimizeStoresInSingleBasicBlock();
+		foldConstants();
+
+		analyzeControlFlow();
+		eliminateCommonSubexpressions();
+		hoistLoopInvariants();
 		eliminateDeadCode();
 
 		for(auto uses : allocatedUses)
@@ -427,6 +586,362 @@ namespace
 		}
 	}
 
+	void Optimizer::foldConstants()
+	{
+		bool modified;
+		do
+		{
+			modified = false;
+			for(Ice::CfgNode *basicBlock : function->getNodes())
+			{
+				for(Ice::Inst &inst : basicBlock->getInsts())
+				{
+					if(inst.isDeleted() || !inst.getDest())
+					{
+						continue;
+					}
+
+					Ice::Operand *value = fold(&inst);
+
+					if(value && (llvm::isa<Ice::Variable>(value) || acceptsConstant(inst.getDest())))
+					{
+						replace(&inst, value);
+						modified = true;
+					}
+				}
+			}
+		}
+		while(modified);
+	}
+
+	void Optimizer::eliminateCommonSubexpressions()
+	{
+		std::unordered_map<size_t, std::vector<Ice::Inst*>> available;
+
+		// Dominating blocks come first in reverse post-order
+		for(Ice::CfgNode *basicBlock : order)
+		{
+			for(Ice::Inst &inst : basicBlock->getInsts())
+			{
+				// Shuffle indices aren't operands, so shuffles can't be compared
+				if(inst.isDeleted() || !isPure(&inst) || llvm::isa<Ice::InstShuffleVector>(inst))
+				{
+					continue;
+				}
+
+				std::vector<Ice::Inst*> &candidates = available[hash(&inst)];
+				Ice::Inst *equivalent = nullptr;
+
+				for(Ice::Inst *candidate : candidates)
+				{
+					if(!candidate->isDeleted() && isEquivalent(candidate, &inst) && dominates(getNode(candidate), basicBlock))
+					{
+						equivalent = candidate;
+						break;
+					}
+				}
+
+				if(equivalent)
+				{
+					replace(&inst, equivalent->getDest());
+				}
+				else
+				{
+					candidates.push_back(&inst);
+				}
+			}
+		}
+	}
+
+	void Optimizer::hoistLoopInvariants()
+	{
+		// Natural loops, formed by the blocks reaching a back edge without passing through its target
+		std::vector<std::vector<Ice::CfgNode*>> loops;
+
+		for(Ice::CfgNode *header : order)
+		{
+			std::vector<Ice::CfgNode*> loop(1, header);
+			std::vector<Ice::CfgNode*> pending;
+			std::vector<bool> inLoop(orderIndex.size(), false);
+			inLoop[header->getIndex()] = true;
+
+			for(Ice::CfgNode *predecessor : predecessors[header->getIndex()])
+			{
+				if(dominates(header, predecessor))
+				{
+					pending.push_back(predecessor);
+				}
+			}
+
+			if(pending.empty())
+			{
+				continue;
+			}
+
+			while(!pending.empty())
+			{
+				Ice::CfgNode *basicBlock = pending.back();
+				pending.pop_back();
+
+				if(!inLoop[basicBlock->getIndex()])
+				{
+					inLoop[basicBlock->getIndex()] = true;
+					loop.push_back(basicBlock);
+
+					pending.insert(pending.end(), predecessors[basicBlock->getIndex()].begin(), predecessors[basicBlock->getIndex()].end());
+				}
+			}
+
+			loops.push_back(loop);
+		}
+
+		// Nested loops are smaller than the ones enclosing them. Processing them first allows
+		// invariants to be hoisted out of multiple levels.
+		std::stable_sort(loops.begin(), loops.end(), [](const std::vector<Ice::CfgNode*> &a, const std::vector<Ice::CfgNode*> &b)
+		{
+			return a.size() < b.size();
+		});
+
+		for(auto &loop : loops)
+		{
+			Ice::CfgNode *header = loop[0];
+			std::vector<bool> inLoop(orderIndex.size(), false);
+
+			for(Ice::CfgNode *basicBlock : loop)
+			{
+				inLoop[basicBlock->getIndex()] = true;
+			}
+
+			// Code can only be hoisted into a single block which always enters the loop
+			Ice::CfgNode *preheader = nullptr;
+			bool unique = true;
+
+			for(Ice::CfgNode *predecessor : predecessors[header->getIndex()])
+			{
+				if(!inLoop[predecessor->getIndex()])
+				{
+					unique = unique && (!preheader || preheader == predecessor);
+					preheader = predecessor;
+				}
+			}
+
+			if(!preheader || !unique)
+			{
+				continue;
+			}
+
+			for(Ice::CfgNode *successor : successors[preheader->getIndex()])
+			{
+				unique = unique && (successor == header);
+			}
+
+			if(!unique)
+			{
+				continue;
+			}
+
+			Ice::InstList &preheaderInsts = preheader->getInsts();
+			auto terminator = preheaderInsts.begin();
+
+			while(terminator->isDeleted() || !(llvm::isa<Ice::InstBr>(*terminator) || llvm::isa<Ice::InstSwitch>(*terminator)))
+			{
+				terminator++;
+			}
+
+			// Definitions precede their uses in reverse post-order
+			std::sort(loop.begin(), loop.end(), [this](Ice::CfgNode *a, Ice::CfgNode *b)
+			{
+				return orderIndex[a->getIndex()] < orderIndex[b->getIndex()];
+			});
+
+			for(Ice::CfgNode *basicBlock : loop)
+			{
+				std::vector<Ice::Inst*> invariants;
+
+				for(Ice::Inst &inst : basicBlock->getInsts())
+				{
+					if(inst.isDeleted())
+					{
+						continue;
+					}
+
+					bool hoistable = isPure(&inst);
+
+					if(auto *arithmetic = llvm::dyn_cast<Ice::InstArithmetic>(&inst))
+					{
+						switch(arithmetic->getOp())
+						{
+						case Ice::InstArithmetic::Udiv:
+						case Ice::InstArithmetic::Sdiv:
+						case Ice::InstArithmetic::Urem:
+						case Ice::InstArithmetic::Srem:
+							hoistable = false;   // Could trap when the loop wouldn't have executed them
+							break;
+						default:
+							break;
+						}
+					}
+					else if(isLoad(inst))
+					{
+						// Only local variables which aren't stored to within the loop are known to remain unchanged
+						auto *address = llvm::dyn_cast<Ice::Variable>(loadAddress(&inst));
+						Ice::Inst *definition = address ? getDefinition(address) : nullptr;
+
+						if(definition && llvm::isa<Ice::InstAlloca>(definition) && getUses(address)->areOnlyLoadStore())
+						{
+							hoistable = true;
+
+							for(Ice::Inst *store : getUses(address)->stores)
+							{
+								hoistable = hoistable && !inLoop[getNode(store)->getIndex()];
+							}
+						}
+					}
+
+					for(Ice::SizeT i = 0; hoistable && i < inst.getSrcSize(); i++)
+					{
+						hoistable = isInvariant(inst.getSrc(i), inLoop);
+					}
+
+					if(hoistable)
+					{
+						invariants.push_back(&inst);
+						setNode(&inst, preheader);
+					}
+				}
+
+				for(Ice::Inst *inst : invariants)
+				{
+					basicBlock->getInsts().remove(*inst);
+					preheaderInsts.insert(terminator, inst);
+				}
+			}
+		}
+	}
+
+	void Optimizer::analyzeControlFlow()
+	{
+		const Ice::NodeList &nodes = function->getNodes();
+		size_t count = nodes.size();
+
+		successors.assign(count, std::vector<Ice::CfgNode*>());
+		predecessors.assign(count, std::vector<Ice::CfgNode*>());
+		orderIndex.assign(count, -1);
+		order.clear();
+
+		for(Ice::CfgNode *basicBlock : nodes)
+		{
+			const Ice::NodeList &edges = basicBlock->getOutEdges();
+			successors[basicBlock->getIndex()].assign(edges.begin(), edges.end());
+		}
+
+		// Depth-first search of the reachable blocks
+		std::vector<std::pair<Ice::CfgNode*, size_t>> stack;
+		std::vector<bool> visited(count, false);
+		Ice::CfgNode *entryBlock = function->getEntryNode();
+
+		stack.push_back(std::make_pair(entryBlock, 0));
+		visited[entryBlock->getIndex()] = true;
+
+		while(!stack.empty())
+		{
+			Ice::CfgNode *basicBlock = stack.back().first;
+			size_t next = stack.back().second++;
+			const std::vector<Ice::CfgNode*> &edges = successors[basicBlock->getIndex()];
+
+			if(next < edges.size())
+			{
+				Ice::CfgNode *successor = edges[next];
+
+				if(!visited[successor->getIndex()])
+				{
+					visited[successor->getIndex()] = true;
+					stack.push_back(std::make_pair(successor, 0));
+				}
+			}
+			else
+			{
+				order.push_back(basicBlock);   // Post-order
+				stack.pop_back();
+			}
+		}
+
+		std::reverse(order.begin(), order.end());
+
+		for(size_t i = 0; i < order.size(); i++)
+		{
+			orderIndex[order[i]->getIndex()] = (int)i;
+		}
+
+		for(Ice::CfgNode *basicBlock : order)
+		{
+			for(Ice::CfgNode *successor : successors[basicBlock->getIndex()])
+			{
+				predecessors[successor->getIndex()].push_back(basicBlock);
+			}
+		}
+
+		// "A Simple, Fast Dominance Algorithm" by Cooper, Harvey and Kennedy
+		immediateDominator.assign(order.size(), -1);
+		immediateDominator[0] = 0;
+
+		bool modified;
+		do
+		{
+			modified = false;
+			for(size_t i = 1; i < order.size(); i++)
+			{
+				int dominator = -1;
+
+				for(Ice::CfgNode *predecessor : predecessors[order[i]->getIndex()])
+				{
+					int p = orderIndex[predecessor->getIndex()];
+
+					if(immediateDominator[p] == -1)
+					{
+						continue;   // Not processed yet
+					}
+
+					int q = (dominator == -1) ? p : dominator;
+
+					while(p != q)
+					{
+						while(p > q) p = immediateDominator[p];
+						while(q > p) q = immediateDominator[q];
+					}
+
+					dominator = p;
+				}
+
+				if(immediateDominator[i] != dominator)
+				{
+					immediateDominator[i] = dominator;
+					modified = true;
+				}
+			}
+		}
+		while(modified);
+	}
+
+	bool Optimizer::dominates(Ice::CfgNode *dominator, Ice::CfgNode *node) const
+	{
+		int target = orderIndex[dominator->getIndex()];
+		int index = orderIndex[node->getIndex()];
+
+		if(target < 0 || index < 0)
+		{
+			return false;   // Unreachable
+		}
+
+		// Dominators precede the blocks they dominate in reverse post-order
+		while(index > target)
+		{
+			index = immediateDominator[index];
+		}
+
+		return index == target;
+	}
+
 	void Optimizer::analyzeUses(Ice::Cfg *function)
 	{
 		for(Ice::CfgNode *basicBlock : function->getNodes())
@@ -707,6 +1222,308 @@ namespace
 		return false;
 	}
 
+	Ice::Operand *Optimizer::fold(const Ice::Inst *instruction)
+	{
+		Ice::Type type = instruction->getDest()->getType();
+
+		if(auto *arithmetic = llvm::dyn_cast<Ice::InstArithmetic>(instruction))
+		{
+			Ice::InstArithmetic::OpKind op = arithmetic->getOp();
+			Ice::Operand *x = arithmetic->getSrc(0);
+			Ice::Operand *y = arithmetic->getSrc(1);
+
+			if(Ice::isScalarIntegerType(type))
+			{
+				int width = bitWidth(type);
+				int64_t a = 0;
+				int64_t b = 0;
+				bool constantX = getInteger(x, a);
+				bool constantY = getInteger(y, b);
+				int64_t result = 0;
+
+				if(constantX && constantY)
+				{
+					return foldInteger(op, width, a, b, result) ? context->getConstantInt(type, result) : nullptr;
+				}
+
+				uint64_t allOnes = zeroExtend(-1, width);
+
+				if(constantY)
+				{
+					uint64_t value = zeroExtend(b, width);
+
+					switch(op)
+					{
+					case Ice::InstArithmetic::Add:
+					case Ice::InstArithmetic::Sub:
+					case Ice::InstArithmetic::Or:
+					case Ice::InstArithmetic::Xor:
+					case Ice::InstArithmetic::Shl:
+					case Ice::InstArithmetic::Lshr:
+					case Ice::InstArithmetic::Ashr:
+						return (value == 0) ? x : nullptr;
+					case Ice::InstArithmetic::Mul:
+						return (value == 1) ? x : (value == 0) ? y : nullptr;
+					case Ice::InstArithmetic::Udiv:
+					case Ice::InstArithmetic::Sdiv:
+						return (value == 1) ? x : nullptr;
+					case Ice::InstArithmetic::And:
+						return (value == allOnes) ? x : (value == 0) ? y : nullptr;
+					default:
+						return nullptr;
+					}
+				}
+
+				if(constantX)
+				{
+					uint64_t value = zeroExtend(a, width);
+
+					switch(op)
+					{
+					case Ice::InstArithmetic::Add:
+					case Ice::InstArithmetic::Or:
+					case Ice::InstArithmetic::Xor:
+						return (value == 0) ? y : nullptr;
+					case Ice::InstArithmetic::Shl:
+					case Ice::InstArithmetic::Lshr:
+					case Ice::InstArithmetic::Ashr:
+						return (value == 0) ? x : nullptr;
+					case Ice::InstArithmetic::Mul:
+						return (value == 1) ? y : (value == 0) ? x : nullptr;
+					case Ice::InstArithmetic::And:
+						return (value == allOnes) ? y : (value == 0) ? x : nullptr;
+					default:
+						return nullptr;
+					}
+				}
+			}
+			else if(type == Ice::IceType_f32)
+			{
+				auto *a = llvm::dyn_cast<Ice::ConstantFloat>(x);
+				auto *b = llvm::dyn_cast<Ice::ConstantFloat>(y);
+				float result = 0.0f;
+
+				if(a && b && foldFloatingPoint(op, a->getValue(), b->getValue(), result))
+				{
+					return context->getConstantFloat(result);
+				}
+			}
+			else if(type == Ice::IceType_f64)
+			{
+				auto *a = llvm::dyn_cast<Ice::ConstantDouble>(x);
+				auto *b = llvm::dyn_cast<Ice::ConstantDouble>(y);
+				double result = 0.0;
+
+				if(a && b && foldFloatingPoint(op, a->getValue(), b->getValue(), result))
+				{
+					return context->getConstantDouble(result);
+				}
+			}
+		}
+		else if(auto *cast = llvm::dyn_cast<Ice::InstCast>(instruction))
+		{
+			Ice::Operand *x = cast->getSrc(0);
+			int64_t a = 0;
+
+			if(Ice::isScalarIntegerType(type) && getInteger(x, a))
+			{
+				int width = bitWidth(x->getType());
+
+				switch(cast->getCastKind())
+				{
+				case Ice::InstCast::Trunc: return context->getConstantInt(type, a);
+				case Ice::InstCast::Zext:  return context->getConstantInt(type, (int64_t)zeroExtend(a, width));
+				case Ice::InstCast::Sext:  return context->getConstantInt(type, signExtend(a, width));
+				default:
+					break;
+				}
+			}
+		}
+		else if(auto *icmp = llvm::dyn_cast<Ice::InstIcmp>(instruction))
+		{
+			int64_t a = 0;
+			int64_t b = 0;
+
+			if(type == Ice::IceType_i1 && getInteger(icmp->getSrc(0), a) && getInteger(icmp->getSrc(1), b))
+			{
+				return context->getConstantInt1(compare(icmp->getCondition(), bitWidth(icmp->getSrc(0)->getType()), a, b));
+			}
+		}
+		else if(auto *select = llvm::dyn_cast<Ice::InstSelect>(instruction))
+		{
+			int64_t condition = 0;
+
+			if(getInteger(select->getCondition(), condition))
+			{
+				return (condition & 1) ? select->getTrueOperand() : select->getFalseOperand();
+			}
+
+			if(select->getTrueOperand() == select->getFalseOperand())
+			{
+				return select->getTrueOperand();
+			}
+		}
+
+		return nullptr;
+	}
+
+	bool Optimizer::acceptsConstant(Ice::Operand *value)
+	{
+		if(!hasUses(value))
+		{
+			return true;
+		}
+
+		for(Ice::Inst *use : *getUses(value))
+		{
+			switch(use->getKind())
+			{
+			case Ice::Inst::Arithmetic:
+			case Ice::Inst::Br:
+			case Ice::Inst::Cast:
+			case Ice::Inst::Fcmp:
+			case Ice::Inst::Icmp:
+			case Ice::Inst::Ret:
+			case Ice::Inst::Select:
+				break;
+			case Ice::Inst::Store:
+				if(storeAddress(use) == value)
+				{
+					return false;
+				}
+				break;
+			case Ice::Inst::InsertElement:
+				if(use->getSrc(0) == value)
+				{
+					return false;
+				}
+				break;
+			default:
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool Optimizer::isInvariant(Ice::Operand *value, const std::vector<bool> &inLoop)
+	{
+		auto *variable = llvm::dyn_cast<Ice::Variable>(value);
+
+		if(!variable)
+		{
+			return true;   // Constant
+		}
+
+		Ice::Inst *definition = getDefinition(variable);
+
+		return !definition || !inLoop[getNode(definition)->getIndex()];   // Arguments have no definition
+	}
+
+	bool Optimizer::isPure(const Ice::Inst *instruction)
+	{
+		switch(instruction->getKind())
+		{
+		case Ice::Inst::Arithmetic:
+		case Ice::Inst::Cast:
+		case Ice::Inst::ExtractElement:
+		case Ice::Inst::Fcmp:
+		case Ice::Inst::Icmp:
+		case Ice::Inst::InsertElement:
+		case Ice::Inst::Select:
+		case Ice::Inst::ShuffleVector:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	bool Optimizer::isEquivalent(const Ice::Inst *a, const Ice::Inst *b)
+	{
+		if(a->getKind() != b->getKind() ||
+		   a->getDest()->getType() != b->getDest()->getType() ||
+		   a->getSrcSize() != b->getSrcSize())
+		{
+			return false;
+		}
+
+		if(auto *arithmetic = llvm::dyn_cast<Ice::InstArithmetic>(a))
+		{
+			if(arithmetic->getOp() != llvm::cast<Ice::InstArithmetic>(b)->getOp())
+			{
+				return false;
+			}
+
+			if(arithmetic->isCommutative() && a->getSrc(0) == b->getSrc(1) && a->getSrc(1) == b->getSrc(0))
+			{
+				return true;
+			}
+		}
+		else if(auto *cast = llvm::dyn_cast<Ice::InstCast>(a))
+		{
+			if(cast->getCastKind() != llvm::cast<Ice::InstCast>(b)->getCastKind())
+			{
+				return false;
+			}
+		}
+		else if(auto *icmp = llvm::dyn_cast<Ice::InstIcmp>(a))
+		{
+			if(icmp->getCondition() != llvm::cast<Ice::InstIcmp>(b)->getCondition())
+			{
+				return false;
+			}
+		}
+		else if(auto *fcmp = llvm::dyn_cast<Ice::InstFcmp>(a))
+		{
+			if(fcmp->getCondition() != llvm::cast<Ice::InstFcmp>(b)->getCondition())
+			{
+				return false;
+			}
+		}
+
+		for(Ice::SizeT i = 0; i < a->getSrcSize(); i++)
+		{
+			if(a->getSrc(i) != b->getSrc(i))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	size_t Optimizer::hash(const Ice::Inst *instruction)
+	{
+		size_t hash = instruction->getKind();
+
+		if(auto *arithmetic = llvm::dyn_cast<Ice::InstArithmetic>(instruction))
+		{
+			hash = hash * 31 + arithmetic->getOp();
+		}
+		else if(auto *cast = llvm::dyn_cast<Ice::InstCast>(instruction))
+		{
+			hash = hash * 31 + cast->getCastKind();
+		}
+		else if(auto *icmp = llvm::dyn_cast<Ice::InstIcmp>(instruction))
+		{
+			hash = hash * 31 + icmp->getCondition();
+		}
+		else if(auto *fcmp = llvm::dyn_cast<Ice::InstFcmp>(instruction))
+		{
+			hash = hash * 31 + fcmp->getCondition();
+		}
+
+		// Independent of operand order, for commutative operations
+		size_t operands = 0;
+
+		for(Ice::SizeT i = 0; i < instruction->getSrcSize(); i++)
+		{
+			operands += std::hash<const void*>()(instruction->getSrc(i));
+		}
+
+		return hash * 31 + operands;
+	}
+
 	Optimizer::Uses* Optimizer::getUses(Ice::Operand* operand)
 	{
 		Optimizer::Uses* uses = (Optimizer::Uses*)operand->Ice::Operand::getExternalData();
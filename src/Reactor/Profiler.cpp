@@ -0,0 +1,229 @@
+// Copyright 2019 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Profiler.hpp"
+
+#include "MutexLock.hpp"
+
+#if defined(__linux__)
+#include <elf.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace rr
+{
+#if defined(__linux__)
+	namespace
+	{
+		// See tools/perf/Documentation/jitdump-specification.txt in the Linux sources
+		struct JitDumpHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t totalSize;
+			uint32_t elfMachine;
+			uint32_t padding;
+			uint32_t pid;
+			uint64_t timestamp;
+			uint64_t flags;
+		};
+
+		struct JitCodeLoad
+		{
+			uint32_t id;
+			uint32_t totalSize;
+			uint64_t timestamp;
+			uint32_t pid;
+			uint32_t tid;
+			uint64_t vma;
+			uint64_t codeAddress;
+			uint64_t codeSize;
+			uint64_t codeIndex;
+
+			// Followed by the null-terminated name and the code
+		};
+
+		const uint32_t jitDumpMagic = 0x4A695444;   // "JiTD"
+		const uint32_t jitCodeLoadRecord = 0;
+
+		uint64_t timestamp()
+		{
+			timespec time;
+			clock_gettime(CLOCK_MONOTONIC, &time);   // Clock selected by 'perf record -k mono'
+
+			return (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+		}
+
+		uint32_t elfMachine()
+		{
+			#if defined(__x86_64__)
+				return EM_X86_64;
+			#elif defined(__i386__)
+				return EM_386;
+			#elif defined(__aarch64__)
+				return EM_AARCH64;
+			#elif defined(__arm__)
+				return EM_ARM;
+			#elif defined(__mips__)
+				return EM_MIPS;
+			#else
+				return EM_NONE;
+			#endif
+		}
+
+		class Profiler
+		{
+		public:
+			Profiler() : perfMap(nullptr), jitDump(-1), jitDumpMarker(nullptr), codeIndex(0)
+			{
+				const char *mode = getenv("SWIFTSHADER_PERF_MAP");
+
+				if(!mode)
+				{
+					return;
+				}
+
+				char path[64];
+				snprintf(path, sizeof(path), "/tmp/perf-%d.map", (int)getpid());
+				perfMap = fopen(path, "a");
+
+				if(strcmp(mode, "jitdump") == 0)
+				{
+					openJitDump();
+				}
+			}
+
+			~Profiler()
+			{
+				if(perfMap)
+				{
+					fclose(perfMap);
+				}
+
+				if(jitDumpMarker)
+				{
+					munmap(jitDumpMarker, sysconf(_SC_PAGESIZE));
+				}
+
+				if(jitDump >= 0)
+				{
+					close(jitDump);
+				}
+			}
+
+			bool enabled() const
+			{
+				return perfMap || jitDump >= 0;
+			}
+
+			void registerCode(const void *code, size_t size, const char *name)
+			{
+				mutex.lock();
+
+				if(perfMap)
+				{
+					fprintf(perfMap, "%lx %lx %s\n", (unsigned long)(uintptr_t)code, (unsigned long)size, name);
+					fflush(perfMap);
+				}
+
+				if(jitDump >= 0)
+				{
+					size_t nameSize = strlen(name) + 1;
+
+					JitCodeLoad record = {};
+					record.id = jitCodeLoadRecord;
+					record.totalSize = (uint32_t)(sizeof(JitCodeLoad) + nameSize + size);
+					record.timestamp = timestamp();
+					record.pid = (uint32_t)getpid();
+					record.tid = (uint32_t)syscall(SYS_gettid);
+					record.vma = (uint64_t)(uintptr_t)code;
+					record.codeAddress = (uint64_t)(uintptr_t)code;
+					record.codeSize = size;
+					record.codeIndex = codeIndex++;
+
+					if(write(jitDump, &record, sizeof(record)) != (ssize_t)sizeof(record) ||
+					   write(jitDump, name, nameSize) != (ssize_t)nameSize ||
+					   write(jitDump, code, size) != (ssize_t)size)
+					{
+						close(jitDump);
+						jitDump = -1;
+					}
+				}
+
+				mutex.unlock();
+			}
+
+		private:
+			void openJitDump()
+			{
+				char path[64];
+				snprintf(path, sizeof(path), "/tmp/jit-%d.dump", (int)getpid());
+				jitDump = open(path, O_CREAT | O_TRUNC | O_RDWR | O_CLOEXEC, 0666);
+
+				if(jitDump < 0)
+				{
+					return;
+				}
+
+				// perf finds the file through the executable mapping of it recorded in its event stream
+				void *marker = mmap(nullptr, sysconf(_SC_PAGESIZE), PROT_READ | PROT_EXEC, MAP_PRIVATE, jitDump, 0);
+				jitDumpMarker = (marker != MAP_FAILED) ? marker : nullptr;
+
+				JitDumpHeader header = {};
+				header.magic = jitDumpMagic;
+				header.version = 1;
+				header.totalSize = sizeof(JitDumpHeader);
+				header.elfMachine = elfMachine();
+				header.pid = (uint32_t)getpid();
+				header.timestamp = timestamp();
+
+				if(!jitDumpMarker || write(jitDump, &header, sizeof(header)) != (ssize_t)sizeof(header))
+				{
+					close(jitDump);
+					jitDump = -1;
+				}
+			}
+
+			FILE *perfMap;
+			int jitDump;
+			void *jitDumpMarker;
+			uint64_t codeIndex;
+			MutexLock mutex;   // Routines are generated concurrently
+		};
+	}
+
+	void registerRoutineCode(const void *code, size_t size, const char *name)
+	{
+		static Profiler profiler;
+
+		if(profiler.enabled() && code && size != 0)
+		{
+			profiler.registerCode(code, size, name);
+		}
+	}
+#else
+	void registerRoutineCode(const void *code, size_t size, const char *name)
+	{
+	}
+#endif
+}
@@ -0,0 +1,28 @@
+// Copyright 2019 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef rr_Profiler_hpp
+#define rr_Profiler_hpp
+
+#include <cstddef>
+
+namespace rr
+{
+	// Makes generated code known to the Linux perf tool. When the SWIFTSHADER_PERF_MAP environment variable
+	// is set, routines are listed in /tmp/perf-<pid>.map. When it is set to "jitdump", their code is also
+	// written to /tmp/jit-<pid>.dump, for annotating instructions after 'perf record -k mono' and 'perf inject --jit'.
+	void registerRoutineCode(const void *code, size_t size, const char *name);
+}
+
+#endif   // rr_Profiler_hpp
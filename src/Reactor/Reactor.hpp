@@ -48,11 +48,13 @@ namespace rr
 	class UInt2;
 	class Int4;
 	class UInt4;
+	class Int8;
 	class Long;
 	class Half;
 	class Float;
 	class Float2;
 	class Float4;
+	class Float8;
 
 	class Void
 	{
@@ -2138,6 +2140,138 @@ namespace rr
 	RValue<Float4> Floor(RValue<Float4> x);
 	RValue<Float4> Ceil(RValue<Float4> x);
 
+	// 8-wide vectors. They map onto AVX registers when the LLVM back-end can use them, and
+	// operations are performed on both 4-wide halves otherwise.
+	class Int8 : public LValue<Int8>
+	{
+	public:
+		explicit Int8(RValue<Float8> cast);
+
+		Int8() = default;
+		Int8(int xyzw);
+		Int8(int x0, int x1, int x2, int x3, int x4, int x5, int x6, int x7);
+		Int8(RValue<Int8> rhs);
+		Int8(const Int8 &rhs);
+		Int8(const Reference<Int8> &rhs);
+		Int8(RValue<Int4> lo, RValue<Int4> hi);
+		Int8(RValue<Int> rhs);
+		Int8(const Int &rhs);
+		Int8(const Reference<Int> &rhs);
+
+		RValue<Int8> operator=(RValue<Int8> rhs);
+		RValue<Int8> operator=(const Int8 &rhs);
+		RValue<Int8> operator=(const Reference<Int8> &rhs);
+
+		static Type *getType();
+	};
+
+	RValue<Int8> operator+(RValue<Int8> lhs, RValue<Int8> rhs);
+	RValue<Int8> operator-(RValue<Int8> lhs, RValue<Int8> rhs);
+	RValue<Int8> operator*(RValue<Int8> lhs, RValue<Int8> rhs);
+	RValue<Int8> operator&(RValue<Int8> lhs, RValue<Int8> rhs);
+	RValue<Int8> operator|(RValue<Int8> lhs, RValue<Int8> rhs);
+	RValue<Int8> operator^(RValue<Int8> lhs, RValue<Int8> rhs);
+	RValue<Int8> operator<<(RValue<Int8> lhs, unsigned char rhs);
+	RValue<Int8> operator>>(RValue<Int8> lhs, unsigned char rhs);
+	RValue<Int8> operator+=(Int8 &lhs, RValue<Int8> rhs);
+	RValue<Int8> operator-=(Int8 &lhs, RValue<Int8> rhs);
+	RValue<Int8> operator*=(Int8 &lhs, RValue<Int8> rhs);
+	RValue<Int8> operator&=(Int8 &lhs, RValue<Int8> rhs);
+	RValue<Int8> operator|=(Int8 &lhs, RValue<Int8> rhs);
+	RValue<Int8> operator^=(Int8 &lhs, RValue<Int8> rhs);
+	RValue<Int8> operator<<=(Int8 &lhs, unsigned char rhs);
+	RValue<Int8> operator>>=(Int8 &lhs, unsigned char rhs);
+	RValue<Int8> operator+(RValue<Int8> val);
+	RValue<Int8> operator-(RValue<Int8> val);
+	RValue<Int8> operator~(RValue<Int8> val);
+
+	RValue<Int8> CmpEQ(RValue<Int8> x, RValue<Int8> y);
+	RValue<Int8> CmpLT(RValue<Int8> x, RValue<Int8> y);
+	RValue<Int8> CmpLE(RValue<Int8> x, RValue<Int8> y);
+	RValue<Int8> CmpNEQ(RValue<Int8> x, RValue<Int8> y);
+	RValue<Int8> CmpNLT(RValue<Int8> x, RValue<Int8> y);
+	RValue<Int8> CmpNLE(RValue<Int8> x, RValue<Int8> y);
+	RValue<Int8> Max(RValue<Int8> x, RValue<Int8> y);
+	RValue<Int8> Min(RValue<Int8> x, RValue<Int8> y);
+	RValue<Int8> RoundInt(RValue<Float8> cast);
+	RValue<Int> Extract(RValue<Int8> val, int i);
+	RValue<Int8> Insert(RValue<Int8> val, RValue<Int> element, int i);
+	RValue<Int4> Extract4(RValue<Int8> val, int i);   // Lower (0) or upper (1) half
+	RValue<Int8> Insert4(RValue<Int8> val, RValue<Int4> element, int i);
+	RValue<Int> SignMask(RValue<Int8> x);
+
+	class Float8 : public LValue<Float8>
+	{
+	public:
+		explicit Float8(RValue<Int8> cast);
+
+		Float8() = default;
+		Float8(float xyzw);
+		Float8(float x0, float x1, float x2, float x3, float x4, float x5, float x6, float x7);
+		Float8(RValue<Float8> rhs);
+		Float8(const Float8 &rhs);
+		Float8(const Reference<Float8> &rhs);
+		Float8(RValue<Float4> lo, RValue<Float4> hi);
+		Float8(RValue<Float> rhs);
+		Float8(const Float &rhs);
+		Float8(const Reference<Float> &rhs);
+
+		RValue<Float8> operator=(RValue<Float8> rhs);
+		RValue<Float8> operator=(const Float8 &rhs);
+		RValue<Float8> operator=(const Reference<Float8> &rhs);
+
+		static Type *getType();
+	};
+
+	RValue<Float8> operator+(RValue<Float8> lhs, RValue<Float8> rhs);
+	RValue<Float8> operator-(RValue<Float8> lhs, RValue<Float8> rhs);
+	RValue<Float8> operator*(RValue<Float8> lhs, RValue<Float8> rhs);
+	RValue<Float8> operator/(RValue<Float8> lhs, RValue<Float8> rhs);
+	RValue<Float8> operator+=(Float8 &lhs, RValue<Float8> rhs);
+	RValue<Float8> operator-=(Float8 &lhs, RValue<Float8> rhs);
+	RValue<Float8> operator*=(Float8 &lhs, RValue<Float8> rhs);
+	RValue<Float8> operator/=(Float8 &lhs, RValue<Float8> rhs);
+	RValue<Float8> operator+(RValue<Float8> val);
+	RValue<Float8> operator-(RValue<Float8> val);
+
+	RValue<Float8> Abs(RValue<Float8> x);
+	RValue<Float8> Max(RValue<Float8> x, RValue<Float8> y);
+	RValue<Float8> Min(RValue<Float8> x, RValue<Float8> y);
+	RValue<Float8> Sqrt(RValue<Float8> x);
+	RValue<Float8> Insert(RValue<Float8> val, RValue<Float> element, int i);
+	RValue<Float> Extract(RValue<Float8> x, int i);
+	RValue<Float4> Extract4(RValue<Float8> val, int i);   // Lower (0) or upper (1) half
+	RValue<Float8> Insert4(RValue<Float8> val, RValue<Float4> element, int i);
+	RValue<Int> SignMask(RValue<Float8> x);
+	RValue<Int8> CmpEQ(RValue<Float8> x, RValue<Float8> y);
+	RValue<Int8> CmpLT(RValue<Float8> x, RValue<Float8> y);
+	RValue<Int8> CmpLE(RValue<Float8> x, RValue<Float8> y);
+	RValue<Int8> CmpNEQ(RValue<Float8> x, RValue<Float8> y);
+	RValue<Int8> CmpNLT(RValue<Float8> x, RValue<Float8> y);
+	RValue<Int8> CmpNLE(RValue<Float8> x, RValue<Float8> y);
+	RValue<Float8> Round(RValue<Float8> x);
+	RValue<Float8> Trunc(RValue<Float8> x);
+	RValue<Float8> Frac(RValue<Float8> x);
+	RValue<Float8> Floor(RValue<Float8> x);
+	RValue<Float8> Ceil(RValue<Float8> x);
+
+	// Gathers load each lane from base plus its byte offset. Masked loads and stores access consecutive elements.
+	// Lanes with a zero mask don't access memory, and are zero when zeroMaskedLanes is set or undefined otherwise.
+	// The alignment is that of the individual elements.
+	RValue<Float4> Gather(RValue<Pointer<Float>> base, RValue<Int4> offsets, RValue<Int4> mask, unsigned int alignment, bool zeroMaskedLanes = false);
+	RValue<Int4> Gather(RValue<Pointer<Int>> base, RValue<Int4> offsets, RValue<Int4> mask, unsigned int alignment, bool zeroMaskedLanes = false);
+	RValue<Float8> Gather(RValue<Pointer<Float>> base, RValue<Int8> offsets, RValue<Int8> mask, unsigned int alignment, bool zeroMaskedLanes = false);
+	RValue<Int8> Gather(RValue<Pointer<Int>> base, RValue<Int8> offsets, RValue<Int8> mask, unsigned int alignment, bool zeroMaskedLanes = false);
+	RValue<Float4> MaskedLoad(RValue<Pointer<Float4>> base, RValue<Int4> mask, unsigned int alignment, bool zeroMaskedLanes = false);
+	RValue<Int4> MaskedLoad(RValue<Pointer<Int4>> base, RValue<Int4> mask, unsigned int alignment, bool zeroMaskedLanes = false);
+	void MaskedStore(RValue<Pointer<Float4>> base, RValue<Float4> val, RValue<Int4> mask, unsigned int alignment);
+	void MaskedStore(RValue<Pointer<Int4>> base, RValue<Int4> val, RValue<Int4> mask, unsigned int alignment);
+
+	// x * y + z, rounded once when the CPU supports fused multiply-add
+	RValue<Float> FMA(RValue<Float> x, RValue<Float> y, RValue<Float> z);
+	RValue<Float4> FMA(RValue<Float4> x, RValue<Float4> y, RValue<Float4> z);
+	RValue<Float8> FMA(RValue<Float8> x, RValue<Float8> y, RValue<Float8> z);
+
 	template<class T>
 	class Pointer : public LValue<Pointer<T>>
 	{
@@ -2259,9 +2393,13 @@ namespace rr
 
 		Routine *operator()(const char *name, ...);
 
+		// Unoptimized routines are generated faster, for when they're needed quickly. See Routine::isOptimized().
+		void setOptimizations(bool enable);
+
 	protected:
 		Nucleus *core;
 		std::vector<Type*> arguments;
+		bool runOptimizations;
 	};
 
 	template<typename Return>
@@ -2737,6 +2875,7 @@ namespace rr
 	Function<Return(Arguments...)>::Function()
 	{
 		core = new Nucleus();
+		runOptimizations = true;
 
 		Type *types[] = {Arguments::getType()...};
 		for(Type *type : types)
@@ -2766,7 +2905,13 @@ namespace rr
 		vsnprintf(fullName, 1024, name, vararg);
 		va_end(vararg);
 
-		return core->acquireRoutine(fullName, true);
+		return core->acquireRoutine(fullName, runOptimizations);
+	}
+
+	template<typename Return, typename... Arguments>
+	void Function<Return(Arguments...)>::setOptimizations(bool enable)
+	{
+		runOptimizations = enable;
 	}
 
 	template<class T, class S>
@@ -16,6 +16,9 @@
 
 #include "gtest/gtest.h"
 
+#include <cmath>
+#include <cstring>
+
 using namespace rr;
 
 int reference(int *p, int y)
@@ -992,6 +995,314 @@ TEST(ReactorUnitTests, MulAdd)
 	delete routine;
 }
 
+TEST(ReactorUnitTests, WideVectors)
+{
+	Routine *routine = nullptr;
+
+	{
+		Function<Int(Pointer<Byte>, Pointer<Byte>)> function;
+		{
+			Pointer<Byte> in = function.Arg<0>();
+			Pointer<Byte> out = function.Arg<1>();
+
+			Float8 x = *Pointer<Float8>(in);
+			Float8 y = Float8(Extract4(x, 1), Extract4(x, 0));
+
+			*Pointer<Float8>(out + 32 * 0) = Max(x, y) * Float8(2.0f) + Float8(0.5f);
+			*Pointer<Int8>(out + 32 * 1) = RoundInt(x);
+			*Pointer<Int8>(out + 32 * 2) = CmpLT(x, y);
+			*Pointer<Float8>(out + 32 * 3) = Floor(x);
+
+			Return(SignMask(x));
+		}
+
+		routine = function("one");
+
+		if(routine)
+		{
+			float in[8] = {-1.25f, 2.5f, 3.75f, -4.0f, 5.0f, -6.5f, 7.25f, 8.0f};
+			float out[4][8];
+
+			memset(&out, 0, sizeof(out));
+
+			int(*callable)(void*, void*) = (int(*)(void*, void*))routine->getEntry();
+			int mask = callable(in, out);
+
+			EXPECT_EQ(mask, 0x29);
+
+			for(int i = 0; i < 8; i++)
+			{
+				float y = in[(i + 4) % 8];
+				int32_t rounded, less;
+
+				memcpy(&rounded, &out[1][i], sizeof(rounded));
+				memcpy(&less, &out[2][i], sizeof(less));
+
+				EXPECT_EQ(out[0][i], (in[i] > y ? in[i] : y) * 2.0f + 0.5f);
+				EXPECT_EQ(rounded, (int32_t)nearbyintf(in[i]));
+				EXPECT_EQ(less, in[i] < y ? -1 : 0);
+				EXPECT_EQ(out[3][i], floorf(in[i]));
+			}
+		}
+	}
+
+	delete routine;
+}
+
+TEST(ReactorUnitTests, WideIntegerVectors)
+{
+	Routine *routine = nullptr;
+
+	{
+		Function<Int(Pointer<Byte>, Pointer<Byte>)> function;
+		{
+			Pointer<Byte> in = function.Arg<0>();
+			Pointer<Byte> out = function.Arg<1>();
+
+			Int8 x = *Pointer<Int8>(in);
+			Int8 sum = Int8(0);
+
+			For(Int i = 0, i < 3, i++)
+			{
+				sum += (x << 1) ^ Int8(1, 2, 3, 4, 5, 6, 7, 8);
+			}
+
+			*Pointer<Int8>(out + 32 * 0) = Insert(sum, Extract(x, 6), 1);
+			*Pointer<Int8>(out + 32 * 1) = Max(x, -x) >> 1;
+			*Pointer<Float8>(out + 32 * 2) = Float8(x) * Float8(0.5f);
+
+			Return(SignMask(CmpNLE(x, Int8(0))));
+		}
+
+		routine = function("one");
+
+		if(routine)
+		{
+			int32_t in[8] = {-3, 1, 4, -1, 5, -9, 2, 6};
+			int32_t out[3][8];
+
+			memset(&out, 0, sizeof(out));
+
+			int(*callable)(void*, void*) = (int(*)(void*, void*))routine->getEntry();
+			int mask = callable(in, out);
+
+			EXPECT_EQ(mask, 0xD6);
+
+			for(int i = 0; i < 8; i++)
+			{
+				float half;
+				memcpy(&half, &out[2][i], sizeof(half));
+
+				EXPECT_EQ(out[0][i], i == 1 ? in[6] : 3 * ((in[i] << 1) ^ (i + 1)));
+				EXPECT_EQ(out[1][i], (in[i] < 0 ? -in[i] : in[i]) >> 1);
+				EXPECT_EQ(half, in[i] * 0.5f);
+			}
+		}
+	}
+
+	delete routine;
+}
+
+TEST(ReactorUnitTests, GatherAndMaskedMemory)
+{
+	Routine *routine = nullptr;
+
+	{
+		Function<Int(Pointer<Byte>, Pointer<Byte>)> function;
+		{
+			Pointer<Byte> in = function.Arg<0>();
+			Pointer<Byte> out = function.Arg<1>();
+
+			Int4 mask = Int4(-1, 0, -1, 0);
+
+			*Pointer<Float4>(out + 16 * 0) = Gather(Pointer<Float>(in), Int4(28, 0, 12, 4), Int4(-1), 4);
+			*Pointer<Int4>(out + 16 * 1) = Gather(Pointer<Int>(in), Int4(4, 1000000, 8, -1000000), mask, 4, true);
+			*Pointer<Float4>(out + 16 * 2) = MaskedLoad(Pointer<Float4>(in + 16), mask, 4, true);
+			MaskedStore(Pointer<Float4>(out + 16 * 3), *Pointer<Float4>(in), mask, 4);
+			*Pointer<Float4>(out + 16 * 4) = FMA(*Pointer<Float4>(in), Float4(2.0f), Float4(0.5f));
+			*Pointer<Float8>(out + 16 * 5) = Gather(Pointer<Float>(in), Int8(28, 24, 20, 16, 12, 8, 4, 0), Int8(-1, -1, 0, -1, -1, 0, -1, -1), 4, true);
+			*Pointer<Float8>(out + 16 * 7) = FMA(*Pointer<Float8>(in), Float8(2.0f), Float8(0.5f));
+
+			Return(0);
+		}
+
+		routine = function("one");
+
+		if(routine)
+		{
+			float in[8] = {1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f};
+			float out[9][4];
+
+			memset(&out, 0, sizeof(out));
+
+			int(*callable)(void*, void*) = (int(*)(void*, void*))routine->getEntry();
+			callable(in, out);
+
+			int32_t gathered[4];
+			memcpy(&gathered, &out[1], sizeof(gathered));
+
+			float expected[5][4] =
+			{
+				{8.0f, 1.0f, 4.0f, 2.0f},
+				{0.0f, 0.0f, 0.0f, 0.0f},   // Compared as integers
+				{5.0f, 0.0f, 7.0f, 0.0f},
+				{1.0f, 0.0f, 3.0f, 0.0f},
+				{2.5f, 4.5f, 6.5f, 8.5f},
+			};
+
+			int32_t bits[4];
+			memcpy(&bits, in, sizeof(bits));
+
+			EXPECT_EQ(gathered[0], bits[1]);
+			EXPECT_EQ(gathered[1], 0);
+			EXPECT_EQ(gathered[2], bits[2]);
+			EXPECT_EQ(gathered[3], 0);
+
+			for(int i = 0; i < 4; i++)
+			{
+				EXPECT_EQ(out[0][i], expected[0][i]);
+				EXPECT_EQ(out[2][i], expected[2][i]);
+				EXPECT_EQ(out[3][i], expected[3][i]);
+				EXPECT_EQ(out[4][i], expected[4][i]);
+			}
+
+			float expected8[2][8] =
+			{
+				{8.0f, 7.0f, 0.0f, 5.0f, 4.0f, 0.0f, 2.0f, 1.0f},
+				{2.5f, 4.5f, 6.5f, 8.5f, 10.5f, 12.5f, 14.5f, 16.5f},
+			};
+
+			for(int i = 0; i < 8; i++)
+			{
+				EXPECT_EQ(out[5 + i / 4][i % 4], expected8[0][i]);
+				EXPECT_EQ(out[7 + i / 4][i % 4], expected8[1][i]);
+			}
+		}
+	}
+
+	delete routine;
+}
+
+TEST(ReactorUnitTests, RoutineStats)
+{
+	Routine *routine = nullptr;
+	profileRoutines = true;
+
+	{
+		Function<Int(Int)> function;
+		{
+			Int x = function.Arg<0>();
+
+			If(x > 0)
+			{
+				Return(x);
+			}
+
+			Return(-x);
+		}
+
+		routine = function("one");
+
+		if(routine)
+		{
+			int(*callable)(int) = (int(*)(int))routine->getEntry();
+
+			EXPECT_EQ(callable(3), 3);
+			EXPECT_EQ(callable(-4), 4);
+
+			if(const Routine::Stats *stats = routine->getStats())   // Not implemented by all back-ends
+			{
+				EXPECT_EQ(stats->calls, 2);
+				EXPECT_GE(stats->cycles, 0);
+			}
+		}
+	}
+
+	profileRoutines = false;
+	delete routine;
+}
+
+TEST(ReactorUnitTests, LoopInvariants)
+{
+	Routine *routine = nullptr;
+
+	{
+		Function<Int(Int, Int, Pointer<Int>)> function;
+		{
+			Int a = function.Arg<0>();
+			Int b = function.Arg<1>();
+			Pointer<Int> out = function.Arg<2>();
+			Int scale = 3;
+			Int sum = 0;
+
+			For(Int i = 0, i < 10, i++)
+			{
+				Int x = a * b + (scale << 2);
+				Int y = b * a + 12;
+
+				If(b != 0)
+				{
+					sum += a / b;   // Must not be executed when b is zero
+				}
+
+				sum += x - y + i;
+			}
+
+			*out = scale * 0 + 7;
+
+			Return(sum);
+		}
+
+		routine = function("one");
+
+		if(routine)
+		{
+			int(*callable)(int, int, int*) = (int(*)(int, int, int*))routine->getEntry();
+			int out = 0;
+
+			EXPECT_EQ(callable(7, 2, &out), 75);
+			EXPECT_EQ(out, 7);
+			EXPECT_EQ(callable(7, 0, &out), 45);
+		}
+	}
+
+	delete routine;
+}
+
+TEST(ReactorUnitTests, Unoptimized)
+{
+	Routine *routine = nullptr;
+
+	{
+		Function<Int(Int)> function;
+		{
+			Int x = function.Arg<0>();
+			Int sum = 0;
+
+			For(Int i = 0, i < 10, i++)
+			{
+				sum += x;
+			}
+
+			Return(sum);
+		}
+
+		function.setOptimizations(false);
+		routine = function("one");
+
+		if(routine)
+		{
+			int(*callable)(int) = (int(*)(int))routine->getEntry();
+
+			EXPECT_EQ(callable(3), 30);
+			EXPECT_EQ(routine->use(), 1);
+			EXPECT_EQ(routine->use(), 2);
+		}
+	}
+
+	delete routine;
+}
+
 int main(int argc, char **argv)
 {
 	::testing::InitGoogleTest(&argc, argv);
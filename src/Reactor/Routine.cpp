@@ -23,6 +23,9 @@ namespace rr
 	Routine::Routine()
 	{
 		bindCount = 0;
+		useCount = 0;
+		stats = nullptr;
+		optimized = true;
 	}
 
 	void Routine::bind()
@@ -43,5 +46,29 @@ namespace rr
 	Routine::~Routine()
 	{
 		assert(bindCount == 0);
+
+		delete stats;
+	}
+
+	const void *Routine::getImage(size_t &size)
+	{
+		size = 0;
+
+		return nullptr;
+	}
+
+	const Routine::Stats *Routine::getStats() const
+	{
+		return stats;
+	}
+
+	bool Routine::isOptimized() const
+	{
+		return optimized;
+	}
+
+	int Routine::use()
+	{
+		return atomicIncrement(&useCount);
 	}
 }
@@ -15,6 +15,9 @@
 #ifndef rr_Routine_hpp
 #define rr_Routine_hpp
 
+#include <cstddef>
+#include <cstdint>
+
 namespace rr
 {
 	class Routine
@@ -26,12 +29,36 @@ namespace rr
 
 		virtual const void *getEntry() = 0;
 
+		// Relocatable image of the generated code, for loading it in another process.
+		// Only available when retainRoutineImages was set while generating the routine.
+		virtual const void *getImage(size_t &size);
+
+		// Counters updated atomically by the routine itself. Only available when profileRoutines
+		// was set while generating the routine, and not implemented by Subzero.
+		struct Stats
+		{
+			int64_t calls;
+			int64_t cycles;   // Time stamp counter ticks
+		};
+
+		const Stats *getStats() const;
+
+		// Routines generated without optimizations compile faster, but run slower. Callers
+		// count their uses to decide when to generate an optimized replacement.
+		bool isOptimized() const;
+		int use();   // Returns the number of uses, including this one
+
 		// Reference counting
 		void bind();
 		void unbind();
 
 	private:
+		friend class Nucleus;
+
 		volatile int bindCount;
+		volatile int useCount;
+		Stats *stats;
+		bool optimized;
 	};
 }
 
@@ -16,6 +16,7 @@
 
 #include "Optimizer.hpp"
 #include "ExecutableMemory.hpp"
+#include "Profiler.hpp"
 
 #include "src/IceTypes.h"
 #include "src/IceCfg.h"
@@ -55,16 +56,15 @@
 
 namespace
 {
-	Ice::GlobalContext *context = nullptr;
-	Ice::Cfg *function = nullptr;
-	Ice::CfgNode *basicBlock = nullptr;
-	Ice::CfgLocalAllocatorScope *allocator = nullptr;
-	rr::Routine *routine = nullptr;
-
-	std::mutex codegenMutex;
-
-	Ice::ELFFileStreamer *elfFile = nullptr;
-	Ice::Fdstream *out = nullptr;
+	// Code generation state is kept per thread, so that routines can be built concurrently
+	thread_local Ice::GlobalContext *context = nullptr;
+	thread_local Ice::Cfg *function = nullptr;
+	thread_local Ice::CfgNode *basicBlock = nullptr;
+	thread_local Ice::CfgLocalAllocatorScope *allocator = nullptr;
+	thread_local rr::Routine *routine = nullptr;
+
+	thread_local Ice::ELFFileStreamer *elfFile = nullptr;
+	thread_local Ice::Fdstream *out = nullptr;
 }
 
 namespace
@@ -139,7 +139,8 @@ namespace rr
 		EmulatedV2 = 2 << EmulatedShift,
 		EmulatedV4 = 4 << EmulatedShift,
 		EmulatedV8 = 8 << EmulatedShift,
-		EmulatedBits = EmulatedV2 | EmulatedV4 | EmulatedV8,
+		EmulatedPair = 16 << EmulatedShift,   // Two 128-bit halves in a stack slot, see combine()
+		EmulatedBits = EmulatedV2 | EmulatedV4 | EmulatedV8 | EmulatedPair,
 
 		Type_v2i32 = Ice::IceType_v4i32 | EmulatedV2,
 		Type_v4i16 = Ice::IceType_v8i16 | EmulatedV4,
@@ -147,6 +148,8 @@ namespace rr
 		Type_v8i8 =  Ice::IceType_v16i8 | EmulatedV8,
 		Type_v4i8 =  Ice::IceType_v16i8 | EmulatedV4,
 		Type_v2f32 = Ice::IceType_v4f32 | EmulatedV2,
+		Type_v8i32 = Ice::IceType_v4i32 | EmulatedPair,
+		Type_v8f32 = Ice::IceType_v4f32 | EmulatedPair,
 	};
 
 	class Value : public Ice::Operand {};
@@ -191,6 +194,8 @@ namespace rr
 			case Type_v8i8:  return 8;
 			case Type_v4i8:  return 4;
 			case Type_v2f32: return 8;
+			case Type_v8i32: return 32;
+			case Type_v8f32: return 32;
 			default: assert(false);
 			}
 		}
@@ -198,7 +203,14 @@ namespace rr
 		return Ice::typeWidthInBytes(T(type));
 	}
 
+	static bool isPair(Type *type)
+	{
+		return (reinterpret_cast<std::intptr_t>(type) & EmulatedPair) != 0;
+	}
+
 	Optimization optimization[10] = {InstructionCombining, Disabled};
+	bool retainRoutineImages = false;
+	bool profileRoutines = false;   // Not supported, routines have no stats
 
 	using ElfHeader = std::conditional<sizeof(void*) == 8, Elf64_Ehdr, Elf32_Ehdr>::type;
 	using SectionHeader = std::conditional<sizeof(void*) == 8, Elf64_Shdr, Elf32_Shdr>::type;
@@ -213,7 +225,7 @@ namespace rr
 		return &sectionHeader(elfHeader)[index];
 	}
 
-	static void *relocateSymbol(const ElfHeader *elfHeader, const Elf32_Rel &relocation, const SectionHeader &relocationTable)
+	static void *relocateSymbol(const ElfHeader *elfHeader, intptr_t delta, const Elf32_Rel &relocation, const SectionHeader &relocationTable)
 	{
 		const SectionHeader *target = elfSection(elfHeader, relocationTable.sh_info);
 
@@ -240,7 +252,7 @@ namespace rr
 			if(section != SHN_UNDEF && section < SHN_LORESERVE)
 			{
 				const SectionHeader *target = elfSection(elfHeader, symbol.st_shndx);
-				symbolValue = reinterpret_cast<void*>((intptr_t)elfHeader + symbol.st_value + target->sh_offset);
+				symbolValue = reinterpret_cast<void*>((intptr_t)elfHeader + delta + symbol.st_value + target->sh_offset);
 			}
 			else
 			{
@@ -298,7 +310,7 @@ namespace rr
 		return symbolValue;
 	}
 
-	static void *relocateSymbol(const ElfHeader *elfHeader, const Elf64_Rela &relocation, const SectionHeader &relocationTable)
+	static void *relocateSymbol(const ElfHeader *elfHeader, intptr_t delta, const Elf64_Rela &relocation, const SectionHeader &relocationTable)
 	{
 		const SectionHeader *target = elfSection(elfHeader, relocationTable.sh_info);
 
@@ -325,7 +337,7 @@ namespace rr
 			if(section != SHN_UNDEF && section < SHN_LORESERVE)
 			{
 				const SectionHeader *target = elfSection(elfHeader, symbol.st_shndx);
-				symbolValue = reinterpret_cast<void*>((intptr_t)elfHeader + symbol.st_value + target->sh_offset);
+				symbolValue = reinterpret_cast<void*>((intptr_t)elfHeader + delta + symbol.st_value + target->sh_offset);
 			}
 			else
 			{
@@ -346,7 +358,7 @@ namespace rr
 			*patchSite64 = (int64_t)((intptr_t)symbolValue + *patchSite64 + relocation.r_addend);
 			break;
 		case R_X86_64_PC32:
-			*patchSite32 = (int32_t)((intptr_t)symbolValue + *patchSite32 - (intptr_t)patchSite32 + relocation.r_addend);
+			*patchSite32 = (int32_t)((intptr_t)symbolValue + *patchSite32 - (address + delta + relocation.r_offset) + relocation.r_addend);
 			break;
 		case R_X86_64_32S:
 			*patchSite32 = (int32_t)((intptr_t)symbolValue + *patchSite32 + relocation.r_addend);
@@ -359,9 +371,11 @@ namespace rr
 		return symbolValue;
 	}
 
-	void *loadImage(uint8_t *const elfImage, size_t &codeSize)
+	// Relocates the image in place, for execution from another mapping of the same memory
+	void *loadImage(uint8_t *const elfImage, const void *executable, size_t &codeSize)
 	{
 		ElfHeader *elfHeader = (ElfHeader*)elfImage;
+		intptr_t delta = (intptr_t)executable - (intptr_t)elfImage;
 
 		if(!elfHeader->checkMagic())
 		{
@@ -393,7 +407,7 @@ namespace rr
 			{
 				if(sectionHeader[i].sh_flags & SHF_EXECINSTR)
 				{
-					entry = elfImage + sectionHeader[i].sh_offset;
+					entry = (uint8_t*)executable + sectionHeader[i].sh_offset;
 					codeSize = sectionHeader[i].sh_size;
 				}
 			}
@@ -404,7 +418,7 @@ namespace rr
 				for(Elf32_Word index = 0; index < sectionHeader[i].sh_size / sectionHeader[i].sh_entsize; index++)
 				{
 					const Elf32_Rel &relocation = ((const Elf32_Rel*)(elfImage + sectionHeader[i].sh_offset))[index];
-					relocateSymbol(elfHeader, relocation, sectionHeader[i]);
+					relocateSymbol(elfHeader, delta, relocation, sectionHeader[i]);
 				}
 			}
 			else if(sectionHeader[i].sh_type == SHT_RELA)
@@ -414,7 +428,7 @@ namespace rr
 				for(Elf32_Word index = 0; index < sectionHeader[i].sh_size / sectionHeader[i].sh_entsize; index++)
 				{
 					const Elf64_Rela &relocation = ((const Elf64_Rela*)(elfImage + sectionHeader[i].sh_offset))[index];
-					relocateSymbol(elfHeader, relocation, sectionHeader[i]);
+					relocateSymbol(elfHeader, delta, relocation, sectionHeader[i]);
 				}
 			}
 		}
@@ -422,33 +436,13 @@ namespace rr
 		return entry;
 	}
 
-	template<typename T>
-	struct ExecutableAllocator
-	{
-		ExecutableAllocator() {};
-		template<class U> ExecutableAllocator(const ExecutableAllocator<U> &other) {};
-
-		using value_type = T;
-		using size_type = std::size_t;
-
-		T *allocate(size_type n)
-		{
-			return (T*)allocateExecutable(sizeof(T) * n);
-		}
-
-		void deallocate(T *p, size_type n)
-		{
-			deallocateExecutable(p, sizeof(T) * n);
-		}
-	};
-
 	class ELFMemoryStreamer : public Ice::ELFStreamer, public Routine
 	{
 		ELFMemoryStreamer(const ELFMemoryStreamer &) = delete;
 		ELFMemoryStreamer &operator=(const ELFMemoryStreamer &) = delete;
 
 	public:
-		ELFMemoryStreamer() : Routine(), entry(nullptr)
+		ELFMemoryStreamer() : Routine(), entry(nullptr), code(nullptr), codeAllocation(0), retainImage(retainRoutineImages)
 		{
 			position = 0;
 			buffer.reserve(0x1000);
@@ -456,13 +450,10 @@ namespace rr
 
 		~ELFMemoryStreamer() override
 		{
-			#if defined(_WIN32)
-				if(buffer.size() != 0)
-				{
-					DWORD exeProtection;
-					VirtualProtect(&buffer[0], buffer.size(), oldProtection, &exeProtection);
-				}
-			#endif
+			if(code)
+			{
+				deallocateCode(code, codeAllocation);
+			}
 		}
 
 		void write8(uint8_t Value) override
@@ -494,57 +485,95 @@ namespace rr
 
 		const void *getEntry() override
 		{
-			if(!entry)
+			if(!code)
 			{
 				position = std::numeric_limits<std::size_t>::max();   // Can't stream more data after this
 
+				void *writable = nullptr;
+				code = allocateCode(buffer.size(), writable);
+
+				if(!code)
+				{
+					return nullptr;
+				}
+
+				codeAllocation = buffer.size();
+				memcpy(writable, &buffer[0], buffer.size());
+
 				size_t codeSize = 0;
-				entry = loadImage(&buffer[0], codeSize);
+				entry = loadImage((uint8_t*)writable, code, codeSize);
 
-				#if defined(_WIN32)
-					VirtualProtect(&buffer[0], buffer.size(), PAGE_EXECUTE_READ, &oldProtection);
-					FlushInstructionCache(GetCurrentProcess(), NULL, 0);
-				#else
-					mprotect(&buffer[0], buffer.size(), PROT_READ | PROT_EXEC);
-					__builtin___clear_cache((char*)entry, (char*)entry + codeSize);
+				finalizeCode(code, codeAllocation);
+
+				#if !__has_feature(memory_sanitizer)   // Calls to __msan_unpoison use absolute addresses
+					if(retainImage)
+					{
+						image.swap(buffer);
+					}
 				#endif
+
+				std::vector<uint8_t>().swap(buffer);
+
+				if(entry && !name.empty())   // Loaded routines are not named
+				{
+					registerRoutineCode(entry, codeSize, name.c_str());
+				}
 			}
 
 			return entry;
 		}
 
+		const void *getImage(size_t &size) override
+		{
+			getEntry();   // The image is retained when the code is loaded
+
+			size = image.size();
+
+			return image.empty() ? nullptr : &image[0];
+		}
+
+		void setName(const char *name)
+		{
+			this->name = name;
+		}
+
 	private:
 		void *entry;
-		std::vector<uint8_t, ExecutableAllocator<uint8_t>> buffer;
+		std::string name;
+		void *code;   // Relocated copy of the buffer
+		size_t codeAllocation;
+		std::vector<uint8_t> buffer;
 		std::size_t position;
 
-		#if defined(_WIN32)
-		DWORD oldProtection;
-		#endif
+		const bool retainImage;
+		std::vector<uint8_t> image;   // Unrelocated copy of the buffer
 	};
 
 	Nucleus::Nucleus()
 	{
-		::codegenMutex.lock();   // Reactor is currently not thread safe
-
-		Ice::ClFlags &Flags = Ice::ClFlags::Flags;
-		Ice::ClFlags::getParsedClFlags(Flags);
+		// The flags are global, so only initialize them once
+		static std::once_flag flagsInitialized;
+		std::call_once(flagsInitialized, []()
+		{
+			Ice::ClFlags &Flags = Ice::ClFlags::Flags;
+			Ice::ClFlags::getParsedClFlags(Flags);
 
-		#if defined(__arm__)
-			Flags.setTargetArch(Ice::Target_ARM32);
-			Flags.setTargetInstructionSet(Ice::ARM32InstructionSet_HWDivArm);
-		#elif defined(__mips__)
-			Flags.setTargetArch(Ice::Target_MIPS32);
-			Flags.setTargetInstructionSet(Ice::BaseInstructionSet);
-		#else   // x86
-			Flags.setTargetArch(sizeof(void*) == 8 ? Ice::Target_X8664 : Ice::Target_X8632);
-			Flags.setTargetInstructionSet(CPUID::SSE4_1 ? Ice::X86InstructionSet_SSE4_1 : Ice::X86InstructionSet_SSE2);
-		#endif
-		Flags.setOutFileType(Ice::FT_Elf);
-		Flags.setOptLevel(Ice::Opt_2);
-		Flags.setApplicationBinaryInterface(Ice::ABI_Platform);
-		Flags.setVerbose(false ? Ice::IceV_Most : Ice::IceV_None);
-		Flags.setDisableHybridAssembly(true);
+			#if defined(__arm__)
+				Flags.setTargetArch(Ice::Target_ARM32);
+				Flags.setTargetInstructionSet(Ice::ARM32InstructionSet_HWDivArm);
+			#elif defined(__mips__)
+				Flags.setTargetArch(Ice::Target_MIPS32);
+				Flags.setTargetInstructionSet(Ice::BaseInstructionSet);
+			#else   // x86
+				Flags.setTargetArch(sizeof(void*) == 8 ? Ice::Target_X8664 : Ice::Target_X8632);
+				Flags.setTargetInstructionSet(CPUID::SSE4_1 ? Ice::X86InstructionSet_SSE4_1 : Ice::X86InstructionSet_SSE2);
+			#endif
+			Flags.setOutFileType(Ice::FT_Elf);
+			Flags.setOptLevel(Ice::Opt_2);
+			Flags.setApplicationBinaryInterface(Ice::ABI_Platform);
+			Flags.setVerbose(false ? Ice::IceV_Most : Ice::IceV_None);
+			Flags.setDisableHybridAssembly(true);
+		});
 
 		static llvm::raw_os_ostream cout(std::cout);
 		static llvm::raw_os_ostream cerr(std::cerr);
@@ -575,7 +604,12 @@ namespace rr
 		delete ::elfFile;
 		delete ::out;
 
-		::codegenMutex.unlock();
+		::routine = nullptr;
+		::allocator = nullptr;
+		::function = nullptr;
+		::context = nullptr;
+		::elfFile = nullptr;
+		::out = nullptr;
 	}
 
 	Routine *Nucleus::acquireRoutine(const char *name, bool runOptimizations)
@@ -614,9 +648,33 @@ namespace rr
 		Routine *handoffRoutine = ::routine;
 		::routine = nullptr;
 
+		if(handoffRoutine)
+		{
+			static_cast<ELFMemoryStreamer*>(handoffRoutine)->setName(name);
+		}
+
 		return handoffRoutine;
 	}
 
+	Routine *Nucleus::loadRoutine(const void *image, size_t size)
+	{
+		ELFMemoryStreamer *routine = new ELFMemoryStreamer();
+		routine->writeBytes(llvm::StringRef(static_cast<const char*>(image), size));
+
+		if(!routine->getEntry())
+		{
+			delete routine;
+			return nullptr;
+		}
+
+		return routine;
+	}
+
+	bool Nucleus::supportsWideVectors()
+	{
+		return false;   // Subzero has no 256-bit vector types
+	}
+
 	void Nucleus::optimize()
 	{
 		rr::optimize(::function);
@@ -625,7 +683,7 @@ namespace rr
 	Value *Nucleus::allocateStackVariable(Type *t, int arraySize)
 	{
 		Ice::Type type = T(t);
-		int typeSize = Ice::typeWidthInBytes(type);
+		int typeSize = isPair(t) ? 32 : Ice::typeWidthInBytes(type);
 		int totalSize = typeSize * (arraySize ? arraySize : 1);
 
 		auto bytes = Ice::ConstantInteger32::create(::context, type, totalSize);
@@ -848,6 +906,21 @@ namespace rr
 
 	Value *Nucleus::createLoad(Value *ptr, Type *type, bool isVolatile, unsigned int align)
 	{
+		if(isPair(type))   // Copied into a stack slot of its own
+		{
+			Type *half = T(T(type));
+			Value *halves = allocateStackVariable(type);
+
+			for(int i = 0; i < 2; i++)
+			{
+				Value *index = createConstantInt(i);
+				Value *load = createLoad(createGEP(ptr, half, index, false), half, isVolatile, align);
+				createStore(load, createGEP(halves, half, index, false), half, false, 0);
+			}
+
+			return halves;
+		}
+
 		int valueType = (int)reinterpret_cast<intptr_t>(type);
 		Ice::Variable *result = ::function->makeVariable(T(type));
 
@@ -913,6 +986,20 @@ namespace rr
 			}
 		#endif
 
+		if(isPair(type))
+		{
+			Type *half = T(T(type));
+
+			for(int i = 0; i < 2; i++)
+			{
+				Value *index = createConstantInt(i);
+				Value *load = createLoad(createGEP(value, half, index, false), half, false, 0);
+				createStore(load, createGEP(ptr, half, index, false), half, isVolatile, align);
+			}
+
+			return value;
+		}
+
 		int valueType = (int)reinterpret_cast<intptr_t>(type);
 
 		if((valueType & EmulatedBits) && (align != 0))   // Narrow vector not stored on stack.
@@ -1061,6 +1148,11 @@ namespace rr
 
 	Value *Nucleus::createBitCast(Value *v, Type *destType)
 	{
+		if(isPair(destType))
+		{
+			return v;   // Reinterpreting the halves stored in the slot
+		}
+
 		// Bitcasts must be between types of the same logical size. But with emulated narrow vectors we need
 		// support for casting between scalars and wide vectors. For platforms where this is not supported,
 		// emulate them by writing to the stack and reading back as the destination type.
@@ -6387,38 +6479,38 @@ namespace rr
 		return T(Ice::IceType_v4i32);
 	}
 
-	Half::Half(RValue<Float> cast)
-	{
-		UInt fp32i = As<UInt>(cast);
-		UInt abs = fp32i & 0x7FFFFFFF;
-		UShort fp16i((fp32i & 0x80000000) >> 16); // sign
-
-		If(abs > 0x47FFEFFF) // Infinity
-		{
-			fp16i |= UShort(0x7FFF);
-		}
-		Else
-		{
-			If(abs < 0x38800000) // Denormal
-			{
-				Int mantissa = (abs & 0x007FFFFF) | 0x00800000;
-				Int e = 113 - (abs >> 23);
-				abs = IfThenElse(e < 24, mantissa >> e, Int(0));
-				fp16i |= UShort((abs + 0x00000FFF + ((abs >> 13) & 1)) >> 13);
-			}
-			Else
-			{
-				fp16i |= UShort((abs + 0xC8000000 + 0x00000FFF + ((abs >> 13) & 1)) >> 13);
-			}
-		}
-
-		storeValue(fp16i.loadValue());
-	}
-
-	Type *Half::getType()
-	{
-		return T(Ice::IceType_i16);
-	}
+	Half::Half(RValue<Float> cast)
+	{
+		UInt fp32i = As<UInt>(cast);
+		UInt abs = fp32i & 0x7FFFFFFF;
+		UShort fp16i((fp32i & 0x80000000) >> 16); // sign
+
+		If(abs > 0x47FFEFFF) // Infinity
+		{
+			fp16i |= UShort(0x7FFF);
+		}
+		Else
+		{
+			If(abs < 0x38800000) // Denormal
+			{
+				Int mantissa = (abs & 0x007FFFFF) | 0x00800000;
+				Int e = 113 - (abs >> 23);
+				abs = IfThenElse(e < 24, mantissa >> e, Int(0));
+				fp16i |= UShort((abs + 0x00000FFF + ((abs >> 13) & 1)) >> 13);
+			}
+			Else
+			{
+				fp16i |= UShort((abs + 0xC8000000 + 0x00000FFF + ((abs >> 13) & 1)) >> 13);
+			}
+		}
+
+		storeValue(fp16i.loadValue());
+	}
+
+	Type *Half::getType()
+	{
+		return T(Ice::IceType_i16);
+	}
 
 	Float::Float(RValue<Int> cast)
 	{
@@ -6435,34 +6527,34 @@ namespace rr
 		storeValue(result.value);
 	}
 
-	Float::Float(RValue<Half> cast)
-	{
-		Int fp16i(As<UShort>(cast));
-
-		Int s = (fp16i >> 15) & 0x00000001;
-		Int e = (fp16i >> 10) & 0x0000001F;
-		Int m = fp16i & 0x000003FF;
-
-		UInt fp32i(s << 31);
-		If(e == 0)
-		{
-			If(m != 0)
-			{
-				While((m & 0x00000400) == 0)
-				{
-					m <<= 1;
-					e -= 1;
-				}
-
-				fp32i |= As<UInt>(((e + (127 - 15) + 1) << 23) | ((m & ~0x00000400) << 13));
-			}
-		}
-		Else
-		{
-			fp32i |= As<UInt>(((e + (127 - 15)) << 23) | (m << 13));
-		}
-
-		storeValue(As<Float>(fp32i).value);
+	Float::Float(RValue<Half> cast)
+	{
+		Int fp16i(As<UShort>(cast));
+
+		Int s = (fp16i >> 15) & 0x00000001;
+		Int e = (fp16i >> 10) & 0x0000001F;
+		Int m = fp16i & 0x000003FF;
+
+		UInt fp32i(s << 31);
+		If(e == 0)
+		{
+			If(m != 0)
+			{
+				While((m & 0x00000400) == 0)
+				{
+					m <<= 1;
+					e -= 1;
+				}
+
+				fp32i |= As<UInt>(((e + (127 - 15) + 1) << 23) | ((m & ~0x00000400) << 13));
+			}
+		}
+		Else
+		{
+			fp32i |= As<UInt>(((e + (127 - 15)) << 23) | (m << 13));
+		}
+
+		storeValue(As<Float>(fp32i).value);
 	}
 
 	Float::Float(float x)
@@ -7169,6 +7261,581 @@ namespace rr
 		return T(Ice::IceType_v4f32);
 	}
 
+	// Subzero has no 256-bit vector types. The value of an Int8 or Float8 is the address of a stack slot
+	// holding its lower and upper 4-wide halves, and operations are performed on each half.
+	static RValue<Int8> combine(RValue<Int4> lo, RValue<Int4> hi)
+	{
+		Value *halves = Nucleus::allocateStackVariable(Int8::getType());
+		Nucleus::createStore(lo.value, halves, Int4::getType(), false, 0);
+		Nucleus::createStore(hi.value, Nucleus::createGEP(halves, Int4::getType(), Nucleus::createConstantInt(1), false), Int4::getType(), false, 0);
+
+		return RValue<Int8>(halves);
+	}
+
+	static RValue<Float8> combine(RValue<Float4> lo, RValue<Float4> hi)
+	{
+		Value *halves = Nucleus::allocateStackVariable(Float8::getType());
+		Nucleus::createStore(lo.value, halves, Float4::getType(), false, 0);
+		Nucleus::createStore(hi.value, Nucleus::createGEP(halves, Float4::getType(), Nucleus::createConstantInt(1), false), Float4::getType(), false, 0);
+
+		return RValue<Float8>(halves);
+	}
+
+	Int8::Int8(RValue<Float8> cast)
+	{
+		storeValue(combine(Int4(Extract4(cast, 0)), Int4(Extract4(cast, 1))).value);
+	}
+
+	Int8::Int8(int xyzw)
+	{
+		storeValue(combine(Int4(xyzw), Int4(xyzw)).value);
+	}
+
+	Int8::Int8(int x0, int x1, int x2, int x3, int x4, int x5, int x6, int x7)
+	{
+		storeValue(combine(Int4(x0, x1, x2, x3), Int4(x4, x5, x6, x7)).value);
+	}
+
+	Int8::Int8(RValue<Int8> rhs)
+	{
+		storeValue(rhs.value);
+	}
+
+	Int8::Int8(const Int8 &rhs)
+	{
+		Value *value = rhs.loadValue();
+		storeValue(value);
+	}
+
+	Int8::Int8(const Reference<Int8> &rhs)
+	{
+		Value *value = rhs.loadValue();
+		storeValue(value);
+	}
+
+	Int8::Int8(RValue<Int4> lo, RValue<Int4> hi)
+	{
+		storeValue(combine(lo, hi).value);
+	}
+
+	Int8::Int8(RValue<Int> rhs)
+	{
+		storeValue(combine(Int4(rhs), Int4(rhs)).value);
+	}
+
+	Int8::Int8(const Int &rhs)
+	{
+		*this = Int8(RValue<Int>(rhs.loadValue()));
+	}
+
+	Int8::Int8(const Reference<Int> &rhs)
+	{
+		*this = Int8(RValue<Int>(rhs.loadValue()));
+	}
+
+	RValue<Int8> Int8::operator=(RValue<Int8> rhs)
+	{
+		storeValue(rhs.value);
+
+		return rhs;
+	}
+
+	RValue<Int8> Int8::operator=(const Int8 &rhs)
+	{
+		Value *value = rhs.loadValue();
+		storeValue(value);
+
+		return RValue<Int8>(value);
+	}
+
+	RValue<Int8> Int8::operator=(const Reference<Int8> &rhs)
+	{
+		Value *value = rhs.loadValue();
+		storeValue(value);
+
+		return RValue<Int8>(value);
+	}
+
+	Type *Int8::getType()
+	{
+		return T(Type_v8i32);
+	}
+
+	RValue<Int8> operator+(RValue<Int8> lhs, RValue<Int8> rhs)
+	{
+		return combine(Extract4(lhs, 0) + Extract4(rhs, 0), Extract4(lhs, 1) + Extract4(rhs, 1));
+	}
+
+	RValue<Int8> operator-(RValue<Int8> lhs, RValue<Int8> rhs)
+	{
+		return combine(Extract4(lhs, 0) - Extract4(rhs, 0), Extract4(lhs, 1) - Extract4(rhs, 1));
+	}
+
+	RValue<Int8> operator*(RValue<Int8> lhs, RValue<Int8> rhs)
+	{
+		return combine(Extract4(lhs, 0) * Extract4(rhs, 0), Extract4(lhs, 1) * Extract4(rhs, 1));
+	}
+
+	RValue<Int8> operator&(RValue<Int8> lhs, RValue<Int8> rhs)
+	{
+		return combine(Extract4(lhs, 0) & Extract4(rhs, 0), Extract4(lhs, 1) & Extract4(rhs, 1));
+	}
+
+	RValue<Int8> operator|(RValue<Int8> lhs, RValue<Int8> rhs)
+	{
+		return combine(Extract4(lhs, 0) | Extract4(rhs, 0), Extract4(lhs, 1) | Extract4(rhs, 1));
+	}
+
+	RValue<Int8> operator^(RValue<Int8> lhs, RValue<Int8> rhs)
+	{
+		return combine(Extract4(lhs, 0) ^ Extract4(rhs, 0), Extract4(lhs, 1) ^ Extract4(rhs, 1));
+	}
+
+	RValue<Int8> operator<<(RValue<Int8> lhs, unsigned char rhs)
+	{
+		return combine(Extract4(lhs, 0) << rhs, Extract4(lhs, 1) << rhs);
+	}
+
+	RValue<Int8> operator>>(RValue<Int8> lhs, unsigned char rhs)
+	{
+		return combine(Extract4(lhs, 0) >> rhs, Extract4(lhs, 1) >> rhs);
+	}
+
+	RValue<Int8> operator+=(Int8 &lhs, RValue<Int8> rhs)
+	{
+		return lhs = lhs + rhs;
+	}
+
+	RValue<Int8> operator-=(Int8 &lhs, RValue<Int8> rhs)
+	{
+		return lhs = lhs - rhs;
+	}
+
+	RValue<Int8> operator*=(Int8 &lhs, RValue<Int8> rhs)
+	{
+		return lhs = lhs * rhs;
+	}
+
+	RValue<Int8> operator&=(Int8 &lhs, RValue<Int8> rhs)
+	{
+		return lhs = lhs & rhs;
+	}
+
+	RValue<Int8> operator|=(Int8 &lhs, RValue<Int8> rhs)
+	{
+		return lhs = lhs | rhs;
+	}
+
+	RValue<Int8> operator^=(Int8 &lhs, RValue<Int8> rhs)
+	{
+		return lhs = lhs ^ rhs;
+	}
+
+	RValue<Int8> operator<<=(Int8 &lhs, unsigned char rhs)
+	{
+		return lhs = lhs << rhs;
+	}
+
+	RValue<Int8> operator>>=(Int8 &lhs, unsigned char rhs)
+	{
+		return lhs = lhs >> rhs;
+	}
+
+	RValue<Int8> operator+(RValue<Int8> val)
+	{
+		return val;
+	}
+
+	RValue<Int8> operator-(RValue<Int8> val)
+	{
+		return combine(-Extract4(val, 0), -Extract4(val, 1));
+	}
+
+	RValue<Int8> operator~(RValue<Int8> val)
+	{
+		return combine(~Extract4(val, 0), ~Extract4(val, 1));
+	}
+
+	RValue<Int8> CmpEQ(RValue<Int8> x, RValue<Int8> y)
+	{
+		return combine(CmpEQ(Extract4(x, 0), Extract4(y, 0)), CmpEQ(Extract4(x, 1), Extract4(y, 1)));
+	}
+
+	RValue<Int8> CmpLT(RValue<Int8> x, RValue<Int8> y)
+	{
+		return combine(CmpLT(Extract4(x, 0), Extract4(y, 0)), CmpLT(Extract4(x, 1), Extract4(y, 1)));
+	}
+
+	RValue<Int8> CmpLE(RValue<Int8> x, RValue<Int8> y)
+	{
+		return combine(CmpLE(Extract4(x, 0), Extract4(y, 0)), CmpLE(Extract4(x, 1), Extract4(y, 1)));
+	}
+
+	RValue<Int8> CmpNEQ(RValue<Int8> x, RValue<Int8> y)
+	{
+		return combine(CmpNEQ(Extract4(x, 0), Extract4(y, 0)), CmpNEQ(Extract4(x, 1), Extract4(y, 1)));
+	}
+
+	RValue<Int8> CmpNLT(RValue<Int8> x, RValue<Int8> y)
+	{
+		return combine(CmpNLT(Extract4(x, 0), Extract4(y, 0)), CmpNLT(Extract4(x, 1), Extract4(y, 1)));
+	}
+
+	RValue<Int8> CmpNLE(RValue<Int8> x, RValue<Int8> y)
+	{
+		return combine(CmpNLE(Extract4(x, 0), Extract4(y, 0)), CmpNLE(Extract4(x, 1), Extract4(y, 1)));
+	}
+
+	RValue<Int8> Max(RValue<Int8> x, RValue<Int8> y)
+	{
+		return combine(Max(Extract4(x, 0), Extract4(y, 0)), Max(Extract4(x, 1), Extract4(y, 1)));
+	}
+
+	RValue<Int8> Min(RValue<Int8> x, RValue<Int8> y)
+	{
+		return combine(Min(Extract4(x, 0), Extract4(y, 0)), Min(Extract4(x, 1), Extract4(y, 1)));
+	}
+
+	RValue<Int8> RoundInt(RValue<Float8> cast)
+	{
+		return combine(RoundInt(Extract4(cast, 0)), RoundInt(Extract4(cast, 1)));
+	}
+
+	RValue<Int> Extract(RValue<Int8> x, int i)
+	{
+		return Extract(Extract4(x, i / 4), i % 4);
+	}
+
+	RValue<Int8> Insert(RValue<Int8> x, RValue<Int> element, int i)
+	{
+		return Insert4(x, Insert(Extract4(x, i / 4), element, i % 4), i / 4);
+	}
+
+	RValue<Int4> Extract4(RValue<Int8> val, int i)
+	{
+		Value *half = Nucleus::createGEP(val.value, Int4::getType(), Nucleus::createConstantInt(i), false);
+
+		return RValue<Int4>(Nucleus::createLoad(half, Int4::getType(), false, 0));
+	}
+
+	RValue<Int8> Insert4(RValue<Int8> val, RValue<Int4> element, int i)
+	{
+		return i == 0 ? combine(element, Extract4(val, 1)) : combine(Extract4(val, 0), element);
+	}
+
+	RValue<Int> SignMask(RValue<Int8> x)
+	{
+		return SignMask(Extract4(x, 0)) | (SignMask(Extract4(x, 1)) << 4);
+	}
+
+	Float8::Float8(RValue<Int8> cast)
+	{
+		storeValue(combine(Float4(Extract4(cast, 0)), Float4(Extract4(cast, 1))).value);
+	}
+
+	Float8::Float8(float xyzw)
+	{
+		storeValue(combine(Float4(xyzw), Float4(xyzw)).value);
+	}
+
+	Float8::Float8(float x0, float x1, float x2, float x3, float x4, float x5, float x6, float x7)
+	{
+		storeValue(combine(Float4(x0, x1, x2, x3), Float4(x4, x5, x6, x7)).value);
+	}
+
+	Float8::Float8(RValue<Float8> rhs)
+	{
+		storeValue(rhs.value);
+	}
+
+	Float8::Float8(const Float8 &rhs)
+	{
+		Value *value = rhs.loadValue();
+		storeValue(value);
+	}
+
+	Float8::Float8(const Reference<Float8> &rhs)
+	{
+		Value *value = rhs.loadValue();
+		storeValue(value);
+	}
+
+	Float8::Float8(RValue<Float4> lo, RValue<Float4> hi)
+	{
+		storeValue(combine(lo, hi).value);
+	}
+
+	Float8::Float8(RValue<Float> rhs)
+	{
+		storeValue(combine(Float4(rhs), Float4(rhs)).value);
+	}
+
+	Float8::Float8(const Float &rhs)
+	{
+		*this = Float8(RValue<Float>(rhs.loadValue()));
+	}
+
+	Float8::Float8(const Reference<Float> &rhs)
+	{
+		*this = Float8(RValue<Float>(rhs.loadValue()));
+	}
+
+	RValue<Float8> Float8::operator=(RValue<Float8> rhs)
+	{
+		storeValue(rhs.value);
+
+		return rhs;
+	}
+
+	RValue<Float8> Float8::operator=(const Float8 &rhs)
+	{
+		Value *value = rhs.loadValue();
+		storeValue(value);
+
+		return RValue<Float8>(value);
+	}
+
+	RValue<Float8> Float8::operator=(const Reference<Float8> &rhs)
+	{
+		Value *value = rhs.loadValue();
+		storeValue(value);
+
+		return RValue<Float8>(value);
+	}
+
+	Type *Float8::getType()
+	{
+		return T(Type_v8f32);
+	}
+
+	RValue<Float8> operator+(RValue<Float8> lhs, RValue<Float8> rhs)
+	{
+		return combine(Extract4(lhs, 0) + Extract4(rhs, 0), Extract4(lhs, 1) + Extract4(rhs, 1));
+	}
+
+	RValue<Float8> operator-(RValue<Float8> lhs, RValue<Float8> rhs)
+	{
+		return combine(Extract4(lhs, 0) - Extract4(rhs, 0), Extract4(lhs, 1) - Extract4(rhs, 1));
+	}
+
+	RValue<Float8> operator*(RValue<Float8> lhs, RValue<Float8> rhs)
+	{
+		return combine(Extract4(lhs, 0) * Extract4(rhs, 0), Extract4(lhs, 1) * Extract4(rhs, 1));
+	}
+
+	RValue<Float8> operator/(RValue<Float8> lhs, RValue<Float8> rhs)
+	{
+		return combine(Extract4(lhs, 0) / Extract4(rhs, 0), Extract4(lhs, 1) / Extract4(rhs, 1));
+	}
+
+	RValue<Float8> operator+=(Float8 &lhs, RValue<Float8> rhs)
+	{
+		return lhs = lhs + rhs;
+	}
+
+	RValue<Float8> operator-=(Float8 &lhs, RValue<Float8> rhs)
+	{
+		return lhs = lhs - rhs;
+	}
+
+	RValue<Float8> operator*=(Float8 &lhs, RValue<Float8> rhs)
+	{
+		return lhs = lhs * rhs;
+	}
+
+	RValue<Float8> operator/=(Float8 &lhs, RValue<Float8> rhs)
+	{
+		return lhs = lhs / rhs;
+	}
+
+	RValue<Float8> operator+(RValue<Float8> val)
+	{
+		return val;
+	}
+
+	RValue<Float8> operator-(RValue<Float8> val)
+	{
+		return combine(-Extract4(val, 0), -Extract4(val, 1));
+	}
+
+	RValue<Float8> Abs(RValue<Float8> x)
+	{
+		return combine(Abs(Extract4(x, 0)), Abs(Extract4(x, 1)));
+	}
+
+	RValue<Float8> Max(RValue<Float8> x, RValue<Float8> y)
+	{
+		return combine(Max(Extract4(x, 0), Extract4(y, 0)), Max(Extract4(x, 1), Extract4(y, 1)));
+	}
+
+	RValue<Float8> Min(RValue<Float8> x, RValue<Float8> y)
+	{
+		return combine(Min(Extract4(x, 0), Extract4(y, 0)), Min(Extract4(x, 1), Extract4(y, 1)));
+	}
+
+	RValue<Float8> Sqrt(RValue<Float8> x)
+	{
+		return combine(Sqrt(Extract4(x, 0)), Sqrt(Extract4(x, 1)));
+	}
+
+	RValue<Float> Extract(RValue<Float8> x, int i)
+	{
+		return Extract(Extract4(x, i / 4), i % 4);
+	}
+
+	RValue<Float8> Insert(RValue<Float8> x, RValue<Float> element, int i)
+	{
+		return Insert4(x, Insert(Extract4(x, i / 4), element, i % 4), i / 4);
+	}
+
+	RValue<Float4> Extract4(RValue<Float8> val, int i)
+	{
+		Value *half = Nucleus::createGEP(val.value, Float4::getType(), Nucleus::createConstantInt(i), false);
+
+		return RValue<Float4>(Nucleus::createLoad(half, Float4::getType(), false, 0));
+	}
+
+	RValue<Float8> Insert4(RValue<Float8> val, RValue<Float4> element, int i)
+	{
+		return i == 0 ? combine(element, Extract4(val, 1)) : combine(Extract4(val, 0), element);
+	}
+
+	RValue<Int> SignMask(RValue<Float8> x)
+	{
+		return SignMask(Extract4(x, 0)) | (SignMask(Extract4(x, 1)) << 4);
+	}
+
+	RValue<Int8> CmpEQ(RValue<Float8> x, RValue<Float8> y)
+	{
+		return combine(CmpEQ(Extract4(x, 0), Extract4(y, 0)), CmpEQ(Extract4(x, 1), Extract4(y, 1)));
+	}
+
+	RValue<Int8> CmpLT(RValue<Float8> x, RValue<Float8> y)
+	{
+		return combine(CmpLT(Extract4(x, 0), Extract4(y, 0)), CmpLT(Extract4(x, 1), Extract4(y, 1)));
+	}
+
+	RValue<Int8> CmpLE(RValue<Float8> x, RValue<Float8> y)
+	{
+		return combine(CmpLE(Extract4(x, 0), Extract4(y, 0)), CmpLE(Extract4(x, 1), Extract4(y, 1)));
+	}
+
+	RValue<Int8> CmpNEQ(RValue<Float8> x, RValue<Float8> y)
+	{
+		return combine(CmpNEQ(Extract4(x, 0), Extract4(y, 0)), CmpNEQ(Extract4(x, 1), Extract4(y, 1)));
+	}
+
+	RValue<Int8> CmpNLT(RValue<Float8> x, RValue<Float8> y)
+	{
+		return combine(CmpNLT(Extract4(x, 0), Extract4(y, 0)), CmpNLT(Extract4(x, 1), Extract4(y, 1)));
+	}
+
+	RValue<Int8> CmpNLE(RValue<Float8> x, RValue<Float8> y)
+	{
+		return combine(CmpNLE(Extract4(x, 0), Extract4(y, 0)), CmpNLE(Extract4(x, 1), Extract4(y, 1)));
+	}
+
+	RValue<Float8> Round(RValue<Float8> x)
+	{
+		return combine(Round(Extract4(x, 0)), Round(Extract4(x, 1)));
+	}
+
+	RValue<Float8> Trunc(RValue<Float8> x)
+	{
+		return combine(Trunc(Extract4(x, 0)), Trunc(Extract4(x, 1)));
+	}
+
+	RValue<Float8> Frac(RValue<Float8> x)
+	{
+		return combine(Frac(Extract4(x, 0)), Frac(Extract4(x, 1)));
+	}
+
+	RValue<Float8> Floor(RValue<Float8> x)
+	{
+		return combine(Floor(Extract4(x, 0)), Floor(Extract4(x, 1)));
+	}
+
+	RValue<Float8> Ceil(RValue<Float8> x)
+	{
+		return combine(Ceil(Extract4(x, 0)), Ceil(Extract4(x, 1)));
+	}
+
+	RValue<Float4> Gather(RValue<Pointer<Float>> base, RValue<Int4> offsets, RValue<Int4> mask, unsigned int alignment, bool zeroMaskedLanes)
+	{
+		return As<Float4>(Gather(Pointer<Int>(base), offsets, mask, alignment, zeroMaskedLanes));
+	}
+
+	RValue<Int4> Gather(RValue<Pointer<Int>> base, RValue<Int4> offsets, RValue<Int4> mask, unsigned int alignment, bool zeroMaskedLanes)
+	{
+		// Masked off lanes load a zeroed local variable instead, so they can't fault
+		Int zero = 0;
+		Pointer<Byte> bytes = base;
+		Int4 result;
+
+		for(int i = 0; i < 4; i++)
+		{
+			Pointer<Byte> address = IfThenElse(Extract(mask, i) != Int(0), bytes + Extract(offsets, i), Pointer<Byte>(&zero));
+			result = Insert(result, *Pointer<Int>(address, alignment), i);
+		}
+
+		return result;
+	}
+
+	RValue<Float8> Gather(RValue<Pointer<Float>> base, RValue<Int8> offsets, RValue<Int8> mask, unsigned int alignment, bool zeroMaskedLanes)
+	{
+		return combine(Gather(base, Extract4(offsets, 0), Extract4(mask, 0), alignment, zeroMaskedLanes),
+		               Gather(base, Extract4(offsets, 1), Extract4(mask, 1), alignment, zeroMaskedLanes));
+	}
+
+	RValue<Int8> Gather(RValue<Pointer<Int>> base, RValue<Int8> offsets, RValue<Int8> mask, unsigned int alignment, bool zeroMaskedLanes)
+	{
+		return combine(Gather(base, Extract4(offsets, 0), Extract4(mask, 0), alignment, zeroMaskedLanes),
+		               Gather(base, Extract4(offsets, 1), Extract4(mask, 1), alignment, zeroMaskedLanes));
+	}
+
+	RValue<Float4> MaskedLoad(RValue<Pointer<Float4>> base, RValue<Int4> mask, unsigned int alignment, bool zeroMaskedLanes)
+	{
+		return As<Float4>(Gather(Pointer<Int>(base), Int4(0, 4, 8, 12), mask, alignment, zeroMaskedLanes));
+	}
+
+	RValue<Int4> MaskedLoad(RValue<Pointer<Int4>> base, RValue<Int4> mask, unsigned int alignment, bool zeroMaskedLanes)
+	{
+		return Gather(Pointer<Int>(base), Int4(0, 4, 8, 12), mask, alignment, zeroMaskedLanes);
+	}
+
+	void MaskedStore(RValue<Pointer<Float4>> base, RValue<Float4> val, RValue<Int4> mask, unsigned int alignment)
+	{
+		MaskedStore(Pointer<Int4>(base), As<Int4>(val), mask, alignment);
+	}
+
+	void MaskedStore(RValue<Pointer<Int4>> base, RValue<Int4> val, RValue<Int4> mask, unsigned int alignment)
+	{
+		// Masked off lanes store to a local variable instead
+		Int dummy;
+		Pointer<Byte> bytes = base;
+
+		for(int i = 0; i < 4; i++)
+		{
+			Pointer<Byte> address = IfThenElse(Extract(mask, i) != Int(0), bytes + 4 * i, Pointer<Byte>(&dummy));
+			*Pointer<Int>(address, alignment) = Extract(val, i);
+		}
+	}
+
+	RValue<Float> FMA(RValue<Float> x, RValue<Float> y, RValue<Float> z)
+	{
+		return x * y + z;
+	}
+
+	RValue<Float4> FMA(RValue<Float4> x, RValue<Float4> y, RValue<Float4> z)
+	{
+		return x * y + z;
+	}
+
+	RValue<Float8> FMA(RValue<Float8> x, RValue<Float8> y, RValue<Float8> z)
+	{
+		return combine(FMA(Extract4(x, 0), Extract4(y, 0), Extract4(z, 0)), FMA(Extract4(x, 1), Extract4(y, 1), Extract4(z, 1)));
+	}
+
 	RValue<Pointer<Byte>> operator+(RValue<Pointer<Byte>> lhs, int offset)
 	{
 		return lhs + RValue<Int>(Nucleus::createConstantInt(offset));
@@ -42,6 +42,11 @@ namespace rr
 		RValue<Float4> floorps(RValue<Float4> val);
 		RValue<Float4> ceilps(RValue<Float4> val);
 
+		RValue<Int8> cvtps2dq(RValue<Float8> val);
+		RValue<Float8> maxps(RValue<Float8> x, RValue<Float8> y);
+		RValue<Float8> minps(RValue<Float8> x, RValue<Float8> y);
+		RValue<Float8> roundps(RValue<Float8> val, unsigned char imm);
+
 		RValue<Int4> pabsd(RValue<Int4> x);
 
 		RValue<Short4> paddsw(RValue<Short4> x, RValue<Short4> y);
@@ -97,6 +102,7 @@ namespace rr
 		RValue<Int4> pmaddwd(RValue<Short8> x, RValue<Short8> y);
 
 		RValue<Int> movmskps(RValue<Float4> x);
+		RValue<Int> movmskps(RValue<Float8> x);
 		RValue<Int> pmovmskb(RValue<Byte8> x);
 
 		RValue<Int4> pmovzxbd(RValue<Byte16> x);
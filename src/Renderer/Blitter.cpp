@@ -17,20 +17,55 @@
 #include "Shader/ShaderCore.hpp"
 #include "Reactor/Reactor.hpp"
 #include "Common/Memory.hpp"
+#include "Common/Thread.hpp"
 #include "Common/Debug.hpp"
 
 namespace sw
 {
 	using namespace rr;
 
+	extern AtomicInt threadCount;
+
+	static const int mipmapTileSize = 1 << MIPMAP_TILE_LEVELS;
+
+	struct Blitter::MipmapTask
+	{
+		void (*routine)(const MipmapData *data);
+		MipmapData data;
+
+		int width;    // Of the source level
+		int height;
+		int columns;
+		int tiles;
+	};
+
+	struct Blitter::ConvertTask
+	{
+		void (*routine)(void *dest, const void *source, int count);
+		unsigned char *dest;
+		const unsigned char *source;
+		int dPitchB;
+		int sPitchB;
+		int dSliceB;
+		int sSliceB;
+
+		int width;
+		int height;
+		int rows;   // Of all slices
+	};
+
 	Blitter::Blitter()
 	{
 		blitCache = new RoutineCache<State>(1024);
+		mipmapCache = new RoutineCache<State>(64);
+		convertCache = new RoutineCache<State>(64);
 	}
 
 	Blitter::~Blitter()
 	{
 		delete blitCache;
+		delete mipmapCache;
+		delete convertCache;
 	}
 
 	void Blitter::clear(void *pixel, sw::Format format, Surface *dest, const SliceRect &dRect, unsigned int rgbaMask)
@@ -102,6 +137,20 @@ namespace sw
 		}
 
 		bool useDestInternal = !dest->isExternalDirty();
+
+		if(useDestInternal && dest->getDepth() == 1)
+		{
+			if(Surface::bytes(dest->getFormat()) == 2)
+			{
+				packed = (packed & 0xFFFF) * 0x00010001;
+			}
+
+			if(dest->clearColor(packed, dRect))   // Entire tiles are only filled on first access
+			{
+				return true;
+			}
+		}
+
 		uint8_t *slice = (uint8_t*)dest->lock(dRect.x0, dRect.y0, dRect.slice, sw::LOCK_WRITEONLY, sw::PUBLIC, useDestInternal);
 
 		for(int j = 0; j < dest->getSamples(); j++)
@@ -221,6 +270,177 @@ namespace sw
 		dest->unlockInternal();
 	}
 
+	int Blitter::generateMipmaps(Surface *const *levels, int count, int slice)
+	{
+		Surface *base = levels[0];
+		Format format = base->getInternalFormat();
+
+		if(Surface::isNonNormalizedInteger(format) || Surface::isDepth(format) || Surface::isStencil(format) ||
+		   Surface::hasQuadLayout(format) || base->getSamples() > 1)
+		{
+			return 0;
+		}
+
+		// Halving even dimensions is a 2x2 box filter, which equals a bilinear blit. Other levels are left to blit().
+		int generated = 0;
+
+		while(generated + 1 < count && generated + 1 < MIPMAP_LEVELS)
+		{
+			Surface *source = levels[generated];
+			Surface *dest = levels[generated + 1];
+
+			if(!dest || dest->getInternalFormat() != format || dest->getSamples() > 1 || dest->getDepth() != base->getDepth() ||
+			   (source->getWidth() & 1) != 0 || (source->getHeight() & 1) != 0 ||
+			   dest->getWidth() != source->getWidth() / 2 || dest->getHeight() != source->getHeight() / 2)
+			{
+				break;
+			}
+
+			generated++;
+		}
+
+		if(generated == 0)
+		{
+			return 0;
+		}
+
+		State state(Options(true, false, true));
+		state.sourceFormat = format;
+		state.destFormat = format;
+		state.destSamples = 1;
+
+		criticalSection.lock();
+		Routine *mipmapRoutine = mipmapCache->query(state);
+
+		if(!mipmapRoutine)
+		{
+			mipmapRoutine = generateMipmapRoutine(state);
+
+			if(!mipmapRoutine)
+			{
+				criticalSection.unlock();
+				return 0;
+			}
+
+			mipmapCache->add(state, mipmapRoutine);
+		}
+
+		criticalSection.unlock();
+
+		MipmapTask task;
+		task.routine = (void(*)(const MipmapData*))mipmapRoutine->getEntry();
+
+		void *buffer[MIPMAP_LEVELS];
+		bool layered = base->getDepth() > 1;   // Other layers must be preserved
+
+		for(int level = 0; level <= generated; level++)
+		{
+			Lock lock = (level == 0) ? LOCK_READONLY : (layered ? LOCK_WRITEONLY : LOCK_DISCARD);
+			buffer[level] = levels[level]->lockInternal(0, 0, slice, lock, PUBLIC);
+		}
+
+		// Each pass computes up to MIPMAP_TILE_LEVELS levels one source tile at a time, while the tile and
+		// the smaller levels derived from it are still in the cache. Tiles are distributed over threads.
+		for(int first = 0; first < generated; first += MIPMAP_TILE_LEVELS)
+		{
+			task.data.source = buffer[first];
+			task.data.sPitchB = levels[first]->getInternalPitchB();
+			task.data.levels = min(generated - first, (int)MIPMAP_TILE_LEVELS);
+
+			for(int level = 0; level < task.data.levels; level++)
+			{
+				task.data.dest[level] = buffer[first + 1 + level];
+				task.data.dPitchB[level] = levels[first + 1 + level]->getInternalPitchB();
+			}
+
+			task.width = levels[first]->getWidth();
+			task.height = levels[first]->getHeight();
+			task.columns = (task.width + mipmapTileSize - 1) / mipmapTileSize;
+			task.tiles = task.columns * ((task.height + mipmapTileSize - 1) / mipmapTileSize);
+
+			parallelRows(task.tiles, min((int)threadCount, task.tiles / 16), mipmapTile, &task);
+		}
+
+		for(int level = 0; level <= generated; level++)
+		{
+			levels[level]->unlockInternal();
+		}
+
+		return generated;
+	}
+
+	bool Blitter::convert(void *dest, Format destFormat, int dPitchB, int dSliceB, const void *source, Format sourceFormat, int sPitchB, int sSliceB, int width, int height, int depth)
+	{
+		// Depth and stencil values have their own conversion rules, and quad layouts are not stored row by row
+		if(Surface::isDepth(sourceFormat) || Surface::isStencil(sourceFormat) || Surface::hasQuadLayout(sourceFormat) ||
+		   Surface::isDepth(destFormat) || Surface::isStencil(destFormat) || Surface::hasQuadLayout(destFormat))
+		{
+			return false;
+		}
+
+		State state(Options(false, false, false));
+		state.sourceFormat = sourceFormat;
+		state.destFormat = destFormat;
+		state.destSamples = 1;
+
+		criticalSection.lock();
+		Routine *convertRoutine = convertCache->query(state);
+
+		if(!convertRoutine)
+		{
+			convertRoutine = generateConvertRoutine(state);
+
+			if(!convertRoutine)
+			{
+				criticalSection.unlock();
+				return false;
+			}
+
+			convertCache->add(state, convertRoutine);
+		}
+
+		criticalSection.unlock();
+
+		ConvertTask task;
+		task.routine = (void(*)(void*, const void*, int))convertRoutine->getEntry();
+		task.dest = static_cast<unsigned char*>(dest);
+		task.source = static_cast<const unsigned char*>(source);
+		task.dPitchB = dPitchB;
+		task.sPitchB = sPitchB;
+		task.dSliceB = dSliceB;
+		task.sSliceB = sSliceB;
+		task.width = width;
+		task.height = height;
+		task.rows = height * depth;
+
+		parallelRows(task.rows, min((int)threadCount, task.rows * width / 0x10000), convertRow, &task);
+
+		return true;
+	}
+
+	void Blitter::convertRow(void *parameters, int row)
+	{
+		const ConvertTask *task = static_cast<const ConvertTask*>(parameters);
+
+		int slice = row / task->height;
+		int y = row % task->height;
+
+		task->routine(task->dest + slice * task->dSliceB + y * task->dPitchB, task->source + slice * task->sSliceB + y * task->sPitchB, task->width);
+	}
+
+	void Blitter::mipmapTile(void *parameters, int tile)
+	{
+		const MipmapTask *task = static_cast<const MipmapTask*>(parameters);
+		MipmapData data = task->data;
+
+		data.x0 = (tile % task->columns) * mipmapTileSize;
+		data.y0 = (tile / task->columns) * mipmapTileSize;
+		data.x1 = min(data.x0 + mipmapTileSize, task->width);
+		data.y1 = min(data.y0 + mipmapTileSize, task->height);
+
+		task->routine(&data);
+	}
+
 	bool Blitter::read(Float4 &c, Pointer<Byte> element, const State &state)
 	{
 		c = Float4(0.0f, 0.0f, 0.0f, 1.0f);
@@ -375,11 +595,48 @@ namespace sw
 		case FORMAT_R32F:
 			c.x = *Pointer<Float>(element);
 			break;
+		case FORMAT_A16B16G16R16F:
+			c.w = Float(*Pointer<Half>(element + 6));
+		case FORMAT_X16B16G16R16F:
+		case FORMAT_X16B16G16R16F_UNSIGNED:
+		case FORMAT_B16G16R16F:
+			c.z = Float(*Pointer<Half>(element + 4));
+		case FORMAT_G16R16F:
+			c.y = Float(*Pointer<Half>(element + 2));
+		case FORMAT_R16F:
+			c.x = Float(*Pointer<Half>(element));
+			break;
 		case FORMAT_R5G6B5:
 			c.x = Float(Int((*Pointer<UShort>(element) & UShort(0xF800)) >> UShort(11)));
 			c.y = Float(Int((*Pointer<UShort>(element) & UShort(0x07E0)) >> UShort(5)));
 			c.z = Float(Int(*Pointer<UShort>(element) & UShort(0x001F)));
 			break;
+		case FORMAT_A1R5G5B5:
+			c.w = Float(Int((*Pointer<UShort>(element) & UShort(0x8000)) >> UShort(15)));
+		case FORMAT_X1R5G5B5:
+			c.x = Float(Int((*Pointer<UShort>(element) & UShort(0x7C00)) >> UShort(10)));
+			c.y = Float(Int((*Pointer<UShort>(element) & UShort(0x03E0)) >> UShort(5)));
+			c.z = Float(Int(*Pointer<UShort>(element) & UShort(0x001F)));
+			break;
+		case FORMAT_R5G5B5A1:
+			c.x = Float(Int((*Pointer<UShort>(element) & UShort(0xF800)) >> UShort(11)));
+			c.y = Float(Int((*Pointer<UShort>(element) & UShort(0x07C0)) >> UShort(6)));
+			c.z = Float(Int((*Pointer<UShort>(element) & UShort(0x003E)) >> UShort(1)));
+			c.w = Float(Int(*Pointer<UShort>(element) & UShort(0x0001)));
+			break;
+		case FORMAT_A4R4G4B4:
+			c.w = Float(Int((*Pointer<UShort>(element) & UShort(0xF000)) >> UShort(12)));
+		case FORMAT_X4R4G4B4:
+			c.x = Float(Int((*Pointer<UShort>(element) & UShort(0x0F00)) >> UShort(8)));
+			c.y = Float(Int((*Pointer<UShort>(element) & UShort(0x00F0)) >> UShort(4)));
+			c.z = Float(Int(*Pointer<UShort>(element) & UShort(0x000F)));
+			break;
+		case FORMAT_R4G4B4A4:
+			c.x = Float(Int((*Pointer<UShort>(element) & UShort(0xF000)) >> UShort(12)));
+			c.y = Float(Int((*Pointer<UShort>(element) & UShort(0x0F00)) >> UShort(8)));
+			c.z = Float(Int((*Pointer<UShort>(element) & UShort(0x00F0)) >> UShort(4)));
+			c.w = Float(Int(*Pointer<UShort>(element) & UShort(0x000F)));
+			break;
 		case FORMAT_A2B10G10R10:
 		case FORMAT_A2B10G10R10UI:
 			c.x = Float(Int((*Pointer<UInt>(element) & UInt(0x000003FF))));
@@ -387,6 +644,12 @@ namespace sw
 			c.z = Float(Int((*Pointer<UInt>(element) & UInt(0x3FF00000)) >> 20));
 			c.w = Float(Int((*Pointer<UInt>(element) & UInt(0xC0000000)) >> 30));
 			break;
+		case FORMAT_A2R10G10B10:
+			c.x = Float(Int((*Pointer<UInt>(element) & UInt(0x3FF00000)) >> 20));
+			c.y = Float(Int((*Pointer<UInt>(element) & UInt(0x000FFC00)) >> 10));
+			c.z = Float(Int((*Pointer<UInt>(element) & UInt(0x000003FF))));
+			c.w = Float(Int((*Pointer<UInt>(element) & UInt(0xC0000000)) >> 30));
+			break;
 		case FORMAT_D16:
 			c.x = Float(Int((*Pointer<UShort>(element))));
 			break;
@@ -1042,12 +1305,31 @@ namespace sw
 		case FORMAT_G32R32F:
 		case FORMAT_R32F:
 		case FORMAT_A2B10G10R10UI:
+		case FORMAT_A16B16G16R16F:
+		case FORMAT_X16B16G16R16F:
+		case FORMAT_X16B16G16R16F_UNSIGNED:
+		case FORMAT_B16G16R16F:
+		case FORMAT_G16R16F:
+		case FORMAT_R16F:
 			scale = vector(1.0f, 1.0f, 1.0f, 1.0f);
 			break;
 		case FORMAT_R5G6B5:
 			scale = vector(0x1F, 0x3F, 0x1F, 1.0f);
 			break;
+		case FORMAT_X1R5G5B5:
+		case FORMAT_A1R5G5B5:
+		case FORMAT_R5G5B5A1:
+			scale = vector(0x1F, 0x1F, 0x1F, 1.0f);
+			break;
+		case FORMAT_X4R4G4B4:
+			scale = vector(0xF, 0xF, 0xF, 1.0f);
+			break;
+		case FORMAT_A4R4G4B4:
+		case FORMAT_R4G4B4A4:
+			scale = vector(0xF, 0xF, 0xF, 0xF);
+			break;
 		case FORMAT_A2B10G10R10:
+		case FORMAT_A2R10G10B10:
 			scale = vector(0x3FF, 0x3FF, 0x3FF, 0x03);
 			break;
 		case FORMAT_D16:
@@ -1388,6 +1670,119 @@ namespace sw
 		return function("BlitRoutine");
 	}
 
+	Routine *Blitter::generateMipmapRoutine(const State &state)
+	{
+		Function<Void(Pointer<Byte>)> function;
+		{
+			Pointer<Byte> data(function.Arg<0>());
+
+			Pointer<Byte> source = *Pointer<Pointer<Byte>>(data + OFFSET(MipmapData,source));
+			Int sPitchB = *Pointer<Int>(data + OFFSET(MipmapData,sPitchB));
+			Int levels = *Pointer<Int>(data + OFFSET(MipmapData,levels));
+
+			Int x0 = *Pointer<Int>(data + OFFSET(MipmapData,x0));
+			Int y0 = *Pointer<Int>(data + OFFSET(MipmapData,y0));
+			Int x1 = *Pointer<Int>(data + OFFSET(MipmapData,x1));
+			Int y1 = *Pointer<Int>(data + OFFSET(MipmapData,y1));
+
+			int bytes = Surface::bytes(state.sourceFormat);
+			bool sRGB = state.convertSRGB && Surface::isSRGBformat(state.sourceFormat);
+
+			For(Int level = 0, level < levels, level++)
+			{
+				Pointer<Byte> dest = *Pointer<Pointer<Byte>>(data + OFFSET(MipmapData,dest) + level * Int(sizeof(void*)));
+				Int dPitchB = *Pointer<Int>(data + OFFSET(MipmapData,dPitchB) + level * Int(sizeof(int)));
+
+				x0 = x0 >> 1;
+				y0 = y0 >> 1;
+				x1 = x1 >> 1;
+				y1 = y1 >> 1;
+
+				For(Int j = y0, j < y1, j++)
+				{
+					Pointer<Byte> s0 = source + (j * 2) * sPitchB;
+					Pointer<Byte> s1 = s0 + sPitchB;
+					Pointer<Byte> d = dest + j * dPitchB;
+
+					For(Int i = x0, i < x1, i++)
+					{
+						Float4 c00; if(!read(c00, s0 + i * (2 * bytes), state)) return nullptr;
+						Float4 c01; if(!read(c01, s0 + i * (2 * bytes) + bytes, state)) return nullptr;
+						Float4 c10; if(!read(c10, s1 + i * (2 * bytes), state)) return nullptr;
+						Float4 c11; if(!read(c11, s1 + i * (2 * bytes) + bytes, state)) return nullptr;
+
+						if(sRGB)   // sRGB -> RGB
+						{
+							if(!ApplyScaleAndClamp(c00, state)) return nullptr;
+							if(!ApplyScaleAndClamp(c01, state)) return nullptr;
+							if(!ApplyScaleAndClamp(c10, state)) return nullptr;
+							if(!ApplyScaleAndClamp(c11, state)) return nullptr;
+						}
+
+						// Same rounding as bilinear filtering at the center of the four texels
+						Float4 color = ((c00 + c01) + (c10 + c11)) * Float4(0.25f);
+
+						if(!ApplyScaleAndClamp(color, state, sRGB))
+						{
+							return nullptr;
+						}
+
+						if(!write(color, d + i * bytes, state))
+						{
+							return nullptr;
+						}
+					}
+				}
+
+				source = dest;
+				sPitchB = dPitchB;
+			}
+		}
+
+		return function("MipmapRoutine");
+	}
+
+	Routine *Blitter::generateConvertRoutine(const State &state)
+	{
+		Function<Void(Pointer<Byte>, Pointer<Byte>, Int)> function;
+		{
+			Pointer<Byte> dest(function.Arg<0>());
+			Pointer<Byte> source(function.Arg<1>());
+			Int count(function.Arg<2>());
+
+			bool intBoth = Surface::isNonNormalizedInteger(state.sourceFormat) && Surface::isNonNormalizedInteger(state.destFormat);
+			int srcBytes = Surface::bytes(state.sourceFormat);
+			int dstBytes = Surface::bytes(state.destFormat);
+
+			For(Int i = 0, i < count, i++)
+			{
+				if(intBoth)
+				{
+					Int4 color;
+
+					if(!read(color, source, state) || !write(color, dest, state))
+					{
+						return nullptr;
+					}
+				}
+				else
+				{
+					Float4 color;
+
+					if(!read(color, source, state) || !ApplyScaleAndClamp(color, state) || !write(color, dest, state))
+					{
+						return nullptr;
+					}
+				}
+
+				source += srcBytes;
+				dest += dstBytes;
+			}
+		}
+
+		return function("ConvertRoutine");
+	}
+
 	bool Blitter::blitReactor(Surface *source, const SliceRectF &sourceRect, Surface *dest, const SliceRect &destRect, const Blitter::Options &options)
 	{
 		ASSERT(!options.clearOperation || ((source->getWidth() == 1) && (source->getHeight() == 1) && (source->getDepth() == 1)));
@@ -90,6 +90,24 @@ namespace sw
 			int sHeight;
 		};
 
+		struct MipmapData
+		{
+			void *source;
+			int sPitchB;
+			void *dest[MIPMAP_TILE_LEVELS];
+			int dPitchB[MIPMAP_TILE_LEVELS];
+			int levels;
+
+			// Tile bounds, in source level texels
+			int x0;
+			int y0;
+			int x1;
+			int y1;
+		};
+
+		struct MipmapTask;
+		struct ConvertTask;
+
 	public:
 		Blitter();
 		virtual ~Blitter();
@@ -97,6 +115,8 @@ namespace sw
 		void clear(void *pixel, sw::Format format, Surface *dest, const SliceRect &dRect, unsigned int rgbaMask);
 		void blit(Surface *source, const SliceRectF &sRect, Surface *dest, const SliceRect &dRect, const Options &options);
 		void blit3D(Surface *source, Surface *dest);
+		int generateMipmaps(Surface *const *levels, int count, int slice = 0);   // Returns the number of levels written after the first
+		bool convert(void *dest, Format destFormat, int dPitchB, int dSliceB, const void *source, Format sourceFormat, int sPitchB, int sSliceB, int width, int height, int depth);   // Returns false for unsupported formats
 
 	private:
 		bool fastClear(void *pixel, sw::Format format, Surface *dest, const SliceRect &dRect, unsigned int rgbaMask);
@@ -112,8 +132,14 @@ namespace sw
 		static Float4 sRGBtoLinear(Float4 &color);
 		bool blitReactor(Surface *source, const SliceRectF &sRect, Surface *dest, const SliceRect &dRect, const Options &options);
 		Routine *generate(const State &state);
+		Routine *generateMipmapRoutine(const State &state);
+		Routine *generateConvertRoutine(const State &state);
+		static void mipmapTile(void *parameters, int tile);
+		static void convertRow(void *parameters, int row);
 
 		RoutineCache<State> *blitCache;
+		RoutineCache<State> *mipmapCache;
+		RoutineCache<State> *convertCache;
 		MutexLock criticalSection;
 	};
 }
@@ -1037,6 +1037,19 @@ namespace sw
 		state.multiSample = context->getMultiSampleCount();
 		state.multiSampleMask = context->multiSampleMask;
 
+		if(state.depthTestActive && state.multiSample == 1 && context->depthBuffer->getHiZPitchB() != 0)
+		{
+			// With a less-than comparison depth writes can only decrease the stored values,
+			// so the maximum depth per tile remains a conservative bound.
+			bool lessCompare = (state.depthCompareMode == DEPTH_LESS) || (state.depthCompareMode == DEPTH_LESSEQUAL);
+			bool nonIncreasing = lessCompare || (state.depthCompareMode == DEPTH_EQUAL) || (state.depthCompareMode == DEPTH_NEVER);
+
+			state.hiZTest = lessCompare && !state.depthOverride && !state.stencilActive;
+			state.hiZTighten = lessCompare && state.depthWriteEnable && !state.depthOverride && !state.stencilActive &&
+			                   !state.alphaTestActive() && !state.shaderContainsKill && (state.multiSampleMask & 1);
+			state.hiZRaise = state.depthWriteEnable && !nonIncreasing;
+		}
+
 		if(state.multiSample > 1 && context->pixelShader)
 		{
 			state.centroid = context->pixelShader->containsCentroid();
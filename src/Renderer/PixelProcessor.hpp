@@ -60,6 +60,9 @@ namespace sw
 			bool stencilWriteMaskedCCW                : 1;
 
 			bool depthTestActive                      : 1;
+			bool hiZTest                              : 1;   // Reject tiles whose minimum depth fails against their maximum stored depth
+			bool hiZTighten                           : 1;   // Lower the maximum stored depth of fully covered tiles
+			bool hiZRaise                             : 1;   // Depth writes may increase the stored depth
 			bool fogActive                            : 1;
 			FogMode pixelFogMode                      : BITS(FOG_LAST);
 			bool specularAdd                          : 1;
@@ -20,6 +20,8 @@
 #include "Common/Math.hpp"
 #include "Common/Debug.hpp"
 
+#include <float.h>
+
 namespace sw
 {
 	extern bool veryEarlyDepthTest;
@@ -95,6 +97,7 @@ namespace sw
 		Pointer<Byte> cBuffer[RENDERTARGETS];
 		Pointer<Byte> zBuffer;
 		Pointer<Byte> sBuffer;
+		Pointer<Byte> hiZBuffer;
 
 		for(int index = 0; index < RENDERTARGETS; index++)
 		{
@@ -114,6 +117,11 @@ namespace sw
 			sBuffer = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,stencilBuffer)) + yMin * *Pointer<Int>(data + OFFSET(DrawData,stencilPitchB));
 		}
 
+		if(hiZActive())
+		{
+			hiZBuffer = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,hiZBuffer)) + (yMin >> 1) * *Pointer<Int>(data + OFFSET(DrawData,hiZPitchB));
+		}
+
 		Int y = yMin;
 
 		Do
@@ -276,18 +284,76 @@ namespace sw
 					xRight[q] = Swizzle(xRight[q], 0xF5) - Short4(0, 1, 0, 1);
 				}
 
-				For(Int x = x0, x < x1, x += 2)
+				if(!hiZActive())
 				{
-					Short4 xxxx = Short4(x);
-					Int cMask[4];
-
-					for(unsigned int q = 0; q < state.multiSample; q++)
+					For(Int x = x0, x < x1, x += 2)
 					{
-						Short4 mask = CmpGT(xxxx, xLeft[q]) & CmpGT(xRight[q], xxxx);
-						cMask[q] = SignMask(PackSigned(mask, mask)) & 0x0000000F;
+						coverQuad(cBuffer, zBuffer, sBuffer, xLeft, xRight, x, y);
 					}
+				}
+				else   // Process the span one hierarchical depth tile at a time
+				{
+					Int tileX = x0;
+
+					Do
+					{
+						Int tileStart = tileX & -HIZ_TILE_WIDTH;
+						Int tileEnd = Min(tileStart + HIZ_TILE_WIDTH, x1);
+						Pointer<Float> tileMax = Pointer<Float>(hiZBuffer + (tileStart / HIZ_TILE_WIDTH) * sizeof(float));
+
+						// The depth plane is linear, so its extremes over the tile lie at the outer quads
+						Float4 xFirst = Float4(Float(tileStart)) + *Pointer<Float4>(primitive + OFFSET(Primitive,xQuad), 16);
+						Float4 xLast = Float4(Float((tileEnd - 1) & 0xFFFFFFFE)) + *Pointer<Float4>(primitive + OFFSET(Primitive,xQuad), 16);
+						Float4 zFirst = interpolate(xFirst, Dz[0], zFirst, primitive + OFFSET(Primitive,z), false, false, state.depthClamp);
+						Float4 zLast = interpolate(xLast, Dz[0], zLast, primitive + OFFSET(Primitive,z), false, false, state.depthClamp);
+
+						Float4 zMin = Min(zFirst, zLast);
+						zMin = Min(zMin, Swizzle(zMin, 0x4E));
+						zMin = Min(zMin, Swizzle(zMin, 0xB1));
+
+						Float4 zMax = Max(zFirst, zLast);
+						zMax = Max(zMax, Swizzle(zMax, 0x4E));
+						zMax = Max(zMax, Swizzle(zMax, 0xB1));
+
+						Bool rejected = false;
+
+						if(state.hiZTest)
+						{
+							rejected = Extract(zMin, 0) > *tileMax;
+						}
+
+						If(!rejected)
+						{
+							For(Int x = tileX, x < tileEnd, x += 2)
+							{
+								coverQuad(cBuffer, zBuffer, sBuffer, xLeft, xRight, x, y);
+							}
 
-					quad(cBuffer, zBuffer, sBuffer, cMask, x, y);
+							if(state.hiZTighten)
+							{
+								// Every pixel of a fully covered tile either passed the test and stored its depth, or already had a smaller one
+								If(y + 2 <= yMax && Max(x0a, x0b) <= tileStart && tileStart + HIZ_TILE_WIDTH <= Min(x1a, x1b))
+								{
+									*tileMax = Min(*tileMax, Extract(zMax, 0));
+								}
+							}
+
+							if(state.hiZRaise)
+							{
+								if(state.depthOverride)
+								{
+									*tileMax = Float(FLT_MAX);
+								}
+								else
+								{
+									*tileMax = Max(*tileMax, Extract(zMax, 0));
+								}
+							}
+						}
+
+						tileX = tileEnd;
+					}
+					Until(tileX >= x1)
 				}
 			}
 
@@ -311,11 +377,30 @@ namespace sw
 				sBuffer += *Pointer<Int>(data + OFFSET(DrawData,stencilPitchB)) << (1 + sw::log2(clusterCount));   // FIXME: Precompute
 			}
 
+			if(hiZActive())
+			{
+				hiZBuffer += *Pointer<Int>(data + OFFSET(DrawData,hiZPitchB)) << sw::log2(clusterCount);
+			}
+
 			y += 2 * clusterCount;
 		}
 		Until(y >= yMax)
 	}
 
+	void QuadRasterizer::coverQuad(Pointer<Byte> cBuffer[4], Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Short4 xLeft[4], Short4 xRight[4], Int &x, Int &y)
+	{
+		Short4 xxxx = Short4(x);
+		Int cMask[4];
+
+		for(unsigned int q = 0; q < state.multiSample; q++)
+		{
+			Short4 mask = CmpGT(xxxx, xLeft[q]) & CmpGT(xRight[q], xxxx);
+			cMask[q] = SignMask(PackSigned(mask, mask)) & 0x0000000F;
+		}
+
+		quad(cBuffer, zBuffer, sBuffer, cMask, x, y);
+	}
+
 	Float4 QuadRasterizer::interpolate(Float4 &x, Float4 &D, Float4 &rhw, Pointer<Byte> planeEquation, bool flat, bool perspective, bool clamp)
 	{
 		Float4 interpolant = D;
@@ -347,4 +432,9 @@ namespace sw
 	{
 		return state.perspective || (shader && shader->isVPosDeclared() && fullPixelPositionRegister);
 	}
+
+	bool QuadRasterizer::hiZActive() const
+	{
+		return state.hiZTest || state.hiZTighten || state.hiZRaise;
+	}
 }
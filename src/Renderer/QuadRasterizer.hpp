@@ -48,6 +48,7 @@ namespace sw
 
 		bool interpolateZ() const;
 		bool interpolateW() const;
+		bool hiZActive() const;
 		Float4 interpolate(Float4 &x, Float4 &D, Float4 &rhw, Pointer<Byte> planeEquation, bool flat, bool perspective, bool clamp);
 
 		const PixelProcessor::State &state;
@@ -55,6 +56,7 @@ namespace sw
 
 	private:
 		void rasterize(Int &yMin, Int &yMax);
+		void coverQuad(Pointer<Byte> cBuffer[4], Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Short4 xLeft[4], Short4 xRight[4], Int &x, Int &y);
 	};
 }
 
@@ -31,6 +31,8 @@
 #include "Common/Timer.hpp"
 #include "Common/Debug.hpp"
 
+#include <limits.h>
+
 #undef max
 
 bool disableServer = true;
@@ -210,6 +212,7 @@ namespace sw
 	Renderer::~Renderer()
 	{
 		sync->destruct();
+		terminateThreads();   // Workers may still be setting up primitives with the clipper
 
 		delete clipper;
 		clipper = nullptr;
@@ -217,7 +220,6 @@ namespace sw
 		delete blitter;
 		blitter = nullptr;
 
-		terminateThreads();
 		delete resumeApp;
 
 		for(int draw = 0; draw < DRAW_COUNT; draw++)
@@ -511,6 +513,8 @@ namespace sw
 				}
 			}
 
+			Surface::nextDecodeEpoch();   // Textures are locked by the draw now
+
 			if(pixelState.stencilActive)
 			{
 				data->stencil[0] = stencil;
@@ -637,6 +641,8 @@ namespace sw
 
 			// Target
 			{
+				draw->clearedTiles = false;
+
 				for(int index = 0; index < RENDERTARGETS; index++)
 				{
 					draw->renderTarget[index] = context->renderTarget[index];
@@ -649,6 +655,7 @@ namespace sw
 						data->colorBuffer[index] += q * ms * context->renderTarget[index]->getSliceB(true);
 						data->colorPitchB[index] = context->renderTarget[index]->getInternalPitchB();
 						data->colorSliceB[index] = context->renderTarget[index]->getInternalSliceB();
+						draw->clearedTiles = draw->clearedTiles || draw->renderTarget[index]->hasClearedTiles();
 					}
 				}
 
@@ -663,6 +670,9 @@ namespace sw
 					data->depthBuffer += q * ms * context->depthBuffer->getSliceB(true);
 					data->depthPitchB = context->depthBuffer->getInternalPitchB();
 					data->depthSliceB = context->depthBuffer->getInternalSliceB();
+					data->hiZBuffer = context->depthBuffer->getHiZ(layer);
+					data->hiZPitchB = context->depthBuffer->getHiZPitchB();
+					draw->clearedTiles = draw->clearedTiles || draw->depthBuffer->hasClearedTiles();
 				}
 
 				if(draw->stencilBuffer)
@@ -673,6 +683,7 @@ namespace sw
 					data->stencilBuffer += q * ms * context->stencilBuffer->getSliceB(true);
 					data->stencilPitchB = context->stencilBuffer->getStencilPitchB();
 					data->stencilSliceB = context->stencilBuffer->getStencilSliceB();
+					draw->clearedTiles = draw->clearedTiles || draw->stencilBuffer->hasClearedTiles();
 				}
 			}
 
@@ -738,6 +749,11 @@ namespace sw
 		blitter->blit3D(source, dest);
 	}
 
+	int Renderer::generateMipmaps(Surface *const *levels, int count, int slice)
+	{
+		return blitter->generateMipmaps(levels, count, slice);
+	}
+
 	void Renderer::threadFunction(void *parameters)
 	{
 		Renderer *renderer = static_cast<Parameters*>(parameters)->renderer;
@@ -932,6 +948,11 @@ namespace sw
 					visible = (this->*setupPrimitives)(unit, count);
 				}
 
+				if(draw->clearedTiles)
+				{
+					fillClearedTiles(draw, primitiveBatch[unit], visible);
+				}
+
 				primitiveProgress[unit].visible = visible;
 				primitiveProgress[unit].references = clusterCount;
 
@@ -1114,6 +1135,55 @@ namespace sw
 		pixelProgress[cluster].executing = false;
 	}
 
+	void Renderer::fillClearedTiles(const DrawCall *draw, const Primitive *primitive, int count)
+	{
+		int multiSample = draw->setupState.multiSample;
+
+		for(int i = 0; i < count; i++, primitive += multiSample)
+		{
+			int x0 = INT_MAX;
+			int x1 = 0;
+
+			for(int q = 0; q < multiSample; q++)
+			{
+				for(int y = primitive->yMin; y < primitive->yMax; y++)
+				{
+					const Primitive::Span &span = primitive[q].outline[y];
+
+					if(span.right > span.left)
+					{
+						x0 = min(x0, (int)span.left);
+						x1 = max(x1, (int)span.right);
+					}
+				}
+			}
+
+			if(x0 >= x1)
+			{
+				continue;
+			}
+
+			// Tiles have even bounds, so they contain the entire quads which the pixel routine accesses
+			for(int index = 0; index < RENDERTARGETS; index++)
+			{
+				if(draw->renderTarget[index])
+				{
+					draw->renderTarget[index]->fillClearedTiles(x0, primitive->yMin, x1, primitive->yMax);
+				}
+			}
+
+			if(draw->depthBuffer)
+			{
+				draw->depthBuffer->fillClearedTiles(x0, primitive->yMin, x1, primitive->yMax);
+			}
+
+			if(draw->stencilBuffer && draw->stencilBuffer != draw->depthBuffer)
+			{
+				draw->stencilBuffer->fillClearedTiles(x0, primitive->yMin, x1, primitive->yMax);
+			}
+		}
+	}
+
 	void Renderer::processPrimitiveVertices(int unit, unsigned int start, unsigned int triangleCount, unsigned int loop, int thread)
 	{
 		Triangle *triangle = triangleBatch[unit];
@@ -2772,6 +2842,7 @@ namespace sw
 			VertexProcessor::setRoutineCacheSize(configuration.vertexRoutineCacheSize);
 			PixelProcessor::setRoutineCacheSize(configuration.pixelRoutineCacheSize);
 			SetupProcessor::setRoutineCacheSize(configuration.setupRoutineCacheSize);
+			Surface::setDecodeCacheSize((size_t)configuration.decodeCacheSize << 20);
 
 			switch(configuration.textureSampleQuality)
 			{
@@ -196,6 +196,8 @@ namespace sw
 		float *depthBuffer;
 		int depthPitchB;
 		int depthSliceB;
+		float *hiZBuffer;
+		int hiZPitchB;
 		unsigned char *stencilBuffer;
 		int stencilPitchB;
 		int stencilSliceB;
@@ -284,6 +286,7 @@ namespace sw
 		void clear(void *value, Format format, Surface *dest, const Rect &rect, unsigned int rgbaMask);
 		void blit(Surface *source, const SliceRectF &sRect, Surface *dest, const SliceRect &dRect, bool filter, bool isStencil = false, bool sRGBconversion = true);
 		void blit3D(Surface *source, Surface *dest);
+		int generateMipmaps(Surface *const *levels, int count, int slice = 0);
 
 		void setIndexBuffer(Resource *indexBuffer);
 
@@ -374,6 +377,7 @@ namespace sw
 		void finishRendering(Task &pixelTask);
 
 		void processPrimitiveVertices(int unit, unsigned int start, unsigned int count, unsigned int loop, int thread);
+		static void fillClearedTiles(const DrawCall *draw, const Primitive *primitive, int count);
 
 		int setupSolidTriangles(int batch, int count);
 		int setupWireframeTriangle(int batch, int count);
@@ -489,6 +493,7 @@ namespace sw
 		Surface *renderTarget[RENDERTARGETS];
 		Surface *depthBuffer;
 		Surface *stencilBuffer;
+		bool clearedTiles;   // Some targets have deferred clears, to be filled before their first use
 		Resource *texture[TOTAL_IMAGE_UNITS];
 		Resource* pUniformBuffers[MAX_UNIFORM_BUFFER_BINDINGS];
 		Resource* vUniformBuffers[MAX_UNIFORM_BUFFER_BINDINGS];
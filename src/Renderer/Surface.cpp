@@ -14,6 +14,7 @@
 
 #include "Surface.hpp"
 
+#include "Blitter.hpp"
 #include "Color.hpp"
 #include "Context.hpp"
 #include "ETC_Decoder.hpp"
@@ -22,9 +23,12 @@
 #include "Common/Memory.hpp"
 #include "Common/CPUID.hpp"
 #include "Common/Resource.hpp"
+#include "Common/Thread.hpp"
 #include "Common/Debug.hpp"
 #include "Reactor/Reactor.hpp"
 
+#include <float.h>
+
 #if defined(__i386__) || defined(__x86_64__)
 	#include <xmmintrin.h>
 	#include <emmintrin.h>
@@ -38,10 +42,84 @@ namespace sw
 	extern bool quadLayoutEnabled;
 	extern bool complementaryDepthBuffer;
 	extern TranscendentalPrecision logPrecision;
+	extern AtomicInt threadCount;
 
 	unsigned int *Surface::palette = 0;
 	unsigned int Surface::paletteID = 0;
 
+	struct Surface::DecodeTask
+	{
+		BlockDecoder decoder;
+		const Buffer *internal;
+		byte *dest;
+		const byte *source;
+		int blockRowB;
+		int width;
+		int rowsPerLayer;   // Of blocks
+		int rows;
+	};
+
+	struct Surface::ResolveTask
+	{
+		const Buffer *buffer;
+		unsigned char *source;
+		int bandsPerLayer;
+		int rowsPerBand;
+		int bands;
+	};
+
+	namespace
+	{
+		// 16-bit and 8-bit linear intensities of 8-bit sRGB values, and the inverse mapping
+		struct SRGBTables
+		{
+			SRGBTables()
+			{
+				for(int i = 0; i < 256; i++)
+				{
+					toLinear[i] = (unsigned short)(sRGBtoLinear(i / 255.0f) * 65535.0f + 0.5f);
+					toLinear8[i] = (unsigned char)(sRGBtoLinear(i / 255.0f) * 255.0f + 0.5f);
+				}
+
+				for(int i = 0; i < 65536; i++)
+				{
+					toSRGB[i] = (unsigned char)(linearToSRGB(i / 65535.0f) * 255.0f + 0.5f);
+				}
+			}
+
+			unsigned short toLinear[256];
+			unsigned char toLinear8[256];
+			unsigned char toSRGB[65536];
+		};
+
+		const SRGBTables &sRGBTables()
+		{
+			static const SRGBTables tables;
+
+			return tables;
+		}
+
+		// Compressed surfaces keep their blocks, so their decoded levels can be released under memory pressure
+		MutexLock decodeCacheMutex;
+		size_t decodeCacheSize = 0;
+		size_t decodedBytes = 0;
+		Surface *decodedHead = nullptr;
+		Surface *decodedTail = nullptr;
+		AtomicInt decodeEpoch;
+
+		// Surfaces sharing memory owned by another resource, such as a pixel unpack buffer
+		MutexLock adoptMutex;
+		Surface *adoptersHead = nullptr;
+
+		// Generates and caches the routines for buffer format conversions
+		Blitter &converter()
+		{
+			static Blitter *blitter = new Blitter();   // Not destroyed at exit, when its routines' memory may already be gone
+
+			return *blitter;
+		}
+	}
+
 	void Surface::Buffer::write(int x, int y, int z, const Color<float> &color)
 	{
 		ASSERT((x >= -border) && (x < (width + border)));
@@ -1274,6 +1352,9 @@ namespace sw
 		external.border = 0;
 		external.lock = LOCK_UNLOCKED;
 		external.dirty = true;
+		external.tileState = nullptr;
+		external.tileValue = nullptr;
+		external.clearedTiles = 0;
 
 		internal.buffer = nullptr;
 		internal.width = width;
@@ -1289,6 +1370,9 @@ namespace sw
 		internal.border = 0;
 		internal.lock = LOCK_UNLOCKED;
 		internal.dirty = false;
+		internal.tileState = nullptr;
+		internal.tileValue = nullptr;
+		internal.clearedTiles = 0;
 
 		stencil.buffer = nullptr;
 		stencil.width = width;
@@ -1304,9 +1388,27 @@ namespace sw
 		stencil.border = 0;
 		stencil.lock = LOCK_UNLOCKED;
 		stencil.dirty = false;
+		stencil.tileState = nullptr;
+		stencil.tileValue = nullptr;
+		stencil.clearedTiles = 0;
+
+		hiZ = nullptr;
+		hiZPitchB = (internal.samples == 1 && isDepth(internal.format) && !complementaryDepthBuffer) ? ((internal.width + HIZ_TILE_WIDTH - 1) / HIZ_TILE_WIDTH) * sizeof(float) : 0;
+		hiZSliceB = hiZPitchB * ((internal.height + 1) / 2);
+		hiZValid = false;
 
 		dirtyContents = true;
 		paletteUsed = 0;
+
+		decodedPrevious = nullptr;
+		decodedNext = nullptr;
+		decodedEpoch = 0;
+		decodedCached = false;
+		decodedReleasing = false;
+
+		adoptedOwner = nullptr;
+		adoptedPrevious = nullptr;
+		adoptedNext = nullptr;
 	}
 
 	Surface::Surface(Resource *texture, int width, int height, int depth, int border, int samples, Format format, bool lockable, bool renderTarget, int pitchPprovided) : lockable(lockable), renderTarget(renderTarget)
@@ -1331,6 +1433,9 @@ namespace sw
 		external.border = 0;
 		external.lock = LOCK_UNLOCKED;
 		external.dirty = false;
+		external.tileState = nullptr;
+		external.tileValue = nullptr;
+		external.clearedTiles = 0;
 
 		internal.buffer = nullptr;
 		internal.width = width;
@@ -1346,6 +1451,9 @@ namespace sw
 		internal.border = (short)border;
 		internal.lock = LOCK_UNLOCKED;
 		internal.dirty = false;
+		internal.tileState = nullptr;
+		internal.tileValue = nullptr;
+		internal.clearedTiles = 0;
 
 		stencil.buffer = nullptr;
 		stencil.width = width;
@@ -1361,9 +1469,27 @@ namespace sw
 		stencil.border = 0;
 		stencil.lock = LOCK_UNLOCKED;
 		stencil.dirty = false;
+		stencil.tileState = nullptr;
+		stencil.tileValue = nullptr;
+		stencil.clearedTiles = 0;
+
+		hiZ = nullptr;
+		hiZPitchB = (internal.samples == 1 && isDepth(internal.format) && !complementaryDepthBuffer) ? ((internal.width + HIZ_TILE_WIDTH - 1) / HIZ_TILE_WIDTH) * sizeof(float) : 0;
+		hiZSliceB = hiZPitchB * ((internal.height + 1) / 2);
+		hiZValid = false;
 
 		dirtyContents = true;
 		paletteUsed = 0;
+
+		decodedPrevious = nullptr;
+		decodedNext = nullptr;
+		decodedEpoch = 0;
+		decodedCached = false;
+		decodedReleasing = false;
+
+		adoptedOwner = nullptr;
+		adoptedPrevious = nullptr;
+		adoptedNext = nullptr;
 	}
 
 	Surface::~Surface()
@@ -1372,6 +1498,32 @@ namespace sw
 		// We can't call it here because the parent resource may already have been destroyed.
 		ASSERT(isUnlocked());
 
+		if(isCompressed(external.format))
+		{
+			decodeCacheMutex.lock();
+
+			while(decodedReleasing)   // Let trimDecodeCache() finish with this level
+			{
+				decodeCacheMutex.unlock();
+				Thread::yield();
+				decodeCacheMutex.lock();
+			}
+
+			if(decodedCached)
+			{
+				unlinkDecodedLevel();
+			}
+
+			decodeCacheMutex.unlock();
+		}
+
+		if(adoptedOwner)
+		{
+			adoptMutex.lock();
+			unlinkAdopted();
+			adoptMutex.unlock();
+		}
+
 		if(!hasParent)
 		{
 			resource->destruct();
@@ -1388,16 +1540,38 @@ namespace sw
 		}
 
 		deallocate(stencil.buffer);
+		deallocate(hiZ);
+
+		for(Buffer *buffer : {&internal, &stencil})
+		{
+			delete[] buffer->tileState;
+			delete[] buffer->tileValue;
+		}
 
 		external.buffer = nullptr;
 		internal.buffer = nullptr;
 		stencil.buffer = nullptr;
+		hiZ = nullptr;
 	}
 
 	void *Surface::lockExternal(int x, int y, int z, Lock lock, Accessor client)
 	{
 		resource->lock(client);
 
+		if(adoptedOwner && lock != LOCK_READONLY)
+		{
+			detachAdopted();
+		}
+
+		if(lock == LOCK_DISCARD)
+		{
+			discardTiles(internal);
+		}
+		else
+		{
+			fillTiles(internal, 0, 0, internal.width, internal.height);
+		}
+
 		if(!external.buffer)
 		{
 			if(internal.buffer && identicalBuffers())
@@ -1450,6 +1624,11 @@ namespace sw
 			resource->lock(client);
 		}
 
+		if(adoptedOwner && lock != LOCK_UNLOCKED && lock != LOCK_READONLY)
+		{
+			detachAdopted();
+		}
+
 		if(!internal.buffer)
 		{
 			if(external.buffer && identicalBuffers())
@@ -1489,6 +1668,8 @@ namespace sw
 
 		if(external.dirty || (isPalette(external.format) && paletteUsed != Surface::paletteID))
 		{
+			discardTiles(internal);
+
 			if(lock != LOCK_DISCARD)
 			{
 				update(internal, external);
@@ -1496,6 +1677,23 @@ namespace sw
 
 			external.dirty = false;
 			paletteUsed = Surface::paletteID;
+			hiZValid = false;
+		}
+		else if(client != MANAGED)   // The renderer fills the tiles it touches
+		{
+			if(lock == LOCK_DISCARD)
+			{
+				discardTiles(internal);
+			}
+			else
+			{
+				fillTiles(internal, 0, 0, internal.width, internal.height);
+			}
+		}
+
+		if(isCompressed(external.format))
+		{
+			cacheDecodedLevel();
 		}
 
 		switch(lock)
@@ -1507,6 +1705,7 @@ namespace sw
 		case LOCK_READWRITE:
 		case LOCK_DISCARD:
 			dirtyContents = true;
+			hiZValid = hiZValid && (client == MANAGED);   // Renderer writes maintain the bounds themselves
 			break;
 		default:
 			ASSERT(false);
@@ -1527,7 +1726,276 @@ namespace sw
 		resource->unlock();
 	}
 
+	void Surface::setDecodeCacheSize(size_t bytes)
+	{
+		decodeCacheMutex.lock();
+		decodeCacheSize = bytes;
+		decodeCacheMutex.unlock();
+
+		trimDecodeCache();
+	}
+
+	void Surface::nextDecodeEpoch()
+	{
+		trimDecodeCache();   // Before the levels locked for the new draw stop being the most recent
+		++decodeEpoch;
+	}
+
+	void Surface::cacheDecodedLevel()
+	{
+		// Trimming locks other levels' resources, which the caller of lockInternal() may hold,
+		// so it's left to nextDecodeEpoch() and setDecodeCacheSize()
+		decodeCacheMutex.lock();
+
+		if(decodedCached)
+		{
+			unlinkDecodedLevel();
+		}
+
+		// Levels which were written to can't be decoded again
+		if(decodeCacheSize != 0 && !internal.dirty && internal.buffer != external.buffer)
+		{
+			decodedPrevious = nullptr;
+			decodedNext = decodedHead;
+			(decodedHead ? decodedHead->decodedPrevious : decodedTail) = this;
+			decodedHead = this;
+
+			decodedBytes += size(internal.width, internal.height, internal.depth, internal.border, internal.samples, internal.format);
+			decodedEpoch = decodeEpoch;
+			decodedCached = true;
+		}
+
+		decodeCacheMutex.unlock();
+	}
+
+	bool Surface::releaseDecodedLevel()
+	{
+		// Draws sampling the decoded texels hold the resource, so the level is kept until a later trim
+		if(!resource->attemptLock(PUBLIC))
+		{
+			decodeCacheMutex.lock();
+			decodedReleasing = false;
+			decodeCacheMutex.unlock();
+
+			return false;
+		}
+
+		decodeCacheMutex.lock();
+
+		// Levels which got locked or used again since they were picked stay cached
+		bool release = decodedCached && decodedEpoch != decodeEpoch && internal.lock == LOCK_UNLOCKED;
+
+		if(release)
+		{
+			if(!internal.dirty)
+			{
+				deallocate(internal.buffer);
+				internal.buffer = nullptr;
+				external.dirty = true;
+			}
+
+			unlinkDecodedLevel();
+		}
+
+		decodedReleasing = false;
+
+		decodeCacheMutex.unlock();
+
+		resource->unlock();
+
+		return release;
+	}
+
+	void Surface::unlinkDecodedLevel()
+	{
+		(decodedPrevious ? decodedPrevious->decodedNext : decodedHead) = decodedNext;
+		(decodedNext ? decodedNext->decodedPrevious : decodedTail) = decodedPrevious;
+		decodedPrevious = nullptr;
+		decodedNext = nullptr;
+
+		decodedBytes -= size(internal.width, internal.height, internal.depth, internal.border, internal.samples, internal.format);
+		decodedCached = false;
+	}
+
+	void Surface::trimDecodeCache()
+	{
+		// Levels are picked under the cache mutex, but locking their resource happens outside of it
+		Surface *victims[16];
+		int count;
+		int released;
+
+		do
+		{
+			count = 0;
+			released = 0;
+
+			decodeCacheMutex.lock();
+
+			Surface *surface = decodedTail;
+			size_t bytes = decodedBytes;
+
+			while(surface && decodeCacheSize != 0 && bytes > decodeCacheSize && count < 16)
+			{
+				// Levels locked since the last draw may be bound to samplers without their resource being locked yet
+				if(surface->decodedEpoch == decodeEpoch)
+				{
+					break;
+				}
+
+				if(!surface->decodedReleasing)
+				{
+					surface->decodedReleasing = true;
+					victims[count++] = surface;
+
+					bytes -= size(surface->internal.width, surface->internal.height, surface->internal.depth, surface->internal.border, surface->internal.samples, surface->internal.format);
+				}
+
+				surface = surface->decodedPrevious;
+			}
+
+			decodeCacheMutex.unlock();
+
+			for(int i = 0; i < count; i++)
+			{
+				if(victims[i]->releaseDecodedLevel())
+				{
+					released++;
+				}
+			}
+		}
+		while(count == 16 && released != 0);
+	}
+
+	bool Surface::adopt(Resource *owner, void *pixels, int pitchB, int sliceB)
+	{
+		// Only the external layout without conversions, padding, or stencil can be shared as-is
+		if(!identicalBuffers() || external.samples > 1 || external.border != 0 || stencil.format != FORMAT_NULL ||
+		   pitchB != external.pitchB || sliceB != external.sliceB || (size_t)pixels % 16 != 0)
+		{
+			return false;
+		}
+
+		// The sampler may read slightly beyond the last texel, so the allocation's padding has to cover it
+		size_t offset = (const byte*)pixels - (const byte*)owner->data();
+
+		if(offset > owner->size || owner->size - offset < size(external.width, external.height, external.depth, external.border, external.samples, external.format))
+		{
+			return false;
+		}
+
+		resource->lock(PUBLIC);
+
+		if(ownExternal)
+		{
+			deallocate(external.buffer);
+		}
+
+		if(internal.buffer != external.buffer)
+		{
+			deallocate(internal.buffer);
+		}
+
+		discardTiles(internal);
+
+		external.buffer = pixels;
+		internal.buffer = pixels;
+		external.dirty = false;
+		internal.dirty = false;
+		ownExternal = false;
+		dirtyContents = true;
+		hiZValid = false;
+
+		adoptMutex.lock();
+
+		if(adoptedOwner)
+		{
+			unlinkAdopted();
+		}
+
+		adoptedOwner = owner;
+		adoptedPrevious = nullptr;
+		adoptedNext = adoptersHead;
+
+		if(adoptersHead)
+		{
+			adoptersHead->adoptedPrevious = this;
+		}
+
+		adoptersHead = this;
+
+		adoptMutex.unlock();
+
+		resource->unlock();
+
+		return true;
+	}
+
+	void Surface::releaseAdopters(Resource *owner)
+	{
+		while(true)
+		{
+			adoptMutex.lock();
+
+			Surface *surface = adoptersHead;
+
+			while(surface && surface->adoptedOwner != owner)
+			{
+				surface = surface->adoptedNext;
+			}
+
+			adoptMutex.unlock();
+
+			if(!surface)
+			{
+				break;
+			}
+
+			surface->resource->lock(PUBLIC);   // Wait for draws sampling the shared memory
+
+			if(surface->adoptedOwner == owner)
+			{
+				surface->detachAdopted();
+			}
+
+			surface->resource->unlock();
+		}
+	}
+
+	void Surface::detachAdopted()
+	{
+		size_t bytes = size(external.width, external.height, external.depth, external.border, external.samples, external.format);
+		void *buffer = allocate(bytes);
+		memcpy(buffer, external.buffer, bytes);
+
+		external.buffer = buffer;
+		internal.buffer = buffer;
+		ownExternal = true;
+
+		adoptMutex.lock();
+		unlinkAdopted();
+		adoptMutex.unlock();
+	}
+
+	void Surface::unlinkAdopted()
+	{
+		(adoptedPrevious ? adoptedPrevious->adoptedNext : adoptersHead) = adoptedNext;
+
+		if(adoptedNext)
+		{
+			adoptedNext->adoptedPrevious = adoptedPrevious;
+		}
+
+		adoptedOwner = nullptr;
+		adoptedPrevious = nullptr;
+		adoptedNext = nullptr;
+	}
+
 	void *Surface::lockStencil(int x, int y, int front, Accessor client)
+	{
+		return lockStencil(x, y, front, client, client != MANAGED);
+	}
+
+	void *Surface::lockStencil(int x, int y, int front, Accessor client, bool fillClearedTiles)
 	{
 		resource->lock(client);
 
@@ -1541,6 +2009,11 @@ namespace sw
 			stencil.buffer = allocateBuffer(stencil.width, stencil.height, stencil.depth, stencil.border, stencil.samples, stencil.format);
 		}
 
+		if(fillClearedTiles)
+		{
+			fillTiles(stencil, 0, 0, stencil.width, stencil.height);
+		}
+
 		return stencil.lockRect(x, y, front, LOCK_READWRITE);   // FIXME
 	}
 
@@ -1952,6 +2425,15 @@ namespace sw
 		int width = min(destination.width, source.width);
 		int rowBytes = width * source.bytes;
 
+		if(source.format != destination.format &&
+		   converter().convert(destinationSlice, destination.format, destination.pitchB, destination.sliceB, sourceSlice, source.format, source.pitchB, source.sliceB, width, height, depth))
+		{
+			source.unlockRect();
+			destination.unlockRect();
+
+			return;
+		}
+
 		for(int z = 0; z < depth; z++)
 		{
 			unsigned char *sourceRow = sourceSlice;
@@ -2263,388 +2745,382 @@ namespace sw
 
 	void Surface::decodeDXT1(Buffer &internal, Buffer &external)
 	{
-		unsigned int *destSlice = (unsigned int*)internal.lockRect(0, 0, 0, LOCK_UPDATE);
-		const DXT1 *source = (const DXT1*)external.lockRect(0, 0, 0, LOCK_READONLY);
-
-		for(int z = 0; z < external.depth; z++)
-		{
-			unsigned int *dest = destSlice;
-
-			for(int y = 0; y < external.height; y += 4)
-			{
-				for(int x = 0; x < external.width; x += 4)
-				{
-					Color<byte> c[4];
+		decodeBlocks(internal, external, sizeof(DXT1), decodeDXT1Blocks);
+	}
 
-					c[0] = source->c0;
-					c[1] = source->c1;
+	void Surface::decodeDXT3(Buffer &internal, Buffer &external)
+	{
+		decodeBlocks(internal, external, sizeof(DXT3), decodeDXT3Blocks);
+	}
 
-					if(source->c0 > source->c1)   // No transparency
-					{
-						// c2 = 2 / 3 * c0 + 1 / 3 * c1
-						c[2].r = (byte)((2 * (word)c[0].r + (word)c[1].r + 1) / 3);
-						c[2].g = (byte)((2 * (word)c[0].g + (word)c[1].g + 1) / 3);
-						c[2].b = (byte)((2 * (word)c[0].b + (word)c[1].b + 1) / 3);
-						c[2].a = 0xFF;
-
-						// c3 = 1 / 3 * c0 + 2 / 3 * c1
-						c[3].r = (byte)(((word)c[0].r + 2 * (word)c[1].r + 1) / 3);
-						c[3].g = (byte)(((word)c[0].g + 2 * (word)c[1].g + 1) / 3);
-						c[3].b = (byte)(((word)c[0].b + 2 * (word)c[1].b + 1) / 3);
-						c[3].a = 0xFF;
-					}
-					else   // c3 transparent
-					{
-						// c2 = 1 / 2 * c0 + 1 / 2 * c1
-						c[2].r = (byte)(((word)c[0].r + (word)c[1].r) / 2);
-						c[2].g = (byte)(((word)c[0].g + (word)c[1].g) / 2);
-						c[2].b = (byte)(((word)c[0].b + (word)c[1].b) / 2);
-						c[2].a = 0xFF;
-
-						c[3].r = 0;
-						c[3].g = 0;
-						c[3].b = 0;
-						c[3].a = 0;
-					}
+	void Surface::decodeDXT5(Buffer &internal, Buffer &external)
+	{
+		decodeBlocks(internal, external, sizeof(DXT5), decodeDXT5Blocks);
+	}
 
-					for(int j = 0; j < 4 && (y + j) < internal.height; j++)
-					{
-						for(int i = 0; i < 4 && (x + i) < internal.width; i++)
-						{
-							dest[(x + i) + (y + j) * internal.pitchP] = c[(unsigned int)(source->lut >> 2 * (i + j * 4)) % 4];
-						}
-					}
+	void Surface::decodeATI1(Buffer &internal, Buffer &external)
+	{
+		decodeBlocks(internal, external, sizeof(ATI1), decodeATI1Blocks);
+	}
 
-					source++;
-				}
-			}
+	void Surface::decodeATI2(Buffer &internal, Buffer &external)
+	{
+		decodeBlocks(internal, external, sizeof(ATI2), decodeATI2Blocks);
+	}
 
-			(byte*&)destSlice += internal.sliceB;
-		}
+	void Surface::decodeBlocks(Buffer &internal, Buffer &external, int blockBytes, BlockDecoder decoder)
+	{
+		DecodeTask task;
+		task.decoder = decoder;
+		task.internal = &internal;
+		task.dest = (byte*)internal.lockRect(0, 0, 0, LOCK_UPDATE);
+		task.source = (const byte*)external.lockRect(0, 0, 0, LOCK_READONLY);
+		task.blockRowB = blockBytes * ((external.width + 3) / 4);
+		task.width = min(internal.width, external.width);
+		task.rowsPerLayer = (external.height + 3) / 4;
+		task.rows = min(external.depth, internal.depth) * task.rowsPerLayer;
+
+		// Large textures are decoded by up to one thread per 64k texels, taking one row of blocks at a time
+		parallelRows(task.rows, min((int)threadCount, task.rows * task.width / 16384), decodeBlockRow, &task);
 
 		external.unlockRect();
 		internal.unlockRect();
 	}
 
-	void Surface::decodeDXT3(Buffer &internal, Buffer &external)
+	void Surface::decodeBlockRow(void *parameters, int row)
 	{
-		unsigned int *destSlice = (unsigned int*)internal.lockRect(0, 0, 0, LOCK_UPDATE);
-		const DXT3 *source = (const DXT3*)external.lockRect(0, 0, 0, LOCK_READONLY);
+		const DecodeTask *task = static_cast<const DecodeTask*>(parameters);
+		const Buffer &internal = *task->internal;
+
+		int z = row / task->rowsPerLayer;
+		int y = 4 * (row % task->rowsPerLayer);
 
-		for(int z = 0; z < external.depth; z++)
+		if(y < internal.height)
 		{
-			unsigned int *dest = destSlice;
+			byte *dest = task->dest + z * internal.sliceB + y * internal.pitchB;
 
-			for(int y = 0; y < external.height; y += 4)
-			{
-				for(int x = 0; x < external.width; x += 4)
-				{
-					Color<byte> c[4];
-
-					c[0] = source->c0;
-					c[1] = source->c1;
+			task->decoder(dest, internal.pitchB, task->source + row * task->blockRowB, task->width, min(internal.height - y, 4));
+		}
+	}
 
-					// c2 = 2 / 3 * c0 + 1 / 3 * c1
-					c[2].r = (byte)((2 * (word)c[0].r + (word)c[1].r + 1) / 3);
-					c[2].g = (byte)((2 * (word)c[0].g + (word)c[1].g + 1) / 3);
-					c[2].b = (byte)((2 * (word)c[0].b + (word)c[1].b + 1) / 3);
+	// Computes the four B8G8R8A8 colors of a block. Unless the block is opaque by definition, c0 <= c1 selects
+	// the average of the endpoints for the third color, and transparent black for the fourth.
+	void Surface::colorPalette(unsigned int c[4], word c0, word c1, bool opaque)
+	{
+		c[0] = Color<byte>(c0);
+		c[1] = Color<byte>(c1);
 
-					// c3 = 1 / 3 * c0 + 2 / 3 * c1
-					c[3].r = (byte)(((word)c[0].r + 2 * (word)c[1].r + 1) / 3);
-					c[3].g = (byte)(((word)c[0].g + 2 * (word)c[1].g + 1) / 3);
-					c[3].b = (byte)(((word)c[0].b + 2 * (word)c[1].b + 1) / 3);
+		#if defined(__i386__) || defined(__x86_64__)
+			if(CPUID::supportsSSE2())
+			{
+				__m128i c01 = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)c), _mm_setzero_si128());
+				__m128i c10 = _mm_shuffle_epi32(c01, 0x4E);
 
-					for(int j = 0; j < 4 && (y + j) < internal.height; j++)
-					{
-						for(int i = 0; i < 4 && (x + i) < internal.width; i++)
-						{
-							unsigned int a = (unsigned int)(source->a >> 4 * (i + j * 4)) & 0x0F;
-							unsigned int color = (c[(unsigned int)(source->lut >> 2 * (i + j * 4)) % 4] & 0x00FFFFFF) | ((a << 28) + (a << 24));
+				if(opaque || c0 > c1)
+				{
+					// 2 / 3 * c0 + 1 / 3 * c1 and 1 / 3 * c0 + 2 / 3 * c1 in the two halves, divided by 3 through
+					// the reciprocal rounded up to 16-bit, which is exact for sums below 32768
+					__m128i c23 = _mm_add_epi16(_mm_add_epi16(c01, c01), _mm_add_epi16(c10, _mm_set1_epi16(1)));
+					c23 = _mm_mulhi_epu16(c23, _mm_set1_epi16(0x5556));
 
-							dest[(x + i) + (y + j) * internal.pitchP] = color;
-						}
-					}
+					_mm_storel_epi64((__m128i*)(c + 2), _mm_packus_epi16(c23, c23));
+				}
+				else
+				{
+					__m128i c2 = _mm_move_epi64(_mm_srli_epi16(_mm_add_epi16(c01, c10), 1));   // c3 = 0
 
-					source++;
+					_mm_storel_epi64((__m128i*)(c + 2), _mm_packus_epi16(c2, c2));
 				}
+
+				return;
 			}
+		#endif
+
+		Color<byte> c2;
+		Color<byte> c3;
+		Color<byte> e0 = c0;
+		Color<byte> e1 = c1;
 
-			(byte*&)destSlice += internal.sliceB;
+		if(opaque || c0 > c1)
+		{
+			c2.r = (byte)((2 * (word)e0.r + (word)e1.r + 1) / 3);
+			c2.g = (byte)((2 * (word)e0.g + (word)e1.g + 1) / 3);
+			c2.b = (byte)((2 * (word)e0.b + (word)e1.b + 1) / 3);
+			c2.a = 0xFF;
+
+			c3.r = (byte)(((word)e0.r + 2 * (word)e1.r + 1) / 3);
+			c3.g = (byte)(((word)e0.g + 2 * (word)e1.g + 1) / 3);
+			c3.b = (byte)(((word)e0.b + 2 * (word)e1.b + 1) / 3);
+			c3.a = 0xFF;
+		}
+		else
+		{
+			c2.r = (byte)(((word)e0.r + (word)e1.r) / 2);
+			c2.g = (byte)(((word)e0.g + (word)e1.g) / 2);
+			c2.b = (byte)(((word)e0.b + (word)e1.b) / 2);
+			c2.a = 0xFF;
+
+			c3.r = 0;
+			c3.g = 0;
+			c3.b = 0;
+			c3.a = 0;
 		}
 
-		external.unlockRect();
-		internal.unlockRect();
+		c[2] = c2;
+		c[3] = c3;
 	}
 
-	void Surface::decodeDXT5(Buffer &internal, Buffer &external)
+	// Computes the eight values of an alpha, red or green block. When e0 <= e1, six are interpolated in fifths
+	// and the last two are 0 and 255.
+	void Surface::alphaPalette(byte a[8], byte e0, byte e1)
 	{
-		unsigned int *destSlice = (unsigned int*)internal.lockRect(0, 0, 0, LOCK_UPDATE);
-		const DXT5 *source = (const DXT5*)external.lockRect(0, 0, 0, LOCK_READONLY);
-
-		for(int z = 0; z < external.depth; z++)
-		{
-			unsigned int *dest = destSlice;
-
-			for(int y = 0; y < external.height; y += 4)
+		#if defined(__i386__) || defined(__x86_64__)
+			if(CPUID::supportsSSE2())
 			{
-				for(int x = 0; x < external.width; x += 4)
+				__m128i a0 = _mm_set1_epi16(e0);
+				__m128i a1 = _mm_set1_epi16(e1);
+				__m128i sum;
+
+				// Divisions through reciprocals rounded up to 16-bit are exact for these sums
+				if(e0 > e1)
+				{
+					sum = _mm_add_epi16(_mm_mullo_epi16(a0, _mm_setr_epi16(7, 0, 6, 5, 4, 3, 2, 1)),
+					                    _mm_mullo_epi16(a1, _mm_setr_epi16(0, 7, 1, 2, 3, 4, 5, 6)));
+					sum = _mm_mulhi_epu16(_mm_add_epi16(sum, _mm_set1_epi16(3)), _mm_set1_epi16(0x2493));
+				}
+				else
 				{
-					Color<byte> c[4];
+					sum = _mm_add_epi16(_mm_mullo_epi16(a0, _mm_setr_epi16(5, 0, 4, 3, 2, 1, 0, 0)),
+					                    _mm_mullo_epi16(a1, _mm_setr_epi16(0, 5, 1, 2, 3, 4, 0, 0)));
+					sum = _mm_mulhi_epu16(_mm_add_epi16(sum, _mm_set1_epi16(2)), _mm_set1_epi16(0x3334));
+					sum = _mm_or_si128(sum, _mm_setr_epi16(0, 0, 0, 0, 0, 0, 0, 0xFF));
+				}
 
-					c[0] = source->c0;
-					c[1] = source->c1;
+				_mm_storel_epi64((__m128i*)a, _mm_packus_epi16(sum, sum));
 
-					// c2 = 2 / 3 * c0 + 1 / 3 * c1
-					c[2].r = (byte)((2 * (word)c[0].r + (word)c[1].r + 1) / 3);
-					c[2].g = (byte)((2 * (word)c[0].g + (word)c[1].g + 1) / 3);
-					c[2].b = (byte)((2 * (word)c[0].b + (word)c[1].b + 1) / 3);
+				return;
+			}
+		#endif
 
-					// c3 = 1 / 3 * c0 + 2 / 3 * c1
-					c[3].r = (byte)(((word)c[0].r + 2 * (word)c[1].r + 1) / 3);
-					c[3].g = (byte)(((word)c[0].g + 2 * (word)c[1].g + 1) / 3);
-					c[3].b = (byte)(((word)c[0].b + 2 * (word)c[1].b + 1) / 3);
+		a[0] = e0;
+		a[1] = e1;
 
-					byte a[8];
+		if(e0 > e1)
+		{
+			a[2] = (byte)((6 * (word)e0 + 1 * (word)e1 + 3) / 7);
+			a[3] = (byte)((5 * (word)e0 + 2 * (word)e1 + 3) / 7);
+			a[4] = (byte)((4 * (word)e0 + 3 * (word)e1 + 3) / 7);
+			a[5] = (byte)((3 * (word)e0 + 4 * (word)e1 + 3) / 7);
+			a[6] = (byte)((2 * (word)e0 + 5 * (word)e1 + 3) / 7);
+			a[7] = (byte)((1 * (word)e0 + 6 * (word)e1 + 3) / 7);
+		}
+		else
+		{
+			a[2] = (byte)((4 * (word)e0 + 1 * (word)e1 + 2) / 5);
+			a[3] = (byte)((3 * (word)e0 + 2 * (word)e1 + 2) / 5);
+			a[4] = (byte)((2 * (word)e0 + 3 * (word)e1 + 2) / 5);
+			a[5] = (byte)((1 * (word)e0 + 4 * (word)e1 + 2) / 5);
+			a[6] = 0;
+			a[7] = 0xFF;
+		}
+	}
 
-					a[0] = source->a0;
-					a[1] = source->a1;
+	void Surface::decodeDXT1Blocks(byte *dest, int pitchB, const byte *source, int width, int height)
+	{
+		const DXT1 *block = (const DXT1*)source;
 
-					if(a[0] > a[1])
-					{
-						a[2] = (byte)((6 * (word)a[0] + 1 * (word)a[1] + 3) / 7);
-						a[3] = (byte)((5 * (word)a[0] + 2 * (word)a[1] + 3) / 7);
-						a[4] = (byte)((4 * (word)a[0] + 3 * (word)a[1] + 3) / 7);
-						a[5] = (byte)((3 * (word)a[0] + 4 * (word)a[1] + 3) / 7);
-						a[6] = (byte)((2 * (word)a[0] + 5 * (word)a[1] + 3) / 7);
-						a[7] = (byte)((1 * (word)a[0] + 6 * (word)a[1] + 3) / 7);
-					}
-					else
-					{
-						a[2] = (byte)((4 * (word)a[0] + 1 * (word)a[1] + 2) / 5);
-						a[3] = (byte)((3 * (word)a[0] + 2 * (word)a[1] + 2) / 5);
-						a[4] = (byte)((2 * (word)a[0] + 3 * (word)a[1] + 2) / 5);
-						a[5] = (byte)((1 * (word)a[0] + 4 * (word)a[1] + 2) / 5);
-						a[6] = 0;
-						a[7] = 0xFF;
-					}
+		for(int x = 0; x < width; x += 4, block++)
+		{
+			unsigned int c[4];
+			colorPalette(c, block->c0, block->c1, false);
 
-					for(int j = 0; j < 4 && (y + j) < internal.height; j++)
-					{
-						for(int i = 0; i < 4 && (x + i) < internal.width; i++)
-						{
-							unsigned int alpha = (unsigned int)a[(unsigned int)(source->alut >> (16 + 3 * (i + j * 4))) % 8] << 24;
-							unsigned int color = (c[(source->clut >> 2 * (i + j * 4)) % 4] & 0x00FFFFFF) | alpha;
+			int columns = min(width - x, 4);
 
-							dest[(x + i) + (y + j) * internal.pitchP] = color;
-						}
-					}
+			for(int j = 0; j < height; j++)
+			{
+				unsigned int *texel = (unsigned int*)(dest + j * pitchB) + x;
+				unsigned int lut = block->lut >> 8 * j;
 
-					source++;
+				for(int i = 0; i < columns; i++)
+				{
+					texel[i] = c[(lut >> 2 * i) & 3];
 				}
 			}
-
-			(byte*&)destSlice += internal.sliceB;
 		}
-
-		external.unlockRect();
-		internal.unlockRect();
 	}
 
-	void Surface::decodeATI1(Buffer &internal, Buffer &external)
+	void Surface::decodeDXT3Blocks(byte *dest, int pitchB, const byte *source, int width, int height)
 	{
-		byte *destSlice = (byte*)internal.lockRect(0, 0, 0, LOCK_UPDATE);
-		const ATI1 *source = (const ATI1*)external.lockRect(0, 0, 0, LOCK_READONLY);
+		const DXT3 *block = (const DXT3*)source;
 
-		for(int z = 0; z < external.depth; z++)
+		for(int x = 0; x < width; x += 4, block++)
 		{
-			byte *dest = destSlice;
+			unsigned int c[4];
+			colorPalette(c, block->c0, block->c1, true);
+
+			int columns = min(width - x, 4);
 
-			for(int y = 0; y < external.height; y += 4)
+			for(int j = 0; j < height; j++)
 			{
-				for(int x = 0; x < external.width; x += 4)
+				unsigned int *texel = (unsigned int*)(dest + j * pitchB) + x;
+				unsigned int lut = block->lut >> 8 * j;
+				unsigned int alpha = (unsigned int)(block->a >> 16 * j);
+
+				for(int i = 0; i < columns; i++)
 				{
-					byte r[8];
+					unsigned int a = (alpha >> 4 * i) & 0x0F;
 
-					r[0] = source->r0;
-					r[1] = source->r1;
+					texel[i] = (c[(lut >> 2 * i) & 3] & 0x00FFFFFF) | (a * 0x11000000);
+				}
+			}
+		}
+	}
 
-					if(r[0] > r[1])
-					{
-						r[2] = (byte)((6 * (word)r[0] + 1 * (word)r[1] + 3) / 7);
-						r[3] = (byte)((5 * (word)r[0] + 2 * (word)r[1] + 3) / 7);
-						r[4] = (byte)((4 * (word)r[0] + 3 * (word)r[1] + 3) / 7);
-						r[5] = (byte)((3 * (word)r[0] + 4 * (word)r[1] + 3) / 7);
-						r[6] = (byte)((2 * (word)r[0] + 5 * (word)r[1] + 3) / 7);
-						r[7] = (byte)((1 * (word)r[0] + 6 * (word)r[1] + 3) / 7);
-					}
-					else
-					{
-						r[2] = (byte)((4 * (word)r[0] + 1 * (word)r[1] + 2) / 5);
-						r[3] = (byte)((3 * (word)r[0] + 2 * (word)r[1] + 2) / 5);
-						r[4] = (byte)((2 * (word)r[0] + 3 * (word)r[1] + 2) / 5);
-						r[5] = (byte)((1 * (word)r[0] + 4 * (word)r[1] + 2) / 5);
-						r[6] = 0;
-						r[7] = 0xFF;
-					}
+	void Surface::decodeDXT5Blocks(byte *dest, int pitchB, const byte *source, int width, int height)
+	{
+		const DXT5 *block = (const DXT5*)source;
 
-					for(int j = 0; j < 4 && (y + j) < internal.height; j++)
-					{
-						for(int i = 0; i < 4 && (x + i) < internal.width; i++)
-						{
-							dest[(x + i) + (y + j) * internal.pitchP] = r[(unsigned int)(source->rlut >> (16 + 3 * (i + j * 4))) % 8];
-						}
-					}
+		for(int x = 0; x < width; x += 4, block++)
+		{
+			unsigned int c[4];
+			colorPalette(c, block->c0, block->c1, true);
+
+			byte a[8];
+			alphaPalette(a, block->a0, block->a1);
 
-					source++;
+			int columns = min(width - x, 4);
+
+			for(int j = 0; j < height; j++)
+			{
+				unsigned int *texel = (unsigned int*)(dest + j * pitchB) + x;
+				unsigned int lut = block->clut >> 8 * j;
+				unsigned int alut = (unsigned int)(block->alut >> (16 + 12 * j));
+
+				for(int i = 0; i < columns; i++)
+				{
+					texel[i] = (c[(lut >> 2 * i) & 3] & 0x00FFFFFF) | ((unsigned int)a[(alut >> 3 * i) & 7] << 24);
 				}
 			}
-
-			destSlice += internal.sliceB;
 		}
-
-		external.unlockRect();
-		internal.unlockRect();
 	}
 
-	void Surface::decodeATI2(Buffer &internal, Buffer &external)
+	void Surface::decodeATI1Blocks(byte *dest, int pitchB, const byte *source, int width, int height)
 	{
-		word *destSlice = (word*)internal.lockRect(0, 0, 0, LOCK_UPDATE);
-		const ATI2 *source = (const ATI2*)external.lockRect(0, 0, 0, LOCK_READONLY);
+		const ATI1 *block = (const ATI1*)source;
 
-		for(int z = 0; z < external.depth; z++)
+		for(int x = 0; x < width; x += 4, block++)
 		{
-			word *dest = destSlice;
+			byte r[8];
+			alphaPalette(r, block->r0, block->r1);
 
-			for(int y = 0; y < external.height; y += 4)
-			{
-				for(int x = 0; x < external.width; x += 4)
-				{
-					byte X[8];
+			int columns = min(width - x, 4);
 
-					X[0] = source->x0;
-					X[1] = source->x1;
+			for(int j = 0; j < height; j++)
+			{
+				byte *texel = dest + j * pitchB + x;
+				unsigned int rlut = (unsigned int)(block->rlut >> (16 + 12 * j));
 
-					if(X[0] > X[1])
-					{
-						X[2] = (byte)((6 * (word)X[0] + 1 * (word)X[1] + 3) / 7);
-						X[3] = (byte)((5 * (word)X[0] + 2 * (word)X[1] + 3) / 7);
-						X[4] = (byte)((4 * (word)X[0] + 3 * (word)X[1] + 3) / 7);
-						X[5] = (byte)((3 * (word)X[0] + 4 * (word)X[1] + 3) / 7);
-						X[6] = (byte)((2 * (word)X[0] + 5 * (word)X[1] + 3) / 7);
-						X[7] = (byte)((1 * (word)X[0] + 6 * (word)X[1] + 3) / 7);
-					}
-					else
-					{
-						X[2] = (byte)((4 * (word)X[0] + 1 * (word)X[1] + 2) / 5);
-						X[3] = (byte)((3 * (word)X[0] + 2 * (word)X[1] + 2) / 5);
-						X[4] = (byte)((2 * (word)X[0] + 3 * (word)X[1] + 2) / 5);
-						X[5] = (byte)((1 * (word)X[0] + 4 * (word)X[1] + 2) / 5);
-						X[6] = 0;
-						X[7] = 0xFF;
-					}
+				for(int i = 0; i < columns; i++)
+				{
+					texel[i] = r[(rlut >> 3 * i) & 7];
+				}
+			}
+		}
+	}
 
-					byte Y[8];
+	void Surface::decodeATI2Blocks(byte *dest, int pitchB, const byte *source, int width, int height)
+	{
+		const ATI2 *block = (const ATI2*)source;
 
-					Y[0] = source->y0;
-					Y[1] = source->y1;
+		for(int x = 0; x < width; x += 4, block++)
+		{
+			byte X[8];
+			alphaPalette(X, block->x0, block->x1);
 
-					if(Y[0] > Y[1])
-					{
-						Y[2] = (byte)((6 * (word)Y[0] + 1 * (word)Y[1] + 3) / 7);
-						Y[3] = (byte)((5 * (word)Y[0] + 2 * (word)Y[1] + 3) / 7);
-						Y[4] = (byte)((4 * (word)Y[0] + 3 * (word)Y[1] + 3) / 7);
-						Y[5] = (byte)((3 * (word)Y[0] + 4 * (word)Y[1] + 3) / 7);
-						Y[6] = (byte)((2 * (word)Y[0] + 5 * (word)Y[1] + 3) / 7);
-						Y[7] = (byte)((1 * (word)Y[0] + 6 * (word)Y[1] + 3) / 7);
-					}
-					else
-					{
-						Y[2] = (byte)((4 * (word)Y[0] + 1 * (word)Y[1] + 2) / 5);
-						Y[3] = (byte)((3 * (word)Y[0] + 2 * (word)Y[1] + 2) / 5);
-						Y[4] = (byte)((2 * (word)Y[0] + 3 * (word)Y[1] + 2) / 5);
-						Y[5] = (byte)((1 * (word)Y[0] + 4 * (word)Y[1] + 2) / 5);
-						Y[6] = 0;
-						Y[7] = 0xFF;
-					}
+			byte Y[8];
+			alphaPalette(Y, block->y0, block->y1);
 
-					for(int j = 0; j < 4 && (y + j) < internal.height; j++)
-					{
-						for(int i = 0; i < 4 && (x + i) < internal.width; i++)
-						{
-							word r = X[(unsigned int)(source->xlut >> (16 + 3 * (i + j * 4))) % 8];
-							word g = Y[(unsigned int)(source->ylut >> (16 + 3 * (i + j * 4))) % 8];
+			int columns = min(width - x, 4);
 
-							dest[(x + i) + (y + j) * internal.pitchP] = (g << 8) + r;
-						}
-					}
+			for(int j = 0; j < height; j++)
+			{
+				word *texel = (word*)(dest + j * pitchB) + x;
+				unsigned int xlut = (unsigned int)(block->xlut >> (16 + 12 * j));
+				unsigned int ylut = (unsigned int)(block->ylut >> (16 + 12 * j));
 
-					source++;
+				for(int i = 0; i < columns; i++)
+				{
+					texel[i] = (word)((Y[(ylut >> 3 * i) & 7] << 8) + X[(xlut >> 3 * i) & 7]);
 				}
 			}
+		}
+	}
 
-			(byte*&)destSlice += internal.sliceB;
+	void Surface::decodeETC2(Buffer &internal, Buffer &external, int nbAlphaBits, bool isSRGB)
+	{
+		switch(nbAlphaBits)
+		{
+		case 8:  decodeBlocks(internal, external, 16, isSRGB ? decodeETC2Blocks<ETC_Decoder::ETC_RGBA, true> : decodeETC2Blocks<ETC_Decoder::ETC_RGBA, false>); break;
+		case 1:  decodeBlocks(internal, external, 8, isSRGB ? decodeETC2Blocks<ETC_Decoder::ETC_RGB_PUNCHTHROUGH_ALPHA, true> : decodeETC2Blocks<ETC_Decoder::ETC_RGB_PUNCHTHROUGH_ALPHA, false>); break;
+		default: decodeBlocks(internal, external, 8, isSRGB ? decodeETC2Blocks<ETC_Decoder::ETC_RGB, true> : decodeETC2Blocks<ETC_Decoder::ETC_RGB, false>); break;
 		}
+	}
 
-		external.unlockRect();
-		internal.unlockRect();
+	void Surface::decodeEAC(Buffer &internal, Buffer &external, int nbChannels, bool isSigned)
+	{
+		ASSERT(nbChannels == 1 || nbChannels == 2);
+
+		if(nbChannels == 1)
+		{
+			decodeBlocks(internal, external, 8, isSigned ? decodeEACBlocks<ETC_Decoder::ETC_R_SIGNED> : decodeEACBlocks<ETC_Decoder::ETC_R_UNSIGNED>);
+		}
+		else
+		{
+			decodeBlocks(internal, external, 16, isSigned ? decodeEACBlocks<ETC_Decoder::ETC_RG_SIGNED> : decodeEACBlocks<ETC_Decoder::ETC_RG_UNSIGNED>);
+		}
 	}
 
-	void Surface::decodeETC2(Buffer &internal, Buffer &external, int nbAlphaBits, bool isSRGB)
+	template<int inputType, bool isSRGB>
+	void Surface::decodeETC2Blocks(byte *dest, int pitchB, const byte *source, int width, int height)
 	{
-		ETC_Decoder::Decode((const byte*)external.lockRect(0, 0, 0, LOCK_READONLY), (byte*)internal.lockRect(0, 0, 0, LOCK_UPDATE), external.width, external.height, internal.width, internal.height, internal.pitchB, internal.bytes,
-		                    (nbAlphaBits == 8) ? ETC_Decoder::ETC_RGBA : ((nbAlphaBits == 1) ? ETC_Decoder::ETC_RGB_PUNCHTHROUGH_ALPHA : ETC_Decoder::ETC_RGB));
-		external.unlockRect();
-		internal.unlockRect();
+		ETC_Decoder::Decode(source, dest, width, height, width, height, pitchB, 4, static_cast<ETC_Decoder::InputType>(inputType));
 
 		if(isSRGB)
 		{
-			static byte sRGBtoLinearTable[256];
-			static bool sRGBtoLinearTableDirty = true;
-			if(sRGBtoLinearTableDirty)
-			{
-				for(int i = 0; i < 256; i++)
-				{
-					sRGBtoLinearTable[i] = static_cast<byte>(sRGBtoLinear(static_cast<float>(i) / 255.0f) * 255.0f + 0.5f);
-				}
-				sRGBtoLinearTableDirty = false;
-			}
-
 			// Perform sRGB conversion in place after decoding
-			byte *src = (byte*)internal.lockRect(0, 0, 0, LOCK_READWRITE);
-			for(int y = 0; y < internal.height; y++)
+			const unsigned char *toLinear = sRGBTables().toLinear8;
+
+			for(int y = 0; y < height; y++)
 			{
-				byte *srcRow = src + y * internal.pitchB;
-				for(int x = 0; x <  internal.width; x++)
+				byte *texel = dest + y * pitchB;
+
+				for(int x = 0; x < width; x++, texel += 4)
 				{
-					byte *srcPix = srcRow + x * internal.bytes;
-					for(int i = 0; i < 3; i++)
-					{
-						srcPix[i] = sRGBtoLinearTable[srcPix[i]];
-					}
+					texel[0] = toLinear[texel[0]];
+					texel[1] = toLinear[texel[1]];
+					texel[2] = toLinear[texel[2]];
 				}
 			}
-			internal.unlockRect();
 		}
 	}
 
-	void Surface::decodeEAC(Buffer &internal, Buffer &external, int nbChannels, bool isSigned)
+	template<int inputType>
+	void Surface::decodeEACBlocks(byte *dest, int pitchB, const byte *source, int width, int height)
 	{
-		ASSERT(nbChannels == 1 || nbChannels == 2);
+		const bool isSigned = (inputType == ETC_Decoder::ETC_R_SIGNED) || (inputType == ETC_Decoder::ETC_RG_SIGNED);
+		const int nbChannels = ((inputType == ETC_Decoder::ETC_RG_SIGNED) || (inputType == ETC_Decoder::ETC_RG_UNSIGNED)) ? 2 : 1;
 
-		byte *src = (byte*)internal.lockRect(0, 0, 0, LOCK_READWRITE);
-		ETC_Decoder::Decode((const byte*)external.lockRect(0, 0, 0, LOCK_READONLY), src, external.width, external.height, internal.width, internal.height, internal.pitchB, internal.bytes,
-		                    (nbChannels == 1) ? (isSigned ? ETC_Decoder::ETC_R_SIGNED : ETC_Decoder::ETC_R_UNSIGNED) : (isSigned ? ETC_Decoder::ETC_RG_SIGNED : ETC_Decoder::ETC_RG_UNSIGNED));
-		external.unlockRect();
+		ETC_Decoder::Decode(source, dest, width, height, width, height, pitchB, 4 * nbChannels, static_cast<ETC_Decoder::InputType>(inputType));
 
 		// FIXME: We convert EAC data to float, until signed short internal formats are supported
 		//        This code can be removed if ETC2 images are decoded to internal 16 bit signed R/RG formats
 		const float normalization = isSigned ? (1.0f / (8.0f * 127.875f)) : (1.0f / (8.0f * 255.875f));
-		for(int y = 0; y < internal.height; y++)
+		for(int y = 0; y < height; y++)
 		{
-			byte* srcRow = src + y * internal.pitchB;
-			for(int x = internal.width - 1; x >= 0; x--)
+			byte* srcRow = dest + y * pitchB;
+			for(int x = width - 1; x >= 0; x--)
 			{
-				int* srcPix = reinterpret_cast<int*>(srcRow + x * internal.bytes);
+				int* srcPix = reinterpret_cast<int*>(srcRow + x * 4 * nbChannels);
 				float* dstPix = reinterpret_cast<float*>(srcPix);
 				for(int c = nbChannels - 1; c >= 0; c--)
 				{
@@ -2652,8 +3128,6 @@ namespace sw
 				}
 			}
 		}
-
-		internal.unlockRect();
 	}
 
 	void Surface::decodeASTC(Buffer &internal, Buffer &external, int xBlockSize, int yBlockSize, int zBlockSize, bool isSRGB)
@@ -3343,105 +3817,79 @@ namespace sw
 
 		int x1 = x0 + width;
 		int y1 = y0 + height;
+		bool hiZWasValid = hiZValid && !external.dirty;   // Updating the contents discards the bounds
 
-		if(!hasQuadLayout(internal.format))
+		if(hasQuadLayout(internal.format) && complementaryDepthBuffer)
 		{
-			float *target = (float*)lockInternal(x0, y0, 0, lock, PUBLIC);
+			depth = 1 - depth;
+		}
 
-			for(int z = 0; z < internal.samples; z++)
-			{
-				float *row = target;
-				for(int y = y0; y < y1; y++)
-				{
-					memfill4(row, (int&)depth, width * sizeof(float));
-					row += internal.pitchP;
-				}
-				target += internal.sliceP;
-			}
+		unsigned int pattern;
+		memcpy(&pattern, &depth, sizeof(pattern));
 
-			unlockInternal();
+		lockInternal(0, 0, 0, lock, PUBLIC);
+		clearTiles(internal, pattern, x0, y0, x1, y1);
+
+		if(hiZPitchB != 0)
+		{
+			hiZValid = hiZWasValid;
+			clearHiZ(depth, x0, y0, x1, y1, 0);
 		}
-		else   // Quad layout
+
+		unlockInternal();
+	}
+
+	float *Surface::getHiZ(int z)
+	{
+		if(hiZPitchB == 0)
 		{
-			if(complementaryDepthBuffer)
-			{
-				depth = 1 - depth;
-			}
+			return nullptr;
+		}
 
-			float *buffer = (float*)lockInternal(0, 0, 0, lock, PUBLIC);
+		if(!hiZ)
+		{
+			hiZ = (float*)allocate(hiZSliceB * internal.depth);
+		}
 
-			int oddX0 = (x0 & ~1) * 2 + (x0 & 1);
-			int oddX1 = (x1 & ~1) * 2;
-			int evenX0 = ((x0 + 1) & ~1) * 2;
-			int evenBytes = (oddX1 - evenX0) * sizeof(float);
+		if(!hiZValid)
+		{
+			// Nothing is known about the contents, so any depth may be stored
+			float maxDepth = FLT_MAX;
+			int pattern;
+			memcpy(&pattern, &maxDepth, sizeof(pattern));
+			memfill4(hiZ, pattern, hiZSliceB * internal.depth);
+			hiZValid = true;
+		}
 
-			for(int z = 0; z < internal.samples; z++)
-			{
-				for(int y = y0; y < y1; y++)
-				{
-					float *target = buffer + (y & ~1) * internal.pitchP + (y & 1) * 2;
+		return (float*)((unsigned char*)hiZ + z * hiZSliceB);
+	}
 
-					if((y & 1) == 0 && y + 1 < y1)   // Fill quad line at once
-					{
-						if((x0 & 1) != 0)
-						{
-							target[oddX0 + 0] = depth;
-							target[oddX0 + 2] = depth;
-						}
+	void Surface::clearHiZ(float depth, int x0, int y0, int x1, int y1, int z)
+	{
+		float *slice = getHiZ(z);
 
-					//	for(int x2 = evenX0; x2 < x1 * 2; x2 += 4)
-					//	{
-					//		target[x2 + 0] = depth;
-					//		target[x2 + 1] = depth;
-					//		target[x2 + 2] = depth;
-					//		target[x2 + 3] = depth;
-					//	}
-
-					//	__asm
-					//	{
-					//		movss xmm0, depth
-					//		shufps xmm0, xmm0, 0x00
-					//
-					//		mov eax, x0
-					//		add eax, 1
-					//		and eax, 0xFFFFFFFE
-					//		cmp eax, x1
-					//		jge qEnd
-					//
-					//		mov edi, target
-					//
-					//	qLoop:
-					//		movntps [edi+8*eax], xmm0
-					//
-					//		add eax, 2
-					//		cmp eax, x1
-					//		jl qLoop
-					//	qEnd:
-					//	}
-
-						memfill4(&target[evenX0], (int&)depth, evenBytes);
-
-						if((x1 & 1) != 0)
-						{
-							target[oddX1 + 0] = depth;
-							target[oddX1 + 2] = depth;
-						}
+		int tilesX = hiZPitchB / sizeof(float);
+		int rowPairs = (internal.height + 1) / 2;
 
-						y++;
-					}
-					else
-					{
-						for(int x = x0, i = oddX0; x < x1; x++, i = (x & ~1) * 2 + (x & 1))
-						{
-							target[i] = depth;
-						}
-					}
-				}
+		for(int j = y0 / 2; j < (y1 + 1) / 2; j++)
+		{
+			float *row = (float*)((unsigned char*)slice + j * hiZPitchB);
+			bool rowsCovered = (y0 <= 2 * j) && (2 * j + 2 <= y1 || (j == rowPairs - 1 && y1 == internal.height));
 
-				buffer += internal.sliceP;
-			}
+			for(int i = x0 / HIZ_TILE_WIDTH; i < (x1 + HIZ_TILE_WIDTH - 1) / HIZ_TILE_WIDTH && i < tilesX; i++)
+			{
+				int tileX0 = i * HIZ_TILE_WIDTH;
+				int tileX1 = min(tileX0 + HIZ_TILE_WIDTH, internal.width);
 
-			unlockInternal();
+				if(rowsCovered && x0 <= tileX0 && tileX1 <= x1)
+				{
+					row[i] = depth;
+				}
+				else
+				{
+					row[i] = max(row[i], depth);
+				}
+			}
 		}
 	}
 
@@ -3472,57 +3920,226 @@ namespace sw
 		int x1 = x0 + width;
 		int y1 = y0 + height;
 
-		int oddX0 = (x0 & ~1) * 2 + (x0 & 1);
-		int oddX1 = (x1 & ~1) * 2;
-		int evenX0 = ((x0 + 1) & ~1) * 2;
-		int evenBytes = oddX1 - evenX0;
-
 		unsigned char maskedS = s & mask;
 		unsigned char invMask = ~mask;
-		unsigned int fill = maskedS;
-		fill = fill | (fill << 8) | (fill << 16) | (fill << 24);
 
-		char *buffer = (char*)lockStencil(0, 0, 0, PUBLIC);
+		char *buffer = (char*)lockStencil(0, 0, 0, PUBLIC, false);
 
-		// Stencil buffers are assumed to use quad layout
-		for(int z = 0; z < stencil.samples; z++)
+		if(mask == 0xFF)
 		{
-			for(int y = y0; y < y1; y++)
+			clearTiles(stencil, maskedS * 0x01010101u, x0, y0, x1, y1);
+		}
+		else
+		{
+			fillTiles(stencil, x0, y0, x1, y1);
+
+			// Stencil buffers are assumed to use quad layout
+			for(int z = 0; z < stencil.samples; z++)
 			{
-				char *target = buffer + (y & ~1) * stencil.pitchP + (y & 1) * 2;
+				for(int y = y0; y < y1; y++)
+				{
+					char *target = buffer + (y & ~1) * stencil.pitchP + (y & 1) * 2;
+
+					for(int x = x0; x < x1; x++)
+					{
+						int i = (x & ~1) * 2 + (x & 1);
+						target[i] = maskedS | (target[i] & invMask);
+					}
+				}
+
+				buffer += stencil.sliceP;
+			}
+		}
+
+		unlockStencil();
+	}
+
+	bool Surface::clearColor(unsigned int pattern, const SliceRect &rect)
+	{
+		ASSERT(internal.depth == 1 && rect.slice == 0);
+
+		uint8_t *buffer = (uint8_t*)lockInternal(0, 0, 0, isEntire(rect) ? LOCK_DISCARD : LOCK_WRITEONLY, PUBLIC);
 
-				if((y & 1) == 0 && y + 1 < y1 && mask == 0xFF)   // Fill quad line at once
+		// Images backed by client memory return it instead of the internal buffer
+		if(buffer != (uint8_t*)internal.buffer + internal.border * (internal.pitchB + internal.bytes))
+		{
+			unlockInternal();
+			return false;
+		}
+
+		clearTiles(internal, pattern, rect.x0, rect.y0, rect.x1, rect.y1);
+		unlockInternal();
+
+		return true;
+	}
+
+	bool Surface::hasClearedTiles() const
+	{
+		return internal.clearedTiles != 0 || stencil.clearedTiles != 0;
+	}
+
+	void Surface::fillClearedTiles(int x0, int y0, int x1, int y1)
+	{
+		fillTiles(internal, x0, y0, x1, y1);
+		fillTiles(stencil, x0, y0, x1, y1);
+	}
+
+	void Surface::clearTiles(Buffer &buffer, unsigned int pattern, int x0, int y0, int x1, int y1)
+	{
+		if(buffer.depth != 1)
+		{
+			fillRect(buffer, pattern, x0, y0, x1, y1);
+			return;
+		}
+
+		int columns = (buffer.width + CLEAR_TILE_SIZE - 1) / CLEAR_TILE_SIZE;
+		int rows = (buffer.height + CLEAR_TILE_SIZE - 1) / CLEAR_TILE_SIZE;
+
+		for(int j = y0 / CLEAR_TILE_SIZE; j < (y1 + CLEAR_TILE_SIZE - 1) / CLEAR_TILE_SIZE; j++)
+		{
+			int tileY0 = j * CLEAR_TILE_SIZE;
+			int tileY1 = min(tileY0 + CLEAR_TILE_SIZE, buffer.height);
+
+			for(int i = x0 / CLEAR_TILE_SIZE; i < (x1 + CLEAR_TILE_SIZE - 1) / CLEAR_TILE_SIZE; i++)
+			{
+				int tileX0 = i * CLEAR_TILE_SIZE;
+				int tileX1 = min(tileX0 + CLEAR_TILE_SIZE, buffer.width);
+				int tile = j * columns + i;
+
+				if(x0 <= tileX0 && tileX1 <= x1 && y0 <= tileY0 && tileY1 <= y1)
 				{
-					if((x0 & 1) != 0)
+					if(!buffer.tileState)
 					{
-						target[oddX0 + 0] = fill;
-						target[oddX0 + 2] = fill;
+						buffer.tileState = new std::atomic<int>[columns * rows];
+						buffer.tileValue = new unsigned int[columns * rows];
+
+						for(int t = 0; t < columns * rows; t++)
+						{
+							buffer.tileState[t] = TILE_FILLED;
+						}
 					}
 
-					memfill4(&target[evenX0], fill, evenBytes);
+					// Renderer accesses are excluded by the lock, so no tile is being filled
+					if(buffer.tileState[tile].load(std::memory_order_relaxed) == TILE_FILLED)
+					{
+						++buffer.clearedTiles;
+					}
 
-					if((x1 & 1) != 0)
+					buffer.tileValue[tile] = pattern;
+					buffer.tileState[tile].store(TILE_CLEARED, std::memory_order_release);
+				}
+				else
+				{
+					if(buffer.tileState)
 					{
-						target[oddX1 + 0] = fill;
-						target[oddX1 + 2] = fill;
+						fillTile(buffer, tile);
 					}
 
+					fillRect(buffer, pattern, max(x0, tileX0), max(y0, tileY0), min(x1, tileX1), min(y1, tileY1));
+				}
+			}
+		}
+	}
+
+	void Surface::fillTiles(Buffer &buffer, int x0, int y0, int x1, int y1)
+	{
+		if(buffer.clearedTiles == 0)
+		{
+			return;
+		}
+
+		int columns = (buffer.width + CLEAR_TILE_SIZE - 1) / CLEAR_TILE_SIZE;
+
+		x0 = max(x0, 0);
+		y0 = max(y0, 0);
+		x1 = min(x1, buffer.width);
+		y1 = min(y1, buffer.height);
+
+		for(int j = y0 / CLEAR_TILE_SIZE; j < (y1 + CLEAR_TILE_SIZE - 1) / CLEAR_TILE_SIZE; j++)
+		{
+			for(int i = x0 / CLEAR_TILE_SIZE; i < (x1 + CLEAR_TILE_SIZE - 1) / CLEAR_TILE_SIZE; i++)
+			{
+				fillTile(buffer, j * columns + i);
+			}
+		}
+	}
+
+	void Surface::fillTile(Buffer &buffer, int tile)
+	{
+		int state = TILE_CLEARED;
+
+		// Render threads may touch the same tile concurrently, in which case one fills it and the others wait
+		if(buffer.tileState[tile].compare_exchange_strong(state, TILE_FILLING, std::memory_order_acquire))
+		{
+			int columns = (buffer.width + CLEAR_TILE_SIZE - 1) / CLEAR_TILE_SIZE;
+			int x0 = (tile % columns) * CLEAR_TILE_SIZE;
+			int y0 = (tile / columns) * CLEAR_TILE_SIZE;
+
+			fillRect(buffer, buffer.tileValue[tile], x0, y0, min(x0 + CLEAR_TILE_SIZE, buffer.width), min(y0 + CLEAR_TILE_SIZE, buffer.height));
+
+			buffer.tileState[tile].store(TILE_FILLED, std::memory_order_release);
+			--buffer.clearedTiles;
+		}
+		else
+		{
+			while(state == TILE_FILLING)
+			{
+				Thread::yield();
+				state = buffer.tileState[tile].load(std::memory_order_acquire);
+			}
+		}
+	}
+
+	void Surface::discardTiles(Buffer &buffer)
+	{
+		if(buffer.clearedTiles == 0)
+		{
+			return;
+		}
+
+		int columns = (buffer.width + CLEAR_TILE_SIZE - 1) / CLEAR_TILE_SIZE;
+		int rows = (buffer.height + CLEAR_TILE_SIZE - 1) / CLEAR_TILE_SIZE;
+
+		for(int tile = 0; tile < columns * rows; tile++)
+		{
+			buffer.tileState[tile].store(TILE_FILLED, std::memory_order_relaxed);
+		}
+
+		buffer.clearedTiles = 0;
+	}
+
+	void Surface::fillRect(Buffer &buffer, unsigned int pattern, int x0, int y0, int x1, int y1)
+	{
+		// Stencil buffers are assumed to use quad layout
+		bool quadLayout = (&buffer == &stencil) || hasQuadLayout(buffer.format);
+		uint8_t *slice = (uint8_t*)buffer.buffer + buffer.border * (buffer.pitchB + buffer.bytes);
+
+		for(int z = 0; z < buffer.samples; z++)
+		{
+			for(int y = y0; y < y1; y++)
+			{
+				if(!quadLayout)
+				{
+					memfill4(slice + y * buffer.pitchB + x0 * buffer.bytes, pattern, (x1 - x0) * buffer.bytes);
+				}
+				else if((y & 1) == 0 && y + 1 < y1 && (x0 & 1) == 0 && (x1 & 1) == 0)   // Fill quad line at once
+				{
+					memfill4(slice + y * buffer.pitchB + x0 * 2 * buffer.bytes, pattern, (x1 - x0) * 2 * buffer.bytes);
 					y++;
 				}
 				else
 				{
+					uint8_t *row = slice + (y & ~1) * buffer.pitchB + (y & 1) * 2 * buffer.bytes;
+
 					for(int x = x0; x < x1; x++)
 					{
-						int i = (x & ~1) * 2 + (x & 1);
-						target[i] = maskedS | (target[i] & invMask);
+						memcpy(row + ((x & ~1) * 2 + (x & 1)) * buffer.bytes, &pattern, buffer.bytes);
 					}
 				}
 			}
 
-			buffer += stencil.sliceP;
+			slice += buffer.sliceB;
 		}
-
-		unlockStencil();
 	}
 
 	void Surface::fill(const Color<float> &color, int x0, int y0, int width, int height)
@@ -3583,6 +4200,34 @@ namespace sw
 		}
 	}
 
+	Color<float> Surface::readExternal(int x, int y, int z) const
+	{
+		ASSERT(external.lock != LOCK_UNLOCKED);
+
+		return external.read(x, y, z);
+	}
+
+	Color<float> Surface::readExternal(int x, int y) const
+	{
+		ASSERT(external.lock != LOCK_UNLOCKED);
+
+		return external.read(x, y);
+	}
+
+	void Surface::writeExternal(int x, int y, int z, const Color<float> &color)
+	{
+		ASSERT(external.lock != LOCK_UNLOCKED);
+
+		external.write(x, y, z, color);
+	}
+
+	void Surface::writeExternal(int x, int y, const Color<float> &color)
+	{
+		ASSERT(external.lock != LOCK_UNLOCKED);
+
+		external.write(x, y, color);
+	}
+
 	void Surface::copyInternal(const Surface *source, int x, int y, float srcX, float srcY, bool filter)
 	{
 		ASSERT(internal.lock != LOCK_UNLOCKED && source && source->internal.lock != LOCK_UNLOCKED);
@@ -4005,16 +4650,42 @@ namespace sw
 			return;
 		}
 
-		ASSERT(internal.depth == 1);  // Unimplemented
+		unsigned char *source = (unsigned char*)internal.lockRect(0, 0, 0, LOCK_READWRITE);
+
+		// Large surfaces are split into bands of rows which get resolved concurrently
+		int bandsPerLayer = min(max((int)(((int64_t)internal.sliceB * internal.samples) >> 20), 1), internal.height);
+		int rowsPerBand = (internal.height + bandsPerLayer - 1) / bandsPerLayer;
 
-		void *source = internal.lockRect(0, 0, 0, LOCK_READWRITE);
+		ResolveTask task;
+		task.buffer = &internal;
+		task.source = source;
+		task.bandsPerLayer = bandsPerLayer;
+		task.rowsPerBand = rowsPerBand;
+		task.bands = internal.depth * bandsPerLayer;
 
-		int width = internal.width;
-		int height = internal.height;
-		int pitch = internal.pitchB;
-		int slice = internal.sliceB;
+		parallelRows(task.bands, threadCount, resolveBand, &task);
+	}
+
+	void Surface::resolveBand(void *parameters, int band)
+	{
+		const ResolveTask *task = static_cast<const ResolveTask*>(parameters);
+		const Buffer &buffer = *task->buffer;
 
-		unsigned char *source0 = (unsigned char*)source;
+		int layer = band / task->bandsPerLayer;
+		int y0 = (band % task->bandsPerLayer) * task->rowsPerBand;
+		int y1 = min(y0 + task->rowsPerBand, buffer.height);
+
+		// The samples of each layer are consecutive slices
+		resolveRows(buffer, task->source + layer * buffer.samples * buffer.sliceB + y0 * buffer.pitchB, y1 - y0);
+	}
+
+	void Surface::resolveRows(const Buffer &buffer, unsigned char *source, int height)
+	{
+		int width = buffer.width;
+		int pitch = buffer.pitchB;
+		int slice = buffer.sliceB;
+
+		unsigned char *source0 = source;
 		unsigned char *source1 = source0 + slice;
 		unsigned char *source2 = source1 + slice;
 		unsigned char *source3 = source2 + slice;
@@ -4031,14 +4702,49 @@ namespace sw
 		unsigned char *sourceE = sourceD + slice;
 		unsigned char *sourceF = sourceE + slice;
 
-		if(internal.format == FORMAT_X8R8G8B8 || internal.format == FORMAT_A8R8G8B8 ||
-		   internal.format == FORMAT_X8B8G8R8 || internal.format == FORMAT_A8B8G8R8 ||
-		   internal.format == FORMAT_SRGB8_X8 || internal.format == FORMAT_SRGB8_A8)
+		if(buffer.format == FORMAT_SRGB8_X8 || buffer.format == FORMAT_SRGB8_A8)
+		{
+			// Color channels are averaged in linear space
+			const SRGBTables &tables = sRGBTables();
+			int samples = buffer.samples;
+
+			for(int y = 0; y < height; y++)
+			{
+				for(int x = 0; x < width; x++)
+				{
+					unsigned int c0 = 0;
+					unsigned int c1 = 0;
+					unsigned int c2 = 0;
+					unsigned int c3 = 0;
+
+					for(int s = 0; s < samples; s++)
+					{
+						const unsigned char *sample = source0 + s * slice + 4 * x;
+
+						c0 += tables.toLinear[sample[0]];
+						c1 += tables.toLinear[sample[1]];
+						c2 += tables.toLinear[sample[2]];
+						c3 += sample[3];
+					}
+
+					unsigned char *target = source0 + 4 * x;
+
+					target[0] = tables.toSRGB[(c0 + samples / 2) / samples];
+					target[1] = tables.toSRGB[(c1 + samples / 2) / samples];
+					target[2] = tables.toSRGB[(c2 + samples / 2) / samples];
+					target[3] = (unsigned char)((c3 + samples / 2) / samples);
+				}
+
+				source0 += pitch;
+			}
+		}
+		else if(buffer.format == FORMAT_X8R8G8B8 || buffer.format == FORMAT_A8R8G8B8 ||
+		        buffer.format == FORMAT_X8B8G8R8 || buffer.format == FORMAT_A8B8G8R8)
 		{
 			#if defined(__i386__) || defined(__x86_64__)
 				if(CPUID::supportsSSE2() && (width % 4) == 0)
 				{
-					if(internal.samples == 2)
+					if(buffer.samples == 2)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4056,7 +4762,7 @@ namespace sw
 							source1 += pitch;
 						}
 					}
-					else if(internal.samples == 4)
+					else if(buffer.samples == 4)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4080,7 +4786,7 @@ namespace sw
 							source3 += pitch;
 						}
 					}
-					else if(internal.samples == 8)
+					else if(buffer.samples == 8)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4116,7 +4822,7 @@ namespace sw
 							source7 += pitch;
 						}
 					}
-					else if(internal.samples == 16)
+					else if(buffer.samples == 16)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4183,7 +4889,7 @@ namespace sw
 			{
 				#define AVERAGE(x, y) (((x) & (y)) + ((((x) ^ (y)) >> 1) & 0x7F7F7F7F) + (((x) ^ (y)) & 0x01010101))
 
-				if(internal.samples == 2)
+				if(buffer.samples == 2)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -4201,7 +4907,7 @@ namespace sw
 						source1 += pitch;
 					}
 				}
-				else if(internal.samples == 4)
+				else if(buffer.samples == 4)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -4225,7 +4931,7 @@ namespace sw
 						source3 += pitch;
 					}
 				}
-				else if(internal.samples == 8)
+				else if(buffer.samples == 8)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -4261,7 +4967,7 @@ namespace sw
 						source7 += pitch;
 					}
 				}
-				else if(internal.samples == 16)
+				else if(buffer.samples == 16)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -4326,13 +5032,13 @@ namespace sw
 				#undef AVERAGE
 			}
 		}
-		else if(internal.format == FORMAT_G16R16)
+		else if(buffer.format == FORMAT_G16R16)
 		{
 
 			#if defined(__i386__) || defined(__x86_64__)
 				if(CPUID::supportsSSE2() && (width % 4) == 0)
 				{
-					if(internal.samples == 2)
+					if(buffer.samples == 2)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4350,7 +5056,7 @@ namespace sw
 							source1 += pitch;
 						}
 					}
-					else if(internal.samples == 4)
+					else if(buffer.samples == 4)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4374,7 +5080,7 @@ namespace sw
 							source3 += pitch;
 						}
 					}
-					else if(internal.samples == 8)
+					else if(buffer.samples == 8)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4410,7 +5116,7 @@ namespace sw
 							source7 += pitch;
 						}
 					}
-					else if(internal.samples == 16)
+					else if(buffer.samples == 16)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4477,7 +5183,7 @@ namespace sw
 			{
 				#define AVERAGE(x, y) (((x) & (y)) + ((((x) ^ (y)) >> 1) & 0x7FFF7FFF) + (((x) ^ (y)) & 0x00010001))
 
-				if(internal.samples == 2)
+				if(buffer.samples == 2)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -4495,7 +5201,7 @@ namespace sw
 						source1 += pitch;
 					}
 				}
-				else if(internal.samples == 4)
+				else if(buffer.samples == 4)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -4519,7 +5225,7 @@ namespace sw
 						source3 += pitch;
 					}
 				}
-				else if(internal.samples == 8)
+				else if(buffer.samples == 8)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -4555,7 +5261,7 @@ namespace sw
 						source7 += pitch;
 					}
 				}
-				else if(internal.samples == 16)
+				else if(buffer.samples == 16)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -4620,12 +5326,12 @@ namespace sw
 				#undef AVERAGE
 			}
 		}
-		else if(internal.format == FORMAT_A16B16G16R16)
+		else if(buffer.format == FORMAT_A16B16G16R16)
 		{
 			#if defined(__i386__) || defined(__x86_64__)
 				if(CPUID::supportsSSE2() && (width % 2) == 0)
 				{
-					if(internal.samples == 2)
+					if(buffer.samples == 2)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4643,7 +5349,7 @@ namespace sw
 							source1 += pitch;
 						}
 					}
-					else if(internal.samples == 4)
+					else if(buffer.samples == 4)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4667,7 +5373,7 @@ namespace sw
 							source3 += pitch;
 						}
 					}
-					else if(internal.samples == 8)
+					else if(buffer.samples == 8)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4703,7 +5409,7 @@ namespace sw
 							source7 += pitch;
 						}
 					}
-					else if(internal.samples == 16)
+					else if(buffer.samples == 16)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4770,7 +5476,7 @@ namespace sw
 			{
 				#define AVERAGE(x, y) (((x) & (y)) + ((((x) ^ (y)) >> 1) & 0x7FFF7FFF) + (((x) ^ (y)) & 0x00010001))
 
-				if(internal.samples == 2)
+				if(buffer.samples == 2)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -4788,7 +5494,7 @@ namespace sw
 						source1 += pitch;
 					}
 				}
-				else if(internal.samples == 4)
+				else if(buffer.samples == 4)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -4812,7 +5518,7 @@ namespace sw
 						source3 += pitch;
 					}
 				}
-				else if(internal.samples == 8)
+				else if(buffer.samples == 8)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -4848,7 +5554,7 @@ namespace sw
 						source7 += pitch;
 					}
 				}
-				else if(internal.samples == 16)
+				else if(buffer.samples == 16)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -4913,12 +5619,12 @@ namespace sw
 				#undef AVERAGE
 			}
 		}
-		else if(internal.format == FORMAT_R32F)
+		else if(buffer.format == FORMAT_R32F)
 		{
 			#if defined(__i386__) || defined(__x86_64__)
 				if(CPUID::supportsSSE() && (width % 4) == 0)
 				{
-					if(internal.samples == 2)
+					if(buffer.samples == 2)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4937,7 +5643,7 @@ namespace sw
 							source1 += pitch;
 						}
 					}
-					else if(internal.samples == 4)
+					else if(buffer.samples == 4)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4962,7 +5668,7 @@ namespace sw
 							source3 += pitch;
 						}
 					}
-					else if(internal.samples == 8)
+					else if(buffer.samples == 8)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -4999,7 +5705,7 @@ namespace sw
 							source7 += pitch;
 						}
 					}
-					else if(internal.samples == 16)
+					else if(buffer.samples == 16)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -5065,7 +5771,7 @@ namespace sw
 				else
 			#endif
 			{
-				if(internal.samples == 2)
+				if(buffer.samples == 2)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -5084,7 +5790,7 @@ namespace sw
 						source1 += pitch;
 					}
 				}
-				else if(internal.samples == 4)
+				else if(buffer.samples == 4)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -5109,7 +5815,7 @@ namespace sw
 						source3 += pitch;
 					}
 				}
-				else if(internal.samples == 8)
+				else if(buffer.samples == 8)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -5146,7 +5852,7 @@ namespace sw
 						source7 += pitch;
 					}
 				}
-				else if(internal.samples == 16)
+				else if(buffer.samples == 16)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -5210,12 +5916,12 @@ namespace sw
 				else ASSERT(false);
 			}
 		}
-		else if(internal.format == FORMAT_G32R32F)
+		else if(buffer.format == FORMAT_G32R32F)
 		{
 			#if defined(__i386__) || defined(__x86_64__)
 				if(CPUID::supportsSSE() && (width % 2) == 0)
 				{
-					if(internal.samples == 2)
+					if(buffer.samples == 2)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -5234,7 +5940,7 @@ namespace sw
 							source1 += pitch;
 						}
 					}
-					else if(internal.samples == 4)
+					else if(buffer.samples == 4)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -5259,7 +5965,7 @@ namespace sw
 							source3 += pitch;
 						}
 					}
-					else if(internal.samples == 8)
+					else if(buffer.samples == 8)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -5296,7 +6002,7 @@ namespace sw
 							source7 += pitch;
 						}
 					}
-					else if(internal.samples == 16)
+					else if(buffer.samples == 16)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -5362,7 +6068,7 @@ namespace sw
 				else
 			#endif
 			{
-				if(internal.samples == 2)
+				if(buffer.samples == 2)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -5381,7 +6087,7 @@ namespace sw
 						source1 += pitch;
 					}
 				}
-				else if(internal.samples == 4)
+				else if(buffer.samples == 4)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -5406,7 +6112,7 @@ namespace sw
 						source3 += pitch;
 					}
 				}
-				else if(internal.samples == 8)
+				else if(buffer.samples == 8)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -5443,7 +6149,7 @@ namespace sw
 						source7 += pitch;
 					}
 				}
-				else if(internal.samples == 16)
+				else if(buffer.samples == 16)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -5507,14 +6213,14 @@ namespace sw
 				else ASSERT(false);
 			}
 		}
-		else if(internal.format == FORMAT_A32B32G32R32F ||
-		        internal.format == FORMAT_X32B32G32R32F ||
-		        internal.format == FORMAT_X32B32G32R32F_UNSIGNED)
+		else if(buffer.format == FORMAT_A32B32G32R32F ||
+		        buffer.format == FORMAT_X32B32G32R32F ||
+		        buffer.format == FORMAT_X32B32G32R32F_UNSIGNED)
 		{
 			#if defined(__i386__) || defined(__x86_64__)
 				if(CPUID::supportsSSE())
 				{
-					if(internal.samples == 2)
+					if(buffer.samples == 2)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -5533,7 +6239,7 @@ namespace sw
 							source1 += pitch;
 						}
 					}
-					else if(internal.samples == 4)
+					else if(buffer.samples == 4)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -5558,7 +6264,7 @@ namespace sw
 							source3 += pitch;
 						}
 					}
-					else if(internal.samples == 8)
+					else if(buffer.samples == 8)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -5595,7 +6301,7 @@ namespace sw
 							source7 += pitch;
 						}
 					}
-					else if(internal.samples == 16)
+					else if(buffer.samples == 16)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -5661,7 +6367,7 @@ namespace sw
 				else
 			#endif
 			{
-				if(internal.samples == 2)
+				if(buffer.samples == 2)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -5680,7 +6386,7 @@ namespace sw
 						source1 += pitch;
 					}
 				}
-				else if(internal.samples == 4)
+				else if(buffer.samples == 4)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -5705,7 +6411,7 @@ namespace sw
 						source3 += pitch;
 					}
 				}
-				else if(internal.samples == 8)
+				else if(buffer.samples == 8)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -5742,7 +6448,7 @@ namespace sw
 						source7 += pitch;
 					}
 				}
-				else if(internal.samples == 16)
+				else if(buffer.samples == 16)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -5806,12 +6512,12 @@ namespace sw
 				else ASSERT(false);
 			}
 		}
-		else if(internal.format == FORMAT_R5G6B5)
+		else if(buffer.format == FORMAT_R5G6B5)
 		{
 			#if defined(__i386__) || defined(__x86_64__)
 				if(CPUID::supportsSSE2() && (width % 8) == 0)
 				{
-					if(internal.samples == 2)
+					if(buffer.samples == 2)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -5840,7 +6546,7 @@ namespace sw
 							source1 += pitch;
 						}
 					}
-					else if(internal.samples == 4)
+					else if(buffer.samples == 4)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -5881,7 +6587,7 @@ namespace sw
 							source3 += pitch;
 						}
 					}
-					else if(internal.samples == 8)
+					else if(buffer.samples == 8)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -5946,7 +6652,7 @@ namespace sw
 							source7 += pitch;
 						}
 					}
-					else if(internal.samples == 16)
+					else if(buffer.samples == 16)
 					{
 						for(int y = 0; y < height; y++)
 						{
@@ -6066,7 +6772,7 @@ namespace sw
 			{
 				#define AVERAGE(x, y) (((x) & (y)) + ((((x) ^ (y)) >> 1) & 0x7BEF) + (((x) ^ (y)) & 0x0821))
 
-				if(internal.samples == 2)
+				if(buffer.samples == 2)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -6084,7 +6790,7 @@ namespace sw
 						source1 += pitch;
 					}
 				}
-				else if(internal.samples == 4)
+				else if(buffer.samples == 4)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -6108,7 +6814,7 @@ namespace sw
 						source3 += pitch;
 					}
 				}
-				else if(internal.samples == 8)
+				else if(buffer.samples == 8)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -6144,7 +6850,7 @@ namespace sw
 						source7 += pitch;
 					}
 				}
-				else if(internal.samples == 16)
+				else if(buffer.samples == 16)
 				{
 					for(int y = 0; y < height; y++)
 					{
@@ -19,6 +19,8 @@
 #include "Main/Config.hpp"
 #include "Common/Resource.hpp"
 
+#include <atomic>
+
 namespace sw
 {
 	class Resource;
@@ -274,6 +276,12 @@ namespace sw
 			AtomicInt lock;
 
 			bool dirty;   // Sibling internal/external buffer doesn't match.
+
+			// Clears of entire CLEAR_TILE_SIZE tiles of single-layer buffers only record the value,
+			// which gets written on the first access to the tile.
+			std::atomic<int> *tileState;
+			unsigned int *tileValue;   // Clear pattern, replicated to 32 bits
+			AtomicInt clearedTiles;
 		};
 
 	protected:
@@ -320,6 +328,9 @@ namespace sw
 		inline int getStencilPitchB() const;
 		inline int getStencilSliceB() const;
 
+		bool adopt(Resource *owner, void *pixels, int pitchB, int sliceB);   // Shares the owner's memory as both buffers, until either side writes to it
+		static void releaseAdopters(Resource *owner);                       // Gives surfaces sharing the owner's memory their own copy
+
 		void sync();                      // Wait for lock(s) to be released.
 		virtual bool requiresSync() const { return false; }
 		inline bool isUnlocked() const;   // Only reliable after sync().
@@ -331,8 +342,13 @@ namespace sw
 		bool isEntire(const Rect& rect) const;
 		Rect getRect() const;
 		void clearDepth(float depth, int x0, int y0, int width, int height);
+		float *getHiZ(int z);   // Renderer access only, while the internal buffer is locked
+		inline int getHiZPitchB() const;
 		void clearStencil(unsigned char stencil, unsigned char mask, int x0, int y0, int width, int height);
+		bool clearColor(unsigned int pattern, const SliceRect &rect);   // Pattern replicated to 32 bits, false if the caller has to fill
 		void fill(const Color<float> &color, int x0, int y0, int width, int height);
+		bool hasClearedTiles() const;
+		void fillClearedTiles(int x0, int y0, int x1, int y1);   // Renderer access only, while the buffers are locked
 
 		Color<float> readExternal(int x, int y, int z) const;
 		Color<float> readExternal(int x, int y) const;
@@ -384,6 +400,12 @@ namespace sw
 
 		static void setTexturePalette(unsigned int *palette);
 
+		// Decoded compressed levels beyond this many bytes get released, and decoded again when next used (0 keeps all)
+		static void setDecodeCacheSize(size_t bytes);
+		// Decoded levels locked before this call are held by a draw, and may be released once it finishes.
+		// Releases levels beyond the cache size, so it must be called without holding any surface locks.
+		static void nextDecodeEpoch();
+
 	private:
 		sw::Resource *resource;
 
@@ -477,6 +499,26 @@ namespace sw
 		static void decodeDXT5(Buffer &internal, Buffer &external);
 		static void decodeATI1(Buffer &internal, Buffer &external);
 		static void decodeATI2(Buffer &internal, Buffer &external);
+
+		// Decodes one row of 4x4 blocks, clipped to the given texel width and height
+		typedef void (*BlockDecoder)(byte *dest, int pitchB, const byte *source, int width, int height);
+
+		static void decodeBlocks(Buffer &internal, Buffer &external, int blockBytes, BlockDecoder decoder);
+		static void decodeBlockRow(void *parameters, int row);
+		static void colorPalette(unsigned int c[4], word c0, word c1, bool opaque);
+		static void alphaPalette(byte a[8], byte e0, byte e1);
+		static void decodeDXT1Blocks(byte *dest, int pitchB, const byte *source, int width, int height);
+		static void decodeDXT3Blocks(byte *dest, int pitchB, const byte *source, int width, int height);
+		static void decodeDXT5Blocks(byte *dest, int pitchB, const byte *source, int width, int height);
+		static void decodeATI1Blocks(byte *dest, int pitchB, const byte *source, int width, int height);
+		static void decodeATI2Blocks(byte *dest, int pitchB, const byte *source, int width, int height);
+		template<int inputType, bool isSRGB>
+		static void decodeETC2Blocks(byte *dest, int pitchB, const byte *source, int width, int height);
+		template<int inputType>
+		static void decodeEACBlocks(byte *dest, int pitchB, const byte *source, int width, int height);
+
+		struct DecodeTask;
+
 		static void decodeEAC(Buffer &internal, Buffer &external, int nbChannels, bool isSigned);
 		static void decodeETC2(Buffer &internal, Buffer &external, int nbAlphaBits, bool isSRGB);
 		static void decodeASTC(Buffer &internal, Buffer &external, int xSize, int ySize, int zSize, bool isSRGB);
@@ -490,6 +532,28 @@ namespace sw
 		Format selectInternalFormat(Format format) const;
 
 		void resolve();
+		static void resolveBand(void *parameters, int band);
+		static void resolveRows(const Buffer &buffer, unsigned char *source, int height);
+
+		struct ResolveTask;
+		void clearHiZ(float depth, int x0, int y0, int x1, int y1, int z);
+
+		enum TileState { TILE_FILLED, TILE_CLEARED, TILE_FILLING };
+
+		void *lockStencil(int x, int y, int front, Accessor client, bool fillClearedTiles);
+		void clearTiles(Buffer &buffer, unsigned int pattern, int x0, int y0, int x1, int y1);
+		void fillTiles(Buffer &buffer, int x0, int y0, int x1, int y1);
+		void fillTile(Buffer &buffer, int tile);
+		void discardTiles(Buffer &buffer);
+		void fillRect(Buffer &buffer, unsigned int pattern, int x0, int y0, int x1, int y1);
+
+		void cacheDecodedLevel();
+		bool releaseDecodedLevel();
+		void unlinkDecodedLevel();
+		static void trimDecodeCache();
+
+		void detachAdopted();
+		void unlinkAdopted();
 
 		Buffer external;
 		Buffer internal;
@@ -506,6 +570,24 @@ namespace sw
 
 		bool hasParent;
 		bool ownExternal;
+
+		Surface *decodedPrevious;   // Decoded compressed levels, most recently used first
+		Surface *decodedNext;
+		int decodedEpoch;
+		bool decodedCached;
+		bool decodedReleasing;   // Picked by trimDecodeCache(), which is waiting for the resource
+
+		Resource *adoptedOwner;   // Memory shared with a resource, copied before it's written to
+		Surface *adoptedPrevious;
+		Surface *adoptedNext;
+
+		// Hierarchical depth: a conservative upper bound of the depth values in each tile of
+		// HIZ_TILE_WIDTH x 2 pixels of each slice, for single-sample depth buffers. Writes by
+		// anything other than the renderer invalidate the bounds, which are reset on the next draw.
+		float *hiZ;
+		int hiZPitchB;
+		int hiZSliceB;
+		bool hiZValid;
 	};
 }
 
@@ -634,6 +716,11 @@ namespace sw
 		return stencil.sliceB;
 	}
 
+	int Surface::getHiZPitchB() const
+	{
+		return hiZPitchB;
+	}
+
 	int Surface::getSamples() const
 	{
 		return internal.samples;
@@ -19,12 +19,36 @@
 
 namespace sw
 {
+	enum : unsigned int
+	{
+		COUNT_MASK = 0x00FFFFFF,
+		ACCESSOR_SHIFT = 24,
+		ACCESSOR_MASK = 0x3 << ACCESSOR_SHIFT,
+		BLOCKED = 1 << 28,    // Threads are waiting on the unblock event
+		ORPHANED = 1 << 29,   // destruct() was called while locked
+		CONTENDED = BLOCKED | ORPHANED
+	};
+
+	static inline unsigned int lockCount(unsigned int state)
+	{
+		return state & COUNT_MASK;
+	}
+
+	static inline Accessor lockAccessor(unsigned int state)
+	{
+		return static_cast<Accessor>((state & ACCESSOR_MASK) >> ACCESSOR_SHIFT);
+	}
+
+	static inline unsigned int claimed(unsigned int state, Accessor claimer)
+	{
+		return (state & ~(ACCESSOR_MASK | COUNT_MASK)) | (claimer << ACCESSOR_SHIFT) | (lockCount(state) + 1);
+	}
+
 	Resource::Resource(size_t bytes) : size(bytes)
 	{
-		blocked = 0;
+		state = PUBLIC << ACCESSOR_SHIFT;
 
-		accessor = PUBLIC;
-		count = 0;
+		blocked = 0;
 		orphaned = false;
 
 		buffer = allocate(bytes);
@@ -37,22 +61,18 @@ namespace sw
 
 	void *Resource::lock(Accessor claimer)
 	{
-		criticalSection.lock();
+		unsigned int s = state.load(std::memory_order_relaxed);
 
-		while(count > 0 && accessor != claimer)
+		while(!(s & CONTENDED) && (lockCount(s) == 0 || lockAccessor(s) == claimer))
 		{
-			blocked++;
-			criticalSection.unlock();
-
-			unblock.wait();
-
-			criticalSection.lock();
-			blocked--;
+			if(state.compare_exchange_weak(s, claimed(s, claimer), std::memory_order_acquire, std::memory_order_relaxed))
+			{
+				return buffer;
+			}
 		}
 
-		accessor = claimer;
-		count++;
-
+		criticalSection.lock();
+		acquire(claimer);
 		criticalSection.unlock();
 
 		return buffer;
@@ -60,110 +80,168 @@ namespace sw
 
 	void *Resource::lock(Accessor relinquisher, Accessor claimer)
 	{
+		unsigned int s = state.load(std::memory_order_relaxed);
+
+		while(!(s & CONTENDED) && (lockCount(s) == 0 || (lockAccessor(s) == claimer && claimer != relinquisher)))
+		{
+			if(state.compare_exchange_weak(s, claimed(s, claimer), std::memory_order_acquire, std::memory_order_relaxed))
+			{
+				return buffer;
+			}
+		}
+
 		criticalSection.lock();
 
 		// Release
-		while(count > 0 && accessor == relinquisher)
+		for(s = state.load(std::memory_order_relaxed); lockCount(s) > 0 && lockAccessor(s) == relinquisher; s = state.load(std::memory_order_relaxed))
 		{
-			count--;
-
-			if(count == 0)
+			if(release())
 			{
-				if(blocked)
-				{
-					unblock.signal();
-				}
-				else if(orphaned)
-				{
-					criticalSection.unlock();
+				return 0;
+			}
+		}
 
-					delete this;
+		// Acquire
+		acquire(claimer);
 
-					return 0;
-				}
+		criticalSection.unlock();
+
+		return buffer;
+	}
+
+	void Resource::unlock()
+	{
+		unsigned int s = state.load(std::memory_order_relaxed);
+		ASSERT(lockCount(s) > 0);
+
+		while(!(s & CONTENDED))
+		{
+			if(state.compare_exchange_weak(s, s - 1, std::memory_order_release, std::memory_order_relaxed))
+			{
+				return;
 			}
 		}
 
-		// Acquire
-		while(count > 0 && accessor != claimer)
+		criticalSection.lock();
+
+		if(!release())
 		{
-			blocked++;
 			criticalSection.unlock();
+		}
+	}
 
-			unblock.wait();
+	void Resource::unlock(Accessor relinquisher)
+	{
+		criticalSection.lock();
+		ASSERT(lockCount(state) > 0);
 
-			criticalSection.lock();
-			blocked--;
+		for(unsigned int s = state.load(std::memory_order_relaxed); lockCount(s) > 0 && lockAccessor(s) == relinquisher; s = state.load(std::memory_order_relaxed))
+		{
+			if(release())
+			{
+				return;
+			}
 		}
 
-		accessor = claimer;
-		count++;
-
 		criticalSection.unlock();
+	}
 
-		return buffer;
+	void Resource::lockAll(Resource *const resources[], int count, Accessor relinquisher, Accessor claimer)
+	{
+		for(int i = 0; i < count; i++)
+		{
+			if(resources[i])
+			{
+				resources[i]->lock(relinquisher, claimer);
+			}
+		}
 	}
 
-	void Resource::unlock()
+	void Resource::unlockAll(Resource *const resources[], int count)
 	{
-		criticalSection.lock();
-		ASSERT(count > 0);
+		for(int i = 0; i < count; i++)
+		{
+			if(resources[i])
+			{
+				resources[i]->unlock();
+			}
+		}
+	}
 
-		count--;
+	void Resource::acquire(Accessor claimer)
+	{
+		unsigned int s = state.load(std::memory_order_relaxed);
 
-		if(count == 0)
+		while(true)
 		{
-			if(blocked)
+			if(lockCount(s) == 0 || lockAccessor(s) == claimer)
 			{
-				unblock.signal();
+				if(state.compare_exchange_weak(s, claimed(s, claimer), std::memory_order_acquire, std::memory_order_relaxed))
+				{
+					return;
+				}
+
+				continue;
 			}
-			else if(orphaned)
+
+			// Once the flag is set any release has to take the critical section and signal us,
+			// so only wait if the resource was still held by another accessor at that point.
+			blocked++;
+			s = state.fetch_or(BLOCKED, std::memory_order_acq_rel);
+
+			if(lockCount(s) > 0 && lockAccessor(s) != claimer)
 			{
 				criticalSection.unlock();
 
-				delete this;
+				unblock.wait();
 
-				return;
+				criticalSection.lock();
 			}
-		}
 
-		criticalSection.unlock();
+			blocked--;
+
+			if(blocked == 0)
+			{
+				state.fetch_and(~BLOCKED, std::memory_order_relaxed);
+			}
+
+			s = state.load(std::memory_order_relaxed);
+		}
 	}
 
-	void Resource::unlock(Accessor relinquisher)
+	bool Resource::release()
 	{
-		criticalSection.lock();
-		ASSERT(count > 0);
+		unsigned int s = state.fetch_sub(1, std::memory_order_release);
+		ASSERT(lockCount(s) > 0);
 
-		while(count > 0 && accessor == relinquisher)
+		if(lockCount(s) == 1)
 		{
-			count--;
-
-			if(count == 0)
+			if(blocked)
 			{
-				if(blocked)
-				{
-					unblock.signal();
-				}
-				else if(orphaned)
-				{
-					criticalSection.unlock();
+				unblock.signal();
+			}
+			else if(orphaned)
+			{
+				criticalSection.unlock();
 
-					delete this;
+				delete this;
 
-					return;
-				}
+				return true;
 			}
 		}
 
-		criticalSection.unlock();
+		return false;
 	}
 
 	void Resource::destruct()
 	{
 		criticalSection.lock();
 
-		if(count == 0 && !blocked)
+		// Any unlock from here on takes the critical section and observes the orphaned state
+		orphaned = true;
+		unsigned int s = state.fetch_or(ORPHANED, std::memory_order_acq_rel);
+
+		if(lockCount(s) == 0 && !blocked)
 		{
 			criticalSection.unlock();
 
@@ -172,8 +250,6 @@ namespace sw
 			return;
 		}
 
-		orphaned = true;
-
 		criticalSection.unlock();
 	}
 
@@ -17,6 +17,8 @@
 
 #include "MutexLock.hpp"
 
+#include <atomic>
+
 namespace sw
 {
 	enum Accessor
@@ -39,18 +41,26 @@ namespace sw
 		void unlock();
 		void unlock(Accessor relinquisher);
 
+		// Lock or unlock a set of resources in one pass. Null entries are skipped.
+		static void lockAll(Resource *const resources[], int count, Accessor relinquisher, Accessor claimer);
+		static void unlockAll(Resource *const resources[], int count);
+
 		const void *data() const;
 		const size_t size;
 
 	private:
 		~Resource();   // Always call destruct() instead
 
+		void acquire(Accessor claimer);   // Requires criticalSection
+		bool release();                   // Requires criticalSection, returns true when deleted
+
+		// Lock count, current accessor, and the flags which divert to the contended path, packed
+		// so that uncontended locking and unlocking is a single compare-and-swap.
+		std::atomic<unsigned int> state;
+
 		MutexLock criticalSection;
 		Event unblock;
-		volatile int blocked;
-
-		volatile Accessor accessor;
-		volatile int count;
+		int blocked;
 		bool orphaned;
 
 		void *buffer;
@@ -14,6 +14,8 @@
 
 #include "Thread.hpp"
 
+#include "MutexLock.hpp"
+
 namespace sw
 {
 	Thread::Thread(void (*threadFunction)(void *parameters), void *parameters)
@@ -88,4 +90,143 @@ namespace sw
 			pthread_mutex_destroy(&mutex);
 		#endif
 	}
+
+	namespace
+	{
+		// Workers are kept between parallelRows() calls, so that short jobs don't pay for thread creation
+		class RowPool
+		{
+		public:
+			RowPool();
+
+			~RowPool();
+
+			void run(int rows, int threads, void (*function)(void *parameters, int row), void *parameters);
+
+		private:
+			enum {MAX_WORKERS = 15};
+
+			struct Worker
+			{
+				RowPool *pool;
+				Thread *thread;
+				Event wake;
+			};
+
+			static void workerFunction(void *parameters);
+			void processRows();
+
+			Worker worker[MAX_WORKERS];
+			volatile bool terminate;
+
+			MutexLock busy;   // Held by the thread which dispatches to the workers
+			Event done;
+			AtomicInt pending;
+
+			void (*function)(void *parameters, int row);
+			void *parameters;
+			int rows;
+			AtomicInt nextRow;
+		};
+
+		RowPool::RowPool() : terminate(false)
+		{
+			for(int i = 0; i < MAX_WORKERS; i++)
+			{
+				worker[i].pool = this;
+				worker[i].thread = nullptr;
+			}
+		}
+
+		RowPool::~RowPool()
+		{
+			terminate = true;
+
+			for(int i = 0; i < MAX_WORKERS; i++)
+			{
+				if(worker[i].thread)
+				{
+					worker[i].wake.signal();
+					worker[i].thread->join();
+					delete worker[i].thread;
+				}
+			}
+		}
+
+		void RowPool::run(int rows, int threads, void (*function)(void *parameters, int row), void *parameters)
+		{
+			int workers = (threads < rows ? threads : rows) - 1;
+			workers = workers < MAX_WORKERS ? workers : MAX_WORKERS;
+
+			// Nested or concurrent jobs run on the calling thread only
+			if(workers <= 0 || !busy.attemptLock())
+			{
+				for(int row = 0; row < rows; row++)
+				{
+					function(parameters, row);
+				}
+
+				return;
+			}
+
+			this->function = function;
+			this->parameters = parameters;
+			this->rows = rows;
+			nextRow = 0;
+			pending = workers;
+
+			for(int i = 0; i < workers; i++)
+			{
+				if(!worker[i].thread)
+				{
+					worker[i].thread = new Thread(workerFunction, &worker[i]);
+				}
+
+				worker[i].wake.signal();
+			}
+
+			processRows();
+			done.wait();
+
+			busy.unlock();
+		}
+
+		void RowPool::workerFunction(void *parameters)
+		{
+			Worker *worker = static_cast<Worker*>(parameters);
+			RowPool *pool = worker->pool;
+
+			while(true)
+			{
+				worker->wake.wait();
+
+				if(pool->terminate)
+				{
+					return;
+				}
+
+				pool->processRows();
+
+				if(pool->pending-- == 0)   // Post-decrement returns the new value
+				{
+					pool->done.signal();
+				}
+			}
+		}
+
+		void RowPool::processRows()
+		{
+			for(int row = nextRow++ - 1; row < rows; row = nextRow++ - 1)
+			{
+				function(parameters, row);
+			}
+		}
+	}
+
+	void parallelRows(int rows, int threads, void (*function)(void *parameters, int row), void *parameters)
+	{
+		static RowPool pool;
+
+		pool.run(rows, threads, function, parameters);
+	}
 }
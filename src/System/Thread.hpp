@@ -121,6 +121,10 @@ namespace sw
 	int atomicDecrement(int volatile *value);
 	int atomicAdd(int volatile *target, int value);
 	void nop();
+
+	// Calls function(parameters, row) for each row in [0, rows), on the calling thread and on up to threads - 1
+	// pooled worker threads. Rows are handed out one at a time, so they may complete in any order.
+	void parallelRows(int rows, int threads, void (*function)(void *parameters, int row), void *parameters);
 }
 
 namespace sw
@@ -327,19 +327,28 @@ private:
 
 struct ClearAttachment : public CommandBuffer::Command
 {
-	ClearAttachment(const VkClearAttachment& attachment, const VkClearRect& rect) :
-		attachment(attachment), rect(rect)
+	ClearAttachment(const VkClearAttachment& attachment, uint32_t rectCount, const VkClearRect* pRects) :
+		attachment(attachment), rectCount(rectCount)
 	{
+		// FIXME (b/119409619): use an allocator here so we can control all memory allocations
+		rects = new VkClearRect[rectCount];
+		memcpy(rects, pRects, rectCount * sizeof(VkClearRect));
+	}
+
+	~ClearAttachment() override
+	{
+		delete [] rects;
 	}
 
 	void play(CommandBuffer::ExecutionState& executionState)
 	{
-		executionState.renderPassFramebuffer->clear(attachment, rect);
+		executionState.renderPassFramebuffer->clear(attachment, rectCount, rects);
 	}
 
 private:
 	const VkClearAttachment attachment;
-	const VkClearRect rect;
+	uint32_t rectCount;
+	VkClearRect* rects;
 };
 
 struct BlitImage : public CommandBuffer::Command
@@ -789,10 +798,7 @@ void CommandBuffer::clearAttachments(uint32_t attachmentCount, const VkClearAtta
 
 	for(uint32_t i = 0; i < attachmentCount; i++)
 	{
-		for(uint32_t j = 0; j < rectCount; j++)
-		{
-			addCommand<ClearAttachment>(pAttachments[i], pRects[j]);
-		}
+		addCommand<ClearAttachment>(pAttachments[i], rectCount, pRects);
 	}
 }
 
@@ -69,7 +69,7 @@ void Framebuffer::clear(uint32_t clearValueCount, const VkClearValue* pClearValu
 	}
 }
 
-void Framebuffer::clear(const VkClearAttachment& attachment, const VkClearRect& rect)
+void Framebuffer::clear(const VkClearAttachment& attachment, uint32_t rectCount, const VkClearRect* pRects)
 {
 	if(attachment.aspectMask == VK_IMAGE_ASPECT_COLOR_BIT)
 	{
@@ -81,7 +81,7 @@ void Framebuffer::clear(const VkClearAttachment& attachment, const VkClearRect&
 			ASSERT(subpass.pColorAttachments[attachment.colorAttachment].attachment < attachmentCount);
 
 			attachments[subpass.pColorAttachments[attachment.colorAttachment].attachment]->clear(
-				attachment.clearValue, attachment.aspectMask, rect);
+				attachment.clearValue, attachment.aspectMask, rectCount, pRects);
 		}
 	}
 	else if(attachment.aspectMask & (VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT))
@@ -90,7 +90,7 @@ void Framebuffer::clear(const VkClearAttachment& attachment, const VkClearRect&
 
 		ASSERT(subpass.pDepthStencilAttachment->attachment < attachmentCount);
 
-		attachments[subpass.pDepthStencilAttachment->attachment]->clear(attachment.clearValue, attachment.aspectMask, rect);
+		attachments[subpass.pDepthStencilAttachment->attachment]->clear(attachment.clearValue, attachment.aspectMask, rectCount, pRects);
 	}
 }
 
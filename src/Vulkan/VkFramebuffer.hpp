@@ -31,7 +31,7 @@ public:
 	void destroy(const VkAllocationCallbacks* pAllocator);
 
 	void clear(uint32_t clearValueCount, const VkClearValue* pClearValues, const VkRect2D& renderArea);
-	void clear(const VkClearAttachment& attachment, const VkClearRect& rect);
+	void clear(const VkClearAttachment& attachment, uint32_t rectCount, const VkClearRect* pRects);
 
 	static size_t ComputeRequiredAllocationSize(const VkFramebufferCreateInfo* pCreateInfo);
 
@@ -17,7 +17,9 @@
 #include "VkImage.hpp"
 #include "Device/Blitter.hpp"
 #include "Device/Surface.hpp"
+#include <algorithm>
 #include <cstring>
+#include <vector>
 
 namespace vk
 {
@@ -558,6 +560,52 @@ void Image::clear(void* pixelData, VkFormat format, const VkRect2D& renderArea,
 	}
 }
 
+void Image::clear(void* pixelData, VkFormat format, uint32_t rectCount, const VkClearRect* pRects, const VkImageSubresourceRange& subresourceRange, VkImageAspectFlags aspectMask)
+{
+	if((subresourceRange.baseMipLevel != 0) ||
+	   (subresourceRange.levelCount != 1))
+	{
+		UNIMPLEMENTED();
+	}
+
+	uint32_t firstLayer = ~0u;
+	uint32_t lastLayer = 0;
+	for(uint32_t i = 0; i < rectCount; ++i)
+	{
+		firstLayer = std::min(firstLayer, pRects[i].baseArrayLayer);
+		lastLayer = std::max(lastLayer, pRects[i].baseArrayLayer + pRects[i].layerCount - 1);
+	}
+
+	// All rectangles of a layer are cleared by a single batch
+	std::vector<sw::SliceRect> dRects;
+	for(uint32_t layer = firstLayer; layer <= lastLayer && rectCount > 0; ++layer)
+	{
+		dRects.clear();
+		for(uint32_t i = 0; i < rectCount; ++i)
+		{
+			if((layer < pRects[i].baseArrayLayer) || (layer >= pRects[i].baseArrayLayer + pRects[i].layerCount))
+			{
+				continue;
+			}
+
+			const VkRect2D& rect = pRects[i].rect;
+			for(uint32_t s = 0; s < extent.depth; ++s)
+			{
+				dRects.push_back(sw::SliceRect(rect.offset.x, rect.offset.y,
+				                               rect.offset.x + rect.extent.width,
+				                               rect.offset.y + rect.extent.height, s));
+			}
+		}
+
+		if(!dRects.empty())
+		{
+			sw::Surface* surface = asSurface(aspectMask, 0, subresourceRange.baseArrayLayer + layer);
+			blitter->clear(pixelData, format, surface, dRects.data(), static_cast<int>(dRects.size()), 0xF);
+			delete surface;
+		}
+	}
+}
+
 void Image::clear(const VkClearColorValue& color, const VkImageSubresourceRange& subresourceRange)
 {
 	if(!(subresourceRange.aspectMask == VK_IMAGE_ASPECT_COLOR_BIT))
@@ -616,4 +664,32 @@ void Image::clear(const VkClearValue& clearValue, const VkRect2D& renderArea, co
 	}
 }
 
+void Image::clear(const VkClearValue& clearValue, const VkImageSubresourceRange& subresourceRange, uint32_t rectCount, const VkClearRect* pRects)
+{
+	if(!((subresourceRange.aspectMask == VK_IMAGE_ASPECT_COLOR_BIT) ||
+	     (subresourceRange.aspectMask & (VK_IMAGE_ASPECT_DEPTH_BIT |
+	                                     VK_IMAGE_ASPECT_STENCIL_BIT))))
+	{
+		UNIMPLEMENTED();
+	}
+
+	// The layers of the rectangles are relative to the subresource range
+	if(subresourceRange.aspectMask == VK_IMAGE_ASPECT_COLOR_BIT)
+	{
+		clear((void*)(clearValue.color.float32), getClearFormat(), rectCount, pRects, subresourceRange, VK_IMAGE_ASPECT_COLOR_BIT);
+	}
+	else
+	{
+		if(subresourceRange.aspectMask & VK_IMAGE_ASPECT_DEPTH_BIT)
+		{
+			clear((void*)(&clearValue.depthStencil.depth), VK_FORMAT_D32_SFLOAT, rectCount, pRects, subresourceRange, VK_IMAGE_ASPECT_DEPTH_BIT);
+		}
+
+		if(subresourceRange.aspectMask & VK_IMAGE_ASPECT_STENCIL_BIT)
+		{
+			clear((void*)(&clearValue.depthStencil.stencil), VK_FORMAT_S8_UINT, rectCount, pRects, subresourceRange, VK_IMAGE_ASPECT_STENCIL_BIT);
+		}
+	}
+}
+
 } // namespace vk
\ No newline at end of file
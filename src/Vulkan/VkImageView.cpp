@@ -91,7 +91,7 @@ void ImageView::clear(const VkClearValue& clearValue, const VkImageAspectFlags a
 	image->clear(clearValue, renderArea, subresourceRange);
 }
 
-void ImageView::clear(const VkClearValue& clearValue, const VkImageAspectFlags aspectMask, const VkClearRect& renderArea)
+void ImageView::clear(const VkClearValue& clearValue, const VkImageAspectFlags aspectMask, uint32_t rectCount, const VkClearRect* pRects)
 {
 	// Note: clearing ignores swizzling, so components is ignored.
 
@@ -105,14 +105,10 @@ void ImageView::clear(const VkClearValue& clearValue, const VkImageAspectFlags a
 		UNIMPLEMENTED();
 	}
 
-	VkImageSubresourceRange sr;
+	VkImageSubresourceRange sr = subresourceRange;
 	sr.aspectMask = aspectMask;
-	sr.baseMipLevel = subresourceRange.baseMipLevel;
-	sr.levelCount = subresourceRange.levelCount;
-	sr.baseArrayLayer = renderArea.baseArrayLayer + subresourceRange.baseArrayLayer;
-	sr.layerCount = renderArea.layerCount;
 
-	image->clear(clearValue, renderArea.rect, sr);
+	image->clear(clearValue, sr, rectCount, pRects);
 }
 
 }
\ No newline at end of file
@@ -32,7 +32,7 @@ public:
 	static size_t ComputeRequiredAllocationSize(const VkImageViewCreateInfo* pCreateInfo);
 
 	void clear(const VkClearValue& clearValues, const VkImageAspectFlags aspectMask, const VkRect2D& renderArea);
-	void clear(const VkClearValue& clearValue, const VkImageAspectFlags aspectMask, const VkClearRect& renderArea);
+	void clear(const VkClearValue& clearValue, const VkImageAspectFlags aspectMask, uint32_t rectCount, const VkClearRect* pRects);
 
 private:
 	bool                       imageTypesMatch(VkImageType imageType) const;
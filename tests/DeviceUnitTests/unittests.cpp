@@ -0,0 +1,441 @@
+// Copyright 2019 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit tests of Device components which are hard to reach through the Vulkan API.
+
+#include "gtest/gtest.h"
+
+#include "Device/ASTC_Decoder.hpp"
+#include "Device/Blitter.hpp"
+#include "Device/ETC_Decoder.hpp"
+#include "System/CPUID.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+namespace sw
+{
+	extern AtomicInt threadCount;
+}
+
+namespace
+{
+	// Reference blocks, encoded by hand following the ASTC chapter of the Khronos Data Format Specification
+
+	// LDR void extent without extent coordinates, of UNORM16 color (0xFFFF, 0x8000, 0x0000, 0x4000)
+	const unsigned char ldrVoidExtent[16] = {0xFC, 0xFD, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x80, 0x00, 0x00, 0x00, 0x40};
+
+	// HDR void extent of half-precision color (1.0, 2.0, 0.5, 1.0)
+	const unsigned char hdrVoidExtent[16] = {0xFC, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x3C, 0x00, 0x40, 0x00, 0x38, 0x00, 0x3C};
+
+	// Block mode 0x42 is a 4x4 weight grid of 2-bit weights. LDR luminance endpoints 0 and 255 are stored
+	// as 8-bit values. Texel (x, y) has weight (x + y) % 4, which unquantizes to 0, 21, 43 or 64.
+	const unsigned char luminanceBlock[16] = {0x42, 0x00, 0x00, 0xFE, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC9, 0x72, 0x9C, 0x27};
+
+	// Weights of the luminance block interpolate between the endpoints expanded to 16-bit
+	const unsigned int luminanceUNORM16[4] = {0x0000, 21504, 44031, 0xFFFF};   // Endpoints 0x0000 and 0xFFFF
+	const unsigned char luminanceSRGB8[4] = {0, 84, 171, 255};                   // Endpoints 0x0080 and 0xFF80
+
+	// Block mode 0 is reserved
+	const unsigned char reservedBlock[16] = {};
+
+	void decode(const unsigned char *block, float rgba[4][4][4], int xBlockSize = 4, int yBlockSize = 4)
+	{
+		ASTC_Decoder::Decode(block, reinterpret_cast<unsigned char*>(rgba), xBlockSize, yBlockSize, 4, 4, 1, 4 * 16, 4 * 4 * 16,
+		                     xBlockSize, yBlockSize, 1, false, 0, 1);
+	}
+
+	void decodeSRGB(const unsigned char *block, unsigned char bgra[4][4][4])
+	{
+		ASTC_Decoder::Decode(block, reinterpret_cast<unsigned char*>(bgra), 4, 4, 4, 4, 1, 4 * 4, 4 * 4 * 4, 4, 4, 1, true, 0, 1);
+	}
+
+	// ETC1 block in differential mode, of base color 16 in all channels, which expands to 132. Every pixel
+	// index is 0, which adds 2 in modifier table 0.
+	const unsigned char etc1Block[8] = {0x80, 0x80, 0x80, 0x02, 0x00, 0x00, 0x00, 0x00};
+
+	// EAC R11 blocks of base codeword 128 in modifier table 0, where pixel index 0 selects -3. The 11-bit value
+	// is 8 * 128 + 4 plus the modifier, scaled by 8 * multiplier unless the multiplier is 0.
+	const unsigned char eacBlock[8] = {0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+	const unsigned char eacMultipliedBlock[8] = {0x80, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+	// Xorshift, so that the random blocks don't depend on the C library
+	unsigned char randomByte(unsigned int &state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+
+		return (unsigned char)state;
+	}
+
+	uint64_t fnv1a(const std::vector<unsigned char> &bytes)
+	{
+		uint64_t hash = 0xCBF29CE484222325ull;
+
+		for(unsigned char byte : bytes)
+		{
+			hash = (hash ^ byte) * 0x100000001B3ull;
+		}
+
+		return hash;
+	}
+
+	// Disables SSE2 and the extensions which depend on it, for the lifetime of the object
+	class ScalarPath
+	{
+	public:
+		ScalarPath() : sse3(sw::CPUID::supportsSSE3()), ssse3(sw::CPUID::supportsSSSE3()), sse4_1(sw::CPUID::supportsSSE4_1())
+		{
+			sw::CPUID::setEnableSSE2(false);
+		}
+
+		~ScalarPath()
+		{
+			sw::CPUID::setEnableSSE2(true);
+			sw::CPUID::setEnableSSE3(sse3);
+			sw::CPUID::setEnableSSSE3(ssse3);
+			sw::CPUID::setEnableSSE4_1(sse4_1);
+		}
+
+	private:
+		const bool sse3;
+		const bool ssse3;
+		const bool sse4_1;
+	};
+
+	const int blitWidth = 300;
+	const int blitHeight = 200;
+
+	// Overlapping rectangles, small ones for the batching and large ones for the threading
+	void randomRects(std::vector<sw::SliceRect> &destRects, std::vector<sw::SliceRectF> &sourceRects, int count, int maxSize)
+	{
+		for(int i = 0; i < count; i++)
+		{
+			int w = 1 + rand() % maxSize;
+			int h = 1 + rand() % maxSize;
+			int x = rand() % (blitWidth - w);
+			int y = rand() % (blitHeight - h);
+			float sx = (float)(rand() % (blitWidth - w));
+			float sy = (float)(rand() % (blitHeight - h));
+
+			destRects.push_back(sw::SliceRect(x, y, x + w, y + h, 0));
+			sourceRects.push_back(sw::SliceRectF(sx, sy, sx + w, sy + h, 0));
+		}
+	}
+
+	// Blits or clears the rectangles one call at a time on one thread, and in a single call on several threads
+	void expectBatchMatchesSingleRects(VkFormat format, bool clear, int count, int maxSize)
+	{
+		int bytes = sw::Surface::bytes(format);
+		int pitchB = blitWidth * bytes;
+		int sliceB = blitHeight * pitchB;
+
+		std::vector<unsigned char> source(sliceB);
+		for(unsigned char &byte : source)
+		{
+			byte = (unsigned char)rand();
+		}
+
+		std::vector<unsigned char> single(sliceB, 0x11);
+		std::vector<unsigned char> batched(sliceB, 0x11);
+
+		std::vector<sw::SliceRect> destRects;
+		std::vector<sw::SliceRectF> sourceRects;
+		randomRects(destRects, sourceRects, count, maxSize);
+
+		float color[4] = {0.25f, 0.5f, 0.75f, 1.0f};
+
+		sw::Blitter blitter;
+		sw::Surface *sourceSurface = sw::Surface::create(blitWidth, blitHeight, 1, format, source.data(), pitchB, sliceB);
+		sw::Surface *singleSurface = sw::Surface::create(blitWidth, blitHeight, 1, format, single.data(), pitchB, sliceB);
+		sw::Surface *batchedSurface = sw::Surface::create(blitWidth, blitHeight, 1, format, batched.data(), pitchB, sliceB);
+
+		sw::threadCount = 1;
+
+		for(int i = 0; i < count; i++)
+		{
+			if(clear)
+			{
+				blitter.clear(color, VK_FORMAT_R32G32B32A32_SFLOAT, singleSurface, destRects[i], 0xF);
+			}
+			else
+			{
+				blitter.blit(sourceSurface, sourceRects[i], singleSurface, destRects[i], {false, false, false});
+			}
+		}
+
+		sw::threadCount = 4;
+
+		if(clear)
+		{
+			blitter.clear(color, VK_FORMAT_R32G32B32A32_SFLOAT, batchedSurface, destRects.data(), count, 0xF);
+		}
+		else
+		{
+			blitter.blit(sourceSurface, sourceRects.data(), batchedSurface, destRects.data(), count, {false, false, false});
+		}
+
+		sw::threadCount = 1;
+
+		// Resolve the internal copies into the external memory
+		singleSurface->lockExternal(0, 0, 0, sw::LOCK_READONLY, sw::PUBLIC);
+		singleSurface->unlockExternal();
+		batchedSurface->lockExternal(0, 0, 0, sw::LOCK_READONLY, sw::PUBLIC);
+		batchedSurface->unlockExternal();
+
+		delete sourceSurface;
+		delete singleSurface;
+		delete batchedSurface;
+
+		EXPECT_EQ(0, memcmp(single.data(), batched.data(), sliceB)) << "Format " << format << (clear ? " clear" : " blit");
+	}
+}
+
+TEST(ASTCDecoderTest, VoidExtent)
+{
+	float rgba[4][4][4];
+	decode(ldrVoidExtent, rgba);
+
+	for(int y = 0; y < 4; y++)
+	{
+		for(int x = 0; x < 4; x++)
+		{
+			EXPECT_EQ(rgba[y][x][0], 0xFFFF * (1.0f / 65535.0f));
+			EXPECT_EQ(rgba[y][x][1], 0x8000 * (1.0f / 65535.0f));
+			EXPECT_EQ(rgba[y][x][2], 0.0f);
+			EXPECT_EQ(rgba[y][x][3], 0x4000 * (1.0f / 65535.0f));
+		}
+	}
+
+	decode(hdrVoidExtent, rgba);
+
+	for(int y = 0; y < 4; y++)
+	{
+		for(int x = 0; x < 4; x++)
+		{
+			EXPECT_EQ(rgba[y][x][0], 1.0f);
+			EXPECT_EQ(rgba[y][x][1], 2.0f);
+			EXPECT_EQ(rgba[y][x][2], 0.5f);
+			EXPECT_EQ(rgba[y][x][3], 1.0f);
+		}
+	}
+}
+
+TEST(ASTCDecoderTest, LuminanceBlock)
+{
+	float rgba[4][4][4];
+	decode(luminanceBlock, rgba);
+
+	for(int y = 0; y < 4; y++)
+	{
+		for(int x = 0; x < 4; x++)
+		{
+			float l = luminanceUNORM16[(x + y) % 4] * (1.0f / 65535.0f);
+
+			EXPECT_EQ(rgba[y][x][0], l) << "x = " << x << ", y = " << y;
+			EXPECT_EQ(rgba[y][x][1], l) << "x = " << x << ", y = " << y;
+			EXPECT_EQ(rgba[y][x][2], l) << "x = " << x << ", y = " << y;
+			EXPECT_EQ(rgba[y][x][3], 1.0f) << "x = " << x << ", y = " << y;
+		}
+	}
+
+	unsigned char bgra[4][4][4];
+	decodeSRGB(luminanceBlock, bgra);
+
+	for(int y = 0; y < 4; y++)
+	{
+		for(int x = 0; x < 4; x++)
+		{
+			unsigned char l = luminanceSRGB8[(x + y) % 4];
+
+			EXPECT_EQ(bgra[y][x][0], l) << "x = " << x << ", y = " << y;
+			EXPECT_EQ(bgra[y][x][1], l) << "x = " << x << ", y = " << y;
+			EXPECT_EQ(bgra[y][x][2], l) << "x = " << x << ", y = " << y;
+			EXPECT_EQ(bgra[y][x][3], 255) << "x = " << x << ", y = " << y;
+		}
+	}
+}
+
+TEST(ASTCDecoderTest, ErrorColor)
+{
+	float rgba[4][4][4];
+	unsigned char bgra[4][4][4];
+
+	// A reserved block mode, and an HDR block in an sRGB image, decode to magenta
+	decode(reservedBlock, rgba);
+	decodeSRGB(hdrVoidExtent, bgra);
+
+	for(int y = 0; y < 4; y++)
+	{
+		for(int x = 0; x < 4; x++)
+		{
+			EXPECT_EQ(rgba[y][x][0], 1.0f);
+			EXPECT_EQ(rgba[y][x][1], 0.0f);
+			EXPECT_EQ(rgba[y][x][2], 1.0f);
+			EXPECT_EQ(rgba[y][x][3], 1.0f);
+
+			EXPECT_EQ(bgra[y][x][0], 255);
+			EXPECT_EQ(bgra[y][x][1], 0);
+			EXPECT_EQ(bgra[y][x][2], 255);
+			EXPECT_EQ(bgra[y][x][3], 255);
+		}
+	}
+
+	// The 4x4 weight grid does not fit in a 4x3 footprint
+	decode(luminanceBlock, rgba, 4, 3);
+
+	for(int y = 0; y < 3; y++)
+	{
+		for(int x = 0; x < 4; x++)
+		{
+			EXPECT_EQ(rgba[y][x][0], 1.0f);
+			EXPECT_EQ(rgba[y][x][1], 0.0f);
+		}
+	}
+}
+
+TEST(ASTCDecoderTest, BlockRows)
+{
+	// A 6x5 image of 4x4 blocks, of which only the second row is decoded, clipped to the image
+	unsigned char image[4][16];
+	memcpy(image[0], reservedBlock, 16);
+	memcpy(image[1], reservedBlock, 16);
+	memcpy(image[2], ldrVoidExtent, 16);
+	memcpy(image[3], luminanceBlock, 16);
+
+	float rgba[6][6][4];
+	memset(rgba, 0, sizeof(rgba));
+
+	ASTC_Decoder::Decode(&image[0][0], reinterpret_cast<unsigned char*>(rgba), 6, 5, 6, 5, 1, 6 * 16, 6 * 6 * 16, 4, 4, 1, false, 1, 1);
+
+	for(int y = 0; y < 6; y++)
+	{
+		for(int x = 0; x < 6; x++)
+		{
+			if(y == 4)
+			{
+				float r = (x < 4) ? 1.0f : luminanceUNORM16[(x - 4) % 4] * (1.0f / 65535.0f);
+				float g = (x < 4) ? 0x8000 * (1.0f / 65535.0f) : r;
+
+				EXPECT_EQ(rgba[y][x][0], r) << "x = " << x;
+				EXPECT_EQ(rgba[y][x][1], g) << "x = " << x;
+			}
+			else
+			{
+				EXPECT_EQ(rgba[y][x][0], 0.0f) << "x = " << x << ", y = " << y;
+				EXPECT_EQ(rgba[y][x][3], 0.0f) << "x = " << x << ", y = " << y;
+			}
+		}
+	}
+}
+
+TEST(ETCDecoderTest, ReferenceBlocks)
+{
+	unsigned char bgra[4][4][4];
+	ETC_Decoder::Decode(etc1Block, &bgra[0][0][0], 4, 4, 4, 4, 4 * 4, 4, ETC_Decoder::ETC_RGB);
+
+	int eac[4][4];
+	int eacMultiplied[4][4];
+	ETC_Decoder::Decode(eacBlock, reinterpret_cast<unsigned char*>(eac), 4, 4, 4, 4, 4 * 4, 4, ETC_Decoder::ETC_R_UNSIGNED);
+	ETC_Decoder::Decode(eacMultipliedBlock, reinterpret_cast<unsigned char*>(eacMultiplied), 4, 4, 4, 4, 4 * 4, 4, ETC_Decoder::ETC_R_UNSIGNED);
+
+	for(int y = 0; y < 4; y++)
+	{
+		for(int x = 0; x < 4; x++)
+		{
+			EXPECT_EQ(bgra[y][x][0], 134) << "x = " << x << ", y = " << y;
+			EXPECT_EQ(bgra[y][x][1], 134) << "x = " << x << ", y = " << y;
+			EXPECT_EQ(bgra[y][x][2], 134) << "x = " << x << ", y = " << y;
+			EXPECT_EQ(bgra[y][x][3], 255) << "x = " << x << ", y = " << y;
+
+			EXPECT_EQ(eac[y][x], 1025) << "x = " << x << ", y = " << y;
+			EXPECT_EQ(eacMultiplied[y][x], 1004) << "x = " << x << ", y = " << y;
+		}
+	}
+}
+
+TEST(ETCDecoderTest, RandomBlocks)
+{
+	const int width = 397;   // Partial blocks on the right and bottom edges
+	const int height = 201;
+
+	struct InputType
+	{
+		ETC_Decoder::InputType type;
+		int blockBytes;
+		int texelBytes;
+		uint64_t hash;   // FNV-1a of the texels decoded by the previous, per-texel decoder
+	};
+
+	const InputType inputTypes[] =
+	{
+		{ETC_Decoder::ETC_R_SIGNED, 8, 4, 0x3D28880CAA05A66Full},
+		{ETC_Decoder::ETC_R_UNSIGNED, 8, 4, 0x73BEAA809FB254DEull},
+		{ETC_Decoder::ETC_RG_SIGNED, 16, 8, 0x62F7ACC7E4BF1F4Full},
+		{ETC_Decoder::ETC_RG_UNSIGNED, 16, 8, 0x743A5EC7DC7BBFC6ull},
+		{ETC_Decoder::ETC_RGB, 8, 4, 0x4048DAB9ECF4F7B3ull},
+		{ETC_Decoder::ETC_RGB_PUNCHTHROUGH_ALPHA, 8, 4, 0xBB01CD3616051583ull},
+		{ETC_Decoder::ETC_RGBA, 16, 4, 0x6886BE5C0F62EE87ull},
+	};
+
+	unsigned int state = 1;
+
+	for(const InputType &inputType : inputTypes)
+	{
+		std::vector<unsigned char> blocks(((width + 3) / 4) * ((height + 3) / 4) * inputType.blockBytes);
+		for(unsigned char &byte : blocks)
+		{
+			byte = randomByte(state);
+		}
+
+		int pitchB = width * inputType.texelBytes;
+		std::vector<unsigned char> vector(pitchB * height);
+		std::vector<unsigned char> scalar(pitchB * height);
+
+		ETC_Decoder::Decode(blocks.data(), vector.data(), width, height, width, height, pitchB, inputType.texelBytes, inputType.type);
+
+		{
+			ScalarPath scalarPath;
+			ETC_Decoder::Decode(blocks.data(), scalar.data(), width, height, width, height, pitchB, inputType.texelBytes, inputType.type);
+		}
+
+		EXPECT_EQ(fnv1a(vector), inputType.hash) << "Input type " << inputType.type;
+		EXPECT_TRUE(vector == scalar) << "Input type " << inputType.type;
+	}
+}
+
+TEST(BlitterTest, BatchedClear)
+{
+	srand(1);
+
+	for(VkFormat format : {VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R16G16B16A16_UNORM, VK_FORMAT_R32G32B32A32_SFLOAT})
+	{
+		expectBatchMatchesSingleRects(format, true, 500, 12);
+		expectBatchMatchesSingleRects(format, true, 20, 190);
+	}
+}
+
+TEST(BlitterTest, BatchedBlit)
+{
+	srand(1);
+
+	for(VkFormat format : {VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R16G16B16A16_UNORM})
+	{
+		expectBatchMatchesSingleRects(format, false, 500, 12);
+		expectBatchMatchesSingleRects(format, false, 20, 190);
+	}
+}
@@ -808,6 +808,415 @@ TEST_F(SwiftShaderTest, ReadHalfFloat)
 	Uninitialize();
 }
 
+// Tests that textures specified from a pixel unpack buffer keep their contents when the buffer changes.
+TEST_F(SwiftShaderTest, UnpackBufferModification)
+{
+	Initialize(3, false);
+
+	const unsigned char red[4] = { 255, 0, 0, 255 };
+	const unsigned char green[4] = { 0, 255, 0, 255 };
+	const unsigned char blue[4] = { 0, 0, 255, 255 };
+	const unsigned char white[4] = { 255, 255, 255, 255 };
+
+	// Even dimensions and tightly packed texels, so the texture can use the buffer's memory
+	const GLsizei size = 16;
+	unsigned char pixels[size * size * 4];
+	for(int i = 0; i < size * size; i++)
+	{
+		memcpy(&pixels[i * 4], red, 4);
+	}
+
+	GLuint buffer = 1;
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, sizeof(pixels), pixels, GL_STATIC_DRAW);
+	EXPECT_GLENUM_EQ(GL_NONE, glGetError());
+
+	GLuint tex = 1;
+	glBindTexture(GL_TEXTURE_2D, tex);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	EXPECT_GLENUM_EQ(GL_NONE, glGetError());
+
+	GLuint fbo = 1;
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+	EXPECT_GLENUM_EQ(GL_NONE, glGetError());
+	EXPECT_GLENUM_EQ(GL_FRAMEBUFFER_COMPLETE, glCheckFramebufferStatus(GL_FRAMEBUFFER));
+
+	// Buffer::bufferSubData()
+	for(int i = 0; i < size * size; i++)
+	{
+		memcpy(&pixels[i * 4], green, 4);
+	}
+
+	glBufferSubData(GL_PIXEL_UNPACK_BUFFER, 0, sizeof(pixels), pixels);
+	EXPECT_GLENUM_EQ(GL_NONE, glGetError());
+
+	expectFramebufferColor(red, 5, 7);
+	expectFramebufferColor(red, size - 1, size - 1);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	EXPECT_GLENUM_EQ(GL_NONE, glGetError());
+
+	// Buffer::mapRange()
+	unsigned char *mapping = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, sizeof(pixels), GL_MAP_WRITE_BIT);
+	EXPECT_GLENUM_EQ(GL_NONE, glGetError());
+	ASSERT_NE(nullptr, mapping);
+
+	for(int i = 0; i < size * size; i++)
+	{
+		memcpy(&mapping[i * 4], blue, 4);
+	}
+
+	EXPECT_EQ(GL_TRUE, glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER));
+
+	expectFramebufferColor(green, 5, 7);
+	expectFramebufferColor(green, size - 1, size - 1);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	EXPECT_GLENUM_EQ(GL_NONE, glGetError());
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	// Context::readPixels() into the buffer, from a white texture
+	GLuint tex2 = 2;
+	glBindTexture(GL_TEXTURE_2D, tex2);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex2, 0);
+	glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	EXPECT_GLENUM_EQ(GL_NONE, glGetError());
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+	glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	EXPECT_GLENUM_EQ(GL_NONE, glGetError());
+
+	mapping = (unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizeof(pixels), GL_MAP_READ_BIT);
+	EXPECT_GLENUM_EQ(GL_NONE, glGetError());
+	ASSERT_NE(nullptr, mapping);
+	EXPECT_EQ(0, memcmp(&mapping[(7 * size + 5) * 4], white, 4));
+	EXPECT_EQ(GL_TRUE, glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+	expectFramebufferColor(blue, 5, 7);
+	expectFramebufferColor(blue, size - 1, size - 1);
+
+	// The buffer is no longer used by the texture, and rendering to the texture leaves the buffer alone
+	glClearColor(1.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	expectFramebufferColor(red, 5, 7);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+	mapping = (unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizeof(pixels), GL_MAP_READ_BIT);
+	ASSERT_NE(nullptr, mapping);
+	EXPECT_EQ(0, memcmp(&mapping[(7 * size + 5) * 4], white, 4));
+	EXPECT_EQ(GL_TRUE, glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	EXPECT_GLENUM_EQ(GL_NONE, glGetError());
+
+	Uninitialize();
+}
+
+// Tests that depth tests against cleared, tightened and raised hierarchical depth bounds match per-pixel results
+TEST_F(SwiftShaderTest, HierarchicalDepth)
+{
+	Initialize(3, false);
+
+	const int size = 70;   // Not a multiple of the hierarchical depth tile width
+
+	GLuint color = 1;
+	glBindRenderbuffer(GL_RENDERBUFFER, color);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size, size);
+
+	GLuint depth = 2;
+	glBindRenderbuffer(GL_RENDERBUFFER, depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, size, size);
+
+	GLuint fbo = 1;
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+	EXPECT_GLENUM_EQ(GL_FRAMEBUFFER_COMPLETE, glCheckFramebufferStatus(GL_FRAMEBUFFER));
+	EXPECT_GLENUM_EQ(GL_NONE, glGetError());
+
+	const std::string vs =
+		"attribute vec4 position;\n"
+		"uniform float depth;\n"
+		"void main()\n"
+		"{\n"
+		"    gl_Position = vec4(position.xy, depth, 1.0);\n"
+		"}\n";
+
+	const std::string fs =
+		"precision mediump float;\n"
+		"uniform vec4 color;\n"
+		"void main()\n"
+		"{\n"
+		"    gl_FragColor = color;\n"
+		"}\n";
+
+	const ProgramHandles ph = createProgram(vs, fs);
+
+	glUseProgram(ph.program);
+	GLint depthLocation = glGetUniformLocation(ph.program, "depth");
+	GLint colorLocation = glGetUniformLocation(ph.program, "color");
+	ASSERT_NE(-1, depthLocation);
+	ASSERT_NE(-1, colorLocation);
+
+	const unsigned char black[4] = { 0, 0, 0, 255 };
+	const unsigned char red[4] = { 255, 0, 0, 255 };
+	const unsigned char green[4] = { 0, 255, 0, 255 };
+	const unsigned char blue[4] = { 0, 0, 255, 255 };
+
+	// Draws a full-screen quad at the given window depth
+	auto draw = [&](float windowDepth, const unsigned char c[4])
+	{
+		glUseProgram(ph.program);
+		glUniform1f(depthLocation, 2.0f * windowDepth - 1.0f);
+		glUniform4f(colorLocation, c[0] / 255.0f, c[1] / 255.0f, c[2] / 255.0f, c[3] / 255.0f);
+		drawQuad(ph.program);
+	};
+
+	auto expectColor = [&](const unsigned char c[4])
+	{
+		expectFramebufferColor(c, 0, 0);
+		expectFramebufferColor(c, 33, 1);
+		expectFramebufferColor(c, size - 1, size - 1);
+	};
+
+	glViewport(0, 0, size, size);
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClearDepthf(0.5f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	draw(0.75f, red);     // Behind the cleared depth
+	expectColor(black);
+
+	draw(0.25f, green);   // In front, lowering the bounds
+	expectColor(green);
+
+	draw(0.375f, blue);   // Between the cleared and the drawn depth
+	expectColor(green);
+
+	// Depth writes with a greater-than comparison must raise the bounds
+	glDepthFunc(GL_GREATER);
+	draw(0.875f, red);
+	expectColor(red);
+
+	glDepthFunc(GL_LESS);
+	draw(0.75f, blue);
+	expectColor(blue);
+
+	// A clear which only partially covers tiles must not lower their bounds
+	glClearDepthf(0.125f);
+	glClear(GL_DEPTH_BUFFER_BIT);
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(0, 0, 21, 21);
+	glClearDepthf(1.0f);
+	glClear(GL_DEPTH_BUFFER_BIT);
+	glDisable(GL_SCISSOR_TEST);
+
+	draw(0.5f, green);
+	expectFramebufferColor(green, 0, 0);
+	expectFramebufferColor(green, 20, 20);
+	expectFramebufferColor(blue, 21, 20);
+	expectFramebufferColor(blue, 20, 21);
+	expectFramebufferColor(blue, size - 1, size - 1);
+
+	// Depth written through other paths discards the bounds
+	float depthData[size * size];
+	for(int i = 0; i < size * size; i++)
+	{
+		depthData[i] = 1.0f;
+	}
+
+	GLuint tex = 1;
+	glBindTexture(GL_TEXTURE_2D, tex);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, depthData);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, tex, 0);
+	EXPECT_GLENUM_EQ(GL_FRAMEBUFFER_COMPLETE, glCheckFramebufferStatus(GL_FRAMEBUFFER));
+
+	glClearDepthf(0.125f);
+	glClear(GL_DEPTH_BUFFER_BIT);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size, size, GL_DEPTH_COMPONENT, GL_FLOAT, depthData);
+
+	draw(0.5f, red);
+	expectColor(red);
+
+	EXPECT_GLENUM_EQ(GL_NONE, glGetError());
+
+	deleteProgram(ph);
+
+	Uninitialize();
+}
+
+// Tests that clears of entire tiles, which are only written on first access, are
+// observed by draws, samplers and reads covering any part of the surface
+TEST_F(SwiftShaderTest, DeferredTileClears)
+{
+	Initialize(3, false);
+
+	const int size = 70;   // Not a multiple of the clear tile size
+
+	GLuint color = 1;
+	glBindTexture(GL_TEXTURE_2D, color);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	GLuint depthStencil = 1;
+	glBindRenderbuffer(GL_RENDERBUFFER, depthStencil);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, size, size);
+
+	GLuint fbo = 1;
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthStencil);
+	EXPECT_GLENUM_EQ(GL_FRAMEBUFFER_COMPLETE, glCheckFramebufferStatus(GL_FRAMEBUFFER));
+	EXPECT_GLENUM_EQ(GL_NONE, glGetError());
+
+	const std::string vs =
+		"attribute vec4 position;\n"
+		"uniform float depth;\n"
+		"void main()\n"
+		"{\n"
+		"    gl_Position = vec4(position.xy, depth, 1.0);\n"
+		"}\n";
+
+	const std::string fs =
+		"precision mediump float;\n"
+		"uniform vec4 color;\n"
+		"void main()\n"
+		"{\n"
+		"    gl_FragColor = color;\n"
+		"}\n";
+
+	const ProgramHandles ph = createProgram(vs, fs);
+
+	glUseProgram(ph.program);
+	GLint depthLocation = glGetUniformLocation(ph.program, "depth");
+	GLint colorLocation = glGetUniformLocation(ph.program, "color");
+	ASSERT_NE(-1, depthLocation);
+	ASSERT_NE(-1, colorLocation);
+
+	const unsigned char black[4] = { 0, 0, 0, 255 };
+	const unsigned char red[4] = { 255, 0, 0, 255 };
+	const unsigned char green[4] = { 0, 255, 0, 255 };
+	const unsigned char blue[4] = { 0, 0, 255, 255 };
+
+	// Draws a quad covering the given pixels, at the given window depth
+	auto draw = [&](int x, int y, int width, int height, float windowDepth, const unsigned char c[4])
+	{
+		glViewport(x, y, width, height);
+		glUseProgram(ph.program);
+		glUniform1f(depthLocation, 2.0f * windowDepth - 1.0f);
+		glUniform4f(colorLocation, c[0] / 255.0f, c[1] / 255.0f, c[2] / 255.0f, c[3] / 255.0f);
+		drawQuad(ph.program);
+		glViewport(0, 0, size, size);
+	};
+
+	// A draw touching only the first tile leaves the others to be filled by the read
+	glClearColor(1.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	draw(0, 0, 20, 20, 0.5f, green);
+
+	expectFramebufferColor(green, 0, 0);
+	expectFramebufferColor(green, 19, 19);
+	expectFramebufferColor(red, 20, 0);
+	expectFramebufferColor(red, 33, 1);
+	expectFramebufferColor(red, size - 1, size - 1);
+
+	// Scissored clears defer the tiles they cover and write the partially covered ones
+	glClearColor(0.0f, 0.0f, 1.0f, 1.0f);
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(16, 16, 50, 50);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glDisable(GL_SCISSOR_TEST);
+
+	expectFramebufferColor(green, 15, 15);
+	expectFramebufferColor(blue, 16, 16);
+	expectFramebufferColor(blue, 40, 40);
+	expectFramebufferColor(blue, 65, 65);
+	expectFramebufferColor(red, 66, 65);
+	expectFramebufferColor(red, 65, 66);
+
+	// The depth and stencil values of tiles first touched by a draw are the cleared ones
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClearDepthf(0.5f);
+	glClearStencil(1);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+	draw(0, 0, 20, 20, 0.25f, green);
+	draw(0, 0, size, size, 0.75f, red);
+
+	expectFramebufferColor(green, 0, 0);
+	expectFramebufferColor(black, 20, 0);
+	expectFramebufferColor(black, 33, 1);
+	expectFramebufferColor(black, size - 1, size - 1);
+
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_STENCIL_TEST);
+	glStencilFunc(GL_EQUAL, 1, 0xFF);
+	draw(0, 0, size, size, 0.5f, blue);
+	glDisable(GL_STENCIL_TEST);
+
+	expectFramebufferColor(blue, 0, 0);
+	expectFramebufferColor(blue, 33, 1);
+	expectFramebufferColor(blue, size - 1, size - 1);
+
+	// Sampling the cleared texture fills it
+	glClearColor(0.0f, 1.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	const std::string vs2 =
+		"attribute vec4 position;\n"
+		"varying vec2 texCoord;\n"
+		"void main()\n"
+		"{\n"
+		"    gl_Position = vec4(position.xy, 0.0, 1.0);\n"
+		"    texCoord = position.xy * 0.5 + 0.5;\n"
+		"}\n";
+
+	const std::string fs2 =
+		"precision mediump float;\n"
+		"uniform sampler2D tex;\n"
+		"varying vec2 texCoord;\n"
+		"void main()\n"
+		"{\n"
+		"    gl_FragColor = texture2D(tex, texCoord);\n"
+		"}\n";
+
+	const ProgramHandles ph2 = createProgram(vs2, fs2);
+
+	GLuint target = 2;
+	glBindRenderbuffer(GL_RENDERBUFFER, target);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size, size);
+
+	GLuint fbo2 = 2;
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo2);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target);
+	EXPECT_GLENUM_EQ(GL_FRAMEBUFFER_COMPLETE, glCheckFramebufferStatus(GL_FRAMEBUFFER));
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, color);
+	drawQuad(ph2.program, "tex");
+
+	expectFramebufferColor(green, 0, 0);
+	expectFramebufferColor(green, 33, 1);
+	expectFramebufferColor(green, size - 1, size - 1);
+
+	EXPECT_GLENUM_EQ(GL_NONE, glGetError());
+
+	deleteProgram(ph2);
+	deleteProgram(ph);
+
+	Uninitialize();
+}
+
 // Tests construction of a structure containing a single matrix
 TEST_F(SwiftShaderTest, MatrixInStruct)
 {
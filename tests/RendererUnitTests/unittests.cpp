@@ -0,0 +1,575 @@
+// Copyright 2019 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit tests of Renderer components which are hard to reach through the OpenGL ES API.
+
+#include "gtest/gtest.h"
+
+#include "Renderer/Blitter.hpp"
+#include "Renderer/ETC_Decoder.hpp"
+#include "Renderer/Surface.hpp"
+#include "Common/CPUID.hpp"
+#include "Common/Math.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+namespace sw
+{
+	extern AtomicInt threadCount;
+}
+
+namespace
+{
+	struct ConvertFormats
+	{
+		sw::Format source;
+		sw::Format dest;   // The internal format selected for the source
+		int tolerance;     // Per 16-bit unit, where Buffer::write() rounds differently
+	};
+
+	// Formats converted by the routines since they replaced the per-texel path of Surface::genericUpdate()
+	const ConvertFormats convertFormats[] =
+	{
+		{sw::FORMAT_X1R5G5B5, sw::FORMAT_X8R8G8B8, 0},
+		{sw::FORMAT_A1R5G5B5, sw::FORMAT_A8R8G8B8, 0},
+		{sw::FORMAT_R5G5B5A1, sw::FORMAT_A8B8G8R8, 0},
+		{sw::FORMAT_X4R4G4B4, sw::FORMAT_X8R8G8B8, 0},
+		{sw::FORMAT_A4R4G4B4, sw::FORMAT_A8R8G8B8, 0},
+		{sw::FORMAT_R4G4B4A4, sw::FORMAT_A8B8G8R8, 0},
+		{sw::FORMAT_A2R10G10B10, sw::FORMAT_A16B16G16R16, 1},   // The float division of Buffer::read() can end one unit high
+		{sw::FORMAT_R16F, sw::FORMAT_R32F, 0},
+		{sw::FORMAT_G16R16F, sw::FORMAT_G32R32F, 0},
+		{sw::FORMAT_B16G16R16F, sw::FORMAT_X32B32G32R32F, 0},
+		{sw::FORMAT_X16B16G16R16F, sw::FORMAT_X32B32G32R32F, 0},
+		{sw::FORMAT_A16B16G16R16F, sw::FORMAT_A32B32G32R32F, 0},
+	};
+
+	bool isHalf(sw::Format format)
+	{
+		switch(format)
+		{
+		case sw::FORMAT_R16F:
+		case sw::FORMAT_G16R16F:
+		case sw::FORMAT_B16G16R16F:
+		case sw::FORMAT_X16B16G16R16F:
+		case sw::FORMAT_A16B16G16R16F:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// Random texels, with finite half-precision values
+	std::vector<unsigned char> randomTexels(sw::Format format, size_t size)
+	{
+		std::vector<unsigned char> texels(size);
+
+		for(size_t i = 0; i < size; i++)
+		{
+			texels[i] = (unsigned char)rand();
+
+			if(isHalf(format) && (i & 1) && (texels[i] & 0x7C) == 0x7C)
+			{
+				texels[i] &= 0xBF;
+			}
+		}
+
+		return texels;
+	}
+
+	// Decodes compressed blocks through Surface::lockInternal() and returns the texels without padding
+	std::vector<unsigned char> decode(sw::Format format, int width, int height, const std::vector<unsigned char> &blocks)
+	{
+		sw::Resource *resource = new sw::Resource(0);
+		sw::Surface *surface = sw::Surface::create(resource, width, height, 1, 0, 1, format, false, false);
+
+		unsigned char *external = (unsigned char*)surface->lockExternal(0, 0, 0, sw::LOCK_WRITEONLY, sw::PUBLIC);
+		memcpy(external, blocks.data(), surface->getExternalSliceB());
+		surface->unlockExternal();
+
+		int pitchB = surface->getInternalPitchB();
+		int rowB = width * sw::Surface::bytes(surface->getInternalFormat());
+
+		std::vector<unsigned char> texels(rowB * height);
+		const unsigned char *internal = (const unsigned char*)surface->lockInternal(0, 0, 0, sw::LOCK_READONLY, sw::PUBLIC);
+		for(int y = 0; y < height; y++)
+		{
+			memcpy(&texels[y * rowB], internal + y * pitchB, rowB);
+		}
+		surface->unlockInternal();
+
+		delete surface;
+		resource->destruct();
+
+		return texels;
+	}
+
+	// Disables SSE2 and the extensions which depend on it, for the lifetime of the object
+	class ScalarPath
+	{
+	public:
+		ScalarPath() : sse3(sw::CPUID::supportsSSE3()), ssse3(sw::CPUID::supportsSSSE3()), sse4_1(sw::CPUID::supportsSSE4_1())
+		{
+			sw::CPUID::setEnableSSE2(false);
+		}
+
+		~ScalarPath()
+		{
+			sw::CPUID::setEnableSSE2(true);
+			sw::CPUID::setEnableSSE3(sse3);
+			sw::CPUID::setEnableSSSE3(ssse3);
+			sw::CPUID::setEnableSSE4_1(sse4_1);
+		}
+
+	private:
+		const bool sse3;
+		const bool ssse3;
+		const bool sse4_1;
+	};
+
+	// Resolves random samples and returns the texels left in the first sample
+	std::vector<unsigned char> resolve(sw::Format format, int width, int height, int samples, int threads)
+	{
+		sw::Resource *resource = new sw::Resource(0);
+		sw::Surface *surface = sw::Surface::create(resource, width, height, 1, 0, samples, format, true, true);
+
+		int pitchB = surface->getInternalPitchB();
+		int sliceB = surface->getInternalSliceB();
+		int rowB = width * sw::Surface::bytes(format);
+
+		srand(3);
+
+		unsigned char *buffer = (unsigned char*)surface->lockInternal(0, 0, 0, sw::LOCK_WRITEONLY, sw::PRIVATE);
+		for(int i = 0; i < sliceB * samples; i += 4)
+		{
+			if(sw::Surface::isFloatFormat(format))
+			{
+				*(float*)(buffer + i) = (float)rand() / RAND_MAX;
+			}
+			else
+			{
+				*(unsigned int*)(buffer + i) = rand() ^ (rand() << 16);
+			}
+		}
+		surface->unlockInternal();
+
+		sw::threadCount = threads;
+
+		std::vector<unsigned char> resolved(rowB * height);
+		const unsigned char *texels = (const unsigned char*)surface->lockInternal(0, 0, 0, sw::LOCK_READONLY, sw::PUBLIC);
+		for(int y = 0; y < height; y++)
+		{
+			memcpy(&resolved[y * rowB], texels + y * pitchB, rowB);
+		}
+		surface->unlockInternal();
+
+		sw::threadCount = 1;
+
+		delete surface;
+		resource->destruct();
+
+		return resolved;
+	}
+
+	// ETC1 block in differential mode, of base color 16 in all channels, which expands to 132. Every pixel
+	// index is 0, which adds 2 in modifier table 0.
+	const unsigned char etc1Block[8] = {0x80, 0x80, 0x80, 0x02, 0x00, 0x00, 0x00, 0x00};
+
+	// EAC R11 blocks of base codeword 128 in modifier table 0, where pixel index 0 selects -3. The 11-bit value
+	// is 8 * 128 + 4 plus the modifier, scaled by 8 * multiplier unless the multiplier is 0.
+	const unsigned char eacBlock[8] = {0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+	const unsigned char eacMultipliedBlock[8] = {0x80, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+	// Xorshift, so that the random blocks don't depend on the C library
+	unsigned char randomByte(unsigned int &state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+
+		return (unsigned char)state;
+	}
+
+	uint64_t fnv1a(const std::vector<unsigned char> &bytes)
+	{
+		uint64_t hash = 0xCBF29CE484222325ull;
+
+		for(unsigned char byte : bytes)
+		{
+			hash = (hash ^ byte) * 0x100000001B3ull;
+		}
+
+		return hash;
+	}
+}
+
+TEST(BlitterTest, ConvertMatchesBuffer)
+{
+	const int width = 67;   // Not a multiple of the vector width of the routines
+	const int height = 5;
+	const int depth = 2;
+
+	sw::Blitter blitter;
+	srand(1);
+
+	for(const ConvertFormats &formats : convertFormats)
+	{
+		int sBytes = sw::Surface::bytes(formats.source);
+		int dBytes = sw::Surface::bytes(formats.dest);
+		int sPitchB = sw::Surface::pitchB(width, 0, formats.source, false);
+		int dPitchB = sw::Surface::pitchB(width, 0, formats.dest, false);
+		int sSliceB = sw::Surface::sliceB(width, height, 0, formats.source, false);
+		int dSliceB = sw::Surface::sliceB(width, height, 0, formats.dest, false);
+
+		std::vector<unsigned char> source = randomTexels(formats.source, sSliceB * depth);
+		std::vector<unsigned char> converted(dSliceB * depth);
+		std::vector<unsigned char> expected(dSliceB * depth);
+
+		ASSERT_TRUE(blitter.convert(converted.data(), formats.dest, dPitchB, dSliceB, source.data(), formats.source, sPitchB, sSliceB, width, height, depth))
+			<< "Format " << (int)formats.source << " to " << (int)formats.dest;
+
+		// Each texel through Buffer::read() and Buffer::write(), like Surface::genericUpdate() without the routine
+		sw::Surface *sourceSurface = sw::Surface::create(width, height, depth, formats.source, source.data(), sPitchB, sSliceB);
+		sw::Surface *expectedSurface = sw::Surface::create(width, height, depth, formats.dest, expected.data(), dPitchB, dSliceB);
+
+		sourceSurface->lockExternal(0, 0, 0, sw::LOCK_READONLY, sw::PUBLIC);
+		expectedSurface->lockExternal(0, 0, 0, sw::LOCK_WRITEONLY, sw::PUBLIC);
+
+		for(int z = 0; z < depth; z++)
+		{
+			for(int y = 0; y < height; y++)
+			{
+				for(int x = 0; x < width; x++)
+				{
+					expectedSurface->writeExternal(x, y, z, sourceSurface->readExternal(x, y, z));
+				}
+			}
+		}
+
+		expectedSurface->unlockExternal();
+		sourceSurface->unlockExternal();
+
+		delete sourceSurface;
+		delete expectedSurface;
+
+		int mismatches = 0;
+
+		for(int z = 0; z < depth; z++)
+		{
+			for(int y = 0; y < height; y++)
+			{
+				for(int x = 0; x < width; x++)
+				{
+					const unsigned char *c = &converted[z * dSliceB + y * dPitchB + x * dBytes];
+					const unsigned char *e = &expected[z * dSliceB + y * dPitchB + x * dBytes];
+					bool match = true;
+
+					if(formats.tolerance == 0)
+					{
+						match = memcmp(c, e, dBytes) == 0;
+					}
+					else
+					{
+						for(int i = 0; i < dBytes; i += 2)
+						{
+							int cValue = c[i] | (c[i + 1] << 8);
+							int eValue = e[i] | (e[i + 1] << 8);
+
+							match = match && abs(cValue - eValue) <= formats.tolerance;
+						}
+					}
+
+					if(!match && mismatches++ < 4)
+					{
+						ADD_FAILURE() << "Format " << (int)formats.source << " to " << (int)formats.dest << " differs at (" << x << ", " << y << ", " << z << ")"
+						              << " for source texel bytes at " << (z * sSliceB + y * sPitchB + x * sBytes);
+					}
+				}
+			}
+		}
+	}
+}
+
+TEST(SurfaceTest, DecodeCacheSmallerThanOneLevel)
+{
+	const int size = 16;
+
+	// Both levels share the texture's resource, like the mipmap levels of an OpenGL texture
+	sw::Resource *texture = new sw::Resource(0);
+	sw::Surface *level0 = sw::Surface::create(texture, size, size, 1, 0, 1, sw::FORMAT_ETC1, false, false);
+	sw::Surface *level1 = sw::Surface::create(texture, size / 2, size / 2, 1, 0, 1, sw::FORMAT_ETC1, false, false);
+
+	srand(2);
+
+	unsigned char *blocks = (unsigned char*)level0->lockExternal(0, 0, 0, sw::LOCK_WRITEONLY, sw::PUBLIC);
+	int blocksSize = level0->getExternalSliceB();
+	for(int i = 0; i < blocksSize; i++)
+	{
+		blocks[i] = (unsigned char)rand();
+	}
+	level0->unlockExternal();
+
+	unsigned char *blocks1 = (unsigned char*)level1->lockExternal(0, 0, 0, sw::LOCK_WRITEONLY, sw::PUBLIC);
+	memset(blocks1, 0, level1->getExternalSliceB());
+	level1->unlockExternal();
+
+	sw::Surface::setDecodeCacheSize(1);
+
+	const unsigned char *texels = (const unsigned char*)level0->lockInternal(0, 0, 0, sw::LOCK_READONLY, sw::PUBLIC);
+	int texelsSize = level0->getInternalSliceB();
+	std::vector<unsigned char> decoded(texels, texels + texelsSize);
+	level0->unlockInternal();
+
+	sw::Surface::nextDecodeEpoch();   // Level 0 was locked for this draw, so it stays
+
+	// Renderer locks of another level must not wait for the resource they hold themselves
+	level1->lockInternal(0, 0, 0, sw::LOCK_READONLY, sw::PRIVATE);
+	sw::Surface::nextDecodeEpoch();   // Level 0's resource is held, so it stays decoded
+	level1->unlockInternal();
+
+	// Blocks changed behind the surface's back only show up once the level was decoded again
+	for(int i = 0; i < blocksSize; i++)
+	{
+		blocks[i] = (unsigned char)rand();
+	}
+
+	texels = (const unsigned char*)level0->lockInternal(0, 0, 0, sw::LOCK_READONLY, sw::PUBLIC);
+	EXPECT_EQ(0, memcmp(texels, decoded.data(), texelsSize));
+	level0->unlockInternal();
+
+	// Levels which no draw locked since the previous one get released
+	sw::Surface::nextDecodeEpoch();
+	sw::Surface::nextDecodeEpoch();
+
+	texels = (const unsigned char*)level0->lockInternal(0, 0, 0, sw::LOCK_READONLY, sw::PUBLIC);
+	EXPECT_NE(0, memcmp(texels, decoded.data(), texelsSize));
+	level0->unlockInternal();
+
+	sw::Surface::setDecodeCacheSize(0);
+
+	delete level0;
+	delete level1;
+	texture->destruct();
+}
+
+TEST(SurfaceTest, BlockDecodeMatchesScalarPath)
+{
+	const sw::Format formats[] = {sw::FORMAT_DXT1, sw::FORMAT_DXT3, sw::FORMAT_DXT5, sw::FORMAT_ATI1, sw::FORMAT_ATI2};
+	const int sizes[][2] = {{1, 1}, {3, 5}, {37, 13}, {66, 7}, {255, 9}};   // Partial blocks on the right and bottom edges
+
+	srand(5);
+
+	for(sw::Format format : formats)
+	{
+		for(const int *size : sizes)
+		{
+			int width = size[0];
+			int height = size[1];
+
+			std::vector<unsigned char> blocks(sw::Surface::sliceB(width, height, 0, format, false));
+			for(unsigned char &byte : blocks)
+			{
+				byte = (unsigned char)rand();
+			}
+
+			std::vector<unsigned char> vector = decode(format, width, height, blocks);
+			ScalarPath scalarPath;
+			std::vector<unsigned char> scalar = decode(format, width, height, blocks);
+
+			EXPECT_TRUE(vector == scalar) << "Format " << (int)format << " at " << width << "x" << height;
+		}
+	}
+
+	// Every pair of endpoints of the alpha, red and green palettes, which get divided through reciprocals
+	const int width = 1021;
+	const int height = 1023;
+
+	std::vector<unsigned char> blocks(sw::Surface::sliceB(width, height, 0, sw::FORMAT_ATI1, false));
+	for(size_t i = 0; i < blocks.size(); i += 8)
+	{
+		blocks[i + 0] = (unsigned char)(i / 8);
+		blocks[i + 1] = (unsigned char)(i / 8 / 256);
+
+		for(int j = 2; j < 8; j++)
+		{
+			blocks[i + j] = (unsigned char)rand();
+		}
+	}
+
+	std::vector<unsigned char> vector = decode(sw::FORMAT_ATI1, width, height, blocks);
+	ScalarPath scalarPath;
+	std::vector<unsigned char> scalar = decode(sw::FORMAT_ATI1, width, height, blocks);
+
+	EXPECT_TRUE(vector == scalar);
+}
+
+TEST(SurfaceTest, ParallelResolveMatchesSerial)
+{
+	// Large enough to be split into several bands, with a last band of fewer rows
+	const int width = 604;   // Not a multiple of 8, for the scalar 16-bit paths
+	const int height = 601;
+
+	const sw::Format formats[] =
+	{
+		sw::FORMAT_A8R8G8B8,
+		sw::FORMAT_SRGB8_A8,
+		sw::FORMAT_G16R16,
+		sw::FORMAT_A16B16G16R16,
+		sw::FORMAT_R32F,
+		sw::FORMAT_G32R32F,
+		sw::FORMAT_A32B32G32R32F,
+		sw::FORMAT_R5G6B5,
+	};
+
+	for(sw::Format format : formats)
+	{
+		for(int samples : {2, 4, 8, 16})
+		{
+			std::vector<unsigned char> serial = resolve(format, width, height, samples, 1);
+			std::vector<unsigned char> parallel = resolve(format, width, height, samples, 4);
+
+			EXPECT_TRUE(serial == parallel) << "Format " << (int)format << " with " << samples << " samples";
+		}
+	}
+}
+
+TEST(SurfaceTest, ResolveAveragesSRGBInLinearSpace)
+{
+	const int width = 33;
+	const int height = 7;
+	const int samples = 4;
+
+	sw::Resource *resource = new sw::Resource(0);
+	sw::Surface *surface = sw::Surface::create(resource, width, height, 1, 0, samples, sw::FORMAT_SRGB8_A8, true, true);
+
+	int pitchB = surface->getInternalPitchB();
+	int sliceB = surface->getInternalSliceB();
+
+	srand(4);
+
+	unsigned char *buffer = (unsigned char*)surface->lockInternal(0, 0, 0, sw::LOCK_WRITEONLY, sw::PRIVATE);
+	for(int i = 0; i < sliceB * samples; i++)
+	{
+		buffer[i] = (unsigned char)rand();
+	}
+	std::vector<unsigned char> samplesCopy(buffer, buffer + sliceB * samples);
+	surface->unlockInternal();
+
+	const unsigned char *texels = (const unsigned char*)surface->lockInternal(0, 0, 0, sw::LOCK_READONLY, sw::PUBLIC);
+
+	for(int y = 0; y < height; y++)
+	{
+		for(int x = 0; x < width; x++)
+		{
+			for(int c = 0; c < 4; c++)
+			{
+				float sum = 0.0f;
+
+				for(int s = 0; s < samples; s++)
+				{
+					float value = samplesCopy[s * sliceB + y * pitchB + 4 * x + c] / 255.0f;
+					sum += (c < 3) ? sw::sRGBtoLinear(value) : value;   // Alpha is linear
+				}
+
+				float average = sum / samples;
+				int expected = (int)(((c < 3) ? sw::linearToSRGB(average) : average) * 255.0f + 0.5f);
+
+				EXPECT_NEAR(expected, texels[y * pitchB + 4 * x + c], 1) << "At (" << x << ", " << y << ") channel " << c;
+			}
+		}
+	}
+
+	surface->unlockInternal();
+
+	delete surface;
+	resource->destruct();
+}
+
+TEST(ETCDecoderTest, ReferenceBlocks)
+{
+	unsigned char bgra[4][4][4];
+	ETC_Decoder::Decode(etc1Block, &bgra[0][0][0], 4, 4, 4, 4, 4 * 4, 4, ETC_Decoder::ETC_RGB);
+
+	int eac[4][4];
+	int eacMultiplied[4][4];
+	ETC_Decoder::Decode(eacBlock, reinterpret_cast<unsigned char*>(eac), 4, 4, 4, 4, 4 * 4, 4, ETC_Decoder::ETC_R_UNSIGNED);
+	ETC_Decoder::Decode(eacMultipliedBlock, reinterpret_cast<unsigned char*>(eacMultiplied), 4, 4, 4, 4, 4 * 4, 4, ETC_Decoder::ETC_R_UNSIGNED);
+
+	for(int y = 0; y < 4; y++)
+	{
+		for(int x = 0; x < 4; x++)
+		{
+			EXPECT_EQ(bgra[y][x][0], 134) << "x = " << x << ", y = " << y;
+			EXPECT_EQ(bgra[y][x][1], 134) << "x = " << x << ", y = " << y;
+			EXPECT_EQ(bgra[y][x][2], 134) << "x = " << x << ", y = " << y;
+			EXPECT_EQ(bgra[y][x][3], 255) << "x = " << x << ", y = " << y;
+
+			EXPECT_EQ(eac[y][x], 1025) << "x = " << x << ", y = " << y;
+			EXPECT_EQ(eacMultiplied[y][x], 1004) << "x = " << x << ", y = " << y;
+		}
+	}
+}
+
+TEST(ETCDecoderTest, RandomBlocks)
+{
+	const int width = 397;   // Partial blocks on the right and bottom edges
+	const int height = 201;
+
+	struct InputType
+	{
+		ETC_Decoder::InputType type;
+		int blockBytes;
+		int texelBytes;
+		uint64_t hash;   // FNV-1a of the texels decoded by the previous, per-texel decoder
+	};
+
+	const InputType inputTypes[] =
+	{
+		{ETC_Decoder::ETC_R_SIGNED, 8, 4, 0x3D28880CAA05A66Full},
+		{ETC_Decoder::ETC_R_UNSIGNED, 8, 4, 0x73BEAA809FB254DEull},
+		{ETC_Decoder::ETC_RG_SIGNED, 16, 8, 0x62F7ACC7E4BF1F4Full},
+		{ETC_Decoder::ETC_RG_UNSIGNED, 16, 8, 0x743A5EC7DC7BBFC6ull},
+		{ETC_Decoder::ETC_RGB, 8, 4, 0x4048DAB9ECF4F7B3ull},
+		{ETC_Decoder::ETC_RGB_PUNCHTHROUGH_ALPHA, 8, 4, 0xBB01CD3616051583ull},
+		{ETC_Decoder::ETC_RGBA, 16, 4, 0x6886BE5C0F62EE87ull},
+	};
+
+	unsigned int state = 1;
+
+	for(const InputType &inputType : inputTypes)
+	{
+		std::vector<unsigned char> blocks(((width + 3) / 4) * ((height + 3) / 4) * inputType.blockBytes);
+		for(unsigned char &byte : blocks)
+		{
+			byte = randomByte(state);
+		}
+
+		int pitchB = width * inputType.texelBytes;
+		std::vector<unsigned char> vector(pitchB * height);
+		std::vector<unsigned char> scalar(pitchB * height);
+
+		ETC_Decoder::Decode(blocks.data(), vector.data(), width, height, width, height, pitchB, inputType.texelBytes, inputType.type);
+
+		{
+			ScalarPath scalarPath;
+			ETC_Decoder::Decode(blocks.data(), scalar.data(), width, height, width, height, pitchB, inputType.texelBytes, inputType.type);
+		}
+
+		EXPECT_EQ(fnv1a(vector), inputType.hash) << "Input type " << inputType.type;
+		EXPECT_TRUE(vector == scalar) << "Input type " << inputType.type;
+	}
+}